@@ -21,6 +21,9 @@ win32-msvc* {
     QMAKE_CXXFLAGS += /utf-8
 }
 
+# 共享置换表使用 POSIX shm_open
+unix:!macx: LIBS += -lrt
+
 SOURCES += \
     src/main.cpp \
     src/boarditem.cpp \
@@ -28,7 +31,18 @@ SOURCES += \
     src/gamescene.cpp \
     src/gameview.cpp \
     src/ninechess.cpp \
+    src/ninechess_position.cpp \
     src/ninechess_ai_ab.cpp \
+    src/ninechess_ai_engine.cpp \
+    src/ninechess_ai_mcts.cpp \
+    src/ninechess_ai_nnue.cpp \
+    src/ninechess_ai_weights.cpp \
+    src/ninechess_endgame.cpp \
+    src/ninechess_mappedfile.cpp \
+    src/ninechess_sharedtt.cpp \
+    src/ninechess_book.cpp \
+    src/ninechess_solver.cpp \
+    src/ninechess_batch.cpp \
     src/ninechesswindow.cpp \
     src/pieceitem.cpp \
     src/aithread.cpp
@@ -40,7 +54,19 @@ HEADERS  += \
     src/graphicsconst.h \
     src/ninechess_common.h \
     src/ninechess.h \
+    src/ninechess_position.h \
+    src/ninechess_rule_traits.h \
     src/ninechess_ai_ab.h \
+    src/ninechess_ai_engine.h \
+    src/ninechess_ai_mcts.h \
+    src/ninechess_ai_nnue.h \
+    src/ninechess_ai_weights.h \
+    src/ninechess_endgame.h \
+    src/ninechess_mappedfile.h \
+    src/ninechess_sharedtt.h \
+    src/ninechess_book.h \
+    src/ninechess_solver.h \
+    src/ninechess_batch.h \
     src/ninechesswindow.h \
     src/pieceitem.h \
     src/manuallistview.h \
@@ -3,8 +3,12 @@
 
 AiThread::AiThread(int id, QObject *parent) : QThread(parent),
     waiting_(false),
+    chess(nullptr),
+    ai(createAiEngine(AI_ENGINE_ALPHA_BETA)),
+    engineType(AI_ENGINE_ALPHA_BETA),
     aiDepth(8),
-    aiTime(10)
+    aiTime(10),
+    stepsLimit(0)
 {
     this->id = id;
     // 连接定时器启动，减去118毫秒的返回时间
@@ -26,7 +30,7 @@ void AiThread::setAi(const NineChess &chess)
 {
     mutex.lock();
     this->chess = &chess;
-    ai_ab.setChess(*(this->chess));
+    ai->setChess(*(this->chess));
     mutex.unlock();
 }
 
@@ -34,12 +38,31 @@ void AiThread::setAi(const NineChess &chess, int depth, int time)
 {
     mutex.lock();
     this->chess = &chess;
-    ai_ab.setChess(chess);
+    ai->setChess(chess);
     aiDepth = depth;
     aiTime = time;
     mutex.unlock();
 }
 
+void AiThread::setStepsLimit(int steps)
+{
+    mutex.lock();
+    stepsLimit = steps;
+    mutex.unlock();
+}
+
+void AiThread::setEngine(AiEngineType type)
+{
+    mutex.lock();
+    if (type != engineType) {
+        engineType = type;
+        ai = createAiEngine(type);
+        if (chess != nullptr)
+            ai->setChess(*chess);
+    }
+    mutex.unlock();
+}
+
 void AiThread::run()
 {
     // 测试用数据
@@ -64,18 +87,22 @@ void AiThread::run()
             continue;
         }
 
-        ai_ab.setChess(*chess);
+        ai->setChess(*chess);
+        if (stepsLimit > 0) {
+            const int played = static_cast<int>(chess->getHistorySize());
+            ai->setRemainingSteps(stepsLimit > played ? stepsLimit - played : 1);
+        }
         emit calcStarted();
         mutex.unlock();
 
-        ai_ab.alphaBetaPruning(aiDepth);
+        ai->think(aiDepth);
 
         // 检查是否因 pause() 而被强制中断，若是则不发出招法，避免在人类回合发出 AI 指令
         mutex.lock();
         bool wasPaused = waiting_;
         mutex.unlock();
 
-        const char * str = ai_ab.bestMove();
+        const char * str = ai->bestMove();
         qDebug() << str;
         if (!wasPaused && strcmp(str, "error!"))
             emit command(str);
@@ -99,7 +126,7 @@ void AiThread::act()
 
     mutex.lock();
     waiting_ = false;
-    ai_ab.quit();
+    ai->quit();
     mutex.unlock();
 }
 
@@ -108,7 +135,7 @@ void AiThread::pause()
     mutex.lock();
     waiting_ = true;
     // 同时中断正在进行的搜索，防止搜索完成后仍然 emit command
-    ai_ab.quit();
+    ai->quit();
     mutex.unlock();
 }
 
@@ -129,7 +156,7 @@ void AiThread::stop()
         requestInterruption();
         mutex.lock();
         waiting_ = false;
-        ai_ab.quit();
+        ai->quit();
         pauseCondition.wakeAll();
         mutex.unlock();
     }
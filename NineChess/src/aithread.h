@@ -4,8 +4,9 @@
 #include <QMutex>
 #include <QWaitCondition>
 #include <QTimer>
+#include <memory>
 #include "ninechess.h"
-#include "ninechess_ai_ab.h"
+#include "ninechess_ai_engine.h"
 
 class AiThread : public QThread
 {
@@ -29,8 +30,13 @@ public:
     // AI 设置
     void setAi(const NineChess &chess);
     void setAi(const NineChess &chess, int depth, int time);
+    // 限步（0 为不限），AI 据此避开走不完的取胜线路
+    void setStepsLimit(int steps);
     // 深度和限时
     void getDepthTime(int &depth, int &time) { depth = aiDepth; time = aiTime; }
+    // 切换 AI 后端，需在线程停止时调用
+    void setEngine(AiEngineType type);
+    AiEngineType getEngine() const { return engineType; }
 
 public slots:
     // 强制出招，不退出线程
@@ -54,12 +60,16 @@ private:
 
     // 主线程棋对象的引用
     const NineChess *chess;
-    // Alpha-Beta剪枝算法类
-    NineChess_AI_AB ai_ab;
+    // AI 引擎（Alpha-Beta 或 MCTS）
+    std::unique_ptr<NineChess_AI_Engine> ai;
+    // 当前引擎类型
+    AiEngineType engineType;
     // AI的层数
     int aiDepth;
     // AI的限时
     int aiTime;
+    // 对局限步
+    int stepsLimit;
     // 定时器
     QTimer timer;
 };
@@ -18,6 +18,7 @@
 #include <QVector>
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include "gamecontroller.h"
 #include "boarditem.h"
 
@@ -27,6 +28,9 @@ constexpr int kPieceInHand = -1;
 constexpr int kPieceCaptured = -2;
 constexpr int kPieceUnassigned = -3;
 
+// 棋谱浏览检查点的间隔步数，跳到任意一行最多从检查点重放这么多步。
+constexpr int kManualCheckpointInterval = 32;
+
 QVector<int> collectBoardPositions(uint32_t boardMask)
 {
     QVector<int> positions;
@@ -223,6 +227,8 @@ GameController::GameController(GameScene &scene, QObject *parent) : QObject(pare
     soundCache["win"]->setSource(QUrl("qrc:/sound/resources/sound/win.wav"));
 
     gameReset();
+    ai1.setStepsLimit(stepsLimit);
+    ai2.setStepsLimit(stepsLimit);
     
     connect(&ai1, &AiThread::calcStarted, this, &GameController::onAiCalcStarted);
     connect(&ai2, &AiThread::calcStarted, this, &GameController::onAiCalcStarted);
@@ -525,8 +531,8 @@ void GameController::refreshTimeDisplays()
 
 void GameController::syncManualListFromChess()
 {
-    const std::vector<std::string>* cmdList = chess.getCmdList();
-    const int cmdCount = static_cast<int>(cmdList->size());
+    const std::vector<NineChess::MoveRecord>& history = chess.getMoveHistory();
+    const int cmdCount = static_cast<int>(history.size());
 
     // 没有棋谱时，只保留第 0 行显示当前命令文本。
     if (cmdCount <= 0)
@@ -534,7 +540,7 @@ void GameController::syncManualListFromChess()
         if (manualListModel.rowCount() <= 0) {
             manualListModel.insertRow(0);
         }
-        manualListModel.setData(manualListModel.index(0), chess.getCmdLine());
+        manualListModel.setData(manualListModel.index(0), QString::fromStdString(chess.getCmdLine()));
         currentRow = 0;
         return;
     }
@@ -544,13 +550,15 @@ void GameController::syncManualListFromChess()
     {
         manualListModel.insertRow(0);
     }
-    manualListModel.setData(manualListModel.index(0), cmdList->front().c_str());
+    manualListModel.setData(manualListModel.index(0),
+        QString::fromStdString(NineChess::formatMoveRecord(history.front())));
 
     // 后续只追加新增的棋谱行，避免 removeRows() + 全量插回去。
     for (int row = manualListModel.rowCount(); row < cmdCount; ++row)
     {
         manualListModel.insertRow(row);
-        manualListModel.setData(manualListModel.index(row), cmdList->at(row).c_str());
+        manualListModel.setData(manualListModel.index(row),
+            QString::fromStdString(NineChess::formatMoveRecord(history[row])));
     }
 
     currentRow = cmdCount - 1;
@@ -602,7 +610,7 @@ bool GameController::applyStepLimit(NineChess::Players previousTurn)
     if (stepsLimit <= 0 || chess.whoWin() != NineChess::NOBODY) {
         return false;
     }
-    if (static_cast<int>(chess.getCmdList()->size()) < stepsLimit) {
+    if (static_cast<int>(chess.getHistorySize()) < stepsLimit) {
         return false;
     }
 
@@ -673,6 +681,7 @@ void GameController::gameStart()
     chess.start();
     advanceGameStateRevision();
     chessTemp = chess;
+    dropManualCheckpoints();
     restartTurnClock();
     // 每隔100毫秒调用一次定时器处理函数
     if (timeID == 0) {
@@ -692,6 +701,7 @@ void GameController::gameReset()
     chess.reset();
     advanceGameStateRevision();
     chessTemp = chess;
+    dropManualCheckpoints();
     resetClockState();
 
     // 停掉线程
@@ -750,7 +760,7 @@ void GameController::gameReset()
     // 更新棋谱
     manualListModel.removeRows(0, manualListModel.rowCount());
     manualListModel.insertRow(0);
-    manualListModel.setData(manualListModel.index(0), chess.getCmdLine());
+    manualListModel.setData(manualListModel.index(0), QString::fromStdString(chess.getCmdLine()));
     currentRow = 0;
     // 发信号更新状态栏
     message = QString::fromStdString(chess.getTip());
@@ -799,10 +809,13 @@ void GameController::setRule(int ruleNo, int stepLimited, int timeLimited)
     if (stepLimited != -1 && timeLimited != -1) {
         stepsLimit = stepLimited;
         timeLimit = timeLimited;
+        ai1.setStepsLimit(stepsLimit);
+        ai2.setStepsLimit(stepsLimit);
     }
     // 设置模型规则，重置游戏
     chess.setRule(static_cast<uint32_t>(ruleNo));
     chessTemp = chess;
+    dropManualCheckpoints();
 
     // 重置游戏
     gameReset();
@@ -870,6 +883,38 @@ void GameController::getAiDepthTime(int &depth1, int &time1, int &depth2, int &t
     ai2.getDepthTime(depth2, time2);
 }
 
+// 设置双方AI引擎
+void GameController::setAiEngine(AiEngineType engine1, AiEngineType engine2)
+{
+    if (isEngine1) {
+        ai1.stop();
+        ai1.wait();
+    }
+    if (isEngine2) {
+        ai2.stop();
+        ai2.wait();
+    }
+
+    ai1.setEngine(engine1);
+    ai2.setEngine(engine2);
+    ai1.setAi(chess);
+    ai2.setAi(chess);
+
+    if (isEngine1) {
+        ai1.start();
+    }
+    if (isEngine2) {
+        ai2.start();
+    }
+}
+
+// 获取双方AI引擎
+void GameController::getAiEngine(AiEngineType &engine1, AiEngineType &engine2)
+{
+    engine1 = ai1.getEngine();
+    engine2 = ai2.getEngine();
+}
+
 // 设置是否有落子动画
 void GameController::setAnimation(bool arg)
 {
@@ -913,10 +958,12 @@ void GameController::flip()
     chess.rotate(180);
     advanceGameStateRevision();
     chessTemp = chess;
+    dropManualCheckpoints();
     // 更新棋谱
     int row = 0;
-    for (auto str : *(chess.getCmdList())) {
-        manualListModel.setData(manualListModel.index(row++), str.c_str());
+    for (const NineChess::MoveRecord record : chess.getMoveHistory()) {
+        manualListModel.setData(manualListModel.index(row++),
+            QString::fromStdString(NineChess::formatMoveRecord(record)));
     }
     // 刷新显示
     if (currentRow == row - 1)
@@ -949,10 +996,12 @@ void GameController::mirror()
     chess.mirror();
     advanceGameStateRevision();
     chessTemp = chess;
+    dropManualCheckpoints();
     // 更新棋谱
     int row = 0;
-    for (auto str : *(chess.getCmdList())) {
-        manualListModel.setData(manualListModel.index(row++), str.c_str());
+    for (const NineChess::MoveRecord record : chess.getMoveHistory()) {
+        manualListModel.setData(manualListModel.index(row++),
+            QString::fromStdString(NineChess::formatMoveRecord(record)));
     }
     qDebug() << "list: " << row;
     // 刷新显示
@@ -986,10 +1035,12 @@ void GameController::turnRight()
     chess.rotate(-90);
     advanceGameStateRevision();
     chessTemp = chess;
+    dropManualCheckpoints();
     // 更新棋谱
     int row = 0;
-    for (auto str : *(chess.getCmdList())) {
-        manualListModel.setData(manualListModel.index(row++), str.c_str());
+    for (const NineChess::MoveRecord record : chess.getMoveHistory()) {
+        manualListModel.setData(manualListModel.index(row++),
+            QString::fromStdString(NineChess::formatMoveRecord(record)));
     }
     // 刷新显示
     if (currentRow == row - 1)
@@ -1022,10 +1073,12 @@ void GameController::turnLeft()
     chess.rotate(90);
     advanceGameStateRevision();
     chessTemp = chess;
+    dropManualCheckpoints();
     // 更新棋谱
     int row = 0;
-    for (auto str : *(chess.getCmdList())) {
-        manualListModel.setData(manualListModel.index(row++), str.c_str());
+    for (const NineChess::MoveRecord record : chess.getMoveHistory()) {
+        manualListModel.setData(manualListModel.index(row++),
+            QString::fromStdString(NineChess::formatMoveRecord(record)));
     }
     // 刷新显示
     if (currentRow == row - 1)
@@ -1125,6 +1178,7 @@ bool GameController::actionPiece(QPointF pos)
         {
             chess = chessTemp;
             advanceGameStateRevision();
+            dropManualCheckpoints(static_cast<int>(chess.getHistorySize()));
             manualListModel.removeRows(currentRow + 1, manualListModel.rowCount() - currentRow - 1);
             // 如果再决出胜负后悔棋，则重新启动计时
             if (chess.whoWin() == NineChess::NOBODY) {
@@ -1246,6 +1300,23 @@ bool GameController::giveUp()
     return result;
 }
 
+// 导入棋谱：不经过命令文本，逐条执行记录
+size_t GameController::playManual(const std::vector<NineChess::MoveRecord> &moves)
+{
+    size_t played = 0;
+    while (played < moves.size() && chess.playMoveRecord(moves[played]))
+        ++played;
+
+    if (played > 0)
+    {
+        advanceGameStateRevision();
+        syncManualListFromChess();
+        message = QString::fromStdString(chess.getTip());
+        emit statusBarChanged(message);
+    }
+    return played;
+}
+
 // 执行棋谱命令（供AI调用）
 bool GameController::command(const QString &cmd, bool update)
 {
@@ -1293,18 +1364,19 @@ bool GameController::phaseChange(int row, bool forceUpdate)
 
     // 需要刷新
     currentRow = row;
-    int rows = manualListModel.rowCount();
-    QStringList mlist = manualListModel.stringList();
-    chessTemp.setRule(chess.getRuleIndex());
-    qDebug() << "rows:" << rows << " current:" << row;
-    // row 是当前要显示的棋谱行，所以回放时必须包含这一行。
-    for (int i = 0; i <= row; i++)
+    const std::vector<NineChess::MoveRecord>& history = chess.getMoveHistory();
+
+    // 棋谱行与 chess 的命令历史一一对应，row 是当前要显示的棋谱行，所以必须包含这一行。
+    if (row >= 0 && row < static_cast<int>(history.size()))
     {
-        qDebug() << mlist.at(i);
+        seekManual(row);
         previousStatus = chessTemp.getStatus();
         previousSelectedPos = chessTemp.getCurrentPos();
-        soundAction = soundActionFromCommand(mlist.at(i), previousStatus);
-        chessTemp.command(mlist.at(i).toStdString().c_str());
+        soundAction = soundActionFromRecord(history[row], previousStatus);
+        seekManual(row + 1);
+    }
+    else {
+        seekManual(0);
     }
 
     // 刷新棋局场景
@@ -1313,6 +1385,64 @@ bool GameController::phaseChange(int row, bool forceUpdate)
     return true;
 }
 
+// 把 chessTemp 移到第 ply 步。
+// 从 chessTemp 当前步、最近的检查点和 chess 末尾三者中选走得最少的起点，
+// 向前执行 chess 的历史记录，向后撤销，经过整倍数步时补存检查点。
+void GameController::seekManual(int ply)
+{
+    const std::vector<NineChess::MoveRecord>& history = chess.getMoveHistory();
+    ply = std::max(0, std::min(ply, static_cast<int>(history.size())));
+
+    int current = static_cast<int>(chessTemp.getHistorySize());
+    if (chessTemp.getRuleIndex() != chess.getRuleIndex() || current > static_cast<int>(history.size())) {
+        chessTemp = chess;
+        current = static_cast<int>(history.size());
+    }
+
+    int cost = std::abs(current - ply);
+    auto checkpoint = manualCheckpoints.upperBound(ply);
+    if (checkpoint != manualCheckpoints.begin()) {
+        --checkpoint;
+        if (ply - checkpoint.key() < cost) {
+            chessTemp = checkpoint.value();
+            current = checkpoint.key();
+            cost = ply - current;
+        }
+    }
+    if (static_cast<int>(history.size()) - ply < cost) {
+        chessTemp = chess;
+        current = static_cast<int>(history.size());
+    }
+
+    while (current != ply) {
+        if (current < ply) {
+            if (!chessTemp.playMoveRecord(history[current])) {
+                break;
+            }
+            ++current;
+        }
+        else {
+            if (!chessTemp.seek(static_cast<size_t>(current - 1))) {
+                break;
+            }
+            --current;
+        }
+
+        if (current % kManualCheckpointInterval == 0 && !manualCheckpoints.contains(current)) {
+            manualCheckpoints.insert(current, chessTemp);
+        }
+    }
+}
+
+// 作废 keepPly 步之后的检查点，keepPly 为 -1 时全部作废。
+void GameController::dropManualCheckpoints(int keepPly)
+{
+    auto it = manualCheckpoints.upperBound(keepPly);
+    while (it != manualCheckpoints.end()) {
+        it = manualCheckpoints.erase(it);
+    }
+}
+
 // ==================== 音效与显示更新 ====================
 // 播放动作音效
 GameController::SoundAction GameController::soundActionFromCommand(const QString &cmd,
@@ -1345,6 +1475,36 @@ GameController::SoundAction GameController::soundActionFromCommand(const QString
     return SoundAction::Place;
 }
 
+GameController::SoundAction GameController::soundActionFromRecord(NineChess::MoveRecord record,
+    uint16_t previousStatus)
+{
+    switch (getMoveRecordType(record))
+    {
+    case MOVE_RECORD_MOVE:
+        return SoundAction::Place;
+    case MOVE_RECORD_CAPTURE:
+        return SoundAction::Capture;
+    case MOVE_RECORD_GIVEUP_PLAYER1:
+    case MOVE_RECORD_GIVEUP_PLAYER2:
+    case MOVE_RECORD_DRAW:
+        return SoundAction::GameOver;
+    case MOVE_RECORD_POINT:
+        break;
+    default:
+        return SoundAction::NewGame;
+    }
+
+    const uint16_t previousAction = previousStatus
+        & (NineChess::ACTION_CHOOSE | NineChess::ACTION_PLACE | NineChess::ACTION_CAPTURE);
+    if (previousAction == NineChess::ACTION_CAPTURE) {
+        return SoundAction::Capture;
+    }
+    if (previousAction == NineChess::ACTION_CHOOSE) {
+        return SoundAction::Choose;
+    }
+    return SoundAction::Place;
+}
+
 void GameController::playActionSound(SoundAction action, bool succeeded,
     uint16_t previousStatus, int32_t previousSelectedPos, const NineChess* chess)
 {
@@ -40,6 +40,8 @@ public:
 
     void setAiDepthTime(int depth1, int time1, int depth2, int time2);
     void getAiDepthTime(int &depth1, int &time1, int &depth2, int &time2);
+    void setAiEngine(AiEngineType engine1, AiEngineType engine2);
+    void getAiEngine(AiEngineType &engine1, AiEngineType &engine2);
 
 signals:
     void time1Changed(const QString &time);
@@ -69,6 +71,9 @@ public slots:
     bool actionPiece(QPointF p);
     bool giveUp();
     bool command(const QString &cmd, bool update = true);
+    // 导入整份已解码的棋谱：依次执行记录，不刷新场景，结束后只同步一次棋谱列表。
+    // 遇到无法执行的记录时停止，返回已执行的记录数。
+    size_t playManual(const std::vector<NineChess::MoveRecord> &moves);
     bool phaseChange(int row, bool forceUpdate = false);
 
     void updateScence(const NineChess* chess = nullptr);
@@ -114,10 +119,13 @@ private:
     void finishTurnClock(NineChess::Players finishedTurn);
     void getElapsedTimesMS(int &elapsed1, int &elapsed2) const;
     static SoundAction soundActionFromCommand(const QString &cmd, uint16_t previousStatus);
+    static SoundAction soundActionFromRecord(NineChess::MoveRecord record, uint16_t previousStatus);
     void playActionSound(SoundAction action, bool succeeded = true,
         uint16_t previousStatus = 0, int32_t previousSelectedPos = -1,
         const NineChess* chess = nullptr);
     void syncManualListFromChess();
+    void seekManual(int ply);
+    void dropManualCheckpoints(int keepPly = -1);
     void syncAiState();
     void emitPieceCountsChanged(const NineChess* chess = nullptr);
     bool applyStepLimit(NineChess::Players previousTurn);
@@ -163,4 +171,9 @@ private:
     AiDispatchState aiDispatch1;
     AiDispatchState aiDispatch2;
     uint64_t gameStateRevision = 0;
+
+    // 棋谱浏览的检查点：键为步数（kManualCheckpointInterval 的倍数），值为该步的局面。
+    // 浏览经过时才补存。chessTemp 与检查点都在 chess 的历史线上，
+    // 追加新招不影响它们，历史分叉（重开、换规则、变换、从历史局面续下）时作废。
+    QMap<int, NineChess> manualCheckpoints;
 };
@@ -1,11 +1,38 @@
 #include "ninechesswindow.h"
+#include "ninechess_ai_ab.h"
 #include <QtWidgets/QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    NineChessWindow w;
-    w.show();
-    return a.exec();
+    // 程序目录下若有调参工具生成的权重文件，则在创建 AI 线程前载入；没有时沿用内置权重。
+    NineChess_AI_AB::loadEvalWeights(
+        (QCoreApplication::applicationDirPath() + "/ninechess_weights.txt").toLocal8Bit().toStdString());
+    // 同目录下的 ninechess_rule<N>.nnue 为对应规则的神经网络权重，存在时该规则改用网络估值。
+    for (uint32_t rule = 0; rule < RULE_COUNT; ++rule) {
+        NineChess_AI_AB::loadNeuralNetwork(rule, (QCoreApplication::applicationDirPath()
+            + QString("/ninechess_rule%1.nnue").arg(rule)).toLocal8Bit().toStdString());
+        // endgame 子目录下的残局库文件只对支持的规则（0 与 3）生效。
+        NineChess_AI_AB::loadEndgameDatabase(rule,
+            (QCoreApplication::applicationDirPath() + "/endgame").toLocal8Bit().toStdString());
+        // 同目录下的 ninechess_rule<N>.book 为对应规则的开局库。
+        NineChess_AI_AB::loadOpeningBook(rule, (QCoreApplication::applicationDirPath()
+            + QString("/ninechess_rule%1.book").arg(rule)).toLocal8Bit().toStdString());
+        // ninechess_rule<N>.tt 为上次退出时保存的置换表快照。
+        NineChess_AI_AB::loadTranspositionTable(rule, (QCoreApplication::applicationDirPath()
+            + QString("/ninechess_rule%1.tt").arg(rule)).toLocal8Bit().toStdString());
+    }
+    int result = 0;
+    {
+        NineChessWindow w;
+        w.show();
+        result = a.exec();
+    }
+    // 窗口析构时 AI 线程已经停止，这时保存置换表不会与搜索争用。
+    for (uint32_t rule = 0; rule < RULE_COUNT; ++rule) {
+        NineChess_AI_AB::saveTranspositionTable(rule, (QCoreApplication::applicationDirPath()
+            + QString("/ninechess_rule%1.tt").arg(rule)).toLocal8Bit().toStdString());
+    }
+    return result;
 }
 
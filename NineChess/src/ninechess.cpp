@@ -11,10 +11,100 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <mutex>
 #include <sstream>
 
 namespace {
 
+// 局面编号使用的等价变换数，编号方式与 NineChess::symmetryPos 相同。
+constexpr size_t RANK_SYMMETRY_COUNT = 16;
+
+struct RankTables {
+    // byteMaps[t][k][b]：棋盘第 k 个字节为 b 时，经变换 t 后对应的位棋盘。
+    uint32_t byteMaps[RANK_SYMMETRY_COUNT][3][256] = {};
+
+    // reps[n]：子数为 n 的全部代表元，按从小到大排列。
+    std::vector<uint32_t> reps[BOARD_SIZE + 1];
+
+    std::once_flag symmetryOnce;
+    std::once_flag repsOnce[BOARD_SIZE + 1];
+};
+
+RankTables g_rankTables;
+
+// binomials[n][k] = C(n, k)。
+struct BinomialTable {
+    uint64_t values[BOARD_SIZE + 1][BOARD_SIZE + 1] = {};
+
+    BinomialTable()
+    {
+        for (int n = 0; n <= BOARD_SIZE; ++n) {
+            values[n][0] = 1u;
+            for (int k = 1; k <= n; ++k) {
+                values[n][k] = values[n - 1][k - 1] + (k < n ? values[n - 1][k] : 0u);
+            }
+        }
+    }
+};
+
+const BinomialTable g_binomials;
+
+inline uint64_t binomial(uint32_t n, uint32_t k)
+{
+    return k <= n ? g_binomials.values[n][k] : 0u;
+}
+
+inline uint32_t mapRankBoard(uint32_t board, size_t symmetry)
+{
+    const uint32_t (*maps)[256] = g_rankTables.byteMaps[symmetry];
+    return maps[0][board & 0xffu] | maps[1][(board >> 8) & 0xffu] | maps[2][(board >> 16) & 0xffu];
+}
+
+// 组合数系统：升序点位 p0 < p1 < ... 的编号为 Σ C(p_i, i + 1)。
+// 点位先压缩掉 excluded 占据的格子，即只在剩余空点中计序。
+uint64_t rankCombination(uint32_t board, uint32_t excluded)
+{
+    uint64_t rank = 0u;
+    uint32_t k = 0u;
+    while (board != 0u) {
+        const int32_t pos = CTZ32(board);
+        board &= board - 1u;
+        const uint32_t compact = static_cast<uint32_t>(pos)
+            - static_cast<uint32_t>(POPCOUNT32(excluded & ((1u << pos) - 1u)));
+        rank += binomial(compact, ++k);
+    }
+    return rank;
+}
+
+uint32_t unrankCombination(uint32_t count, uint64_t rank, uint32_t excluded)
+{
+    // 先按组合数系统解出压缩后的点位，再铺回 excluded 之外的空点。
+    uint32_t compactBoard = 0u;
+    uint32_t limit = static_cast<uint32_t>(BOARD_SIZE) - static_cast<uint32_t>(POPCOUNT32(excluded));
+    for (uint32_t k = count; k > 0u; --k) {
+        uint32_t pos = limit;
+        while (pos > 0u && binomial(pos - 1u, k) > rank) {
+            --pos;
+        }
+        --pos;
+        rank -= binomial(pos, k);
+        compactBoard |= 1u << pos;
+        limit = pos;
+    }
+
+    uint32_t board = 0u;
+    uint32_t free = ~excluded & ChessData::VALID_BOARD_MASK;
+    for (uint32_t compact = 0u; free != 0u; ++compact) {
+        const int32_t pos = CTZ32(free);
+        free &= free - 1u;
+        if ((compactBoard & (1u << compact)) != 0u) {
+            board |= 1u << pos;
+        }
+    }
+    return board;
+}
+
 struct ConsoleCoord
 {
     int32_t row;
@@ -48,46 +138,90 @@ const char* const PLAYER2_NUMBER_TOKENS[NUMBERED_PIECE_COUNT] = {
     "⓿", "❶", "❷", "❸", "❹", "❺", "❻", "❼", "❽"
 };
 
-void skipSpaces(const char*& text)
-{
-    while (*text != '\0' && std::isspace(static_cast<unsigned char>(*text))) {
-        ++text;
-    }
-}
+// 命令文本的单遍解析游标，只在 [cursor, end) 内读取，不要求以 '\0' 结尾。
+struct TextCursor {
+    const char* begin;
+    const char* cursor;
+    const char* end;
 
-bool parseUnsignedInt(const char*& text, int32_t& value)
-{
-    skipSpaces(text);
-    if (!std::isdigit(static_cast<unsigned char>(*text))) {
-        return false;
+    bool atEnd() const { return cursor == end; }
+    char peek() const { return cursor < end ? *cursor : '\0'; }
+    size_t offset() const { return static_cast<size_t>(cursor - begin); }
+
+    void skipSpaces()
+    {
+        while (cursor < end && std::isspace(static_cast<unsigned char>(*cursor))) {
+            ++cursor;
+        }
     }
 
-    value = 0;
-    while (std::isdigit(static_cast<unsigned char>(*text))) {
-        value = value * 10 + (*text - '0');
-        ++text;
+    bool consume(char ch)
+    {
+        if (peek() != ch) {
+            return false;
+        }
+        ++cursor;
+        return true;
     }
-    return true;
-}
 
-std::string trimCopy(const char* text)
-{
-    if (text == nullptr) {
-        return std::string();
+    // 十进制非负整数，前面允许空白。超过 3 位时按非法坐标处理，不会溢出。
+    bool parseUnsigned(int32_t& value)
+    {
+        skipSpaces();
+        if (!std::isdigit(static_cast<unsigned char>(peek()))) {
+            return false;
+        }
+        value = 0;
+        while (std::isdigit(static_cast<unsigned char>(peek()))) {
+            value = value < 1000 ? value * 10 + (*cursor - '0') : value;
+            ++cursor;
+        }
+        return true;
     }
 
-    std::string value(text);
-    std::string::size_type begin = 0;
-    while (begin < value.size() && std::isspace(static_cast<unsigned char>(value[begin]))) {
-        ++begin;
+    // "(c,p)"，括号、逗号前后都允许空白。坐标越界时游标停在左括号上。
+    bool parsePoint(int32_t& pos)
+    {
+        skipSpaces();
+        const char* const start = cursor;
+        int32_t c = -1;
+        int32_t p = -1;
+        if (!consume('(') || !parseUnsigned(c)) {
+            return false;
+        }
+        skipSpaces();
+        if (!consume(',') || !parseUnsigned(p)) {
+            return false;
+        }
+        skipSpaces();
+        if (!consume(')')) {
+            return false;
+        }
+        if (!Position::isValidCP(c, p)) {
+            cursor = start;
+            return false;
+        }
+        pos = Position::cpToPos(c, p);
+        return true;
     }
 
-    std::string::size_type end = value.size();
-    while (end > begin && std::isspace(static_cast<unsigned char>(value[end - 1]))) {
-        --end;
+    // 剩余部分只有空白。
+    bool finish()
+    {
+        skipSpaces();
+        return atEnd();
     }
+};
 
-    return value.substr(begin, end - begin);
+// 不区分大小写地比较 [begin, end) 与小写关键字 keyword。
+bool equalsKeyword(const char* begin, const char* end, const char* keyword)
+{
+    for (; begin < end; ++begin, ++keyword) {
+        if (*keyword == '\0' || std::tolower(static_cast<unsigned char>(*begin)) != *keyword) {
+            return false;
+        }
+    }
+    return *keyword == '\0';
 }
 
 void drawConsoleEdge(std::vector<std::vector<std::string>>& grid, int32_t fromPos, int32_t toPos)
@@ -171,43 +305,6 @@ const char* playerText(NineChess::Players player)
 
 } // namespace
 
-const NineChess::Rule NineChess::rules[RULE_COUNT] = {
-{
-    "成三棋",
-    "1. 双方各9颗子，开局依次摆子；\n"
-    "2. 凡出现三子相连，就提掉对手一子；\n"
-    "3. 不能提对手的“三连”子，除非无子可提；\n"
-    "4. 同时出现两个“三连”只能提一子；\n"
-    "5. 摆完后依次走子，每次只能往相邻位置走一步；\n"
-    "6. 把对手棋子提到少于3颗时胜利；\n"
-    "7. 走棋阶段不能行动（被“闷”）算负。",
-    9, 3, false, false, false, true, false, true, true, false
-},
-{
-    "打三棋(12连棋)",
-    "1. 双方各12颗子，棋盘有斜线；\n"
-    "2. 摆棋阶段被提子的位置不能再摆子，直到走棋阶段；\n"
-    "3. 摆棋阶段，摆满棋盘算先手负；\n"
-    "4. 走棋阶段，后摆棋的一方先走；\n"
-    "5. 一步出现几个“三连”就可以提几个子；\n"
-    "6. 其它规则与成三棋基本相同。",
-    12, 3, true, true, true, true, true, true, true, false
-},
-{
-    "九连棋",
-    "1. 规则与成三棋基本相同，只是它的棋子有序号，\n"
-    "2. 相同序号、位置的“三连”不能重复提子；\n"
-    "3. 走棋阶段不能行动（被“闷”），则由对手继续走棋；\n"
-    "4. 一步出现几个“三连”就可以提几个子。",
-    9, 3, false, false, false, false, true, true, false, false
-},
-{
-    "莫里斯九子棋",
-    "规则与成三棋基本相同，只是在走子阶段，当一方仅剩3子时，他可以飞子到任意空位。",
-    9, 3, false, false, false, true, false, true, true, true
-}
-};
-
 NineChess::NineChess()
 {
     setRule(2);
@@ -215,106 +312,17 @@ NineChess::NineChess()
 
 void NineChess::setRule(uint32_t ruleIndex)
 {
-    m_ruleIndex = ruleIndex < RULE_COUNT ? ruleIndex : 0u;
-    m_rule = rules[m_ruleIndex];
-    buildMoveTable();
-    buildMillTable();
+    Position::setRule(ruleIndex);
     reset();
 }
 
-bool NineChess::isValidCP(int32_t c, int32_t p) const
-{
-    return c >= 0 && c < RING && p >= 0 && p < SEAT;
-}
-
-bool NineChess::isValidPos(int32_t pos) const
-{
-    return pos >= 0 && pos < BOARD_SIZE;
-}
-
-int32_t NineChess::cpToPos(int32_t c, int32_t p) const
-{
-    return isValidCP(c, p) ? (c * SEAT + p) : -1;
-}
-
-void NineChess::posToCP(int32_t pos, int32_t& c, int32_t& p) const
-{
-    if (!isValidPos(pos)) {
-        c = -1;
-        p = -1;
-        return;
-    }
-    c = pos / SEAT;
-    p = pos % SEAT;
-}
-
-NineChess::Players NineChess::getWhosPiece(int32_t c, int32_t p) const
-{
-    return getWhosPiecePos(cpToPos(c, p));
-}
-
-NineChess::Players NineChess::getWhosPiecePos(int32_t pos) const
-{
-    if (!isValidPos(pos)) {
-        return NOBODY;
-    }
-
-    const uint32_t bit = bitOf(pos);
-    if ((m_data.player1Board & bit) != 0u) {
-        return PLAYER1;
-    }
-    if ((m_data.player2Board & bit) != 0u) {
-        return PLAYER2;
-    }
-    if ((m_data.forbiddenBoard & bit) != 0u) {
-        // DRAW表示禁止点
-        return DRAW;
-    }
-    return NOBODY;
-}
-
-bool NineChess::getPieceCP(Players player, uint32_t number, int32_t& c, int32_t& p) const
-{
-    if (m_rule.allowRepeatedMills || number >= NUMBERED_PIECE_COUNT) {
-        return false;
-    }
-
-    const uint32_t layer = m_data.numberBoards[number] & boardOf(player);
-    if (layer == 0u) {
-        return false;
-    }
-
-    posToCP(CTZ32(layer), c, p);
-    return true;
-}
-
-bool NineChess::getCurrentPiece(Players& player, uint32_t& number) const
-{
-    if (m_rule.allowRepeatedMills || !isValidPos(m_selectedPos)) {
-        return false;
-    }
-
-    player = getWhosPiecePos(m_selectedPos);
-    if (player == NOBODY) {
-        return false;
-    }
-
-    const int32_t pieceNumber = getPieceNumberAtPos(m_selectedPos);
-    if (pieceNumber < 0) {
-        return false;
-    }
-
-    number = static_cast<uint32_t>(pieceNumber);
-    return true;
-}
-
 std::string NineChess::getConsoleText(bool showMillHistory) const
 {
     std::vector<std::vector<std::string>> grid(
         CONSOLE_GRID_SIZE, std::vector<std::string>(CONSOLE_GRID_SIZE, " "));
 
     for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
-        uint32_t neighbors = m_moveMask[pos] & m_validBoardMask;
+        uint32_t neighbors = m_tables->moveMask[pos] & m_tables->validBoardMask;
         while (neighbors != 0u) {
             const int32_t nextPos = CTZ32(neighbors);
             if (pos < nextPos) {
@@ -330,7 +338,7 @@ std::string NineChess::getConsoleText(bool showMillHistory) const
     }
 
     std::ostringstream out;
-    out << "规则: " << (m_rule.name != nullptr ? m_rule.name : "") << "\n";
+    out << "规则: " << (m_tables->rule.name != nullptr ? m_tables->rule.name : "") << "\n";
     for (int32_t row = 0; row < CONSOLE_GRID_SIZE; ++row) {
         std::string line;
         for (int32_t col = 0; col < CONSOLE_GRID_SIZE; ++col) {
@@ -365,9 +373,9 @@ std::string NineChess::getConsoleText(bool showMillHistory) const
     }
 
     out << "提示: " << m_tip << "\n";
-    out << "最后命令: " << (m_cmdline.empty() ? "无" : m_cmdline) << "\n";
+    out << "最后命令: " << (m_lastCommand == MOVE_RECORD_NONE ? "无" : formatMoveRecord(m_lastCommand)) << "\n";
 
-    if (!m_rule.allowRepeatedMills && showMillHistory) {
+    if (!m_tables->rule.allowRepeatedMills && showMillHistory) {
         out << "历史三连 (" << m_data.millHistory.size() << "):\n";
         if (m_data.millHistory.empty()) {
             out << "  无\n";
@@ -383,73 +391,10 @@ std::string NineChess::getConsoleText(bool showMillHistory) const
     return out.str();
 }
 
-bool NineChess::canChoosePos(int32_t pos) const
-{
-    if (!isValidPos(pos) || m_data.getPhase() != GAME_MID) {
-        return false;
-    }
-    if (m_data.getAction() != ACTION_CHOOSE && m_data.getAction() != ACTION_PLACE) {
-        return false;
-    }
-    if (!isOwnPieceAt(m_data.getTurn(), pos)) {
-        return false;
-    }
-
-    if (canFly(m_data.getTurn())) {
-        const uint32_t occupied = (m_data.player1Board | m_data.player2Board | m_data.forbiddenBoard) & m_validBoardMask;
-        return occupied != m_validBoardMask;
-    }
-
-    const uint32_t occupied = (m_data.player1Board | m_data.player2Board | m_data.forbiddenBoard) & m_validBoardMask;
-    return (m_moveMask[pos] & ~occupied & m_validBoardMask) != 0u;
-}
-
-bool NineChess::canPlacePos(int32_t pos) const
-{
-    if (!isValidPos(pos) || m_data.getPhase() == GAME_OVER) {
-        return false;
-    }
-
-    if (m_data.getPhase() == GAME_NOTSTARTED) {
-        return isEmptyPos(pos);
-    }
-
-    if (m_data.getAction() != ACTION_PLACE || !isEmptyPos(pos)) {
-        return false;
-    }
-
-    if (m_data.getPhase() == GAME_OPENING) {
-        return true;
-    }
-
-    return isValidPos(m_selectedPos)
-        && (canFly(m_data.getTurn()) || isAdjacent(m_selectedPos, pos));
-}
-
-bool NineChess::canCapturePos(int32_t pos) const
-{
-    if (!isValidPos(pos) || m_data.getPhase() == GAME_NOTSTARTED || m_data.getPhase() == GAME_OVER) {
-        return false;
-    }
-    if (m_data.getAction() != ACTION_CAPTURE || m_data.getPendingCaptures() == 0u) {
-        return false;
-    }
-
-    const Players attacker = m_data.getTurn();
-    const Players defender = opponentOf(attacker);
-    return isOpponentPieceAt(attacker, pos)
-        && (isAllInMills(defender) || !isPieceInMill(pos));
-}
-
 void NineChess::reset()
 {
-    m_data = ChessData();
-    m_data.setState(GAME_NOTSTARTED, ACTION_NONE, NOBODY);
-    m_data.setPlayer2InHand(m_rule.piecesPerSide);
-    m_winner = NOBODY;
-    m_selectedPos = -1;
-    m_cmdline.clear();
-    m_cmdHistory.clear();
+    Position::reset();
+    clearHistory();
     m_tip = "未开局";
 }
 
@@ -489,32 +434,44 @@ bool NineChess::capture(int32_t c, int32_t p)
 
 bool NineChess::choosePos(int32_t pos)
 {
-    return doChoose(pos, true, true);
-}
+    // 换选其它棋子时保留第一次选子之前的 selectedPos。
+    const int32_t chooseBase = m_data.getAction() == ACTION_CHOOSE ? m_selectedPos : m_chooseBase;
+    if (!Position::choosePos(pos)) {
+        return false;
+    }
 
-bool NineChess::placePos(int32_t pos)
-{
-    return doPlace(pos, true, true);
+    m_chooseBase = chooseBase;
+    setLastCommand(makeMoveRecord(MOVE_RECORD_POINT, 0, pos));
+    rebuildTip();
+    return true;
 }
 
-bool NineChess::capturePos(int32_t pos)
+bool NineChess::placePos(int32_t pos)
 {
-    return doCapture(pos, true, true);
-}
+    const bool opening = m_data.getPhase() != GAME_MID;
+    const int32_t fromPos = m_selectedPos;
+    const Position before(*this);
+    if (!Position::placePos(pos)) {
+        return false;
+    }
 
-void NineChess::chooseFast(int32_t pos)
-{
-    (void)doChoose(pos, false, false);
+    commitCommand(opening
+        ? makeMoveRecord(MOVE_RECORD_POINT, 0, pos)
+        : makeMoveRecord(MOVE_RECORD_MOVE, fromPos, pos), before);
+    rebuildTip();
+    return true;
 }
 
-void NineChess::placeFast(int32_t pos)
+bool NineChess::capturePos(int32_t pos)
 {
-    (void)doPlace(pos, false, false);
-}
+    const Position before(*this);
+    if (!Position::capturePos(pos)) {
+        return false;
+    }
 
-void NineChess::captureFast(int32_t pos)
-{
-    (void)doCapture(pos, false, false);
+    commitCommand(makeMoveRecord(MOVE_RECORD_CAPTURE, 0, pos), before);
+    rebuildTip();
+    return true;
 }
 
 bool NineChess::giveup()
@@ -529,10 +486,10 @@ bool NineChess::giveup(Players loser)
         return false;
     }
 
-    const std::string command = formatGiveupCommand(loser);
     return adjudicateResult(opponentOf(loser), loser == PLAYER1
         ? "玩家1认负，恭喜玩家2获胜！"
-        : "玩家2认负，恭喜玩家1获胜！", &command);
+        : "玩家2认负，恭喜玩家1获胜！",
+        makeMoveRecord(loser == PLAYER1 ? MOVE_RECORD_GIVEUP_PLAYER1 : MOVE_RECORD_GIVEUP_PLAYER2));
 }
 
 bool NineChess::adjudicateWin(Players winner, const std::string& tipText)
@@ -543,16 +500,16 @@ bool NineChess::adjudicateWin(Players winner, const std::string& tipText)
 
     return adjudicateResult(winner, tipText.empty()
         ? (winner == PLAYER1 ? "恭喜玩家1获胜！" : "恭喜玩家2获胜！")
-        : tipText, nullptr);
+        : tipText, MOVE_RECORD_NONE);
 }
 
 bool NineChess::adjudicateDraw(const std::string& tipText)
 {
-    return adjudicateResult(DRAW, tipText.empty() ? "平局。" : tipText, nullptr);
+    return adjudicateResult(DRAW, tipText.empty() ? "平局。" : tipText, MOVE_RECORD_NONE);
 }
 
 bool NineChess::adjudicateResult(Players winner, const std::string& tipText,
-    const std::string* recordedCommand)
+    MoveRecord recordedCommand)
 {
     if (winner != PLAYER1 && winner != PLAYER2 && winner != DRAW) {
         return false;
@@ -561,764 +518,414 @@ bool NineChess::adjudicateResult(Players winner, const std::string& tipText,
         return false;
     }
 
-    if (recordedCommand != nullptr) {
-        setLastCommand(*recordedCommand, true);
+    const Position before(*this);
+    setGameOver(winner, GAME_OVER_ADJUDICATED);
+    m_tip = tipText;
+    if (recordedCommand != MOVE_RECORD_NONE) {
+        commitCommand(recordedCommand, before);
     }
-    setGameOver(winner, tipText);
     return true;
 }
 
-bool NineChess::command(const char* cmd)
+bool NineChess::command(TextView cmd)
 {
-    const std::string trimmed = trimCopy(cmd);
-    if (trimmed.empty()) {
+    MoveRecord record = MOVE_RECORD_NONE;
+    if (!parseMoveText(cmd, record, m_data.getTurn())) {
         return false;
     }
+    return playMoveRecord(record);
+}
 
-    Players loser = NOBODY;
-    if (parseGiveupCommand(trimmed.c_str(), loser)) {
-        return giveup(loser);
-    }
-    if (parseDrawCommand(trimmed.c_str())) {
-        const std::string command = formatDrawCommand();
-        return adjudicateResult(DRAW, "平局。", &command);
-    }
-
-    std::string lower = trimmed;
-    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char ch) {
-        return static_cast<char>(std::tolower(ch));
-    });
-    if (lower == "giveup" || lower == "resign") {
-        return giveup();
-    }
-    if (lower == "draw") {
-        const std::string command = formatDrawCommand();
-        return adjudicateResult(DRAW, "平局。", &command);
-    }
+bool NineChess::playMoveRecord(MoveRecord record)
+{
+    const int32_t toPos = getMoveRecordTo(record);
+    switch (getMoveRecordType(record))
+    {
+    case MOVE_RECORD_POINT:
+        if (!isValidPos(toPos)) {
+            return false;
+        }
+        if (m_data.getAction() == ACTION_CAPTURE) {
+            return capturePos(toPos);
+        }
+        if (m_data.getPhase() == GAME_MID && m_data.getAction() == ACTION_CHOOSE) {
+            return choosePos(toPos);
+        }
+        return placePos(toPos);
+    case MOVE_RECORD_MOVE: {
+        const int32_t fromPos = getMoveRecordFrom(record);
+        if (!isValidPos(fromPos) || !isValidPos(toPos)) {
+            return false;
+        }
 
-    int32_t fromPos = -1;
-    int32_t toPos = -1;
-    if (parseMoveCommand(trimmed.c_str(), fromPos, toPos)) {
         // 复合走子命令需要具备“原子性”：
         // 1. 如果前半段 choose 成功、后半段 place 失败，棋局不能停留在“已选中某子”的半完成状态；
         // 2. 否则命令调用方会看到“返回 false，但局面已被部分修改”，
         //    这会让控制台 undo、批量测试和上层脚本都很难处理。
         //
-        // 因而这里先保存一份完整快照；只有两步都成功时才提交结果。
-        const NineChess snapshot(*this);
+        // 因而这里先保存快照；只有两步都成功时才提交结果。
+        // 失败时命令历史没有变化，只需恢复局面、选子前的位置、最后命令和提示文本。
+        const Position snapshot(*this);
+        const MoveRecord lastCommand = m_lastCommand;
+        const int32_t chooseBase = m_chooseBase;
+        const std::string tip = m_tip;
         if (!choosePos(fromPos) || !placePos(toPos)) {
-            *this = snapshot;
+            static_cast<Position&>(*this) = snapshot;
+            m_lastCommand = lastCommand;
+            m_chooseBase = chooseBase;
+            m_tip = tip;
             return false;
         }
         return true;
     }
+    case MOVE_RECORD_CAPTURE:
+        return isValidPos(toPos) && capturePos(toPos);
+    case MOVE_RECORD_GIVEUP_PLAYER1:
+        return giveup(PLAYER1);
+    case MOVE_RECORD_GIVEUP_PLAYER2:
+        return giveup(PLAYER2);
+    case MOVE_RECORD_DRAW:
+        return adjudicateResult(DRAW, "平局。", record);
+    default:
+        return false;
+    }
+}
+
+void NineChess::applySymmetry(uint32_t symmetry)
+{
+    // 与 Position::applySymmetry 的分解相同，但经由 NineChess::transformState 同步变换撤销差量。
+    if ((symmetry & 8u) != 0u) {
+        transformState(TRANSFORM_MIRROR, false);
+    }
+    if ((symmetry & 4u) != 0u) {
+        transformState(TRANSFORM_TURN, false);
+    }
+    switch (symmetry & 3u)
+    {
+    case 1u:
+        transformState(TRANSFORM_ROTATE_LEFT, false);
+        break;
+    case 2u:
+        transformState(TRANSFORM_ROTATE_180, false);
+        break;
+    case 3u:
+        transformState(TRANSFORM_ROTATE_RIGHT, false);
+        break;
+    default:
+        break;
+    }
+    rebuildTip();
+}
 
-    int32_t pos = -1;
-    if (parseCaptureCommand(trimmed.c_str(), pos)) {
-        return capturePos(pos);
+bool NineChess::undo()
+{
+    if (cancelPendingChoose()) {
+        refreshTip();
+        return true;
+    }
+    if (m_moveHistory.empty()) {
+        return false;
     }
-    if (!parseSingleCommand(trimmed.c_str(), pos)) {
+
+    applyUndo(m_undoLog.back());
+    m_redoHistory.push_back(m_moveHistory.back());
+    m_moveHistory.pop_back();
+    m_undoLog.pop_back();
+    m_lastCommand = m_moveHistory.empty() ? MOVE_RECORD_NONE : m_moveHistory.back();
+    refreshTip();
+    return true;
+}
+
+bool NineChess::redo()
+{
+    if (m_redoHistory.empty()) {
         return false;
     }
 
-    if (m_data.getAction() == ACTION_CAPTURE) {
-        return capturePos(pos);
+    // 重做记录从命令边界开始执行，先丢掉未完成的选子。
+    if (cancelPendingChoose()) {
+        refreshTip();
     }
-    if (m_data.getPhase() == GAME_MID && m_data.getAction() == ACTION_CHOOSE) {
-        return choosePos(pos);
+    // 执行成功时 commitCommand 会把这条记录弹出重做栈。
+    return playMoveRecord(m_redoHistory.back());
+}
+
+bool NineChess::seek(size_t ply)
+{
+    while (m_moveHistory.size() > ply) {
+        if (!undo()) {
+            return false;
+        }
+    }
+    while (m_moveHistory.size() < ply) {
+        if (!redo()) {
+            return false;
+        }
     }
-    return placePos(pos);
+    return true;
 }
 
-uint64_t NineChess::getHash() const
+NineChess::PositionClass NineChess::getPositionClass() const
 {
-    return m_rule.allowRepeatedMills ? m_data.getHashLite() : m_data.getHashHard();
+    PositionClass positionClass;
+    positionClass.phase = m_data.getPhase();
+    positionClass.action = m_data.getAction();
+    positionClass.turn = m_data.getTurn();
+    positionClass.pendingCaptures = static_cast<uint8_t>(m_data.getPendingCaptures());
+    positionClass.player1OnBoard = static_cast<uint8_t>(POPCOUNT32(m_data.player1Board & m_tables->validBoardMask));
+    positionClass.player2OnBoard = static_cast<uint8_t>(POPCOUNT32(m_data.player2Board & m_tables->validBoardMask));
+    positionClass.forbiddenCount = static_cast<uint8_t>(POPCOUNT32(m_data.forbiddenBoard & m_tables->validBoardMask));
+    positionClass.player1InHand = static_cast<uint8_t>(m_data.getPlayer1InHand());
+    positionClass.player2InHand = static_cast<uint8_t>(m_data.getPlayer2InHand());
+    return positionClass;
 }
 
-void NineChess::mirror(bool rewriteCommands)
+uint64_t NineChess::positionClassSize(const PositionClass& positionClass)
 {
-    transformState(TRANSFORM_MIRROR, rewriteCommands);
-    rebuildTip();
+    return boardClassSize(positionClass.player1OnBoard, positionClass.player2OnBoard, positionClass.forbiddenCount);
 }
 
-void NineChess::turn(bool rewriteCommands)
+uint64_t NineChess::rankPosition() const
 {
-    transformState(TRANSFORM_TURN, rewriteCommands);
-    rebuildTip();
+    return rankBoards(m_data.player1Board & m_tables->validBoardMask, m_data.player2Board & m_tables->validBoardMask,
+        m_data.forbiddenBoard & m_tables->validBoardMask);
 }
 
-void NineChess::flipVertical(bool rewriteCommands)
+bool NineChess::unrankPosition(const PositionClass& positionClass, uint64_t rank)
 {
-    // 几何上，“上下翻转”与“左右镜像 + 180 度旋转”等价。
-    // 这里直接走一个独立的 TransformMode：
-    // 1. 避免重复遍历位棋盘、历史三连和命令历史；
-    // 2. 也避免组合调用时需要额外考虑 rewriteCommands 的传递方式。
-    transformState(TRANSFORM_FLIP_VERTICAL, rewriteCommands);
+    uint32_t player1Board = 0u;
+    uint32_t player2Board = 0u;
+    uint32_t forbiddenBoard = 0u;
+    if (!unrankBoards(positionClass.player1OnBoard, positionClass.player2OnBoard, positionClass.forbiddenCount,
+        rank, player1Board, player2Board, forbiddenBoard)) {
+        return false;
+    }
+
+    ChessData data;
+    data.player1Board = player1Board;
+    data.player2Board = player2Board;
+    data.forbiddenBoard = forbiddenBoard;
+    data.setPlayer2InHand(positionClass.player2InHand);
+    data.setPendingCaptures(positionClass.pendingCaptures);
+    data.setState(positionClass.phase, positionClass.action, positionClass.turn);
+
+    // 先手手牌数由 status 推导，与类别中给出的不一致说明类别本身不成立。
+    if (data.getPlayer1InHand() != positionClass.player1InHand
+        || data.getPendingCaptures() != positionClass.pendingCaptures) {
+        return false;
+    }
+
+    m_data = data;
+    m_winner = NOBODY;
+    m_selectedPos = -1;
+    m_overReason = GAME_OVER_NONE;
+    clearHistory();
     rebuildTip();
+    return true;
 }
 
-void NineChess::rotate(Rotates rotate, bool rewriteCommands)
+uint64_t NineChess::boardClassSize(uint32_t firstCount, uint32_t secondCount, uint32_t thirdCount)
 {
-    switch (rotate)
-    {
-    case ROTATE_LEFT:
-        transformState(TRANSFORM_ROTATE_LEFT, rewriteCommands);
-        break;
-    case ROTATE_RIGHT:
-        transformState(TRANSFORM_ROTATE_RIGHT, rewriteCommands);
-        break;
-    case ROTATE_180:
-        transformState(TRANSFORM_ROTATE_180, rewriteCommands);
-        break;
-    default:
-        return;
+    if (firstCount + secondCount + thirdCount > static_cast<uint32_t>(BOARD_SIZE)) {
+        return 0u;
     }
 
-    rebuildTip();
-}
-
-void NineChess::rotate(int32_t degrees, bool rewriteCommands)
-{
-    switch (degrees)
-    {
-    case 90:
-        rotate(ROTATE_LEFT, rewriteCommands);
-        break;
-    case -90:
-        rotate(ROTATE_RIGHT, rewriteCommands);
-        break;
-    case 180:
-    case -180:
-        rotate(ROTATE_180, rewriteCommands);
-        break;
-    default:
-        break;
-    }
+    std::call_once(g_rankTables.repsOnce[firstCount], &NineChess::buildRankRepresentatives, firstCount);
+    const uint32_t rest = static_cast<uint32_t>(BOARD_SIZE) - firstCount;
+    return static_cast<uint64_t>(g_rankTables.reps[firstCount].size())
+        * binomial(rest, secondCount) * binomial(rest - secondCount, thirdCount);
 }
 
-void NineChess::buildMoveTable()
+void NineChess::prepareBoardRank(uint32_t first, BoardRankKey& key)
 {
-    for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
-        const int32_t ring = pos / SEAT;
-        const int32_t seat = pos % SEAT;
-        uint32_t mask = 0u;
-
-        mask |= bitOf(ring * SEAT + ((seat + SEAT - 1) % SEAT));
-        mask |= bitOf(ring * SEAT + ((seat + 1) % SEAT));
-
-        // 默认规则下，跨圈直线位于 0/2/4/6 四个中点；
-        // 带斜线规则下，8 个点都允许沿同编号跨圈连接。
-        if ((seat & 1) == 0 || m_rule.hasDiagonalLines) {
-            if (ring > 0) {
-                mask |= bitOf((ring - 1) * SEAT + seat);
-            }
-            if (ring + 1 < RING) {
-                mask |= bitOf((ring + 1) * SEAT + seat);
-            }
-        }
+    std::call_once(g_rankTables.symmetryOnce, &NineChess::buildRankSymmetries);
 
-        m_moveMask[pos] = mask;
-    }
-}
-
-void NineChess::buildMillTable()
-{
-    m_lineCount = 0u;
-    std::fill(m_lineMasks, m_lineMasks + MAX_MILL_LINE_COUNT, 0u);
-    std::fill(m_posLineCount, m_posLineCount + BOARD_SIZE, 0u);
-    for (uint32_t i = 0; i < MAX_MILL_LINE_COUNT; ++i) {
-        for (int32_t j = 0; j < MILL; ++j) {
-            m_linePos[i][j] = -1;
+    first &= ChessData::VALID_BOARD_MASK;
+    key.canonical = first;
+    key.transforms = 1u;
+    for (size_t t = 1; t < RANK_SYMMETRY_COUNT; ++t) {
+        const uint32_t mapped = mapRankBoard(first, t);
+        if (mapped < key.canonical) {
+            key.canonical = mapped;
+            key.transforms = static_cast<uint16_t>(1u << t);
         }
-    }
-    for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
-        for (uint32_t i = 0; i < MAX_LINES_PER_POS; ++i) {
-            m_posLineIds[pos][i] = -1;
+        else if (mapped == key.canonical) {
+            key.transforms = static_cast<uint16_t>(key.transforms | (1u << t));
         }
     }
 
-    for (int32_t ring = 0; ring < RING; ++ring) {
-        const int32_t base = ring * SEAT;
-        addMillLine(base + 7, base + 0, base + 1);
-        addMillLine(base + 1, base + 2, base + 3);
-        addMillLine(base + 3, base + 4, base + 5);
-        addMillLine(base + 5, base + 6, base + 7);
-    }
-
-    for (int32_t seat = 0; seat < SEAT; ++seat) {
-        // 默认只在四个边中点生成跨圈“三连”；
-        // 有斜线的规则再额外加入四个角点方向。
-        if ((seat & 1) == 0 || m_rule.hasDiagonalLines) {
-            addMillLine(seat, seat + SEAT, seat + SEAT * 2);
-        }
-    }
+    const uint32_t count = static_cast<uint32_t>(POPCOUNT32(first));
+    std::call_once(g_rankTables.repsOnce[count], &NineChess::buildRankRepresentatives, count);
+    const std::vector<uint32_t>& reps = g_rankTables.reps[count];
+    key.repIndex = static_cast<uint32_t>(std::lower_bound(reps.begin(), reps.end(), key.canonical) - reps.begin());
 }
 
-void NineChess::addMillLine(int32_t pos0, int32_t pos1, int32_t pos2)
+uint64_t NineChess::rankBoards(const BoardRankKey& key, uint32_t second, uint32_t third)
 {
-    if (m_lineCount >= MAX_MILL_LINE_COUNT) {
-        return;
-    }
-
-    const uint32_t lineId = m_lineCount++;
-    m_linePos[lineId][0] = static_cast<int8_t>(pos0);
-    m_linePos[lineId][1] = static_cast<int8_t>(pos1);
-    m_linePos[lineId][2] = static_cast<int8_t>(pos2);
-    m_lineMasks[lineId] = bitOf(pos0) | bitOf(pos1) | bitOf(pos2);
-
-    const int32_t positions[MILL] = { pos0, pos1, pos2 };
-    for (int32_t i = 0; i < MILL; ++i) {
-        const int32_t pos = positions[i];
-        const uint8_t count = m_posLineCount[pos];
-        if (count < MAX_LINES_PER_POS) {
-            m_posLineIds[pos][count] = static_cast<int8_t>(lineId);
-            m_posLineCount[pos] = static_cast<uint8_t>(count + 1u);
+    // 第一张棋盘自身对称时有多个变换可选，依次取把第二、第三张映射得最小的那个，保证编号唯一。
+    uint32_t bestSecond = UINT32_MAX;
+    uint32_t bestThird = UINT32_MAX;
+    uint32_t transforms = key.transforms;
+    while (transforms != 0u) {
+        const size_t t = static_cast<size_t>(CTZ32(transforms));
+        transforms &= transforms - 1u;
+        const uint32_t mappedSecond = mapRankBoard(second, t);
+        const uint32_t mappedThird = mapRankBoard(third, t);
+        if (mappedSecond < bestSecond || (mappedSecond == bestSecond && mappedThird < bestThird)) {
+            bestSecond = mappedSecond;
+            bestThird = mappedThird;
         }
     }
-}
 
-NineChess::Players NineChess::opponentOf(Players player)
-{
-    if (player == PLAYER1) {
-        return PLAYER2;
-    }
-    if (player == PLAYER2) {
-        return PLAYER1;
-    }
-    return NOBODY;
+    const uint32_t rest = static_cast<uint32_t>(BOARD_SIZE) - static_cast<uint32_t>(POPCOUNT32(key.canonical));
+    const uint32_t secondCount = static_cast<uint32_t>(POPCOUNT32(bestSecond));
+    const uint64_t thirdSpan = binomial(rest - secondCount, static_cast<uint32_t>(POPCOUNT32(bestThird)));
+    return (static_cast<uint64_t>(key.repIndex) * binomial(rest, secondCount)
+        + rankCombination(bestSecond, key.canonical)) * thirdSpan
+        + rankCombination(bestThird, key.canonical | bestSecond);
 }
 
-uint32_t NineChess::boardOf(Players player) const
+uint64_t NineChess::rankBoards(uint32_t first, uint32_t second, uint32_t third)
 {
-    if (player == PLAYER1) {
-        return m_data.player1Board;
-    }
-    if (player == PLAYER2) {
-        return m_data.player2Board;
-    }
-    return 0u;
-}
-
-uint32_t& NineChess::boardRef(Players player)
-{
-    return player == PLAYER1 ? m_data.player1Board : m_data.player2Board;
-}
-
-bool NineChess::isOccupiedPos(int32_t pos) const
-{
-    return isValidPos(pos) && (((m_data.player1Board | m_data.player2Board) & bitOf(pos)) != 0u);
-}
-
-bool NineChess::isForbiddenPos(int32_t pos) const
-{
-    return isValidPos(pos) && ((m_data.forbiddenBoard & bitOf(pos)) != 0u);
-}
-
-bool NineChess::isEmptyPos(int32_t pos) const
-{
-    return isValidPos(pos) && !isOccupiedPos(pos) && !isForbiddenPos(pos);
+    BoardRankKey key;
+    prepareBoardRank(first, key);
+    return rankBoards(key, second, third);
 }
 
-bool NineChess::canFly(Players player) const
+bool NineChess::unrankBoards(uint32_t firstCount, uint32_t secondCount, uint32_t thirdCount, uint64_t rank,
+    uint32_t& first, uint32_t& second, uint32_t& third)
 {
-    if (!m_rule.allowFlying || m_data.getPhase() != GAME_MID) {
+    const uint64_t size = boardClassSize(firstCount, secondCount, thirdCount);
+    if (rank >= size) {
         return false;
     }
 
-    return (player == PLAYER1 ? m_data.getPlayer1OnBoardCount() : m_data.getPlayer2OnBoardCount())
-        <= m_rule.minPiecesToSurvive;
-}
-
-bool NineChess::isAdjacent(int32_t fromPos, int32_t toPos) const
-{
-    return isValidPos(fromPos)
-        && isValidPos(toPos)
-        && ((m_moveMask[fromPos] & bitOf(toPos)) != 0u);
-}
-
-bool NineChess::isOwnPieceAt(Players player, int32_t pos) const
-{
-    return isValidPos(pos) && ((boardOf(player) & bitOf(pos)) != 0u);
-}
+    const uint32_t rest = static_cast<uint32_t>(BOARD_SIZE) - firstCount;
+    const uint64_t thirdSpan = binomial(rest - secondCount, thirdCount);
+    const uint64_t secondSpan = binomial(rest, secondCount);
+    const uint64_t thirdRank = rank % thirdSpan;
+    const uint64_t secondRank = (rank / thirdSpan) % secondSpan;
+    const uint64_t repIndex = rank / thirdSpan / secondSpan;
 
-bool NineChess::isOpponentPieceAt(Players player, int32_t pos) const
-{
-    return isOwnPieceAt(opponentOf(player), pos);
+    first = g_rankTables.reps[firstCount][static_cast<size_t>(repIndex)];
+    second = unrankCombination(secondCount, secondRank, first);
+    third = unrankCombination(thirdCount, thirdRank, first | second);
+    return rankBoards(first, second, third) == rank;
 }
 
-bool NineChess::doChoose(int32_t pos, bool validate, bool updateView)
+void NineChess::buildRankSymmetries()
 {
-    if (validate && !canChoosePos(pos)) {
-        return false;
-    }
-
-    m_selectedPos = pos;
-    m_data.setAction(ACTION_PLACE);
-    if (updateView) {
-        setLastCommand(formatPointCommand(pos), false);
-        rebuildTip();
-    }
-    return true;
-}
-
-bool NineChess::doPlace(int32_t pos, bool validate, bool updateView)
-{
-    if (validate && !canPlacePos(pos)) {
-        return false;
-    }
-
-    if (m_data.getPhase() == GAME_NOTSTARTED) {
-        enterOpening();
-    }
-
-    if (m_data.getPhase() == GAME_OPENING) {
-        applyOpeningPlacement(pos);
-        if (updateView) {
-            setLastCommand(formatPointCommand(pos), true);
-        }
-    }
-    else {
-        const int32_t fromPos = m_selectedPos;
-        applyMidMove(pos);
-        if (updateView) {
-            setLastCommand(formatMoveCommand(fromPos, pos), true);
-        }
-    }
-
-    (void)tryFinishAfterPlaceOrMove(pos);
-    if (updateView) {
-        rebuildTip();
-    }
-    return true;
-}
-
-bool NineChess::doCapture(int32_t pos, bool validate, bool updateView)
-{
-    if (validate && !canCapturePos(pos)) {
-        return false;
-    }
-
-    if (updateView) {
-        setLastCommand(formatCaptureCommand(pos), true);
-    }
-
-    applyCapture(pos);
-    (void)tryFinishAfterCapture();
-    if (updateView) {
-        rebuildTip();
-    }
-    return true;
-}
-
-void NineChess::applyOpeningPlacement(int32_t pos)
-{
-    const Players turn = m_data.getTurn();
-    boardRef(turn) |= bitOf(pos);
-    if (!m_rule.allowRepeatedMills) {
-        placeNumberedPiece(pos);
-    }
-    if (turn == PLAYER2) {
-        m_data.decPlayer2InHand();
-    }
-    m_selectedPos = pos;
-}
-
-void NineChess::applyMidMove(int32_t toPos)
-{
-    const Players turn = m_data.getTurn();
-    const uint32_t fromBit = bitOf(m_selectedPos);
-    const uint32_t toBit = bitOf(toPos);
-    uint32_t& board = boardRef(turn);
-
-    board &= ~fromBit;
-    board |= toBit;
-    if (!m_rule.allowRepeatedMills) {
-        moveNumberedPiece(m_selectedPos, toPos);
-    }
-    m_selectedPos = toPos;
-}
-
-void NineChess::applyCapture(int32_t pos)
-{
-    const Players victim = opponentOf(m_data.getTurn());
-    const uint32_t bit = bitOf(pos);
-
-    boardRef(victim) &= ~bit;
-    if (m_rule.hasForbiddenPoints && m_data.getPhase() == GAME_OPENING) {
-        m_data.forbiddenBoard |= bit;
-    }
-    else {
-        m_data.forbiddenBoard &= ~bit;
-    }
-
-    if (!m_rule.allowRepeatedMills) {
-        removeNumberedPiece(pos);
-    }
-
-    m_data.setPendingCaptures(m_data.getPendingCaptures() - 1u);
-    m_selectedPos = -1;
-}
-
-bool NineChess::tryFinishAfterPlaceOrMove(int32_t pos)
-{
-    const uint32_t newMills = addNewMills(pos);
-    if (newMills > 0u) {
-        // 开局最后一手如果同时出现“摆满棋盘”和“三连”，按当前约定应先执行提子。
-        // 因此开局阶段的“满盘判负/判和”必须放到新三连判断之后，
-        // 否则会把本应进入 ACTION_CAPTURE 的局面提前终结。
-        m_data.setPendingCaptures(m_rule.allowMultiCapture ? newMills : 1u);
-        m_data.setAction(ACTION_CAPTURE);
-        return false;
-    }
-
-    if (m_data.getPhase() == GAME_OPENING) {
-        // 开局普通落子完成后，要先把 turn/action 切到“命令结束后的稳定状态”。
-        // 否则当后手刚落完一子、但尚未 toggleTurn 时，
-        // getPlayer1InHand() 会把这个瞬时 ACTION_PLACE|PLAYER2 误判成
-        // “先手刚好多摆了一手”的常态，从而把先手手牌少算 1。
-        toggleTurn();
-        m_data.setAction(ACTION_PLACE);
-
-        if (trySetWinnerFromMaterialOrBoard()) {
-            return true;
-        }
-
-        if (m_data.getPlayer1InHand() == 0u && m_data.getPlayer2InHand() == 0u) {
-            enterMidgame();
-            if (trySetWinnerFromMaterialOrBoard()) {
-                return true;
-            }
-            return tryHandleBlockedTurn();
-        }
-        return false;
-    }
-
-    m_selectedPos = -1;
-    toggleTurn();
-    m_data.setAction(ACTION_CHOOSE);
-    if (trySetWinnerFromMaterialOrBoard()) {
-        return true;
-    }
-    return tryHandleBlockedTurn();
-}
-
-bool NineChess::tryFinishAfterCapture()
-{
-    if (trySetWinnerFromMaterialOrBoard()) {
-        return true;
-    }
-
-    if (m_data.getPendingCaptures() > 0u) {
-        return false;
-    }
-
-    if (m_data.getPhase() == GAME_OPENING) {
-        if (m_data.getPlayer1InHand() == 0u && m_data.getPlayer2InHand() == 0u) {
-            enterMidgame();
-            if (trySetWinnerFromMaterialOrBoard()) {
-                return true;
-            }
-            return tryHandleBlockedTurn();
-        }
-
-        toggleTurn();
-        m_data.setAction(ACTION_PLACE);
-        return false;
-    }
-
-    toggleTurn();
-    m_data.setAction(ACTION_CHOOSE);
-    if (trySetWinnerFromMaterialOrBoard()) {
-        return true;
-    }
-    return tryHandleBlockedTurn();
-}
-
-bool NineChess::trySetWinnerFromMaterialOrBoard()
-{
-    if (m_data.getPhase() == GAME_OVER) {
-        return true;
-    }
-
-    const uint32_t total1 = m_data.getPlayer1OnBoardCount() + m_data.getPlayer1InHand();
-    const uint32_t total2 = m_data.getPlayer2OnBoardCount() + m_data.getPlayer2InHand();
-    if (total1 < m_rule.minPiecesToSurvive) {
-        setGameOver(PLAYER2, "恭喜玩家2获胜！");
-        return true;
-    }
-    if (total2 < m_rule.minPiecesToSurvive) {
-        setGameOver(PLAYER1, "恭喜玩家1获胜！");
-        return true;
-    }
-
-    if (m_data.getPhase() == GAME_OPENING) {
-        const uint32_t onBoardTotal = m_data.getPlayer1OnBoardCount() + m_data.getPlayer2OnBoardCount();
-        if (onBoardTotal >= BOARD_SIZE) {
-            if (m_rule.fullBoardIsLoss) {
-                setGameOver(PLAYER2, "摆满棋盘，恭喜玩家2获胜！");
+    for (uint32_t symmetry = 0; symmetry < RANK_SYMMETRY_COUNT; ++symmetry) {
+        for (int byte = 0; byte < 3; ++byte) {
+            for (uint32_t value = 0; value < 256u; ++value) {
+                uint32_t mapped = 0u;
+                for (int bit = 0; bit < 8; ++bit) {
+                    if ((value & (1u << bit)) != 0u) {
+                        mapped |= bitOf(symmetryPos(byte * 8 + bit, symmetry));
+                    }
+                }
+                g_rankTables.byteMaps[symmetry][byte][value] = mapped;
             }
-            else {
-                setGameOver(DRAW, "摆满棋盘，双方平局。");
-            }
-            return true;
         }
     }
-
-    return false;
 }
 
-bool NineChess::tryHandleBlockedTurn()
+void NineChess::buildRankRepresentatives(uint32_t count)
 {
-    if (m_data.getPhase() != GAME_MID || m_data.getAction() != ACTION_CHOOSE) {
-        return false;
-    }
+    std::call_once(g_rankTables.symmetryOnce, &NineChess::buildRankSymmetries);
 
-    if (hasAnyLegalMove(m_data.getTurn())) {
-        return false;
-    }
-
-    if (m_rule.blockedIsLoss) {
-        const Players loser = m_data.getTurn();
-        setGameOver(opponentOf(loser), loser == PLAYER1
-            ? "玩家1无子可走，恭喜玩家2获胜！"
-            : "玩家2无子可走，恭喜玩家1获胜！");
-        return true;
-    }
-
-    toggleTurn();
-    if (!hasAnyLegalMove(m_data.getTurn())) {
-        setGameOver(DRAW, "双方均无子可走，平局。");
-        return true;
-    }
-    return false;
-}
-
-uint32_t NineChess::countMillsAt(int32_t pos) const
-{
-    const Players owner = getWhosPiecePos(pos);
-    if (owner != PLAYER1 && owner != PLAYER2) {
-        return 0u;
-    }
-
-    const uint32_t board = boardOf(owner);
-    uint32_t count = 0u;
-    for (uint32_t i = 0; i < m_posLineCount[pos]; ++i) {
-        const int32_t lineId = m_posLineIds[pos][i];
-        if (lineId >= 0 && (board & m_lineMasks[lineId]) == m_lineMasks[lineId]) {
-            ++count;
-        }
-    }
-    return count;
-}
-
-bool NineChess::isPieceInMill(int32_t pos) const
-{
-    return countMillsAt(pos) > 0u;
-}
-
-bool NineChess::isAllInMills(Players player) const
-{
-    uint32_t board = boardOf(player) & m_validBoardMask;
-    while (board != 0u) {
-        const int32_t pos = CTZ32(board);
-        if (!isPieceInMill(pos)) {
-            return false;
-        }
-        board &= board - 1u;
-    }
-    return true;
-}
-
-bool NineChess::hasAnyLegalMove(Players player) const
-{
-    uint32_t board = boardOf(player) & m_validBoardMask;
-    if (board == 0u) {
-        return false;
-    }
-
-    const uint32_t occupied = (m_data.player1Board | m_data.player2Board | m_data.forbiddenBoard) & m_validBoardMask;
-    if (canFly(player)) {
-        return occupied != m_validBoardMask;
-    }
-
-    while (board != 0u) {
-        const int32_t pos = CTZ32(board);
-        if ((m_moveMask[pos] & ~occupied & m_validBoardMask) != 0u) {
-            return true;
-        }
-        board &= board - 1u;
-    }
-    return false;
-}
-
-uint32_t NineChess::addNewMills(int32_t pos)
-{
-    const Players player = getWhosPiecePos(pos);
-    if (player != PLAYER1 && player != PLAYER2) {
-        return 0u;
+    // 按从小到大枚举同子数的全部棋盘，自身就是 16 个像中最小者的即为代表元。
+    std::vector<uint32_t>& reps = g_rankTables.reps[count];
+    if (count == 0u) {
+        reps.push_back(0u);
+        return;
     }
 
-    const uint32_t board = boardOf(player);
-    uint32_t count = 0u;
-    for (uint32_t i = 0; i < m_posLineCount[pos]; ++i) {
-        const int32_t lineId = m_posLineIds[pos][i];
-        if (lineId < 0 || (board & m_lineMasks[lineId]) != m_lineMasks[lineId]) {
-            continue;
+    reps.reserve(static_cast<size_t>(binomial(BOARD_SIZE, count) / 8u + 1u));
+    uint32_t board = (1u << count) - 1u;
+    while (board <= ChessData::VALID_BOARD_MASK) {
+        bool canonical = true;
+        for (size_t t = 1; t < RANK_SYMMETRY_COUNT && canonical; ++t) {
+            canonical = mapRankBoard(board, t) >= board;
         }
-
-        if (m_rule.allowRepeatedMills) {
-            ++count;
-            continue;
+        if (canonical) {
+            reps.push_back(board);
         }
 
-        const MillKey key = makeMillKeyForLine(player, static_cast<uint32_t>(lineId));
-        if (!hasMillKey(key)) {
-            m_data.millHistory.push_back(key);
-            ++count;
-        }
+        // Gosper：同 popcount 的下一个更大整数。
+        const uint32_t lowest = board & (0u - board);
+        const uint32_t ripple = board + lowest;
+        board = ripple | (((board ^ ripple) >> 2) / lowest);
     }
-    return count;
 }
 
-int32_t NineChess::getPieceNumberAtPos(int32_t pos) const
+void NineChess::mirror(bool rewriteCommands)
 {
-    if (!isValidPos(pos)) {
-        return -1;
-    }
-
-    const uint32_t bit = bitOf(pos);
-    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
-        if ((m_data.numberBoards[i] & bit) != 0u) {
-            return i;
-        }
-    }
-    return -1;
+    transformState(TRANSFORM_MIRROR, rewriteCommands);
+    rebuildTip();
 }
 
-void NineChess::placeNumberedPiece(int32_t pos)
+void NineChess::turn(bool rewriteCommands)
 {
-    if (m_rule.allowRepeatedMills) {
-        return;
-    }
-
-    const Players turn = m_data.getTurn();
-    const uint32_t number = turn == PLAYER1
-        ? (m_rule.piecesPerSide - m_data.getPlayer1InHand())
-        : (m_rule.piecesPerSide - m_data.getPlayer2InHand());
-    if (number < NUMBERED_PIECE_COUNT) {
-        m_data.numberBoards[number] |= bitOf(pos);
-    }
+    transformState(TRANSFORM_TURN, rewriteCommands);
+    rebuildTip();
 }
 
-void NineChess::moveNumberedPiece(int32_t fromPos, int32_t toPos)
+void NineChess::flipVertical(bool rewriteCommands)
 {
-    if (m_rule.allowRepeatedMills) {
-        return;
-    }
-
-    const uint32_t fromBit = bitOf(fromPos);
-    const uint32_t toBit = bitOf(toPos);
-    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
-        if ((m_data.numberBoards[i] & fromBit) != 0u) {
-            m_data.numberBoards[i] &= ~fromBit;
-            m_data.numberBoards[i] |= toBit;
-            return;
-        }
-    }
+    // 几何上，“上下翻转”与“左右镜像 + 180 度旋转”等价。
+    // 这里直接走一个独立的 TransformMode：
+    // 1. 避免重复遍历位棋盘、历史三连和命令历史；
+    // 2. 也避免组合调用时需要额外考虑 rewriteCommands 的传递方式。
+    transformState(TRANSFORM_FLIP_VERTICAL, rewriteCommands);
+    rebuildTip();
 }
 
-void NineChess::removeNumberedPiece(int32_t pos)
+void NineChess::rotate(Rotates rotate, bool rewriteCommands)
 {
-    if (m_rule.allowRepeatedMills) {
+    switch (rotate)
+    {
+    case ROTATE_LEFT:
+        transformState(TRANSFORM_ROTATE_LEFT, rewriteCommands);
+        break;
+    case ROTATE_RIGHT:
+        transformState(TRANSFORM_ROTATE_RIGHT, rewriteCommands);
+        break;
+    case ROTATE_180:
+        transformState(TRANSFORM_ROTATE_180, rewriteCommands);
+        break;
+    default:
         return;
     }
 
-    const uint32_t bit = bitOf(pos);
-    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
-        if ((m_data.numberBoards[i] & bit) != 0u) {
-            m_data.numberBoards[i] &= ~bit;
-            return;
-        }
-    }
-}
-
-bool NineChess::hasMillKey(MillKey key) const
-{
-    for (std::vector<MillKey>::const_iterator it = m_data.millHistory.begin(); it != m_data.millHistory.end(); ++it) {
-        if (*it == key) {
-            return true;
-        }
-    }
-    return false;
-}
-
-NineChess::MillKey NineChess::makeMillKeyForLine(Players player, uint32_t lineId) const
-{
-    const int32_t piece0 = getPieceNumberAtPos(m_linePos[lineId][0]);
-    const int32_t piece1 = getPieceNumberAtPos(m_linePos[lineId][1]);
-    const int32_t piece2 = getPieceNumberAtPos(m_linePos[lineId][2]);
-
-    return makeMillKey(player == PLAYER2, lineId,
-        piece0 >= 0 ? static_cast<uint32_t>(piece0) : 0u,
-        piece1 >= 0 ? static_cast<uint32_t>(piece1) : 0u,
-        piece2 >= 0 ? static_cast<uint32_t>(piece2) : 0u);
+    rebuildTip();
 }
 
-NineChess::Players NineChess::toggleTurn()
+void NineChess::rotate(int32_t degrees, bool rewriteCommands)
 {
-    if (m_data.getTurn() == PLAYER1) {
-        m_data.setTurn(PLAYER2);
-        return PLAYER2;
-    }
-    if (m_data.getTurn() == PLAYER2) {
-        m_data.setTurn(PLAYER1);
-        return PLAYER1;
+    switch (degrees)
+    {
+    case 90:
+        rotate(ROTATE_LEFT, rewriteCommands);
+        break;
+    case -90:
+        rotate(ROTATE_RIGHT, rewriteCommands);
+        break;
+    case 180:
+    case -180:
+        rotate(ROTATE_180, rewriteCommands);
+        break;
+    default:
+        break;
     }
-    return NOBODY;
-}
-
-void NineChess::enterOpening()
-{
-    m_winner = NOBODY;
-    m_selectedPos = -1;
-    m_data.setState(GAME_OPENING, ACTION_PLACE, PLAYER1);
-    m_data.clearPendingCaptures();
-}
-
-void NineChess::enterMidgame()
-{
-    m_selectedPos = -1;
-    m_data.setPhase(GAME_MID);
-    m_data.setAction(ACTION_CHOOSE);
-    m_data.clearPendingCaptures();
-    m_data.forbiddenBoard = 0u;
-    m_data.setTurn(m_rule.defenderMovesFirst ? PLAYER2 : PLAYER1);
-}
-
-void NineChess::setGameOver(Players winner, const std::string& tipText)
-{
-    m_winner = winner;
-    m_selectedPos = -1;
-    m_data.setState(GAME_OVER, ACTION_NONE,
-        winner == PLAYER1 ? PLAYER1 : (winner == PLAYER2 ? PLAYER2 : NOBODY));
-    m_data.clearPendingCaptures();
-    m_tip = tipText;
 }
 
 void NineChess::rebuildTip()
 {
     if (m_data.getPhase() == GAME_OVER) {
-        if (!m_tip.empty()) {
-            return;
-        }
-        if (m_winner == PLAYER1) {
-            m_tip = "恭喜玩家1获胜！";
-        }
-        else if (m_winner == PLAYER2) {
-            m_tip = "恭喜玩家2获胜！";
-        }
-        else {
-            m_tip = "平局。";
+        // 裁定结果的提示文本由调用方给出，其余结局按原因重新生成。
+        if (m_overReason != GAME_OVER_ADJUDICATED || m_tip.empty()) {
+            m_tip = gameOverTip();
         }
         return;
     }
@@ -1351,7 +958,36 @@ void NineChess::rebuildTip()
     }
 }
 
-std::string NineChess::formatPointCommand(int32_t pos) const
+std::string NineChess::gameOverTip() const
+{
+    const Players loser = opponentOf(m_winner);
+    switch (m_overReason)
+    {
+    case GAME_OVER_FULL_BOARD:
+        return m_winner == PLAYER2 ? "摆满棋盘，恭喜玩家2获胜！" : "摆满棋盘，双方平局。";
+    case GAME_OVER_BLOCKED:
+        if (loser == PLAYER1 || loser == PLAYER2) {
+            return loser == PLAYER1
+                ? "玩家1无子可走，恭喜玩家2获胜！"
+                : "玩家2无子可走，恭喜玩家1获胜！";
+        }
+        break;
+    case GAME_OVER_ALL_BLOCKED:
+        return "双方均无子可走，平局。";
+    default:
+        break;
+    }
+
+    if (m_winner == PLAYER1) {
+        return "恭喜玩家1获胜！";
+    }
+    if (m_winner == PLAYER2) {
+        return "恭喜玩家2获胜！";
+    }
+    return "平局。";
+}
+
+std::string NineChess::formatPointCommand(int32_t pos)
 {
     int32_t c = -1;
     int32_t p = -1;
@@ -1363,7 +999,7 @@ std::string NineChess::formatConsolePointToken(int32_t pos) const
 {
     const Players owner = getWhosPiecePos(pos);
     if (owner == PLAYER1 || owner == PLAYER2) {
-        if (!m_rule.allowRepeatedMills) {
+        if (!m_tables->rule.allowRepeatedMills) {
             const int32_t number = getPieceNumberAtPos(pos);
             if (number >= 0 && number < NUMBERED_PIECE_COUNT) {
                 return owner == PLAYER1
@@ -1392,298 +1028,315 @@ std::string NineChess::formatMillHistoryEntry(MillKey key) const
         << getMillKeyPiece1(key) << ","
         << getMillKeyPiece2(key) << "]";
 
-    if (lineId < m_lineCount) {
+    if (lineId < m_tables->lineCount) {
         out << " cells=["
-            << formatPointCommand(m_linePos[lineId][0]) << ","
-            << formatPointCommand(m_linePos[lineId][1]) << ","
-            << formatPointCommand(m_linePos[lineId][2]) << "]";
+            << formatPointCommand(m_tables->linePos[lineId][0]) << ","
+            << formatPointCommand(m_tables->linePos[lineId][1]) << ","
+            << formatPointCommand(m_tables->linePos[lineId][2]) << "]";
     }
 
     return out.str();
 }
 
-std::string NineChess::formatMoveCommand(int32_t fromPos, int32_t toPos) const
+std::string NineChess::formatMoveCommand(int32_t fromPos, int32_t toPos)
 {
     return formatPointCommand(fromPos) + "->" + formatPointCommand(toPos);
 }
 
-std::string NineChess::formatCaptureCommand(int32_t pos) const
+std::string NineChess::formatCaptureCommand(int32_t pos)
 {
     return "-" + formatPointCommand(pos);
 }
 
-std::string NineChess::formatGiveupCommand(Players loser) const
+std::string NineChess::formatGiveupCommand(Players loser)
 {
     return loser == PLAYER1 ? "-0" : "-1";
 }
 
-std::string NineChess::formatDrawCommand() const
+std::string NineChess::formatDrawCommand()
 {
     return "==";
 }
 
-void NineChess::setLastCommand(const std::string& cmdline, bool commitHistory)
+std::string NineChess::formatMoveRecord(MoveRecord record)
 {
-    m_cmdline = cmdline;
-    if (commitHistory) {
-        m_cmdHistory.push_back(cmdline);
+    switch (getMoveRecordType(record))
+    {
+    case MOVE_RECORD_POINT:
+        return formatPointCommand(getMoveRecordTo(record));
+    case MOVE_RECORD_MOVE:
+        return formatMoveCommand(getMoveRecordFrom(record), getMoveRecordTo(record));
+    case MOVE_RECORD_CAPTURE:
+        return formatCaptureCommand(getMoveRecordTo(record));
+    case MOVE_RECORD_GIVEUP_PLAYER1:
+        return formatGiveupCommand(PLAYER1);
+    case MOVE_RECORD_GIVEUP_PLAYER2:
+        return formatGiveupCommand(PLAYER2);
+    case MOVE_RECORD_DRAW:
+        return formatDrawCommand();
+    default:
+        return std::string();
     }
 }
 
-bool NineChess::parsePoint(const char*& text, int32_t& c, int32_t& p) const
+std::vector<std::string> NineChess::getCmdHistory() const
 {
-    skipSpaces(text);
-    if (*text != '(') {
-        return false;
-    }
-    ++text;
-    if (!parseUnsignedInt(text, c)) {
-        return false;
-    }
-    skipSpaces(text);
-    if (*text != ',') {
-        return false;
-    }
-    ++text;
-    if (!parseUnsignedInt(text, p)) {
-        return false;
-    }
-    skipSpaces(text);
-    if (*text != ')') {
-        return false;
+    std::vector<std::string> history;
+    history.reserve(m_moveHistory.size());
+    for (const MoveRecord record : m_moveHistory) {
+        history.push_back(formatMoveRecord(record));
     }
-    ++text;
-    return true;
+    return history;
 }
 
-bool NineChess::parseSingleCommand(const char* text, int32_t& pos) const
+void NineChess::setLastCommand(MoveRecord record)
 {
-    const char* cursor = text;
-    int32_t c = -1;
-    int32_t p = -1;
-    if (!parsePoint(cursor, c, p)) {
-        return false;
-    }
-    skipSpaces(cursor);
-    if (*cursor != '\0' || !isValidCP(c, p)) {
-        return false;
-    }
-    pos = cpToPos(c, p);
-    return true;
+    m_lastCommand = record;
 }
 
-bool NineChess::parseMoveCommand(const char* text, int32_t& fromPos, int32_t& toPos) const
+void NineChess::commitCommand(MoveRecord record, const Position& before)
 {
-    const char* cursor = text;
-    int32_t c1 = -1;
-    int32_t p1 = -1;
-    int32_t c2 = -1;
-    int32_t p2 = -1;
-    if (!parsePoint(cursor, c1, p1)) {
-        return false;
+    const ChessData& old = before.getData();
+    MoveDelta delta;
+    delta.player1Board = old.player1Board;
+    delta.player2Board = old.player2Board;
+    delta.forbiddenBoard = old.forbiddenBoard;
+    delta.status = old.status;
+    delta.selectedPos = static_cast<int8_t>(before.getCurrentPos());
+    if (old.getPhase() == GAME_MID && old.getAction() == ACTION_PLACE) {
+        // 走子（或已选子时认输）之前的选子没有记入命令历史，撤销时一并退回选子之前。
+        delta.status = (delta.status & ~STATUS_ACTION_MASK) | ACTION_CHOOSE;
+        delta.selectedPos = static_cast<int8_t>(m_chooseBase);
     }
-    skipSpaces(cursor);
-    if (cursor[0] != '-' || cursor[1] != '>') {
-        return false;
+    for (uint8_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+        if (old.numberBoards[i] != m_data.numberBoards[i]) {
+            delta.numberLayer = i;
+            delta.numberBoard = old.numberBoards[i];
+            break;
+        }
     }
-    cursor += 2;
-    if (!parsePoint(cursor, c2, p2)) {
-        return false;
+    delta.millCount = static_cast<uint8_t>(old.millHistory.size());
+    delta.overReason = static_cast<uint8_t>(before.getGameOverReason());
+    delta.winner = before.getWinner();
+
+    setLastCommand(record);
+    m_moveHistory.push_back(record);
+    m_undoLog.push_back(delta);
+
+    // 按重做记录重走同一步时保留其余重做记录，走了别的命令则原来的后续作废。
+    if (!m_redoHistory.empty() && m_redoHistory.back() == record) {
+        m_redoHistory.pop_back();
     }
-    skipSpaces(cursor);
-    if (*cursor != '\0' || !isValidCP(c1, p1) || !isValidCP(c2, p2)) {
-        return false;
+    else {
+        m_redoHistory.clear();
     }
-    fromPos = cpToPos(c1, p1);
-    toPos = cpToPos(c2, p2);
-    return true;
 }
 
-bool NineChess::parseCaptureCommand(const char* text, int32_t& pos) const
+void NineChess::applyUndo(const MoveDelta& delta)
 {
-    const char* cursor = text;
-    skipSpaces(cursor);
-    if (*cursor != '-') {
-        return false;
+    m_data.player1Board = delta.player1Board;
+    m_data.player2Board = delta.player2Board;
+    m_data.forbiddenBoard = delta.forbiddenBoard;
+    m_data.status = delta.status;
+    if (delta.numberLayer != MoveDelta::NO_NUMBER_LAYER) {
+        m_data.numberBoards[delta.numberLayer] = delta.numberBoard;
     }
-    ++cursor;
-
-    int32_t c = -1;
-    int32_t p = -1;
-    if (!parsePoint(cursor, c, p)) {
-        return false;
-    }
-    skipSpaces(cursor);
-    if (*cursor != '\0' || !isValidCP(c, p)) {
-        return false;
-    }
-    pos = cpToPos(c, p);
-    return true;
+    m_data.millHistory.resize(delta.millCount);
+    m_selectedPos = delta.selectedPos;
+    m_winner = delta.winner;
+    m_overReason = static_cast<GameOverReason>(delta.overReason);
 }
 
-bool NineChess::parseGiveupCommand(const char* text, Players& loser) const
+void NineChess::clearHistory()
 {
-    loser = NOBODY;
+    m_lastCommand = MOVE_RECORD_NONE;
+    m_moveHistory.clear();
+    m_undoLog.clear();
+    m_redoHistory.clear();
+    m_chooseBase = -1;
+}
 
-    const char* cursor = text;
-    skipSpaces(cursor);
-    if (cursor[0] != '-' || (cursor[1] != '0' && cursor[1] != '1')) {
-        return false;
-    }
-    cursor += 2;
-    skipSpaces(cursor);
-    if (*cursor != '\0') {
+bool NineChess::cancelPendingChoose()
+{
+    if (m_data.getPhase() != GAME_MID || m_data.getAction() != ACTION_PLACE) {
         return false;
     }
 
-    loser = cursor[-1] == '0' ? PLAYER1 : PLAYER2;
+    m_data.setAction(ACTION_CHOOSE);
+    m_selectedPos = m_chooseBase;
+    m_lastCommand = m_moveHistory.empty() ? MOVE_RECORD_NONE : m_moveHistory.back();
     return true;
 }
 
-bool NineChess::parseDrawCommand(const char* text) const
+bool NineChess::parseMoveText(TextView text, MoveRecord& record, Players turn, size_t* errorColumn)
 {
-    const char* cursor = text;
-    skipSpaces(cursor);
-    if (cursor[0] != '=' || cursor[1] != '=') {
+    record = MOVE_RECORD_NONE;
+    TextCursor in = { text.data, text.data, text.data + text.size };
+    const auto fail = [&in, errorColumn]() {
+        if (errorColumn != nullptr) {
+            *errorColumn = in.offset();
+        }
         return false;
-    }
-    cursor += 2;
-    skipSpaces(cursor);
-    return *cursor == '\0';
-}
-
-int32_t NineChess::transformPos(int32_t pos, TransformMode mode)
-{
-    const int32_t ring = pos / SEAT;
-    const int32_t seat = pos % SEAT;
+    };
 
-    switch (mode)
+    // 首个非空白字符就能确定命令种类，之后只向前扫描一遍。
+    in.skipSpaces();
+    int32_t fromPos = -1;
+    int32_t toPos = -1;
+    switch (in.peek())
     {
-    case TRANSFORM_MIRROR:
-        return ring * SEAT + ((SEAT - seat) & 7);
-    case TRANSFORM_TURN:
-        return (RING - 1 - ring) * SEAT + seat;
-    case TRANSFORM_FLIP_VERTICAL:
-        // 上下翻转可视为 seat -> (4 - seat) mod 8。
-        // 它与“左右镜像 + 180 度旋转”完全等价，但这里直接给出闭式表达式，
-        // 便于一次完成整局变换。
-        return ring * SEAT + ((4 - seat) & 7);
-    case TRANSFORM_ROTATE_LEFT:
-        return ring * SEAT + ((seat + SEAT - 2) & 7);
-    case TRANSFORM_ROTATE_RIGHT:
-        return ring * SEAT + ((seat + 2) & 7);
-    case TRANSFORM_ROTATE_180:
-        return ring * SEAT + ((seat + 4) & 7);
+    case '(':
+        if (!in.parsePoint(toPos)) {
+            return fail();
+        }
+        in.skipSpaces();
+        if (in.atEnd()) {
+            record = makeMoveRecord(MOVE_RECORD_POINT, 0, toPos);
+            return true;
+        }
+        fromPos = toPos;
+        if (!in.consume('-') || !in.consume('>') || !in.parsePoint(toPos) || !in.finish()) {
+            return fail();
+        }
+        record = makeMoveRecord(MOVE_RECORD_MOVE, fromPos, toPos);
+        return true;
+    case '-':
+        in.consume('-');
+        if (in.peek() == '0' || in.peek() == '1') {
+            const bool player1Loses = in.peek() == '0';
+            in.consume(in.peek());
+            if (!in.finish()) {
+                return fail();
+            }
+            record = makeMoveRecord(player1Loses ? MOVE_RECORD_GIVEUP_PLAYER1 : MOVE_RECORD_GIVEUP_PLAYER2);
+            return true;
+        }
+        if (!in.parsePoint(toPos) || !in.finish()) {
+            return fail();
+        }
+        record = makeMoveRecord(MOVE_RECORD_CAPTURE, 0, toPos);
+        return true;
+    case '=':
+        if (!in.consume('=') || !in.consume('=') || !in.finish()) {
+            return fail();
+        }
+        record = makeMoveRecord(MOVE_RECORD_DRAW);
+        return true;
     default:
-        return pos;
+        break;
     }
-}
 
-uint32_t NineChess::transformBoard(uint32_t board, TransformMode mode) const
-{
-    uint32_t result = 0u;
-    uint32_t bits = board & m_validBoardMask;
-    while (bits != 0u) {
-        const int32_t pos = CTZ32(bits);
-        result |= bitOf(transformPos(pos, mode));
-        bits &= bits - 1u;
+    const char* const word = in.cursor;
+    while (std::isalpha(static_cast<unsigned char>(in.peek()))) {
+        in.consume(in.peek());
+    }
+    const char* const wordEnd = in.cursor;
+    if (word == wordEnd || !in.finish()) {
+        return fail();
     }
-    return result;
+    if (equalsKeyword(word, wordEnd, "draw")) {
+        record = makeMoveRecord(MOVE_RECORD_DRAW);
+        return true;
+    }
+    if ((equalsKeyword(word, wordEnd, "giveup") || equalsKeyword(word, wordEnd, "resign"))
+        && (turn == PLAYER1 || turn == PLAYER2)) {
+        record = makeMoveRecord(turn == PLAYER1 ? MOVE_RECORD_GIVEUP_PLAYER1 : MOVE_RECORD_GIVEUP_PLAYER2);
+        return true;
+    }
+    in.cursor = word;
+    return fail();
 }
 
-NineChess::MillKey NineChess::transformMillKey(MillKey key, TransformMode mode) const
+bool NineChess::decodeManual(TextView text, std::vector<MoveRecord>& moves, ManualError* error)
 {
-    const uint32_t oldLineId = getMillKeyLineId(key);
-    if (oldLineId >= m_lineCount) {
-        return key;
-    }
-
-    const int32_t mappedPos[MILL] = {
-        transformPos(m_linePos[oldLineId][0], mode),
-        transformPos(m_linePos[oldLineId][1], mode),
-        transformPos(m_linePos[oldLineId][2], mode)
-    };
-    const uint32_t mappedMask = bitOf(mappedPos[0]) | bitOf(mappedPos[1]) | bitOf(mappedPos[2]);
-
-    int32_t newLineId = -1;
-    for (uint32_t lineId = 0; lineId < m_lineCount; ++lineId) {
-        if (m_lineMasks[lineId] == mappedMask) {
-            newLineId = static_cast<int32_t>(lineId);
-            break;
+    const char* cursor = text.data;
+    const char* const end = text.data + text.size;
+    size_t line = 0;
+    while (cursor < end) {
+        ++line;
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+        const char* const next = lineEnd == nullptr ? end : lineEnd + 1;
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+        if (lineEnd > cursor && lineEnd[-1] == '\r') {
+            --lineEnd;
         }
-    }
-    if (newLineId < 0) {
-        return key;
-    }
 
-    const uint32_t oldPieces[MILL] = { getMillKeyPiece0(key), getMillKeyPiece1(key), getMillKeyPiece2(key) };
-    uint32_t newPieces[MILL] = {};
-    for (int32_t targetIndex = 0; targetIndex < MILL; ++targetIndex) {
-        const int32_t targetPos = m_linePos[newLineId][targetIndex];
-        for (int32_t sourceIndex = 0; sourceIndex < MILL; ++sourceIndex) {
-            if (mappedPos[sourceIndex] == targetPos) {
-                newPieces[targetIndex] = oldPieces[sourceIndex];
-                break;
+        const char* first = cursor;
+        while (first < lineEnd && std::isspace(static_cast<unsigned char>(*first))) {
+            ++first;
+        }
+        if (first < lineEnd) {
+            MoveRecord record = MOVE_RECORD_NONE;
+            size_t column = 0;
+            if (!parseMoveText(TextView(cursor, static_cast<size_t>(lineEnd - cursor)), record, NOBODY, &column)) {
+                if (error != nullptr) {
+                    error->line = line;
+                    error->column = column + 1;
+                }
+                return false;
             }
+            moves.push_back(record);
         }
+        cursor = next;
     }
-
-    return makeMillKey(isMillKeyPlayer2(key), static_cast<uint32_t>(newLineId),
-        newPieces[0], newPieces[1], newPieces[2]);
+    return true;
 }
 
 void NineChess::transformState(TransformMode mode, bool rewriteCommands)
 {
-    m_data.player1Board = transformBoard(m_data.player1Board, mode);
-    m_data.player2Board = transformBoard(m_data.player2Board, mode);
-    m_data.forbiddenBoard = transformBoard(m_data.forbiddenBoard, mode);
-    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
-        m_data.numberBoards[i] = transformBoard(m_data.numberBoards[i], mode);
-    }
+    Position::transformState(mode);
 
-    if (!m_rule.allowRepeatedMills) {
-        for (std::vector<MillKey>::iterator it = m_data.millHistory.begin(); it != m_data.millHistory.end(); ++it) {
-            *it = transformMillKey(*it, mode);
+    for (MoveDelta& delta : m_undoLog) {
+        delta.player1Board = transformBoard(delta.player1Board, mode);
+        delta.player2Board = transformBoard(delta.player2Board, mode);
+        delta.forbiddenBoard = transformBoard(delta.forbiddenBoard, mode);
+        delta.numberBoard = transformBoard(delta.numberBoard, mode);
+        if (isValidPos(delta.selectedPos)) {
+            delta.selectedPos = static_cast<int8_t>(transformPos(delta.selectedPos, mode));
         }
     }
-
-    if (isValidPos(m_selectedPos)) {
-        m_selectedPos = transformPos(m_selectedPos, mode);
+    if (isValidPos(m_chooseBase)) {
+        m_chooseBase = transformPos(m_chooseBase, mode);
     }
 
     if (rewriteCommands) {
-        if (!m_cmdline.empty()) {
-            m_cmdline = transformCommandString(m_cmdline, mode);
+        m_lastCommand = transformMoveRecord(m_lastCommand, mode);
+        for (MoveRecord& record : m_moveHistory) {
+            record = transformMoveRecord(record, mode);
         }
-        for (std::vector<std::string>::iterator it = m_cmdHistory.begin(); it != m_cmdHistory.end(); ++it) {
-            *it = transformCommandString(*it, mode);
+        for (MoveRecord& record : m_redoHistory) {
+            record = transformMoveRecord(record, mode);
         }
     }
 }
 
-std::string NineChess::transformCommandString(const std::string& command, TransformMode mode) const
+NineChess::MoveRecord NineChess::transformMoveRecord(MoveRecord record, TransformMode mode)
 {
-    int32_t fromPos = -1;
-    int32_t toPos = -1;
-    if (parseMoveCommand(command.c_str(), fromPos, toPos)) {
-        return formatMoveCommand(transformPos(fromPos, mode), transformPos(toPos, mode));
-    }
+    // 每种变换一张 24 点映射表，首次使用时由 transformPos 生成。
+    struct PosMaps {
+        uint8_t maps[TRANSFORM_MODE_COUNT][BOARD_SIZE];
 
-    int32_t pos = -1;
-    if (parseCaptureCommand(command.c_str(), pos)) {
-        return formatCaptureCommand(transformPos(pos, mode));
-    }
-    if (parseSingleCommand(command.c_str(), pos)) {
-        return formatPointCommand(transformPos(pos, mode));
-    }
+        PosMaps()
+        {
+            for (uint32_t m = 0; m < TRANSFORM_MODE_COUNT; ++m) {
+                for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+                    maps[m][pos] = static_cast<uint8_t>(transformPos(pos, static_cast<TransformMode>(m)));
+                }
+            }
+        }
+    };
+    static const PosMaps posMaps;
 
-    Players loser = NOBODY;
-    if (parseGiveupCommand(command.c_str(), loser)) {
-        return formatGiveupCommand(loser);
-    }
-    if (parseDrawCommand(command.c_str())) {
-        return formatDrawCommand();
+    const uint32_t type = getMoveRecordType(record);
+    if (type != MOVE_RECORD_POINT && type != MOVE_RECORD_MOVE && type != MOVE_RECORD_CAPTURE) {
+        return record;
     }
-    return command;
-}
 
+    const uint8_t* map = posMaps.maps[mode];
+    const int32_t fromPos = getMoveRecordFrom(record);
+    const int32_t toPos = getMoveRecordTo(record);
+    return makeMoveRecord(static_cast<MoveRecordType>(type),
+        type == MOVE_RECORD_MOVE ? map[fromPos] : 0, map[toPos]);
+}
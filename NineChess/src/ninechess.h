@@ -13,20 +13,49 @@
 ** 其中：
 **   - 安全接口：带完整合法性校验，适合普通调用方
 **   - 快速接口：直接按 0~23 点位操作，适合 AI 搜索热路径
+**
+** 局面状态与全部规则走子在基类 Position（ninechess_position.h）中，
+** NineChess 在其上维护命令文本、命令历史和提示文本。
+** AI 搜索只需要复制 Position。
 ****************************************************************************/
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define NINECHESS_HAS_STRING_VIEW 1
+#endif
+
 #include "ninechess_common.h"
+#include "ninechess_position.h"
+
+// 只读文本片段：起始指针 + 长度，不持有内存，也不要求以 '\0' 结尾。
+// 核心代码按 C++14 编译，不直接依赖 std::string_view；C++17 调用方可以直接传入 string_view。
+struct TextView {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    TextView() = default;
+    TextView(const char* text, size_t length) : data(text), size(length) {}
+    TextView(const char* text) : data(text), size(text == nullptr ? 0 : std::char_traits<char>::length(text)) {}
+    TextView(const std::string& text) : data(text.data()), size(text.size()) {}
+#if defined(NINECHESS_HAS_STRING_VIEW)
+    TextView(std::string_view text) : data(text.data()), size(text.size()) {}
+#endif
+};
 
-class NineChess
+class NineChess : public Position
 {
     // AI 搜索类需要直接访问内部辅助表和局面数据。
     friend class NineChess_AI_AB;
+    friend class NineChess_AI_MCTS;
+    // 证明数求解器输出着法时与 AI 共用命令文本格式。
+    friend class NineChess_Solver;
 
 public:
     // 从公共头中导出常用类型，减少外部书写成本。
@@ -37,6 +66,8 @@ public:
     using Players = ::Players;
     using Rotates = ::Rotates;
     using MillKey = ::MillKey;
+    using MoveRecord = ::MoveRecord;
+    using GameOverReason = Position::GameOverReason;
 
     // 兼容旧代码中通过类名访问的公共常量。
     static constexpr int MILL = ::MILL;
@@ -61,10 +92,6 @@ public:
     static constexpr Rotates ROTATE_RIGHT = ::ROTATE_RIGHT;
     static constexpr Rotates ROTATE_180 = ::ROTATE_180;
 
-    // 工程内置的 4 套规则表。
-    // setRule(ruleIndex) 时会从这里拷贝到 m_rule。
-    static const Rule rules[RULE_COUNT];
-
 public:
     // 默认构造当前使用“九连棋”规则（rules[2]）。
     NineChess();
@@ -72,7 +99,7 @@ public:
     // 默认析构即可，所有成员都由其自身类型负责清理。
     ~NineChess() = default;
 
-    // 允许按值复制整个棋局对象，便于 AI 搜索时保存和回退局面。
+    // 允许按值复制整个棋局对象；AI 搜索只复制基类 Position。
     NineChess(const NineChess&) = default;
 
     // 允许按值赋值整个棋局对象。
@@ -80,109 +107,10 @@ public:
 
     // ==================== 规则与数据 ====================
     // 切换规则会：
-    // 1. 更新当前规则对象 m_rule
-    // 2. 重建招法表和三连线表
-    // 3. 自动 reset 到该规则的初始局面
+    // 1. 改为引用该规则的共享辅助表
+    // 2. 自动 reset 到该规则的初始局面，并清空命令历史
     void setRule(uint32_t ruleIndex);
 
-    // 返回当前规则在 rules[] 中的下标。
-    uint32_t getRuleIndex() const { return m_ruleIndex; }
-
-    // 返回当前规则对象。
-    const Rule* getRule() const { return &m_rule; }
-
-    // 直接返回当前局面数据。
-    // const 版本用于查询，非 const 版本主要给 AI / 调试代码使用。
-    const ChessData& getData() const { return m_data; }
-    ChessData& getData() { return m_data; }
-
-    // ==================== 基础查询 ====================
-    // 坐标均为 0-based：
-    // c: 0~2 表示三圈
-    // p: 0~7 表示该圈上的 8 个位置
-    // 判断给定的圈位坐标是否落在棋盘范围内。
-    bool isValidCP(int32_t c, int32_t p) const;
-
-    // 判断给定的一维点位编号是否在 0~23 范围内。
-    bool isValidPos(int32_t pos) const;
-
-    // 将 (圈, 位) 转成 0~23 的一维点位编号。
-    // 输入非法时返回 -1。
-    int32_t cpToPos(int32_t c, int32_t p) const;
-
-    // 将一维点位编号拆成 (圈, 位)。
-    // 输入非法时 c / p 均返回 -1。
-    void posToCP(int32_t pos, int32_t& c, int32_t& p) const;
-
-    // 当前局面阶段：未开局 / 开局摆子 / 中局走子 / 结局。
-    Phases getPhase() const { return m_data.getPhase(); }
-
-    // 当前动作：选子 / 落子 / 提子。
-    Actions getAction() const { return m_data.getAction(); }
-
-    // 当前轮到哪一方行动。
-    Players getTurn() const { return m_data.getTurn(); }
-
-    // 当前赢家。
-    // 未分胜负返回 NOBODY，平局返回 DRAW。
-    Players getWinner() const { return m_winner; }
-
-    // 兼容旧接口名。
-    Players whoWin() const { return getWinner(); }
-
-    // 压缩后的 status 原始值。
-    uint32_t getStatus() const { return m_data.status; }
-
-    // 兼容旧接口名。
-    uint16_t getFlags() const { return static_cast<uint16_t>(getStatus()); }
-
-    // 当前被选中的棋子点位；没有选中时为 -1。
-    int32_t getCurrentPos() const { return m_selectedPos; }
-
-    // 先手当前手中的未落子数。
-    uint32_t getPlayer1InHand() const { return m_data.getPlayer1InHand(); }
-
-    // 兼容旧接口名。
-    uint32_t getPlayer1_InHand() const { return getPlayer1InHand(); }
-
-    // 后手当前手中的未落子数。
-    uint32_t getPlayer2InHand() const { return m_data.getPlayer2InHand(); }
-
-    // 兼容旧接口名。
-    uint32_t getPlayer2_InHand() const { return getPlayer2InHand(); }
-
-    // 先手当前在盘存活棋子数。
-    uint32_t getPlayer1OnBoardCount() const { return m_data.getPlayer1OnBoardCount(); }
-
-    // 后手当前在盘存活棋子数。
-    uint32_t getPlayer2OnBoardCount() const { return m_data.getPlayer2OnBoardCount(); }
-
-    // 当前还需要继续提掉多少颗子。
-    uint32_t getPendingCaptures() const { return m_data.getPendingCaptures(); }
-
-    // 兼容旧接口名。
-    Players whosTurn() const { return getTurn(); }
-
-    // 查询给定圈位坐标上的棋子归属。
-    // 空点或禁点都返回 NOBODY。
-    Players getWhosPiece(int32_t c, int32_t p) const;
-
-    // 查询给定 0~23 点位上的棋子归属。
-    // 空点或禁点都返回 NOBODY。
-    Players getWhosPiecePos(int32_t pos) const;
-
-    // 返回某个点位的邻接点位掩码。
-    // 主要给 AI 快速生成着法时使用。
-    uint32_t getMoveMask(int32_t pos) const { return isValidPos(pos) ? m_moveMask[pos] : 0u; }
-
-    // 九连棋专用查询：按“玩家 + 编号”返回对应棋子的圈位坐标。
-    // 非九连棋规则或该编号棋不在盘上时返回 false。
-    bool getPieceCP(Players player, uint32_t number, int32_t& c, int32_t& p) const;
-
-    // 九连棋专用查询：返回当前选中棋子的玩家和编号。
-    // 非九连棋规则或当前没有选中棋子时返回 false。
-    bool getCurrentPiece(Players& player, uint32_t& number) const;
-
     // ==================== 命令文本 ====================
     // 命令格式统一为：
     //   "(c,p)"            开局落子
@@ -194,14 +122,38 @@ public:
     // 返回当前局面的提示文本。
     const std::string& getTip() const { return m_tip; }
 
-    // 返回最后一次成功执行的命令文本。
-    const char* getCmdLine() const { return m_cmdline.c_str(); }
+    // 返回最后一次成功执行的命令文本，没有时为空串。
+    std::string getCmdLine() const { return formatMoveRecord(m_lastCommand); }
+
+    // 按需把完整命令历史格式化为文本。
+    std::vector<std::string> getCmdHistory() const;
 
-    // 返回完整命令历史。
-    const std::vector<std::string>& getCmdHistory() const { return m_cmdHistory; }
+    // 返回打包的命令历史，每步一条 MoveRecord。
+    const std::vector<MoveRecord>& getMoveHistory() const { return m_moveHistory; }
 
-    // 兼容旧接口名，含义与 getCmdHistory() 相同。
-    const std::vector<std::string>* getCmdList() const { return &m_cmdHistory; }
+    // 命令历史的步数。
+    size_t getHistorySize() const { return m_moveHistory.size(); }
+
+    // 把一条棋谱记录格式化为命令文本。
+    static std::string formatMoveRecord(MoveRecord record);
+
+    // 单遍解析一条命令文本，不分配内存；语法与 command() 相同，首尾空白忽略。
+    // "giveup" / "resign" 要按 turn 决定哪一方认输，turn 为 NOBODY 时视为无法解析。
+    // 失败时返回 false，errorColumn 非空时写出第一个无法解析的字符在 text 中的下标（从 0 开始）。
+    static bool parseMoveText(TextView text, MoveRecord& record, Players turn = NOBODY,
+        size_t* errorColumn = nullptr);
+
+    // decodeManual() 的出错位置，行号与列号都从 1 开始。
+    struct ManualError {
+        size_t line = 0;
+        size_t column = 0;
+    };
+
+    // 把整份棋谱文本解码为棋谱记录，依次追加到 moves。
+    // 每行一条命令，行尾 "\r" 与空白行忽略；只检查语法，不检查走法在局面中是否合法，
+    // 因此按轮次解析的 "giveup" / "resign" 不能出现在棋谱里（保存的棋谱只会写 "-0" / "-1"）。
+    // 遇到无法解析的行时返回 false，moves 保留此前解码的记录，error 非空时写出出错位置。
+    static bool decodeManual(TextView text, std::vector<MoveRecord>& moves, ManualError* error = nullptr);
 
     // 生成适合命令行测试的 UTF-8 棋盘文本。
     // 文本中会包含：
@@ -211,18 +163,8 @@ public:
     // showMillHistory 为 false 时，最后一段历史三连列表会被省略。
     std::string getConsoleText(bool showMillHistory = true) const;
 
-    // ==================== 合法性判断 ====================
-    // 判断当前局面下，给定点位是否允许“选子”。
-    bool canChoosePos(int32_t pos) const;
-
-    // 判断当前局面下，给定点位是否允许“落子/移子到该点”。
-    bool canPlacePos(int32_t pos) const;
-
-    // 判断当前局面下，给定点位是否允许“提子”。
-    bool canCapturePos(int32_t pos) const;
-
     // ==================== 游戏控制 ====================
-    // 重置局面到当前规则的初始状态，但不改变规则本身。
+    // 重置局面到当前规则的初始状态并清空命令历史，但不改变规则本身。
     void reset();
 
     // 从未开局或已结局状态进入新对局。
@@ -265,19 +207,28 @@ public:
     bool adjudicateDraw(const std::string& tipText = std::string());
 
     // 解析并执行一条命令文本。
-    bool command(const char* cmd);
+    bool command(TextView cmd);
+
+    // 执行一条棋谱记录，效果与执行对应的命令文本相同，但不经过文本解析。
+    // 回放 getMoveHistory() 时使用。
+    bool playMoveRecord(MoveRecord record);
 
-    // ==================== AI 快速接口 ====================
-    // 快速接口只按 pos 执行，不做合法性验证，也不维护命令历史/提示文本。
+    // ==================== 悔棋与回放 ====================
+    // 每条命令历史都带一条撤销差量，撤销和重做都是 O(1)，不需要从开局重放。
 
-    // 快速版选子。
-    void chooseFast(int32_t pos);
+    // 撤销最后一条命令，局面回到执行它之前。
+    // 中局已选子但还没走子时，先取消选子。没有可撤销的内容时返回 false。
+    bool undo();
 
-    // 快速版落子/移子。
-    void placeFast(int32_t pos);
+    // 重做最近一次撤销的命令。之后执行了不同的命令时，重做记录被丢弃。
+    bool redo();
 
-    // 快速版提子。
-    void captureFast(int32_t pos);
+    // 可重做的步数。
+    size_t getRedoSize() const { return m_redoHistory.size(); }
+
+    // 从当前步逐步撤销或重做，直到命令历史正好 ply 步，耗时与移动的步数成正比。
+    // ply 超出可重做范围时停在最远处并返回 false。
+    bool seek(size_t ply);
 
     // ==================== 变换与哈希 ====================
     // 左右镜像当前局面。
@@ -297,210 +248,120 @@ public:
     // 兼容旧接口：使用整数角度旋转。
     void rotate(int32_t degrees, bool rewriteCommands = true);
 
-    // 按当前规则自动选择 lite / hard 哈希算法。
-    uint64_t getHash() const;
+    // 对整局状态执行第 symmetry 种变换，不改写命令历史。
+    void applySymmetry(uint32_t symmetry);
+
+    // ==================== 局面编号 ====================
+    // 把局面映射为所属类别内的连续整数编号，可直接用作数组下标（残局库、访问位图、统计表），
+    // 不需要哈希表。编号只覆盖位棋盘和 status，信息量与 getHashLite() 相同：
+    // 九连棋的序号层、历史三连和中局已选中的棋子都不参与编号。
+    //
+    // 编号方式：先手、后手、禁点三张位棋盘取 16 种等价变换中字典序最小的一种；
+    // 先手棋盘按“同子数代表元列表”中的序号编号，后手棋盘压缩到先手之外的空点、
+    // 禁点棋盘压缩到两方之外的空点后，分别用组合数系统编号，三者混合进制相乘。
+    // 先手棋盘自身对称时，同一局面的其它写法会占用一些不使用的编号，区间因此略有空洞。
+
+    // 局面类别：同类局面的编号落在 [0, positionClassSize()) 中。
+    struct PositionClass {
+        Phases phase = ::GAME_NOTSTARTED;
+        Actions action = ::ACTION_NONE;
+        Players turn = ::NOBODY;
+        uint8_t pendingCaptures = 0;
+        uint8_t player1OnBoard = 0;
+        uint8_t player2OnBoard = 0;
+        uint8_t forbiddenCount = 0;
+        uint8_t player1InHand = 0;
+        uint8_t player2InHand = 0;
+    };
 
-    // 只基于主位棋盘和 status 的轻量哈希。
-    uint64_t getHashLite() const { return m_data.getHashLite(); }
+    // 第一张棋盘的归一化结果。同一第一张棋盘下给多组其余棋盘编号时可以复用。
+    struct BoardRankKey {
+        // 16 种变换下最小的第一张棋盘。
+        uint32_t canonical = 0;
 
-    // 把九连棋序号层和历史三连也混入的重哈希。
-    uint64_t getHashHard() const { return m_data.getHashHard(); }
+        // canonical 在同子数代表元列表中的序号。
+        uint32_t repIndex = 0;
 
-protected:
-    // 棋盘上合法三连线的最大数量。
-    // 无斜线为 16，有斜线时为 20，因此这里取上界 20。
-    static constexpr uint32_t MAX_MILL_LINE_COUNT = 20;
-
-    // 单个点位最多会参与 3 条三连线。
-    static constexpr uint32_t MAX_LINES_PER_POS = 3;
-
-    // 局面变换的内部编码。
-    // mirror / turn / rotate 最终都会映射到这里统一处理。
-    enum TransformMode : uint32_t {
-        TRANSFORM_MIRROR = 0,
-        TRANSFORM_TURN = 1,
-        TRANSFORM_FLIP_VERTICAL = 2,
-        TRANSFORM_ROTATE_LEFT = 3,
-        TRANSFORM_ROTATE_RIGHT = 4,
-        TRANSFORM_ROTATE_180 = 5
+        // 能把第一张棋盘变成 canonical 的全部变换，按位记录。
+        uint16_t transforms = 0;
     };
 
-    // 当前规则在 rules[] 中的下标。
-    uint32_t m_ruleIndex = 0;
+    // 当前局面所属的类别。
+    PositionClass getPositionClass() const;
 
-    // 当前正在使用的规则对象。
-    Rule m_rule = rules[0];
+    // 某个类别的编号总数（含不使用的编号）。
+    static uint64_t positionClassSize(const PositionClass& positionClass);
 
-    // 棋盘辅助表：
-    // 1. m_moveMask[pos]       : 该点的邻接点位集合
-    // 2. m_lineMasks[lineId]   : 某条三连线的位掩码
-    // 3. m_linePos[lineId][k]  : 某条三连线第 k 个固定位置
-    // 4. m_posLineIds[pos][i]  : 某点位参与的所有 lineId
-    // 24 位有效棋盘掩码，低 24 位对应真实棋盘点位。
-    uint32_t m_validBoardMask = ChessData::VALID_BOARD_MASK;
+    // 当前局面在其类别内的编号。
+    uint64_t rankPosition() const;
 
-    // 每个点位的邻接点位集合。
-    uint32_t m_moveMask[BOARD_SIZE] = {};
+    // 把局面设为类别内编号 rank 对应的规范局面，清空命令历史、选子和胜者。
+    // 编号越界、不是规范编号或类别内容自相矛盾时返回 false，局面保持不变。
+    bool unrankPosition(const PositionClass& positionClass, uint64_t rank);
 
-    // 当前规则下实际三连线总数。
-    uint32_t m_lineCount = 0;
+    // 以下为只针对位棋盘的底层编号，三张棋盘两两不重叠，第三张可以为空。
+    // 子数组合的编号总数。
+    static uint64_t boardClassSize(uint32_t firstCount, uint32_t secondCount, uint32_t thirdCount = 0);
 
-    // 每条三连线对应的 24 位掩码。
-    uint32_t m_lineMasks[MAX_MILL_LINE_COUNT] = {};
+    // 归一化第一张棋盘。
+    static void prepareBoardRank(uint32_t first, BoardRankKey& key);
 
-    // 每条三连线的 3 个固定点位。
-    int8_t m_linePos[MAX_MILL_LINE_COUNT][MILL] = {};
+    // 在已归一化的第一张棋盘下，给其余两张棋盘编号。
+    static uint64_t rankBoards(const BoardRankKey& key, uint32_t second, uint32_t third = 0);
 
-    // 每个点位一共参与多少条三连线。
-    uint8_t m_posLineCount[BOARD_SIZE] = {};
+    // 给三张棋盘编号。
+    static uint64_t rankBoards(uint32_t first, uint32_t second, uint32_t third = 0);
 
-    // 每个点位参与的 lineId 列表。
-    int8_t m_posLineIds[BOARD_SIZE][MAX_LINES_PER_POS] = {};
+    // 由编号还原三张规范棋盘；越界或不是规范编号时返回 false。
+    static bool unrankBoards(uint32_t firstCount, uint32_t secondCount, uint32_t thirdCount, uint64_t rank,
+        uint32_t& first, uint32_t& second, uint32_t& third);
 
-    // 当前局面真值数据。
-    ChessData m_data;
+protected:
+    // 最后一条成功执行的命令。
+    MoveRecord m_lastCommand = MOVE_RECORD_NONE;
 
-    // 当前赢家缓存。
-    Players m_winner = NOBODY;
+    // 完整命令历史。
+    std::vector<MoveRecord> m_moveHistory;
+
+    // 撤销一条命令所需的局面差量，只记执行前会被改动的字段。
+    // 位棋盘和 status 记原值；一条命令最多改动一层序号棋盘，只记这一层；
+    // 历史三连只会追加，记下执行前的条数即可。
+    struct MoveDelta {
+        static constexpr uint8_t NO_NUMBER_LAYER = 0xffu;
+
+        uint32_t player1Board = 0;
+        uint32_t player2Board = 0;
+        uint32_t forbiddenBoard = 0;
+        uint32_t status = 0;
+        uint32_t numberBoard = 0;
+        uint8_t numberLayer = NO_NUMBER_LAYER;
+        uint8_t millCount = 0;
+        int8_t selectedPos = -1;
+        uint8_t overReason = GAME_OVER_NONE;
+        Players winner = ::NOBODY;
+    };
 
-    // 当前被选中的棋子点位；未选中时为 -1。
-    int32_t m_selectedPos = -1;
+    // 撤销差量，与 m_moveHistory 一一对应。
+    std::vector<MoveDelta> m_undoLog;
 
-    // 最后一条成功执行的命令文本。
-    std::string m_cmdline;
+    // 已撤销、可重做的命令，栈顶是下一条。
+    std::vector<MoveRecord> m_redoHistory;
 
-    // 完整命令历史。
-    std::vector<std::string> m_cmdHistory;
+    // 中局选子之前的 selectedPos。选子不进命令历史，撤销走子时要一并退回选子之前。
+    int32_t m_chooseBase = -1;
 
     // 当前局面的提示文本。
     std::string m_tip;
 
 protected:
-    // 重建整张邻接招法表。
-    void buildMoveTable();
-
-    // 重建整张三连线辅助表。
-    void buildMillTable();
-
-    // 向辅助表中登记一条三连线。
-    void addMillLine(int32_t pos0, int32_t pos1, int32_t pos2);
-
-    // 计算点位 pos 对应的单比特掩码。
-    static uint32_t bitOf(int32_t pos) { return 1u << pos; }
-
-    // 返回某一方的对手。
-    static Players opponentOf(Players player);
-
-    // 返回指定玩家当前主位棋盘的值拷贝。
-    uint32_t boardOf(Players player) const;
-
-    // 返回指定玩家主位棋盘的可写引用。
-    uint32_t& boardRef(Players player);
-
-    // 判断点位上是否已有棋子。
-    bool isOccupiedPos(int32_t pos) const;
-
-    // 判断点位当前是否是禁点。
-    bool isForbiddenPos(int32_t pos) const;
-
-    // 判断点位是否为空且不是禁点。
-    bool isEmptyPos(int32_t pos) const;
-
-    // 判断指定玩家在当前局面下是否拥有飞子权。
-    bool canFly(Players player) const;
-
-    // 判断两个点位是否直接邻接。
-    bool isAdjacent(int32_t fromPos, int32_t toPos) const;
-
-    // 判断点位上是否是某一方自己的棋子。
-    bool isOwnPieceAt(Players player, int32_t pos) const;
-
-    // 判断点位上是否是某一方对手的棋子。
-    bool isOpponentPieceAt(Players player, int32_t pos) const;
-
-    // 统一的选子执行入口。
-    // validate 控制是否做合法性检查；
-    // updateView 控制是否维护提示文本和命令文本。
-    bool doChoose(int32_t pos, bool validate, bool updateView);
-
-    // 统一的落子/移子执行入口。
-    bool doPlace(int32_t pos, bool validate, bool updateView);
-
-    // 统一的提子执行入口。
-    bool doCapture(int32_t pos, bool validate, bool updateView);
-
-    // 执行开局阶段的一次摆子。
-    void applyOpeningPlacement(int32_t pos);
-
-    // 执行中局阶段的一次移子。
-    void applyMidMove(int32_t toPos);
-
-    // 执行一次提子。
-    void applyCapture(int32_t pos);
-
-    // 落子或移子后，处理成三、切换阶段、切换轮次和胜负判断。
-    bool tryFinishAfterPlaceOrMove(int32_t pos);
-
-    // 提子后，处理剩余提子数、切换阶段、切换轮次和胜负判断。
-    bool tryFinishAfterCapture();
-
-    // 仅从棋子数量和棋盘是否摆满角度判断是否已经分胜负。
-    bool trySetWinnerFromMaterialOrBoard();
-
-    // 在中局选子阶段处理“无子可走”的情况。
-    bool tryHandleBlockedTurn();
-
-    // 统计某个点位上的棋子当前参与了多少条三连。
-    uint32_t countMillsAt(int32_t pos) const;
-
-    // 判断某个点位上的棋子是否处于至少一条三连中。
-    bool isPieceInMill(int32_t pos) const;
-
-    // 判断某一方当前是否所有棋子都处于三连中。
-    bool isAllInMills(Players player) const;
-
-    // 判断某一方当前是否还存在至少一步合法着法。
-    bool hasAnyLegalMove(Players player) const;
-
-    // 检查某点产生的新三连，并返回本次真正新增的可提子三连数。
-    uint32_t addNewMills(int32_t pos);
-
-    // 返回某点位上的棋子编号。
-    // 非九连棋或该点无编号棋时返回 -1。
-    int32_t getPieceNumberAtPos(int32_t pos) const;
-
-    // 开局落子时，为九连棋编号层登记一颗新棋子。
-    void placeNumberedPiece(int32_t pos);
-
-    // 中局移子时，同步移动编号层中的那颗棋子。
-    void moveNumberedPiece(int32_t fromPos, int32_t toPos);
-
-    // 提子时，从编号层中移除对应棋子。
-    void removeNumberedPiece(int32_t pos);
-
-    // 查询某个历史三连 key 是否已经存在。
-    bool hasMillKey(MillKey key) const;
-
-    // 按“玩家 + lineId”生成当前三连对应的 MillKey。
-    MillKey makeMillKeyForLine(Players player, uint32_t lineId) const;
-
-    // 在 PLAYER1 / PLAYER2 之间切换轮次，并返回切换后的结果。
-    Players toggleTurn();
-
-    // 把局面切换到开局摆子阶段。
-    void enterOpening();
-
-    // 把局面切换到中局走子阶段。
-    void enterMidgame();
-
-    // 设置赢家并进入 GAME_OVER 状态。
-    void setGameOver(Players winner, const std::string& tipText);
-
     // 按当前局面重建 m_tip。
     void rebuildTip();
 
+    // 由结局原因和赢家生成结局提示文本。
+    std::string gameOverTip() const;
+
     // 把单点动作格式化为 "(c,p)"。
-    std::string formatPointCommand(int32_t pos) const;
+    static std::string formatPointCommand(int32_t pos);
 
     // 返回命令行棋盘中某个点位应显示的字符。
     // 普通规则使用 ● / ○，九连棋使用带编号的 Unicode 圈号字符。
@@ -510,56 +371,49 @@ protected:
     std::string formatMillHistoryEntry(MillKey key) const;
 
     // 把走子动作格式化为 "(c1,p1)->(c2,p2)"。
-    std::string formatMoveCommand(int32_t fromPos, int32_t toPos) const;
+    static std::string formatMoveCommand(int32_t fromPos, int32_t toPos);
 
     // 把提子动作格式化为 "-(c,p)"。
-    std::string formatCaptureCommand(int32_t pos) const;
+    static std::string formatCaptureCommand(int32_t pos);
 
     // 生成认输命令文本。
     // "-0" 表示先手认输，"-1" 表示后手认输。
-    std::string formatGiveupCommand(Players loser) const;
+    static std::string formatGiveupCommand(Players loser);
 
     // 生成平局命令文本。
-    std::string formatDrawCommand() const;
+    static std::string formatDrawCommand();
 
-    // 更新最后命令文本，并按需把它加入命令历史。
-    void setLastCommand(const std::string& cmdline, bool commitHistory);
+    // 更新最后命令，不改动命令历史。
+    void setLastCommand(MoveRecord record);
 
-    // 从文本中解析一个 "(c,p)" 点位。
-    bool parsePoint(const char*& text, int32_t& c, int32_t& p) const;
+    // 把命令加入命令历史，并由执行前的局面 before 生成撤销差量。
+    void commitCommand(MoveRecord record, const Position& before);
 
-    // 解析单点命令 "(c,p)"。
-    bool parseSingleCommand(const char* text, int32_t& pos) const;
+    // 把差量应用到当前局面，回到执行对应命令之前。
+    void applyUndo(const MoveDelta& delta);
 
-    // 解析走子命令 "(c1,p1)->(c2,p2)"。
-    bool parseMoveCommand(const char* text, int32_t& fromPos, int32_t& toPos) const;
+    // 清空命令历史、撤销差量和重做记录。
+    void clearHistory();
 
-    // 解析提子命令 "-(c,p)"。
-    bool parseCaptureCommand(const char* text, int32_t& pos) const;
-
-    // 解析认输命令 "-0" / "-1"。
-    bool parseGiveupCommand(const char* text, Players& loser) const;
-
-    // 解析平局命令 "=="。
-    bool parseDrawCommand(const char* text) const;
+    // 中局已选子、还没走子时取消选子，回到选子之前；否则返回 false。
+    bool cancelPendingChoose();
 
     // 统一的外部裁定入口。
+    // recordedCommand 不为 MOVE_RECORD_NONE 时把它记入命令历史。
     bool adjudicateResult(Players winner, const std::string& tipText,
-        const std::string* recordedCommand);
-
-    // 把单个点位按指定变换模式映射到新点位。
-    static int32_t transformPos(int32_t pos, TransformMode mode);
+        MoveRecord recordedCommand);
 
-    // 把整张位棋盘按指定变换模式映射。
-    uint32_t transformBoard(uint32_t board, TransformMode mode) const;
+    // 对整局状态执行几何变换，撤销差量总是同步变换；
+    // rewriteCommands 为 true 时同步改写命令历史和重做记录。
+    void transformState(TransformMode mode, bool rewriteCommands);
 
-    // 把历史三连 key 按指定变换模式映射。
-    MillKey transformMillKey(MillKey key, TransformMode mode) const;
+    // 对一条棋谱记录执行几何变换，按点位映射表查表完成。
+    static MoveRecord transformMoveRecord(MoveRecord record, TransformMode mode);
 
-    // 对整局状态执行几何变换。
-    void transformState(TransformMode mode, bool rewriteCommands);
+    // 预计算局面编号用的 16 种变换按字节映射表。
+    static void buildRankSymmetries();
 
-    // 对一条命令文本执行几何变换。
-    std::string transformCommandString(const std::string& command, TransformMode mode) const;
+    // 预计算子数为 count 的全部代表元。
+    static void buildRankRepresentatives(uint32_t count);
 };
 
@@ -3,11 +3,24 @@
 ** 以Alpha-Beta算法设计的AI下棋程序，实现等价局面和置换表功能 ***************/
 
 #include "ninechess_ai_ab.h"
+#include "ninechess_mappedfile.h"
 
 #include <algorithm>
+#include <fstream>
 #include <vector>
 
 std::array<NineChess_AI_AB::TTStore, RULE_COUNT> NineChess_AI_AB::s_ttStores = {};
+EvalWeightTable NineChess_AI_AB::s_evalWeights = {};
+std::array<std::shared_ptr<const NnueNetwork>, RULE_COUNT> NineChess_AI_AB::s_networks = {};
+std::mutex NineChess_AI_AB::s_networkMutex;
+std::array<NineChess_AI_AB::EvalCache, RULE_COUNT> NineChess_AI_AB::s_evalCaches;
+std::array<std::shared_ptr<const NineChess_Endgame>, RULE_COUNT> NineChess_AI_AB::s_endgames = {};
+std::mutex NineChess_AI_AB::s_endgameMutex;
+std::array<std::shared_ptr<const NineChess_Book>, RULE_COUNT> NineChess_AI_AB::s_books = {};
+std::mutex NineChess_AI_AB::s_bookMutex;
+std::atomic<uint64_t> NineChess_AI_AB::s_proofNodes(0u);
+std::atomic<int> NineChess_AI_AB::s_proofTrigger(NineChess_AI_AB::PROOF_TRIGGER_SCORE);
+std::atomic<int> NineChess_AI_AB::s_contempt(0);
 
 namespace {
 
@@ -26,6 +39,9 @@ inline int clampScore(int value, int lower, int upper)
     return value < lower ? lower : (value > upper ? upper : value);
 }
 
+// 24 位有效棋盘掩码，与规则无关。
+constexpr uint32_t VALID_BOARD_MASK = NineChess::ChessData::VALID_BOARD_MASK;
+
 } // namespace
 
 NineChess_AI_AB::NineChess_AI_AB()
@@ -45,22 +61,148 @@ void NineChess_AI_AB::setChess(const NineChess& chess)
     m_bestMove = Move();
     m_iterationBestMove = Move();
     m_bestMoveText = "error!";
+    m_weights = s_evalWeights[m_root.getRuleIndex()];
+    {
+        std::lock_guard<std::mutex> lock(s_networkMutex);
+        m_network = s_networks[m_root.getRuleIndex()];
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_endgameMutex);
+        m_endgame = s_endgames[m_root.getRuleIndex()];
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_bookMutex);
+        m_book = s_books[m_root.getRuleIndex()];
+    }
+    m_remainingSteps = 0;
+    m_contempt = s_contempt.load();
+    m_drawKey = drawScore() != 0
+        ? mix64(0xd6e8feb86659fd93ULL + static_cast<uint64_t>(static_cast<int64_t>(drawScore())))
+        : 0u;
+    buildPositionHistory(chess);
     beginTranspositionGeneration();
     buildSymmetryVariants();
 }
 
+bool NineChess_AI_AB::loadEvalWeights(const std::string& path)
+{
+    if (!loadEvalWeightTable(path, s_evalWeights)) {
+        return false;
+    }
+
+    clearEvalCaches();
+    return true;
+}
+
+const EvalWeights& NineChess_AI_AB::evalWeights(uint32_t ruleIndex)
+{
+    return s_evalWeights[ruleIndex < RULE_COUNT ? ruleIndex : 0u];
+}
+
+bool NineChess_AI_AB::loadNeuralNetwork(uint32_t ruleIndex, const std::string& path)
+{
+    if (ruleIndex >= RULE_COUNT) {
+        return false;
+    }
+
+    std::shared_ptr<NnueNetwork> network = std::make_shared<NnueNetwork>();
+    if (!network->load(path)) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_networkMutex);
+        s_networks[ruleIndex] = network;
+    }
+    clearEvalCaches();
+    return true;
+}
+
+bool NineChess_AI_AB::hasNeuralNetwork(uint32_t ruleIndex)
+{
+    std::lock_guard<std::mutex> lock(s_networkMutex);
+    return ruleIndex < RULE_COUNT && s_networks[ruleIndex] != nullptr;
+}
+
+bool NineChess_AI_AB::loadEndgameDatabase(uint32_t ruleIndex, const std::string& directory)
+{
+    if (!NineChess_Endgame::supportsRule(ruleIndex)) {
+        return false;
+    }
+
+    std::shared_ptr<NineChess_Endgame> endgame = std::make_shared<NineChess_Endgame>(ruleIndex);
+    if (endgame->loadDirectory(directory) == 0u) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_endgameMutex);
+    s_endgames[ruleIndex] = endgame;
+    return true;
+}
+
+bool NineChess_AI_AB::hasEndgameDatabase(uint32_t ruleIndex)
+{
+    std::lock_guard<std::mutex> lock(s_endgameMutex);
+    return ruleIndex < RULE_COUNT && s_endgames[ruleIndex] != nullptr;
+}
+
+bool NineChess_AI_AB::loadOpeningBook(uint32_t ruleIndex, const std::string& path)
+{
+    if (ruleIndex >= RULE_COUNT) {
+        return false;
+    }
+
+    std::shared_ptr<NineChess_Book> book = std::make_shared<NineChess_Book>();
+    if (!book->load(path, ruleIndex)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_bookMutex);
+    s_books[ruleIndex] = book;
+    return true;
+}
+
+bool NineChess_AI_AB::hasOpeningBook(uint32_t ruleIndex)
+{
+    std::lock_guard<std::mutex> lock(s_bookMutex);
+    return ruleIndex < RULE_COUNT && s_books[ruleIndex] != nullptr;
+}
+
+void NineChess_AI_AB::setProofSearch(uint64_t maxNodes, int triggerScore)
+{
+    s_proofNodes.store(maxNodes);
+    s_proofTrigger.store(triggerScore);
+}
+
+void NineChess_AI_AB::setContempt(int contempt)
+{
+    s_contempt.store(contempt);
+}
+
 int NineChess_AI_AB::alphaBetaPruning(int depth)
+{
+    // 规则只在这里分派一次，之后整棵搜索树都走 RuleTraits<N> 实例化的版本。
+    return dispatchRule(m_root.getRuleIndex(), [&](auto rule) {
+        return iterativeDeepening<decltype(rule)::value>(depth);
+    });
+}
+
+template<uint32_t N>
+int NineChess_AI_AB::iterativeDeepening(int depth)
 {
     // 采用迭代加深：
     // 1. 浅层结果可以为深层排序；
     // 2. 如果外部要求中断，仍然能保留“上一层完整算完”的 best move。
     m_search = m_root;
+    resetAccumulators();
     m_iterationAborted = false;
     m_lastCompletedDepth = 0;
-    m_lastCompletedValue = evaluate(0);
+    m_lastCompletedValue = evaluate<N>(0);
 
+    // 开局库和求解器给出的着法不一定是等价类的代表，这里保留完整的根着法列表供匹配；
+    // 迭代加深本身在 searchRoot() 中只展开代表着法。
     MoveList rootMoves;
-    generateMoves(rootMoves);
+    generateMoves<N>(rootMoves, false);
     if (rootMoves.count == 0) {
         m_bestMove = Move();
         m_bestMoveText = "error!";
@@ -75,14 +217,30 @@ int NineChess_AI_AB::alphaBetaPruning(int depth)
         return m_lastCompletedValue;
     }
 
+    // 超过限步的层数只会得到和棋，不必再加深。
+    if (m_remainingSteps > 0) {
+        depth = std::min(depth, m_remainingSteps);
+    }
+
+    // 开局库命中时直接出着，不再迭代加深。
+    Move bookMove;
+    int bookValue = 0;
+    if (probeOpeningBook(rootMoves, bookMove, bookValue)) {
+        m_bestMove = bookMove;
+        m_bestMoveText = formatMove(m_bestMove);
+        m_lastCompletedValue = bookValue;
+        return m_lastCompletedValue;
+    }
+
     for (int currentDepth = 1; currentDepth <= depth; ++currentDepth) {
         if (m_requiredQuit.load()) {
             break;
         }
 
         m_search = m_root;
+        resetAccumulators();
         m_iterationAborted = false;
-        const int value = searchRoot(currentDepth);
+        const int value = searchRoot<N>(currentDepth);
         if (m_iterationAborted) {
             break;
         }
@@ -91,8 +249,14 @@ int NineChess_AI_AB::alphaBetaPruning(int depth)
         m_lastCompletedValue = value;
         m_bestMove = m_iterationBestMove;
         m_bestMoveText = formatMove(m_bestMove);
+
+        // 本层已在搜索深度之内分出胜负，再加深也不会改变结论。
+        if (std::abs(value) >= WIN_SCORE - currentDepth) {
+            break;
+        }
     }
 
+    tryProveWin(rootMoves);
     return m_lastCompletedValue;
 }
 
@@ -101,17 +265,19 @@ const char* NineChess_AI_AB::bestMove()
     return m_bestMoveText.empty() ? "error!" : m_bestMoveText.c_str();
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::searchRoot(int depth)
 {
     // 根节点与普通节点的区别在于：
     // 普通节点只关心分值，根节点还需要把“哪一步走到这个分值”记下来。
     MoveList moves;
-    generateMoves(moves);
+    generateMoves<N>(moves);
     if (moves.count == 0) {
-        return evaluate(0);
+        return evaluate<N>(0);
     }
 
     orderMoves(moves, true);
+    m_extensionLimit = 2 * depth;
 
     const bool maximizing = m_search.getTurn() == PLAYER1;
     int alpha = -INF_SCORE;
@@ -126,8 +292,8 @@ int NineChess_AI_AB::searchRoot(int depth)
         }
 
         Snapshot snapshot;
-        applyMove(moves.moves[i], snapshot);
-        const int value = search(depth - 1, alpha, beta, 1);
+        applyMove<N>(moves.moves[i], snapshot);
+        const int value = search<N>(depth - 1, alpha, beta, 1);
         undoMove(snapshot);
 
         if (m_iterationAborted) {
@@ -161,38 +327,56 @@ int NineChess_AI_AB::searchRoot(int depth)
     return bestValue;
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::search(int depth, int alpha, int beta, int ply)
 {
     if (m_requiredQuit.load()) {
         m_iterationAborted = true;
-        return evaluate(ply);
+        return evaluate<N>(ply);
     }
 
     if (m_search.getPhase() == GAME_OVER) {
         return evaluateTerminal(ply);
     }
 
+    // 走到限步或回到了之前的局面都按和棋计，这样的分支不再展开。
+    if ((m_remainingSteps > 0 && ply >= m_remainingSteps) || isRepetition()) {
+        return drawScore();
+    }
+
+    // 残局库给出的是精确结果，叶节点也优先用它代替静态估值。
+    int endgameValue = 0;
+    if (probeEndgame(ply, endgameValue)) {
+        return endgameValue;
+    }
+
     if (depth <= 0) {
-        return evaluate(ply);
+        return evaluate<N>(ply);
     }
 
     const int originalAlpha = alpha;
     const int originalBeta = beta;
 
+    // 子树可能走到限步时，分值取决于离根的步数，不能与别的搜索共用置换表。
+    const bool stepLimited = m_remainingSteps > 0 && ply + depth >= m_remainingSteps;
+
     int ttValue = 0;
     // 先查置换表：
     // - 精确命中时可以直接复用；
     // - 边界命中时可以先收紧窗口，再决定是否已经足够剪枝。
-    if (probeTransposition(depth, alpha, beta, ttValue)) {
+    if (!stepLimited && probeTransposition<N>(depth, alpha, beta, ttValue)) {
         return ttValue;
     }
 
     MoveList moves;
-    generateMoves(moves);
+    generateMoves<N>(moves);
     if (moves.count == 0) {
-        return evaluate(ply);
+        return evaluate<N>(ply);
     }
 
+    if (!stepLimited) {
+        keepFlyingBlocks<N>(moves);
+    }
     orderMoves(moves, false);
 
     const bool maximizing = m_search.getTurn() == PLAYER1;
@@ -200,8 +384,13 @@ int NineChess_AI_AB::search(int depth, int alpha, int beta, int ply)
 
     for (size_t i = 0; i < moves.count; ++i) {
         Snapshot snapshot;
-        applyMove(moves.moves[i], snapshot);
-        const int value = search(depth - 1, alpha, beta, ply + 1);
+        applyMove<N>(moves.moves[i], snapshot);
+        // 飞子残局里走出成三威胁的一步不减深度，免得威胁和应对被地平线截断。
+        int childDepth = depth - 1;
+        if (ply < m_extensionLimit && moves.moves[i].type == MOVE_SHIFT && givesFlyingThreat<N>()) {
+            childDepth = depth;
+        }
+        const int value = search<N>(childDepth, alpha, beta, ply + 1);
         undoMove(snapshot);
 
         if (m_iterationAborted) {
@@ -234,52 +423,325 @@ int NineChess_AI_AB::search(int depth, int alpha, int beta, int ply)
     }
 
     // 用进入节点时的原始窗口来决定 bestValue 是精确值、上界还是下界。
-    storeTransposition(depth, bestValue, originalAlpha, originalBeta);
+    if (!stepLimited) {
+        storeTransposition<N>(depth, bestValue, originalAlpha, originalBeta);
+    }
     return bestValue;
 }
 
+bool NineChess_AI_AB::probeEndgame(int ply, int& value) const
+{
+    if (!m_endgame) {
+        return false;
+    }
+
+    EndgameValue result = ENDGAME_DRAW;
+    int distance = -1;
+    if (!m_endgame->probe(m_search, result, distance)) {
+        return false;
+    }
+
+    if (result == ENDGAME_DRAW) {
+        value = drawScore();
+        return true;
+    }
+
+    // 库中距离按“走子并提子算一步”计，折算成分值时越快取胜越好、越晚落败越好。
+    const int score = WIN_SCORE - ply - (distance >= 0 ? distance : ENDGAME_FALLBACK_DISTANCE);
+    const bool moverWins = result == ENDGAME_WIN;
+    value = (m_search.getTurn() == PLAYER1) == moverWins ? score : -score;
+    return true;
+}
+
+bool NineChess_AI_AB::probeOpeningBook(const MoveList& rootMoves, Move& move, int& value) const
+{
+    if (!m_book) {
+        return false;
+    }
+
+    std::vector<BookEntry> entries;
+    if (!m_book->probe(m_root, entries)) {
+        return false;
+    }
+
+    // 库中着法已按权重降序；旧库与当前规则实现不一致时跳过对不上的条目。
+    for (const BookEntry& entry : entries) {
+        for (size_t i = 0; i < rootMoves.count; ++i) {
+            const Move& candidate = rootMoves.moves[i];
+            if (candidate.to == static_cast<int8_t>(entry.pos)
+                && (candidate.type == MOVE_PLACE || candidate.type == MOVE_CAPTURE)) {
+                move = candidate;
+                value = entry.value;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool NineChess_AI_AB::tryProveWin(const MoveList& rootMoves)
+{
+    // 浅层搜索只看到大优，胜负还没有算清时，才值得让求解器去证明。
+    const uint64_t maxNodes = s_proofNodes.load();
+    const Players turn = m_root.getTurn();
+    const int sideValue = turn == PLAYER1 ? m_lastCompletedValue : -m_lastCompletedValue;
+    if (maxNodes == 0u || m_requiredQuit.load() || m_lastCompletedDepth == 0
+        || sideValue < s_proofTrigger.load() || sideValue >= DECIDED_SCORE) {
+        return false;
+    }
+
+    if (!m_solver) {
+        m_solver.reset(new NineChess_Solver(PROOF_MEMORY_MB));
+    }
+    SolverLimits limits;
+    limits.maxNodes = maxNodes;
+    limits.abort = &m_requiredQuit;
+    if (m_solver->solve(m_root, turn, limits) != SOLVER_PROVEN) {
+        return false;
+    }
+
+    for (size_t i = 0; i < rootMoves.count; ++i) {
+        if (formatMove(rootMoves.moves[i]) == m_solver->bestMove()) {
+            // 已证明但不知道步数，按残局库没有距离时的约定折算胜负分。
+            m_bestMove = rootMoves.moves[i];
+            m_bestMoveText = m_solver->bestMove();
+            m_lastCompletedValue = (turn == PLAYER1 ? 1 : -1) * (WIN_SCORE - ENDGAME_FALLBACK_DISTANCE);
+            return true;
+        }
+    }
+    return false;
+}
+
+template<uint32_t N>
 int NineChess_AI_AB::evaluate(int ply) const
 {
     if (m_search.getPhase() == GAME_OVER) {
         return evaluateTerminal(ply);
     }
 
+    // 缓存里存的是与 ply 无关的静态分，取出后再按 ply 截断。
+    const uint64_t key = makeEvalKey();
+    int score = 0;
+    if (!probeEvalCache(key, score)) {
+        if (m_network && !m_accumulators.empty()) {
+            score = m_network->evaluate(m_accumulators.back());
+            // 网络没有专门见过飞子残局的双威胁，这几项照样叠加上去。
+            if (isFlyingEndgame<N>()) {
+                EvalFeatures features;
+                flyingEndgameFeatures<N>(features);
+                score += features.dot(m_weights);
+            }
+        }
+        else {
+            EvalFeatures features;
+            evaluationFeatures<N>(features);
+            score = features.dot(m_weights);
+        }
+        score = clampScore(score, -WIN_SCORE, WIN_SCORE);
+        storeEvalCache(key, score);
+    }
+    return clampScore(score, -WIN_SCORE + ply, WIN_SCORE - ply);
+}
+
+uint64_t NineChess_AI_AB::makeEvalKey() const
+{
+    uint64_t key = m_search.getHashLite();
+    if (m_search.getPhase() == GAME_MID && m_search.getAction() == ACTION_PLACE) {
+        key = mixSelectedPos(key, m_search.m_selectedPos);
+    }
+    return mix64(key);
+}
+
+bool NineChess_AI_AB::probeEvalCache(uint64_t key, int& score) const
+{
+    const EvalCache& cache = s_evalCaches[m_root.getRuleIndex()];
+    const uint64_t entry = cache.entries[key & (EVAL_CACHE_SIZE - 1u)].load(std::memory_order_relaxed);
+    if (entry == 0u || ((entry ^ key) & ~0xffffULL) != 0u) {
+        return false;
+    }
+
+    score = static_cast<int16_t>(static_cast<uint16_t>(entry & 0xffffu));
+    return true;
+}
+
+void NineChess_AI_AB::storeEvalCache(uint64_t key, int score) const
+{
+    EvalCache& cache = s_evalCaches[m_root.getRuleIndex()];
+    const uint64_t entry = (key & ~0xffffULL) | static_cast<uint16_t>(static_cast<int16_t>(score));
+    cache.entries[key & (EVAL_CACHE_SIZE - 1u)].store(entry, std::memory_order_relaxed);
+}
+
+void NineChess_AI_AB::clearEvalCaches()
+{
+    for (EvalCache& cache : s_evalCaches) {
+        for (std::atomic<uint64_t>& entry : cache.entries) {
+            entry.store(0u, std::memory_order_relaxed);
+        }
+    }
+}
+
+void NineChess_AI_AB::evaluationFeatures(EvalFeatures& features) const
+{
+    dispatchRule(m_search.getRuleIndex(), [&](auto rule) {
+        evaluationFeatures<decltype(rule)::value>(features);
+    });
+}
+
+template<uint32_t N>
+void NineChess_AI_AB::evaluationFeatures(EvalFeatures& features) const
+{
+    // 估值是各项特征的线性组合，这里只负责算特征，权重统一放在 EvalWeights 中。
+    features = EvalFeatures();
+    if (m_search.getPhase() == GAME_OVER) {
+        return;
+    }
+
     const int onBoardDiff =
         static_cast<int>(m_search.getPlayer1OnBoardCount())
         - static_cast<int>(m_search.getPlayer2OnBoardCount());
     const int inHandDiff =
         static_cast<int>(m_search.getPlayer1InHand())
         - static_cast<int>(m_search.getPlayer2InHand());
-    const int millDiff = countAllMills(PLAYER1) - countAllMills(PLAYER2);
-    const int openMillDiff = countOpenMills(PLAYER1) - countOpenMills(PLAYER2);
+    const int millDiff = countAllMills<N>(PLAYER1) - countAllMills<N>(PLAYER2);
+    const int openMillDiff = countOpenMills<N>(PLAYER1) - countOpenMills<N>(PLAYER2);
 
-    int mobilityDiff = 0;
-    if (m_search.getPhase() == GAME_MID) {
-        mobilityDiff = countMobility(PLAYER1) - countMobility(PLAYER2);
+    int captureDiff = 0;
+    if (m_search.getAction() == ACTION_CAPTURE) {
+        const int pending = static_cast<int>(m_search.getPendingCaptures());
+        captureDiff = m_search.getTurn() == PLAYER1 ? pending : -pending;
     }
 
-    int score = 0;
     if (m_search.getPhase() == GAME_NOTSTARTED || m_search.getPhase() == GAME_OPENING) {
-        score += onBoardDiff * 120;
-        score += inHandDiff * 48;
-        score += millDiff * 96;
-        score += openMillDiff * 24;
+        features.values[EVAL_OPENING_ON_BOARD] = static_cast<int16_t>(onBoardDiff);
+        features.values[EVAL_OPENING_IN_HAND] = static_cast<int16_t>(inHandDiff);
+        features.values[EVAL_OPENING_MILL] = static_cast<int16_t>(millDiff);
+        features.values[EVAL_OPENING_OPEN_MILL] = static_cast<int16_t>(openMillDiff);
+        features.values[EVAL_OPENING_CAPTURE] = static_cast<int16_t>(captureDiff);
     }
     else {
-        score += onBoardDiff * 180;
-        score += millDiff * 112;
-        score += openMillDiff * 32;
-        score += mobilityDiff * 10;
+        features.values[EVAL_MID_ON_BOARD] = static_cast<int16_t>(onBoardDiff);
+        features.values[EVAL_MID_MILL] = static_cast<int16_t>(millDiff);
+        features.values[EVAL_MID_OPEN_MILL] = static_cast<int16_t>(openMillDiff);
+        features.values[EVAL_MID_MOBILITY] = static_cast<int16_t>(countMobility<N>(PLAYER1) - countMobility<N>(PLAYER2));
+        features.values[EVAL_MID_CAPTURE] = static_cast<int16_t>(captureDiff);
+        flyingEndgameFeatures<N>(features);
     }
+}
 
-    if (m_search.getAction() == ACTION_CAPTURE) {
-        const int captureBonus =
-            (m_search.getPhase() == GAME_OPENING ? 160 : 220)
-            * static_cast<int>(m_search.getPendingCaptures());
-        score += m_search.getTurn() == PLAYER1 ? captureBonus : -captureBonus;
+template<uint32_t N>
+bool NineChess_AI_AB::isFlyingEndgame() const
+{
+    return m_search.canFly<N>(PLAYER1) || m_search.canFly<N>(PLAYER2);
+}
+
+template<uint32_t N>
+void NineChess_AI_AB::flyingEndgameFeatures(EvalFeatures& features) const
+{
+    features.values[EVAL_FLY_THREAT] = 0;
+    features.values[EVAL_FLY_DOUBLE_THREAT] = 0;
+    features.values[EVAL_FLY_BLOCK] = 0;
+    if (m_search.getPhase() != GAME_MID || !isFlyingEndgame<N>()) {
+        return;
     }
 
-    return clampScore(score, -WIN_SCORE + ply, WIN_SCORE - ply);
+    // 飞子一方的每条活二都是下一步的成三威胁，对手一步只能挡一个点：
+    // 威胁点多于对手能挡住的点（至多一个）时就是挡不住的双威胁。
+    const uint32_t threats1 = millThreatPoints<N>(PLAYER1);
+    const uint32_t threats2 = millThreatPoints<N>(PLAYER2);
+    const int blocks1 = countReachablePoints<N>(PLAYER1, threats2);
+    const int blocks2 = countReachablePoints<N>(PLAYER2, threats1);
+    const int count1 = static_cast<int>(POPCOUNT32(threats1));
+    const int count2 = static_cast<int>(POPCOUNT32(threats2));
+    const int double1 = count1 > std::min(blocks2, 1) ? 1 : 0;
+    const int double2 = count2 > std::min(blocks1, 1) ? 1 : 0;
+
+    features.values[EVAL_FLY_THREAT] = static_cast<int16_t>(count1 - count2);
+    features.values[EVAL_FLY_DOUBLE_THREAT] = static_cast<int16_t>(double1 - double2);
+    features.values[EVAL_FLY_BLOCK] = static_cast<int16_t>(blocks1 - blocks2);
+}
+
+template<uint32_t N>
+uint32_t NineChess_AI_AB::millThreatPoints(uint32_t board, uint32_t occupied, bool canFly) const
+{
+    uint32_t points = 0u;
+    for (uint32_t lineId = 0; lineId < RuleTraits<N>::lineCount; ++lineId) {
+        const uint32_t mask = RuleTraits<N>::lineMask(lineId);
+        const uint32_t ownBits = board & mask;
+        if (POPCOUNT32(ownBits) != 2u || POPCOUNT32(occupied & mask) != 2u) {
+            continue;
+        }
+
+        // 补上第三点的棋子不能取自这条线本身。
+        const int32_t emptyPos = CTZ32(mask & ~ownBits);
+        const uint32_t movers = board & ~mask;
+        if (canFly ? movers != 0u : (RuleTraits<N>::moveMask(emptyPos) & movers) != 0u) {
+            points |= NineChess::bitOf(emptyPos);
+        }
+    }
+    return points;
+}
+
+template<uint32_t N>
+uint32_t NineChess_AI_AB::millThreatPoints(NineChess::Players player) const
+{
+    const uint32_t occupied =
+        (m_search.m_data.player1Board | m_search.m_data.player2Board | m_search.m_data.forbiddenBoard)
+        & VALID_BOARD_MASK;
+    return millThreatPoints<N>(m_search.boardOf(player) & VALID_BOARD_MASK, occupied, m_search.canFly<N>(player));
+}
+
+template<uint32_t N>
+int NineChess_AI_AB::countReachablePoints(NineChess::Players player, uint32_t points) const
+{
+    const uint32_t pieces = m_search.boardOf(player) & VALID_BOARD_MASK;
+    if (pieces == 0u || points == 0u) {
+        return 0;
+    }
+    if (m_search.canFly<N>(player)) {
+        return static_cast<int>(POPCOUNT32(points));
+    }
+    return static_cast<int>(POPCOUNT32(RuleTraits<N>::neighbors(pieces) & points));
+}
+
+template<uint32_t N>
+bool NineChess_AI_AB::givesFlyingThreat() const
+{
+    // 成三后还要提子、轮次未交换，这种情况由提子着法本身处理。
+    // 只在应对方已经只剩可飞的子数时延伸：这时它的着法会被 keepFlyingBlocks() 收窄到挡点，延伸几乎不增加结点。
+    if (m_search.getPhase() != GAME_MID || m_search.getAction() != ACTION_CHOOSE
+        || !m_search.canFly<N>(m_search.getTurn())) {
+        return false;
+    }
+    return millThreatPoints<N>(NineChess::opponentOf(m_search.getTurn())) != 0u;
+}
+
+template<uint32_t N>
+void NineChess_AI_AB::keepFlyingBlocks(MoveList& list) const
+{
+    // 只剩可飞子数的一方再被提一子就输了。它这一步成不了三、对手又有成三点时，
+    // 不去挡的着法都会在下一步丢子输棋，只需展开挡点的着法。
+    // 不能重复成三的规则里同一个三连未必能再提子，此时不做收窄。
+    const NineChess::Players turn = m_search.getTurn();
+    if (m_search.getPhase() != GAME_MID || m_search.getAction() != ACTION_CHOOSE
+        || !RuleTraits<N>::allowRepeatedMills || !m_search.canFly<N>(turn)
+        || millThreatPoints<N>(turn) != 0u) {
+        return;
+    }
+
+    const uint32_t threats = millThreatPoints<N>(NineChess::opponentOf(turn));
+    if (threats == 0u) {
+        return;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < list.count; ++i) {
+        if (list.moves[i].type == MOVE_SHIFT && (threats & NineChess::bitOf(list.moves[i].to)) != 0u) {
+            list.moves[kept++] = list.moves[i];
+        }
+    }
+    if (kept > 0u) {
+        list.count = kept;
+    }
 }
 
 int NineChess_AI_AB::evaluateTerminal(int ply) const
@@ -290,10 +752,69 @@ int NineChess_AI_AB::evaluateTerminal(int ply) const
     if (m_search.getWinner() == PLAYER2) {
         return -WIN_SCORE + ply;
     }
-    return 0;
+    return drawScore();
+}
+
+int NineChess_AI_AB::drawScore() const
+{
+    return m_root.getTurn() == PLAYER1 ? -m_contempt : m_contempt;
 }
 
-void NineChess_AI_AB::generateMoves(MoveList& list) const
+void NineChess_AI_AB::buildPositionHistory(const NineChess& chess)
+{
+    m_positionHistory.clear();
+    m_reversibleBegin = 0;
+    if (m_root.getPhase() != GAME_MID) {
+        return;
+    }
+
+    // 从开局重放命令历史。提子之后的局面不可能回到提子之前，只保留最后一次提子之后的部分。
+    // 由 setData() 等方式直接摆出的局面没有可重放的历史，重放结果对不上根局面时只保留根局面。
+    NineChess replay(chess);
+    replay.reset();
+    replay.start();
+    bool replayed = true;
+    for (const NineChess::MoveRecord record : chess.getMoveHistory()) {
+        const uint32_t piecesBefore = replay.getPlayer1OnBoardCount() + replay.getPlayer2OnBoardCount()
+            + replay.getPlayer1InHand() + replay.getPlayer2InHand();
+        if (!replay.playMoveRecord(record)) {
+            replayed = false;
+            break;
+        }
+        const uint32_t piecesAfter = replay.getPlayer1OnBoardCount() + replay.getPlayer2OnBoardCount()
+            + replay.getPlayer1InHand() + replay.getPlayer2InHand();
+        if (replay.getPhase() != GAME_MID || piecesAfter != piecesBefore) {
+            m_positionHistory.clear();
+        }
+        if (replay.getPhase() == GAME_MID) {
+            m_positionHistory.push_back(replay.getHash());
+        }
+    }
+
+    const uint64_t rootHash = m_root.getHash();
+    if (!replayed || m_positionHistory.empty() || m_positionHistory.back() != rootHash) {
+        m_positionHistory.assign(1u, rootHash);
+    }
+}
+
+bool NineChess_AI_AB::isRepetition() const
+{
+    if (m_search.getPhase() != GAME_MID || m_positionHistory.size() < m_reversibleBegin + 2u) {
+        return false;
+    }
+
+    // 栈顶就是当前局面。
+    const uint64_t hash = m_positionHistory.back();
+    for (size_t i = m_reversibleBegin; i + 1u < m_positionHistory.size(); ++i) {
+        if (m_positionHistory[i] == hash) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<uint32_t N>
+void NineChess_AI_AB::generateMoves(MoveList& list, bool reduceSymmetry) const
 {
     list.count = 0;
     if (m_search.getPhase() == GAME_OVER) {
@@ -301,31 +822,109 @@ void NineChess_AI_AB::generateMoves(MoveList& list) const
     }
 
     if (m_search.getAction() == ACTION_CAPTURE) {
-        generateCaptureMoves(list);
+        generateCaptureMoves<N>(list);
+    }
+    else if (m_search.getPhase() == GAME_NOTSTARTED || m_search.getPhase() == GAME_OPENING) {
+        generateOpeningMoves<N>(list);
+    }
+    else if (m_search.getPhase() == GAME_MID) {
+        if (m_search.getAction() == ACTION_PLACE && m_search.isValidPos(m_search.m_selectedPos)) {
+            generateMovesFromSelected<N>(list, m_search.m_selectedPos);
+        }
+        else {
+            generateMidMoves<N>(list);
+        }
+    }
+
+    if (reduceSymmetry) {
+        reduceSymmetricMoves<N>(list);
+    }
+}
+
+template<uint32_t N>
+size_t NineChess_AI_AB::findStabilizer(std::array<uint8_t, SYMMETRY_COUNT>& stabilizer) const
+{
+    const NineChess::ChessData& data = m_search.m_data;
+    const bool selected = m_search.getPhase() == GAME_MID
+        && m_search.getAction() == ACTION_PLACE
+        && m_search.isValidPos(m_search.m_selectedPos);
+
+    // 绝大多数局面在第一块位棋盘上就不对称，先比较位棋盘，代价很小。
+    // 九连棋的编号棋子与历史三连再用对称哈希确认。
+    size_t count = 0;
+    uint64_t identityHash = 0u;
+    for (size_t i = 1; i < m_symmetryCount; ++i) {
+        const SymmetryVariant& symmetry = m_symmetries[i];
+        if (mapBoard(data.player1Board, symmetry) != data.player1Board
+            || mapBoard(data.player2Board, symmetry) != data.player2Board
+            || mapBoard(data.forbiddenBoard, symmetry) != data.forbiddenBoard) {
+            continue;
+        }
+        if (selected && symmetry.posMap[static_cast<size_t>(m_search.m_selectedPos)] != m_search.m_selectedPos) {
+            continue;
+        }
+        if (!RuleTraits<N>::allowRepeatedMills) {
+            if (identityHash == 0u) {
+                identityHash = makeSymmetryHash<N>(m_symmetries[0]);
+            }
+            if (makeSymmetryHash<N>(symmetry) != identityHash) {
+                continue;
+            }
+        }
+        stabilizer[count++] = static_cast<uint8_t>(i);
+    }
+    return count;
+}
+
+template<uint32_t N>
+void NineChess_AI_AB::reduceSymmetricMoves(MoveList& list) const
+{
+    if (list.count < 2u) {
         return;
     }
 
-    if (m_search.getPhase() == GAME_NOTSTARTED || m_search.getPhase() == GAME_OPENING) {
-        generateOpeningMoves(list);
+    // 重复判和要和历史栈里的局面比较。稳定子群只保证当前局面映射回自身，
+    // 可重复区间里更早的局面一般不对称，等价着法的子树可能一个重复、一个不重复，
+    // 所以区间内除当前局面外还有别的局面时不做约简。
+    if (m_positionHistory.size() > m_reversibleBegin + 1u) {
         return;
     }
 
-    if (m_search.getPhase() == GAME_MID) {
-        if (m_search.getAction() == ACTION_PLACE && m_search.isValidPos(m_search.m_selectedPos)) {
-            generateMovesFromSelected(list, m_search.m_selectedPos);
+    std::array<uint8_t, SYMMETRY_COUNT> stabilizer = {};
+    const size_t stabilizerCount = findStabilizer<N>(stabilizer);
+    if (stabilizerCount == 0u) {
+        return;
+    }
+
+    // 稳定子群中的变换把局面映射回自身，也就把着法 m 的子树映射成 s(m) 的子树。
+    // 同一等价类里只保留编号最大的着法：它在任何 s 下的像都不比自己大。
+    // 取最大而不是最小，是因为同分着法排序后保持生成顺序，实测这样剪枝更早。
+    const auto moveKey = [](int32_t from, int32_t to) {
+        return (from + 1) * BOARD_SIZE + to;
+    };
+
+    size_t kept = 0;
+    for (size_t i = 0; i < list.count; ++i) {
+        const Move& move = list.moves[i];
+        const int32_t key = moveKey(move.from, move.to);
+        bool representative = true;
+        for (size_t k = 0; k < stabilizerCount && representative; ++k) {
+            const SymmetryVariant& symmetry = m_symmetries[stabilizer[k]];
+            const int32_t from = move.from >= 0 ? symmetry.posMap[static_cast<size_t>(move.from)] : -1;
+            const int32_t to = symmetry.posMap[static_cast<size_t>(move.to)];
+            representative = moveKey(from, to) <= key;
         }
-        else {
-            generateMidMoves(list);
+        if (representative) {
+            list.moves[kept++] = move;
         }
     }
+    list.count = kept;
 }
 
+template<uint32_t N>
 void NineChess_AI_AB::generateOpeningMoves(MoveList& list) const
 {
-    const uint32_t occupied =
-        (m_search.m_data.player1Board | m_search.m_data.player2Board | m_search.m_data.forbiddenBoard)
-        & m_search.m_validBoardMask;
-    uint32_t empty = (~occupied) & m_search.m_validBoardMask;
+    uint32_t empty = m_search.legalTargets<N>();
 
     while (empty != 0u && list.count < MoveList::MAX_COUNT) {
         const int32_t pos = CTZ32(empty);
@@ -333,71 +932,44 @@ void NineChess_AI_AB::generateOpeningMoves(MoveList& list) const
         move.type = MOVE_PLACE;
         move.from = -1;
         move.to = static_cast<int8_t>(pos);
-        move.order = static_cast<int16_t>(scorePlaceOrShiftMove(-1, pos));
+        move.order = static_cast<int16_t>(scorePlaceOrShiftMove<N>(-1, pos));
         empty &= empty - 1u;
     }
 }
 
+template<uint32_t N>
 void NineChess_AI_AB::generateMidMoves(MoveList& list) const
 {
-    const NineChess::Players turn = m_search.getTurn();
-    uint32_t pieces = m_search.boardOf(turn) & m_search.m_validBoardMask;
+    uint32_t pieces = m_search.legalSources<N>();
 
     while (pieces != 0u && list.count < MoveList::MAX_COUNT) {
         const int32_t fromPos = CTZ32(pieces);
-        generateMovesFromSelected(list, fromPos);
+        generateMovesFromSelected<N>(list, fromPos);
         pieces &= pieces - 1u;
     }
 }
 
+template<uint32_t N>
 void NineChess_AI_AB::generateMovesFromSelected(MoveList& list, int32_t fromPos) const
 {
-    if (!m_search.isValidPos(fromPos)) {
-        return;
-    }
-
-    const NineChess::Players turn = m_search.getTurn();
-    const uint32_t occupied =
-        (m_search.m_data.player1Board | m_search.m_data.player2Board | m_search.m_data.forbiddenBoard)
-        & m_search.m_validBoardMask;
-    const uint32_t empty = (~occupied) & m_search.m_validBoardMask;
-    uint32_t targets = 0u;
-
-    if (m_search.canFly(turn)) {
-        targets = empty;
-    }
-    else {
-        targets = m_search.m_moveMask[fromPos] & empty & m_search.m_validBoardMask;
-    }
-
+    uint32_t targets = m_search.legalTargets<N>(fromPos);
     while (targets != 0u && list.count < MoveList::MAX_COUNT) {
         const int32_t toPos = CTZ32(targets);
         Move& move = list.moves[list.count++];
         move.type = MOVE_SHIFT;
         move.from = static_cast<int8_t>(fromPos);
         move.to = static_cast<int8_t>(toPos);
-        move.order = static_cast<int16_t>(scorePlaceOrShiftMove(fromPos, toPos));
+        move.order = static_cast<int16_t>(scorePlaceOrShiftMove<N>(fromPos, toPos));
         targets &= targets - 1u;
     }
 }
 
+template<uint32_t N>
 void NineChess_AI_AB::generateCaptureMoves(MoveList& list) const
 {
-    const NineChess::Players defender = NineChess::opponentOf(m_search.getTurn());
-    uint32_t targets = m_search.boardOf(defender) & m_search.m_validBoardMask;
-
-    if (!m_search.isAllInMills(defender)) {
-        uint32_t filtered = 0u;
-        uint32_t bits = targets;
-        while (bits != 0u) {
-            const int32_t pos = CTZ32(bits);
-            if (!m_search.isPieceInMill(pos)) {
-                filtered |= NineChess::bitOf(pos);
-            }
-            bits &= bits - 1u;
-        }
-        targets = filtered;
-    }
+    // 提子排序还要用到对手的三连掩码。
+    const uint32_t mills = m_search.millBoard<N>(NineChess::opponentOf(m_search.getTurn()));
+    uint32_t targets = m_search.legalCaptures<N>();
 
     while (targets != 0u && list.count < MoveList::MAX_COUNT) {
         const int32_t pos = CTZ32(targets);
@@ -405,7 +977,7 @@ void NineChess_AI_AB::generateCaptureMoves(MoveList& list) const
         move.type = MOVE_CAPTURE;
         move.from = -1;
         move.to = static_cast<int8_t>(pos);
-        move.order = static_cast<int16_t>(scoreCaptureMove(pos));
+        move.order = static_cast<int16_t>(scoreCaptureMove<N>(pos, mills));
         targets &= targets - 1u;
     }
 }
@@ -428,57 +1000,95 @@ void NineChess_AI_AB::orderMoves(MoveList& list, bool isRoot) const
         });
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::scorePlaceOrShiftMove(int32_t fromPos, int32_t toPos) const
 {
     const NineChess::Players turn = m_search.getTurn();
     const NineChess::Players opponent = NineChess::opponentOf(turn);
+    const int openMills = countOpenMillsAfterOccupy<N>(turn, fromPos, toPos);
+    const int blockedThreats = countBlockedThreats<N>(opponent, toPos);
 
     int score = 0;
-    score += countMillsAfterOccupy(turn, fromPos, toPos) * 2400;
-    score += countOpenMillsAfterOccupy(turn, fromPos, toPos) * 240;
-    score += countBlockedThreats(opponent, toPos) * 180;
-    score += countLinesThroughPos(turn, toPos) * 48;
+    score += countMillsAfterOccupy<N>(turn, fromPos, toPos) * m_weights[ORDER_MILL];
+    score += openMills * m_weights[ORDER_OPEN_MILL];
+    score += blockedThreats * m_weights[ORDER_BLOCK_THREAT];
+    score += countLinesThroughPos<N>(turn, toPos) * m_weights[ORDER_LINES];
 
     if (fromPos >= 0) {
-        score -= static_cast<int>(m_search.countMillsAt(fromPos)) * 160;
+        score -= static_cast<int>(m_search.countMillsAt<N>(fromPos)) * m_weights[ORDER_LEAVE_MILL];
+
+        // 飞子残局里活二几乎都是下一步的成三威胁：先挡对手的成三点，再走出自己的威胁。
+        if (isFlyingEndgame<N>()) {
+            score += blockedThreats * m_weights[ORDER_FLY_BLOCK];
+            score += openMills * m_weights[ORDER_FLY_THREAT];
+        }
     }
 
     return score;
 }
 
-int NineChess_AI_AB::scoreCaptureMove(int32_t pos) const
+template<uint32_t N>
+int NineChess_AI_AB::scoreCaptureMove(int32_t pos, uint32_t defenderMills) const
 {
     const NineChess::Players defender = NineChess::opponentOf(m_search.getTurn());
     int score = 3000;
-    score += countLinesThroughPos(defender, pos) * 128;
-    score += static_cast<int>(m_search.countMillsAt(pos)) * 64;
-    score += static_cast<int>(m_search.m_posLineCount[pos]) * 32;
+    score += countLinesThroughPos<N>(defender, pos) * 128;
+
+    // defenderMills 只包含完整三连上的点位，
+    // 因此“经过 pos 且三个点都落在该掩码内”的线，正好就是 pos 所在的三连。
+    if ((defenderMills & NineChess::bitOf(pos)) != 0u) {
+        for (uint32_t index = 0; index < RuleTraits<N>::posLineCount(pos); ++index) {
+            const int32_t lineId = RuleTraits<N>::posLineId(pos, index);
+            if (lineId >= 0 && (RuleTraits<N>::lineMask(lineId) & ~defenderMills) == 0u) {
+                score += 64;
+            }
+        }
+    }
+
+    score += static_cast<int>(RuleTraits<N>::posLineCount(pos)) * 32;
     return score;
 }
 
+template<uint32_t N>
 void NineChess_AI_AB::applyMove(const Move& move, Snapshot& snapshot)
 {
     snapshot.data = m_search.m_data;
     snapshot.winner = m_search.m_winner;
     snapshot.selectedPos = m_search.m_selectedPos;
+    snapshot.historySize = m_positionHistory.size();
+    snapshot.reversibleBegin = m_reversibleBegin;
 
     switch (move.type)
     {
     case MOVE_PLACE:
-        m_search.placeFast(move.to);
+        m_search.placeFast<N>(move.to);
         break;
     case MOVE_SHIFT:
         if (m_search.getAction() == ACTION_CHOOSE) {
             m_search.chooseFast(move.from);
         }
-        m_search.placeFast(move.to);
+        m_search.placeFast<N>(move.to);
         break;
     case MOVE_CAPTURE:
-        m_search.captureFast(move.to);
+        m_search.captureFast<N>(move.to);
         break;
     default:
         break;
     }
+
+    // 落子和提子改变了子力，之前的局面不会再出现。
+    if (move.type != MOVE_SHIFT) {
+        m_reversibleBegin = m_positionHistory.size();
+    }
+    if (m_search.getPhase() == GAME_MID) {
+        m_positionHistory.push_back(m_search.getHash<N>());
+    }
+
+    if (m_network && !m_accumulators.empty()) {
+        m_accumulators.emplace_back();
+        const size_t top = m_accumulators.size() - 1;
+        m_network->update(m_accumulators[top - 1], snapshot.data, m_search.m_data, m_accumulators[top]);
+    }
 }
 
 void NineChess_AI_AB::undoMove(const Snapshot& snapshot)
@@ -486,23 +1096,52 @@ void NineChess_AI_AB::undoMove(const Snapshot& snapshot)
     m_search.m_data = snapshot.data;
     m_search.m_winner = snapshot.winner;
     m_search.m_selectedPos = snapshot.selectedPos;
+    m_positionHistory.resize(snapshot.historySize);
+    m_reversibleBegin = snapshot.reversibleBegin;
+
+    if (m_accumulators.size() > 1) {
+        m_accumulators.pop_back();
+    }
 }
 
+void NineChess_AI_AB::resetAccumulators()
+{
+    m_accumulators.clear();
+    if (m_network) {
+        m_accumulators.emplace_back();
+        m_network->refresh(m_search.m_data, m_accumulators.back());
+    }
+}
+
+template<uint32_t N>
 bool NineChess_AI_AB::probeTransposition(int depth, int& alpha, int& beta, int& value) const
 {
     // makeCanonicalHash 会把 16 个等价视角压成同一个 key，
     // 因此这里一次查表，等价于“顺带查了所有镜像 / 翻转 / 旋转局面”。
-    const uint64_t hash = makeCanonicalHash();
-    TTStore& store = s_ttStores[m_root.getRuleIndex()];
-    std::lock_guard<std::mutex> lock(store.mutex);
-
-    const std::unordered_map<uint64_t, TTEntry>::iterator it = store.table.find(hash);
-    if (it == store.table.end()) {
-        return false;
+    const uint64_t hash = makeTranspositionKey<N>();
+    TTEntry entry;
+    if (m_sharedTable) {
+        // 共享表无锁读取，命中时不回写世代号。
+        SharedTTEntry shared;
+        if (!m_sharedTable->probe(hash, shared)) {
+            return false;
+        }
+        entry.value = shared.value;
+        entry.depth = shared.depth;
+        entry.flag = shared.flag;
     }
+    else {
+        TTStore& store = s_ttStores[m_root.getRuleIndex()];
+        std::lock_guard<std::mutex> lock(store.mutex);
 
-    TTEntry& entry = it->second;
-    entry.generation = m_generation;
+        const std::unordered_map<uint64_t, TTEntry>::iterator it = store.table.find(hash);
+        if (it == store.table.end()) {
+            return false;
+        }
+
+        it->second.generation = m_generation;
+        entry = it->second;
+    }
 
     if (entry.depth < depth) {
         return false;
@@ -527,17 +1166,10 @@ bool NineChess_AI_AB::probeTransposition(int depth, int& alpha, int& beta, int&
     return alpha >= beta;
 }
 
+template<uint32_t N>
 void NineChess_AI_AB::storeTransposition(int depth, int value, int alpha, int beta) const
 {
-    const uint64_t hash = makeCanonicalHash();
-    TTStore& store = s_ttStores[m_root.getRuleIndex()];
-    std::lock_guard<std::mutex> lock(store.mutex);
-    const std::unordered_map<uint64_t, TTEntry>::iterator existing = store.table.find(hash);
-
-    if (existing == store.table.end() && store.table.size() >= MAX_TT_ENTRIES) {
-        pruneTranspositionStore(store);
-    }
-
+    const uint64_t hash = makeTranspositionKey<N>();
     TTEntry entry;
     entry.value = static_cast<int16_t>(clampScore(value, -INF_SCORE, INF_SCORE));
     entry.depth = static_cast<int16_t>(depth);
@@ -553,6 +1185,22 @@ void NineChess_AI_AB::storeTransposition(int depth, int value, int alpha, int be
         entry.flag = TT_LOWER;
     }
 
+    if (m_sharedTable) {
+        SharedTTEntry shared;
+        shared.value = entry.value;
+        shared.depth = entry.depth;
+        shared.flag = entry.flag;
+        shared.generation = static_cast<uint8_t>(m_generation);
+        m_sharedTable->store(hash, shared);
+        return;
+    }
+
+    TTStore& store = s_ttStores[m_root.getRuleIndex()];
+    std::lock_guard<std::mutex> lock(store.mutex);
+    if (store.table.find(hash) == store.table.end() && store.table.size() >= MAX_TT_ENTRIES) {
+        pruneTranspositionStore(store);
+    }
+
     TTEntry& slot = store.table[hash];
     if (slot.depth <= entry.depth) {
         slot = entry;
@@ -568,6 +1216,13 @@ void NineChess_AI_AB::beginTranspositionGeneration()
 {
     TTStore& store = s_ttStores[m_root.getRuleIndex()];
     std::lock_guard<std::mutex> lock(store.mutex);
+    m_sharedTable = store.shared;
+    if (m_sharedTable) {
+        // 共享表的世代号由段头统一计数，各进程的新搜索都会推进它。
+        m_generation = m_sharedTable->nextGeneration();
+        return;
+    }
+
     ++store.generation;
     if (store.generation == 0u) {
         ++store.generation;
@@ -575,6 +1230,41 @@ void NineChess_AI_AB::beginTranspositionGeneration()
     m_generation = store.generation;
 }
 
+bool NineChess_AI_AB::attachSharedTranspositionTable(uint32_t ruleIndex, const std::string& name, size_t memoryMB)
+{
+    if (ruleIndex >= RULE_COUNT || name.empty()) {
+        return false;
+    }
+
+    std::shared_ptr<SharedTranspositionTable> shared = std::make_shared<SharedTranspositionTable>();
+    if (!shared->attach(sharedTranspositionTableName(ruleIndex, name), ruleIndex, TT_HASH_SCHEME, memoryMB)) {
+        return false;
+    }
+
+    TTStore& store = s_ttStores[ruleIndex];
+    std::lock_guard<std::mutex> lock(store.mutex);
+    store.shared = shared;
+    store.table.clear();
+    return true;
+}
+
+void NineChess_AI_AB::detachSharedTranspositionTable(uint32_t ruleIndex)
+{
+    if (ruleIndex >= RULE_COUNT) {
+        return;
+    }
+
+    // 正在搜索的实例仍持有引用，搜索结束后段才真正解除映射。
+    TTStore& store = s_ttStores[ruleIndex];
+    std::lock_guard<std::mutex> lock(store.mutex);
+    store.shared.reset();
+}
+
+std::string NineChess_AI_AB::sharedTranspositionTableName(uint32_t ruleIndex, const std::string& name)
+{
+    return name + "_rule" + std::to_string(ruleIndex);
+}
+
 void NineChess_AI_AB::pruneTranspositionStore(TTStore& store) const
 {
     if (store.table.size() < MAX_TT_ENTRIES) {
@@ -631,13 +1321,146 @@ void NineChess_AI_AB::pruneTranspositionStore(TTStore& store) const
     }
 }
 
+bool NineChess_AI_AB::saveTranspositionTable(uint32_t ruleIndex, const std::string& path)
+{
+    if (ruleIndex >= RULE_COUNT) {
+        return false;
+    }
+
+    // 先在锁内拷出条目，排序和写文件不占用置换表。
+    std::vector<std::pair<uint64_t, TTEntry>> entries;
+    {
+        TTStore& store = s_ttStores[ruleIndex];
+        std::lock_guard<std::mutex> lock(store.mutex);
+        if (store.shared) {
+            store.shared->forEach([&entries](uint64_t key, const SharedTTEntry& shared) {
+                TTEntry entry;
+                entry.value = shared.value;
+                entry.depth = shared.depth;
+                entry.flag = shared.flag;
+                entries.emplace_back(key, entry);
+            });
+        }
+        else {
+            entries.assign(store.table.begin(), store.table.end());
+        }
+    }
+    if (entries.empty()) {
+        return false;
+    }
+
+    // 深条目在前，载入时超出上限只会舍弃最浅的部分。
+    std::sort(entries.begin(), entries.end(),
+        [](const std::pair<uint64_t, TTEntry>& lhs, const std::pair<uint64_t, TTEntry>& rhs) {
+            if (lhs.second.depth != rhs.second.depth) {
+                return lhs.second.depth > rhs.second.depth;
+            }
+            return lhs.first < rhs.first;
+        });
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    // 文件头：魔数、版本、规则、哈希方案、条目格式、条目字节数、条目数（64 位）。
+    writeU32(out, TT_FILE_MAGIC);
+    writeU32(out, TT_FILE_VERSION);
+    writeU32(out, ruleIndex);
+    writeU32(out, TT_HASH_SCHEME);
+    writeU32(out, TT_ENTRY_FORMAT);
+    writeU32(out, static_cast<uint32_t>(TT_FILE_ENTRY_SIZE));
+    writeU64(out, static_cast<uint64_t>(entries.size()));
+
+    for (const std::pair<uint64_t, TTEntry>& item : entries) {
+        writeU64(out, item.first);
+        writeU16(out, static_cast<uint16_t>(item.second.value));
+        writeU16(out, static_cast<uint16_t>(item.second.depth));
+        const char tail[4] = { static_cast<char>(item.second.flag), 0, 0, 0 };
+        out.write(tail, sizeof(tail));
+    }
+    return static_cast<bool>(out);
+}
+
+bool NineChess_AI_AB::loadTranspositionTable(uint32_t ruleIndex, const std::string& path)
+{
+    if (ruleIndex >= RULE_COUNT) {
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.open(path) || file.size() < TT_FILE_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint8_t* header = file.data();
+    const uint64_t count = readU64(header + 24);
+    if (readU32(header) != TT_FILE_MAGIC
+        || readU32(header + 4) != TT_FILE_VERSION
+        || readU32(header + 8) != ruleIndex
+        || readU32(header + 12) != TT_HASH_SCHEME
+        || readU32(header + 16) != TT_ENTRY_FORMAT
+        || readU32(header + 20) != TT_FILE_ENTRY_SIZE
+        // 先限制条目数，避免损坏的计数让乘法回绕后通过长度检查。
+        || count > (file.size() - TT_FILE_HEADER_SIZE) / TT_FILE_ENTRY_SIZE
+        || file.size() != TT_FILE_HEADER_SIZE + count * TT_FILE_ENTRY_SIZE) {
+        return false;
+    }
+
+    TTStore& store = s_ttStores[ruleIndex];
+    std::lock_guard<std::mutex> lock(store.mutex);
+    if (store.shared) {
+        // 共享表按当前世代写入，同键更深的条目由 store() 保留。
+        const uint8_t generation = store.shared->generation();
+        for (uint64_t i = 0; i < count; ++i) {
+            const uint8_t* bytes = file.data() + TT_FILE_HEADER_SIZE + i * TT_FILE_ENTRY_SIZE;
+            SharedTTEntry entry;
+            entry.value = static_cast<int16_t>(readU16(bytes + 8));
+            entry.depth = static_cast<int16_t>(readU16(bytes + 10));
+            entry.flag = bytes[12];
+            entry.generation = generation;
+            if (entry.flag <= TT_UPPER) {
+                store.shared->store(readU64(bytes), entry);
+            }
+        }
+        return true;
+    }
+
+    const size_t capacity = MAX_TT_ENTRIES;
+    store.table.reserve(std::min<size_t>(capacity, store.table.size() + static_cast<size_t>(count)));
+    for (uint64_t i = 0; i < count; ++i) {
+        const uint8_t* bytes = file.data() + TT_FILE_HEADER_SIZE + i * TT_FILE_ENTRY_SIZE;
+        TTEntry entry;
+        entry.value = static_cast<int16_t>(readU16(bytes + 8));
+        entry.depth = static_cast<int16_t>(readU16(bytes + 10));
+        entry.flag = bytes[12];
+        entry.generation = store.generation;
+        if (entry.flag > TT_UPPER) {
+            continue;
+        }
+
+        const uint64_t key = readU64(bytes);
+        const std::unordered_map<uint64_t, TTEntry>::iterator existing = store.table.find(key);
+        if (existing != store.table.end()) {
+            if (existing->second.depth < entry.depth) {
+                existing->second = entry;
+            }
+        }
+        else if (store.table.size() < MAX_TT_ENTRIES) {
+            store.table.emplace(key, entry);
+        }
+    }
+    return true;
+}
+
+template<uint32_t N>
 uint64_t NineChess_AI_AB::makeCanonicalHash() const
 {
     // 对每个等价变换都生成一个哈希，取最小值作为 canonical key。
     // 这样无论局面是原图、镜像图还是旋转后的图，都会落到同一个 TT 桶里。
-    uint64_t bestHash = makeSymmetryHash(m_symmetries[0]);
+    uint64_t bestHash = makeSymmetryHash<N>(m_symmetries[0]);
     for (size_t i = 1; i < m_symmetryCount; ++i) {
-        const uint64_t current = makeSymmetryHash(m_symmetries[i]);
+        const uint64_t current = makeSymmetryHash<N>(m_symmetries[i]);
         if (current < bestHash) {
             bestHash = current;
         }
@@ -645,6 +1468,7 @@ uint64_t NineChess_AI_AB::makeCanonicalHash() const
     return bestHash;
 }
 
+template<uint32_t N>
 uint64_t NineChess_AI_AB::makeSymmetryHash(const SymmetryVariant& symmetry) const
 {
     // 先把当前局面搬到“某个具体对称视角”下，再调用 NineChess 自带哈希。
@@ -657,7 +1481,7 @@ uint64_t NineChess_AI_AB::makeSymmetryHash(const SymmetryVariant& symmetry) cons
     data.forbiddenBoard = mapBoard(m_search.m_data.forbiddenBoard, symmetry);
 
     uint64_t hash = 0u;
-    if (m_search.m_rule.allowRepeatedMills) {
+    if (RuleTraits<N>::allowRepeatedMills) {
         hash = data.getHashLite();
     }
     else {
@@ -667,7 +1491,7 @@ uint64_t NineChess_AI_AB::makeSymmetryHash(const SymmetryVariant& symmetry) cons
 
         data.millHistory.resize(m_search.m_data.millHistory.size());
         for (size_t i = 0; i < m_search.m_data.millHistory.size(); ++i) {
-            data.millHistory[i] = mapMillKey(m_search.m_data.millHistory[i], symmetry);
+            data.millHistory[i] = mapMillKey<N>(m_search.m_data.millHistory[i], symmetry);
         }
         hash = data.getHashHard();
     }
@@ -736,18 +1560,18 @@ void NineChess_AI_AB::buildSymmetryVariants()
 
                 // 再建线映射：原三连线 -> 变换后对应的三连线。
                 // 对九连棋还要顺便记录“原线内三个编号槽位如何重排”。
-                for (uint32_t lineId = 0; lineId < m_root.m_lineCount; ++lineId) {
+                for (uint32_t lineId = 0; lineId < m_root.m_tables->lineCount; ++lineId) {
                     const int32_t mappedPos[MILL] = {
-                        symmetry.posMap[static_cast<size_t>(m_root.m_linePos[lineId][0])],
-                        symmetry.posMap[static_cast<size_t>(m_root.m_linePos[lineId][1])],
-                        symmetry.posMap[static_cast<size_t>(m_root.m_linePos[lineId][2])]
+                        symmetry.posMap[static_cast<size_t>(m_root.m_tables->linePos[lineId][0])],
+                        symmetry.posMap[static_cast<size_t>(m_root.m_tables->linePos[lineId][1])],
+                        symmetry.posMap[static_cast<size_t>(m_root.m_tables->linePos[lineId][2])]
                     };
                     const uint32_t mappedMask =
                         NineChess::bitOf(mappedPos[0]) | NineChess::bitOf(mappedPos[1]) | NineChess::bitOf(mappedPos[2]);
 
                     int32_t newLineId = -1;
-                    for (uint32_t candidate = 0; candidate < m_root.m_lineCount; ++candidate) {
-                        if (m_root.m_lineMasks[candidate] == mappedMask) {
+                    for (uint32_t candidate = 0; candidate < m_root.m_tables->lineCount; ++candidate) {
+                        if (m_root.m_tables->lineMasks[candidate] == mappedMask) {
                             newLineId = static_cast<int32_t>(candidate);
                             break;
                         }
@@ -759,7 +1583,7 @@ void NineChess_AI_AB::buildSymmetryVariants()
                     }
 
                     for (int32_t targetIndex = 0; targetIndex < MILL; ++targetIndex) {
-                        const int32_t targetPos = m_root.m_linePos[newLineId][targetIndex];
+                        const int32_t targetPos = m_root.m_tables->linePos[newLineId][targetIndex];
                         uint8_t sourceIndex = 0u;
                         for (int32_t candidate = 0; candidate < MILL; ++candidate) {
                             if (mappedPos[candidate] == targetPos) {
@@ -779,7 +1603,7 @@ uint32_t NineChess_AI_AB::mapBoard(uint32_t board, const SymmetryVariant& symmet
 {
     // 位棋盘映射本质上就是把每个 1 bit 搬到变换后的新位置。
     uint32_t result = 0u;
-    uint32_t bits = board & m_root.m_validBoardMask;
+    uint32_t bits = board & VALID_BOARD_MASK;
     while (bits != 0u) {
         const int32_t pos = CTZ32(bits);
         result |= NineChess::bitOf(symmetry.posMap[static_cast<size_t>(pos)]);
@@ -788,6 +1612,7 @@ uint32_t NineChess_AI_AB::mapBoard(uint32_t board, const SymmetryVariant& symmet
     return result;
 }
 
+template<uint32_t N>
 NineChess::MillKey NineChess_AI_AB::mapMillKey(NineChess::MillKey key, const SymmetryVariant& symmetry) const
 {
     // 九连棋的历史三连不只是“哪条线成三”，
@@ -796,7 +1621,7 @@ NineChess::MillKey NineChess_AI_AB::mapMillKey(NineChess::MillKey key, const Sym
     // 1. 映射 lineId；
     // 2. 按新线的位置顺序重排 3 个 piece 编号。
     const uint32_t oldLineId = getMillKeyLineId(key);
-    if (oldLineId >= m_root.m_lineCount) {
+    if (oldLineId >= RuleTraits<N>::lineCount) {
         return key;
     }
 
@@ -819,28 +1644,30 @@ NineChess::MillKey NineChess_AI_AB::mapMillKey(NineChess::MillKey key, const Sym
         newPieces[0], newPieces[1], newPieces[2]);
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::countAllMills(NineChess::Players player) const
 {
-    const uint32_t board = m_search.boardOf(player) & m_search.m_validBoardMask;
+    const uint32_t board = m_search.boardOf(player) & VALID_BOARD_MASK;
     int count = 0;
-    for (uint32_t lineId = 0; lineId < m_search.m_lineCount; ++lineId) {
-        if ((board & m_search.m_lineMasks[lineId]) == m_search.m_lineMasks[lineId]) {
+    for (uint32_t lineId = 0; lineId < RuleTraits<N>::lineCount; ++lineId) {
+        if ((board & RuleTraits<N>::lineMask(lineId)) == RuleTraits<N>::lineMask(lineId)) {
             ++count;
         }
     }
     return count;
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::countOpenMills(NineChess::Players player) const
 {
-    const uint32_t board = m_search.boardOf(player) & m_search.m_validBoardMask;
+    const uint32_t board = m_search.boardOf(player) & VALID_BOARD_MASK;
     const uint32_t occupied =
         (m_search.m_data.player1Board | m_search.m_data.player2Board | m_search.m_data.forbiddenBoard)
-        & m_search.m_validBoardMask;
+        & VALID_BOARD_MASK;
     int count = 0;
 
-    for (uint32_t lineId = 0; lineId < m_search.m_lineCount; ++lineId) {
-        const uint32_t mask = m_search.m_lineMasks[lineId];
+    for (uint32_t lineId = 0; lineId < RuleTraits<N>::lineCount; ++lineId) {
+        const uint32_t mask = RuleTraits<N>::lineMask(lineId);
         const uint32_t ownBits = board & mask;
         if (POPCOUNT32(ownBits) == 2u && POPCOUNT32(occupied & mask) == 2u) {
             ++count;
@@ -849,6 +1676,7 @@ int NineChess_AI_AB::countOpenMills(NineChess::Players player) const
     return count;
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::countMobility(NineChess::Players player) const
 {
     if (m_search.getPhase() != GAME_MID) {
@@ -857,8 +1685,8 @@ int NineChess_AI_AB::countMobility(NineChess::Players player) const
 
     const uint32_t occupied =
         (m_search.m_data.player1Board | m_search.m_data.player2Board | m_search.m_data.forbiddenBoard)
-        & m_search.m_validBoardMask;
-    const uint32_t empty = (~occupied) & m_search.m_validBoardMask;
+        & VALID_BOARD_MASK;
+    const uint32_t empty = (~occupied) & VALID_BOARD_MASK;
 
     if (m_search.getAction() == ACTION_CAPTURE && m_search.getTurn() == player) {
         return static_cast<int>(m_search.getPendingCaptures());
@@ -867,15 +1695,15 @@ int NineChess_AI_AB::countMobility(NineChess::Players player) const
     if (m_search.getAction() == ACTION_PLACE
         && m_search.getTurn() == player
         && m_search.isValidPos(m_search.m_selectedPos)) {
-        if (m_search.canFly(player)) {
+        if (m_search.canFly<N>(player)) {
             return static_cast<int>(POPCOUNT32(empty));
         }
-        return static_cast<int>(POPCOUNT32(m_search.m_moveMask[m_search.m_selectedPos] & empty));
+        return static_cast<int>(POPCOUNT32(RuleTraits<N>::moveMask(m_search.m_selectedPos) & empty));
     }
 
-    uint32_t pieces = m_search.boardOf(player) & m_search.m_validBoardMask;
+    uint32_t pieces = m_search.boardOf(player) & VALID_BOARD_MASK;
     int mobility = 0;
-    if (m_search.canFly(player)) {
+    if (m_search.canFly<N>(player)) {
         const int emptyCount = static_cast<int>(POPCOUNT32(empty));
         while (pieces != 0u) {
             ++mobility;
@@ -886,31 +1714,32 @@ int NineChess_AI_AB::countMobility(NineChess::Players player) const
 
     while (pieces != 0u) {
         const int32_t pos = CTZ32(pieces);
-        mobility += static_cast<int>(POPCOUNT32(m_search.m_moveMask[pos] & empty));
+        mobility += static_cast<int>(POPCOUNT32(RuleTraits<N>::moveMask(pos) & empty));
         pieces &= pieces - 1u;
     }
     return mobility;
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::countBlockedThreats(NineChess::Players player, int32_t pos) const
 {
     if (!m_search.isValidPos(pos)) {
         return 0;
     }
 
-    const uint32_t board = m_search.boardOf(player) & m_search.m_validBoardMask;
+    const uint32_t board = m_search.boardOf(player) & VALID_BOARD_MASK;
     const uint32_t occupied =
         (m_search.m_data.player1Board | m_search.m_data.player2Board | m_search.m_data.forbiddenBoard)
-        & m_search.m_validBoardMask;
+        & VALID_BOARD_MASK;
     int count = 0;
 
-    for (uint32_t index = 0; index < m_search.m_posLineCount[pos]; ++index) {
-        const int32_t lineId = m_search.m_posLineIds[pos][index];
+    for (uint32_t index = 0; index < RuleTraits<N>::posLineCount(pos); ++index) {
+        const int32_t lineId = RuleTraits<N>::posLineId(pos, index);
         if (lineId < 0) {
             continue;
         }
 
-        const uint32_t mask = m_search.m_lineMasks[lineId];
+        const uint32_t mask = RuleTraits<N>::lineMask(lineId);
         if (POPCOUNT32(board & mask) == 2u && POPCOUNT32(occupied & mask) == 2u) {
             ++count;
         }
@@ -918,48 +1747,51 @@ int NineChess_AI_AB::countBlockedThreats(NineChess::Players player, int32_t pos)
     return count;
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::countLinesThroughPos(NineChess::Players player, int32_t pos) const
 {
     if (!m_search.isValidPos(pos)) {
         return 0;
     }
 
-    const uint32_t board = m_search.boardOf(player) & m_search.m_validBoardMask;
+    const uint32_t board = m_search.boardOf(player) & VALID_BOARD_MASK;
     int score = 0;
-    for (uint32_t index = 0; index < m_search.m_posLineCount[pos]; ++index) {
-        const int32_t lineId = m_search.m_posLineIds[pos][index];
+    for (uint32_t index = 0; index < RuleTraits<N>::posLineCount(pos); ++index) {
+        const int32_t lineId = RuleTraits<N>::posLineId(pos, index);
         if (lineId < 0) {
             continue;
         }
-        score += static_cast<int>(POPCOUNT32(board & m_search.m_lineMasks[lineId]));
+        score += static_cast<int>(POPCOUNT32(board & RuleTraits<N>::lineMask(lineId)));
     }
     return score;
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::countMillsAfterOccupy(NineChess::Players player, int32_t fromPos, int32_t toPos) const
 {
-    uint32_t board = m_search.boardOf(player) & m_search.m_validBoardMask;
+    uint32_t board = m_search.boardOf(player) & VALID_BOARD_MASK;
     if (fromPos >= 0) {
         board &= ~NineChess::bitOf(fromPos);
     }
     board |= NineChess::bitOf(toPos);
 
     int count = 0;
-    for (uint32_t index = 0; index < m_search.m_posLineCount[toPos]; ++index) {
-        const int32_t lineId = m_search.m_posLineIds[toPos][index];
-        if (lineId >= 0 && (board & m_search.m_lineMasks[lineId]) == m_search.m_lineMasks[lineId]) {
+    for (uint32_t index = 0; index < RuleTraits<N>::posLineCount(toPos); ++index) {
+        const int32_t lineId = RuleTraits<N>::posLineId(toPos, index);
+        if (lineId >= 0 && (board & RuleTraits<N>::lineMask(lineId)) == RuleTraits<N>::lineMask(lineId)) {
             ++count;
         }
     }
     return count;
 }
 
+template<uint32_t N>
 int NineChess_AI_AB::countOpenMillsAfterOccupy(NineChess::Players player, int32_t fromPos, int32_t toPos) const
 {
-    uint32_t board = m_search.boardOf(player) & m_search.m_validBoardMask;
+    uint32_t board = m_search.boardOf(player) & VALID_BOARD_MASK;
     uint32_t occupied =
         (m_search.m_data.player1Board | m_search.m_data.player2Board | m_search.m_data.forbiddenBoard)
-        & m_search.m_validBoardMask;
+        & VALID_BOARD_MASK;
 
     if (fromPos >= 0) {
         const uint32_t fromBit = NineChess::bitOf(fromPos);
@@ -972,12 +1804,12 @@ int NineChess_AI_AB::countOpenMillsAfterOccupy(NineChess::Players player, int32_
     occupied |= toBit;
 
     int count = 0;
-    for (uint32_t index = 0; index < m_search.m_posLineCount[toPos]; ++index) {
-        const int32_t lineId = m_search.m_posLineIds[toPos][index];
+    for (uint32_t index = 0; index < RuleTraits<N>::posLineCount(toPos); ++index) {
+        const int32_t lineId = RuleTraits<N>::posLineId(toPos, index);
         if (lineId < 0) {
             continue;
         }
-        const uint32_t mask = m_search.m_lineMasks[lineId];
+        const uint32_t mask = RuleTraits<N>::lineMask(lineId);
         if (POPCOUNT32(board & mask) == 2u && POPCOUNT32(occupied & mask) == 2u) {
             ++count;
         }
@@ -993,13 +1825,13 @@ bool NineChess_AI_AB::isSameMove(const Move& lhs, const Move& rhs) const
 std::string NineChess_AI_AB::formatMove(const Move& move) const
 {
     if (move.type == MOVE_CAPTURE) {
-        return m_root.formatCaptureCommand(move.to);
+        return NineChess::formatCaptureCommand(move.to);
     }
     if (move.type == MOVE_SHIFT) {
-        return m_root.formatMoveCommand(move.from, move.to);
+        return NineChess::formatMoveCommand(move.from, move.to);
     }
     if (move.type == MOVE_PLACE) {
-        return m_root.formatPointCommand(move.to);
+        return NineChess::formatPointCommand(move.to);
     }
     return "error!";
 }
@@ -6,34 +6,110 @@
 #pragma once
 
 #include "ninechess.h"
+#include "ninechess_ai_engine.h"
+#include "ninechess_ai_nnue.h"
+#include "ninechess_ai_weights.h"
+#include "ninechess_book.h"
+#include "ninechess_endgame.h"
+#include "ninechess_sharedtt.h"
+#include "ninechess_solver.h"
 
 #include <array>
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
-class NineChess_AI_AB
+class NineChess_AI_AB : public NineChess_AI_Engine
 {
 public:
     // 构造一个空的 AI；真正搜索前需要先调用 setChess() 注入局面。
     NineChess_AI_AB();
 
     // 默认析构即可，AI 不拥有需要手工释放的外部资源。
-    ~NineChess_AI_AB() = default;
+    ~NineChess_AI_AB() override = default;
 
     // 设置待搜索的根局面，并重置本轮搜索的内部状态。
-    void setChess(const NineChess& chess);
+    void setChess(const NineChess& chess) override;
 
     // 请求搜索尽快中止；供外部线程或控制层发出停止信号。
-    void quit() { m_requiredQuit.store(true); }
+    void quit() override { m_requiredQuit.store(true); }
+
+    // 引擎接口：等同于 alphaBetaPruning(depth)。
+    int think(int depth) override { return alphaBetaPruning(depth); }
 
     // 以给定深度执行迭代加深 Alpha-Beta 搜索，返回最终估值。
     int alphaBetaPruning(int depth);
 
     // 返回当前搜索得到的最佳着法文本。
-    const char* bestMove();
+    const char* bestMove() override;
+
+    // 设置离限步判和还剩的命令条数，搜索不再展开超过这个步数的着法，到达时按和棋计分。
+    void setRemainingSteps(int steps) override { m_remainingSteps = steps > 0 ? steps : 0; }
+
+    // 计算当前局面（setChess() 之后即根局面）在各估值线性项上的特征值，
+    // 供调参工具拟合权重。
+    void evaluationFeatures(EvalFeatures& features) const;
+
+    // 程序启动时载入权重文件，覆盖内置默认权重。
+    // 之后 setChess() 的搜索都会按局面规则使用新权重。
+    static bool loadEvalWeights(const std::string& path);
+
+    // 返回某规则当前生效的权重。
+    static const EvalWeights& evalWeights(uint32_t ruleIndex);
+
+    // 为某规则载入神经网络权重文件。载入成功后，该规则的新搜索改用网络估值，
+    // 线性估值只保留给走法排序；文件不存在或格式不符时返回 false，原设置不变。
+    static bool loadNeuralNetwork(uint32_t ruleIndex, const std::string& path);
+
+    // 某规则当前是否启用了神经网络估值。
+    static bool hasNeuralNetwork(uint32_t ruleIndex);
+
+    // 映射目录下某规则的中局残局库文件。至少载入一个子力类别时返回 true，
+    // 之后该规则的新搜索遇到库内局面直接取库中结果；规则不受支持时返回 false。
+    static bool loadEndgameDatabase(uint32_t ruleIndex, const std::string& directory);
+
+    // 某规则当前是否载入了残局库。
+    static bool hasEndgameDatabase(uint32_t ruleIndex);
+
+    // 映射某规则的开局库文件。载入成功后，该规则的新搜索在开局阶段先查库，
+    // 命中时不做迭代加深、直接给出库中权重最大的着法；文件不存在或格式不符时返回 false。
+    static bool loadOpeningBook(uint32_t ruleIndex, const std::string& path);
+
+    // 某规则当前是否载入了开局库。
+    static bool hasOpeningBook(uint32_t ruleIndex);
+
+    // 把某规则当前的置换表写成快照文件，下次启动时载入即可跳过重复的开局搜索。
+    // 条目按深度从深到浅写出。表为空或写入失败时返回 false。
+    static bool saveTranspositionTable(uint32_t ruleIndex, const std::string& path);
+
+    // 映射置换表快照，条目并入该规则的置换表：同键已有不浅于快照的条目时保留原条目，
+    // 超出条目上限的浅条目舍弃。文件头的规则、哈希方案或条目格式与当前程序不符时返回 false。
+    // 快照不记录估值权重，换用权重或神经网络后应丢弃旧快照。
+    static bool loadTranspositionTable(uint32_t ruleIndex, const std::string& path);
+
+    // 把某规则的置换表换成命名共享内存段，同机挂接同一名称的进程共用一份（见 ninechess_sharedtt.h）。
+    // 段名为 name 加规则后缀，不存在时按 memoryMB 创建。挂接后进程内原有的置换表不再使用，
+    // 快照的保存与载入也改为针对共享段。段头与本程序不符时返回 false，保持原置换表。
+    static bool attachSharedTranspositionTable(uint32_t ruleIndex, const std::string& name, size_t memoryMB);
+
+    // 解除某规则的共享置换表，回到进程内置换表；共享段本身保留。
+    static void detachSharedTranspositionTable(uint32_t ruleIndex);
+
+    // 某规则的共享段名称（不含平台前缀），供 SharedTranspositionTable::remove() 使用。
+    static std::string sharedTranspositionTableName(uint32_t ruleIndex, const std::string& name);
+
+    // 迭代加深结束后，若行棋方估值达到 triggerScore 但还不是已确定的胜负分，
+    // 用证明数搜索在 maxNodes 个结点内尝试证明强制取胜；证明成功则改走取胜着法。
+    // maxNodes 为 0 时关闭（默认）。对之后开始的搜索生效。
+    static void setProofSearch(uint64_t maxNodes, int triggerScore = PROOF_TRIGGER_SCORE);
+
+    // 和棋对根局面行棋方的折扣分：为正时引擎不愿和棋，重复局面、限步判和、终局和棋
+    // 都按行棋方 -contempt 计。默认 0，对之后开始的搜索生效。
+    static void setContempt(int contempt);
 
 private:
     // AI 内部统一使用的走法类别。
@@ -81,6 +157,10 @@ private:
 
         // 走法执行前的当前选中点位。
         int32_t selectedPos = -1;
+
+        // 走法执行前局面历史栈的长度与可重复区间起点。
+        size_t historySize = 0;
+        size_t reversibleBegin = 0;
     };
 
     struct TTEntry {
@@ -107,6 +187,19 @@ private:
 
         // 当前规则置换表所在的“世代号”。
         uint32_t generation = 0;
+
+        // 挂接的共享置换表；不为空时取代 table。
+        std::shared_ptr<SharedTranspositionTable> shared;
+    };
+
+    // 估值缓存单规则条目数，必须是 2 的幂。
+    static constexpr size_t EVAL_CACHE_SIZE = 64u * 1024u;
+
+    struct EvalCache {
+        // 每个条目把 key 的高 48 位与 16 位静态分打包进一个 64 位原子字：
+        // 读写各是一次原子操作，多个 AI 线程共享时不会读到半新半旧的条目，也不需要加锁。
+        // 低位已经用作下标，高位用来校验，两者合起来相当于完整 64 位 key。
+        std::array<std::atomic<uint64_t>, EVAL_CACHE_SIZE> entries;
     };
 
     struct SymmetryVariant {
@@ -138,59 +231,153 @@ private:
     // Alpha-Beta 使用的正负无穷边界。
     static constexpr int INF_SCORE = 32000;
 
+    // 残局库没有距离文件时，按这个步数折算胜负分，仍高于任何静态估值。
+    static constexpr int ENDGAME_FALLBACK_DISTANCE = 1000;
+
+    // 估值超过这个分值即视为已确定胜负（终局分或残局库分），不再尝试证明。
+    static constexpr int DECIDED_SCORE = WIN_SCORE - 2 * ENDGAME_FALLBACK_DISTANCE;
+
+    // 证明数搜索的默认触发分值，大约是领先五颗子。
+    static constexpr int PROOF_TRIGGER_SCORE = 600;
+
+    // 借用求解器时置换表的内存上限（MB）。
+    static constexpr size_t PROOF_MEMORY_MB = 16;
+
     // 单规则置换表允许保存的最大条目数。
     static constexpr size_t MAX_TT_ENTRIES = 256u * 1024u;
 
+    // 置换表快照文件的魔数 "NCTT" 与文件格式版本。
+    static constexpr uint32_t TT_FILE_MAGIC = 0x5454434eu;
+    static constexpr uint32_t TT_FILE_VERSION = 1u;
+
+    // 置换表键值的哈希方案版本。makeCanonicalHash()、局面哈希或对称变换表有改动时加一，旧快照随之失效。
+    static constexpr uint32_t TT_HASH_SCHEME = 1u;
+
+    // 快照条目格式：键值 u64、分值 i16、深度 i16、标记 u8、保留 3 字节，均为小端。
+    static constexpr uint32_t TT_ENTRY_FORMAT = 1u;
+
+    // 快照文件头与单个条目的字节数。
+    static constexpr size_t TT_FILE_HEADER_SIZE = 32;
+    static constexpr size_t TT_FILE_ENTRY_SIZE = 16;
+
     // 镜像、内外翻转和离散旋转组合后共有 16 种等价视角。
     static constexpr size_t SYMMETRY_COUNT = 16;
 
 private:
+    // 以下搜索与估值函数都按规则下标 N 实例化（见 ninechess_rule_traits.h），
+    // 规则开关和棋盘辅助表都是编译期常量；alphaBetaPruning() 与 evaluationFeatures() 在入口处分派一次。
+    // alphaBetaPruning() 分派后的迭代加深主体。
+    template<uint32_t N>
+    int iterativeDeepening(int depth);
+
     // 根节点搜索：除了求值，还负责记录“本层迭代的最佳着法”。
+    template<uint32_t N>
     int searchRoot(int depth);
 
     // 常规 Alpha-Beta 递归搜索。
+    template<uint32_t N>
     int search(int depth, int alpha, int beta, int ply);
 
+    // 查询残局库；命中时写出先手视角的精确分值。
+    bool probeEndgame(int ply, int& value) const;
+
+    // 查询开局库；命中且库中着法在 rootMoves 中时，写出最佳着法与库中分值。
+    bool probeOpeningBook(const MoveList& rootMoves, Move& move, int& value) const;
+
+    // 按 setProofSearch() 的设置尝试证明当前估值领先的一方必胜；成功时改写最佳着法与估值。
+    bool tryProveWin(const MoveList& rootMoves);
+
     // 对非终局局面进行静态评估。
+    template<uint32_t N>
     int evaluate(int ply) const;
 
+    // 按编译期规则计算的 evaluationFeatures()。
+    template<uint32_t N>
+    void evaluationFeatures(EvalFeatures& features) const;
+
+    // 估值缓存的 key：轻量哈希足以区分估值用到的全部信息，
+    // 中局已选子等待落子时再混入选中点位（机动性只看该子）。
+    uint64_t makeEvalKey() const;
+
+    // 查询估值缓存，命中时写出未截断的静态分。
+    bool probeEvalCache(uint64_t key, int& score) const;
+
+    // 写入估值缓存，直接覆盖同一槽位的旧条目。
+    void storeEvalCache(uint64_t key, int score) const;
+
+    // 权重或网络变化后清空全部规则的估值缓存。
+    static void clearEvalCaches();
+
     // 对终局局面进行评估，通常直接给出胜负分。
     int evaluateTerminal(int ply) const;
 
+    // 和棋的先手视角分值，已计入 contempt。
+    int drawScore() const;
+
+    // 重放 chess 的命令历史，取出最近一次提子之后的中局局面哈希作为历史栈的底部。
+    void buildPositionHistory(const NineChess& chess);
+
+    // 当前局面是否与历史栈中可重复区间内的某个局面相同。
+    bool isRepetition() const;
+
     // 按当前局面阶段统一生成合法走法列表。
-    void generateMoves(MoveList& list) const;
+    // reduceSymmetry 为 true 时，局面自身对称的等价着法只保留一个（见 reduceSymmetricMoves）。
+    template<uint32_t N>
+    void generateMoves(MoveList& list, bool reduceSymmetry = true) const;
 
     // 生成开局摆子阶段的落子走法。
+    template<uint32_t N>
     void generateOpeningMoves(MoveList& list) const;
 
     // 生成中局“待选子”状态下的所有可走子。
+    template<uint32_t N>
     void generateMidMoves(MoveList& list) const;
 
     // 从指定起点生成后续可落到的目标点位。
+    template<uint32_t N>
     void generateMovesFromSelected(MoveList& list, int32_t fromPos) const;
 
     // 生成当前提子阶段允许的全部提子走法。
+    template<uint32_t N>
     void generateCaptureMoves(MoveList& list) const;
 
+    // 求当前局面的稳定子群，即把局面映射回自身的非恒等变换，返回个数。
+    template<uint32_t N>
+    size_t findStabilizer(std::array<uint8_t, SYMMETRY_COUNT>& stabilizer) const;
+
+    // 按稳定子群把着法分成等价类，每类只保留一个代表。
+    // 重复判和依赖走到当前局面的路径，可重复区间里还有更早的局面时不约简。
+    template<uint32_t N>
+    void reduceSymmetricMoves(MoveList& list) const;
+
     // 按启发式分值对走法排序；根节点会额外优先沿用上一层最优着法。
     void orderMoves(MoveList& list, bool isRoot) const;
 
     // 为落子/走子计算排序分。
+    template<uint32_t N>
     int scorePlaceOrShiftMove(int32_t fromPos, int32_t toPos) const;
 
     // 为提子计算排序分。
-    int scoreCaptureMove(int32_t pos) const;
+    // defenderMills 为被提方的三连掩码，由调用方一次算好后传入。
+    template<uint32_t N>
+    int scoreCaptureMove(int32_t pos, uint32_t defenderMills) const;
 
     // 在 m_search 上执行一个走法，并保存回退所需快照。
+    template<uint32_t N>
     void applyMove(const Move& move, Snapshot& snapshot);
 
     // 把 m_search 回退到快照记录的旧状态。
     void undoMove(const Snapshot& snapshot);
 
+    // 按 m_search 重建神经网络累加器栈，只保留根节点一层。
+    void resetAccumulators();
+
     // 查询置换表；若命中精确值或命中后足以剪枝，则返回 true。
+    template<uint32_t N>
     bool probeTransposition(int depth, int& alpha, int& beta, int& value) const;
 
     // 把当前节点结果写入置换表。
+    template<uint32_t N>
     void storeTransposition(int depth, int value, int alpha, int beta) const;
 
     // 当新的真实局面开始搜索时，切换到置换表的新 generation。
@@ -200,9 +387,15 @@ private:
     void pruneTranspositionStore(TTStore& store) const;
 
     // 对所有对称变换生成哈希，取最小值作为规范化 key。
+    template<uint32_t N>
     uint64_t makeCanonicalHash() const;
 
+    // 置换表使用的 key：规范化哈希再异或 m_drawKey。
+    template<uint32_t N>
+    uint64_t makeTranspositionKey() const { return makeCanonicalHash<N>() ^ m_drawKey; }
+
     // 在某一个具体对称视角下生成局面哈希。
+    template<uint32_t N>
     uint64_t makeSymmetryHash(const SymmetryVariant& symmetry) const;
 
     // 将 selectedPos 额外混入哈希，避免 ACTION_PLACE 状态丢失关键信息。
@@ -215,27 +408,64 @@ private:
     uint32_t mapBoard(uint32_t board, const SymmetryVariant& symmetry) const;
 
     // 把九连棋的历史三连 key 映射到给定对称视角。
+    template<uint32_t N>
     NineChess::MillKey mapMillKey(NineChess::MillKey key, const SymmetryVariant& symmetry) const;
 
     // 统计某一方当前形成的三连总数。
+    template<uint32_t N>
     int countAllMills(NineChess::Players player) const;
 
     // 统计某一方当前“二子成线且第三点为空”的活三潜力。
+    template<uint32_t N>
     int countOpenMills(NineChess::Players player) const;
 
     // 统计某一方当前局面的机动性。
+    template<uint32_t N>
     int countMobility(NineChess::Players player) const;
 
+    // 是否为飞子残局：中局且至少一方已经可以飞子。
+    template<uint32_t N>
+    bool isFlyingEndgame() const;
+
+    // 飞子残局的估值特征（fly.*），其余项不动；不是飞子残局时全部为 0。
+    template<uint32_t N>
+    void flyingEndgameFeatures(EvalFeatures& features) const;
+
+    // board / occupied 下一方下一步就能成三的空点：线上另两点是己方棋子，
+    // 且有不在这条线上的己方棋子能走到（canFly 时任意一颗都能飞到）。
+    template<uint32_t N>
+    uint32_t millThreatPoints(uint32_t board, uint32_t occupied, bool canFly) const;
+
+    // 某一方当前的成三威胁点。
+    template<uint32_t N>
+    uint32_t millThreatPoints(NineChess::Players player) const;
+
+    // 某一方一步能走到 points 中的几个空点，即能挡住对手几个威胁点。
+    template<uint32_t N>
+    int countReachablePoints(NineChess::Players player, uint32_t points) const;
+
+    // 刚走完一步后，走子方是否对只剩可飞子数的对手形成了成三威胁（用于搜索延伸）。
+    template<uint32_t N>
+    bool givesFlyingThreat() const;
+
+    // 飞子残局的应将收窄：只剩可飞子数的一方面对成三点、自己又成不了三时，只保留挡点的着法。
+    template<uint32_t N>
+    void keepFlyingBlocks(MoveList& list) const;
+
     // 统计某点位能阻断对手多少条潜在威胁线。
+    template<uint32_t N>
     int countBlockedThreats(NineChess::Players player, int32_t pos) const;
 
     // 统计某点位穿过的己方线资源，用于估计此点的重要性。
+    template<uint32_t N>
     int countLinesThroughPos(NineChess::Players player, int32_t pos) const;
 
     // 估计把棋子占到 toPos 后可立即形成多少个三连。
+    template<uint32_t N>
     int countMillsAfterOccupy(NineChess::Players player, int32_t fromPos, int32_t toPos) const;
 
     // 估计把棋子占到 toPos 后可形成多少个活三。
+    template<uint32_t N>
     int countOpenMillsAfterOccupy(NineChess::Players player, int32_t fromPos, int32_t toPos) const;
 
     // 判断两个走法在搜索语义上是否相同。
@@ -246,10 +476,11 @@ private:
 
 private:
     // 搜索开始时的根局面，不在递归中直接改动。
-    NineChess m_root;
+    // 搜索只需要局面本身，命令历史与提示文本不随之复制。
+    Position m_root;
 
     // 递归搜索过程中实际被 applyMove()/undoMove() 改写的工作局面。
-    mutable NineChess m_search;
+    mutable Position m_search;
 
     // 预计算的全部对称变换表。
     std::array<SymmetryVariant, SYMMETRY_COUNT> m_symmetries = {};
@@ -263,6 +494,26 @@ private:
     // 当前这一层迭代是否被中途打断。
     bool m_iterationAborted = false;
 
+    // 离限步判和还剩的命令条数，0 表示不限。
+    int m_remainingSteps = 0;
+
+    // 本次搜索使用的 contempt，setChess() 时取出。
+    int m_contempt = 0;
+
+    // 和棋分随根局面的行棋方取符号，写进置换表的分值因此依赖于“谁在搜索”。
+    // contempt 非零时把带符号的和棋分混进置换表 key，两方的条目互不命中；
+    // contempt 为 0 时为 0，key 与快照、共享表中的旧条目保持一致。
+    uint64_t m_drawKey = 0;
+
+    // 中局局面哈希栈：对局历史在下，搜索路径在上，applyMove() 压入、undoMove() 弹出。
+    std::vector<uint64_t> m_positionHistory;
+
+    // 栈中从这个下标起的局面才可能重复；落子和提子都会使之前的局面不再出现。
+    size_t m_reversibleBegin = 0;
+
+    // 飞子残局成三威胁延伸的层数上限：ply 不小于它的结点不再延伸，保证递归有界。
+    int m_extensionLimit = 0;
+
     // 最近一次完整算完的迭代深度。
     int m_lastCompletedDepth = 0;
 
@@ -281,6 +532,58 @@ private:
     // 当前 AI 实例正在使用的置换表 generation。
     uint32_t m_generation = 0;
 
+    // 本次搜索使用的共享置换表；为空时使用进程内置换表。
+    std::shared_ptr<SharedTranspositionTable> m_sharedTable;
+
+    // 本次搜索使用的估值与排序权重，setChess() 时按规则取出。
+    EvalWeights m_weights;
+
+    // 按规则分开的全局权重表，启动时由 loadEvalWeights() 覆盖。
+    static EvalWeightTable s_evalWeights;
+
+    // 本次搜索使用的神经网络；为空时使用线性估值。
+    std::shared_ptr<const NnueNetwork> m_network;
+
+    // 神经网络累加器栈：applyMove() 压入增量更新后的一层，undoMove() 弹出。
+    std::vector<NnueAccumulator> m_accumulators;
+
+    // 按规则分开的全局神经网络，启动时由 loadNeuralNetwork() 设置。
+    static std::array<std::shared_ptr<const NnueNetwork>, RULE_COUNT> s_networks;
+
+    // 保护 s_networks 的替换与读取。
+    static std::mutex s_networkMutex;
+
+    // 本次搜索使用的残局库；为空时不查询。
+    std::shared_ptr<const NineChess_Endgame> m_endgame;
+
+    // 按规则分开的全局残局库，启动时由 loadEndgameDatabase() 设置。
+    static std::array<std::shared_ptr<const NineChess_Endgame>, RULE_COUNT> s_endgames;
+
+    // 保护 s_endgames 的替换与读取。
+    static std::mutex s_endgameMutex;
+
+    // 本次搜索使用的开局库；为空时不查询。
+    std::shared_ptr<const NineChess_Book> m_book;
+
+    // 按规则分开的全局开局库，启动时由 loadOpeningBook() 设置。
+    static std::array<std::shared_ptr<const NineChess_Book>, RULE_COUNT> s_books;
+
+    // 保护 s_books 的替换与读取。
+    static std::mutex s_bookMutex;
+
+    // 证明数搜索求解器，第一次需要时才分配。
+    std::unique_ptr<NineChess_Solver> m_solver;
+
+    // setProofSearch() 的全局设置。
+    static std::atomic<uint64_t> s_proofNodes;
+    static std::atomic<int> s_proofTrigger;
+
+    // setContempt() 的全局设置。
+    static std::atomic<int> s_contempt;
+
+    // 按规则分开的全局估值缓存，与置换表相互独立。
+    static std::array<EvalCache, RULE_COUNT> s_evalCaches;
+
     // 按规则分开的全局置换表：
     // 同规则不同 AI 实例共享缓存，不同规则之间彼此隔离。
     static std::array<TTStore, RULE_COUNT> s_ttStores;
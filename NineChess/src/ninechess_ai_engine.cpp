@@ -0,0 +1,21 @@
+/****************************************************************************
+** NineChess - AI 引擎公共接口
+****************************************************************************/
+
+#include "ninechess_ai_engine.h"
+
+#include "ninechess_ai_ab.h"
+#include "ninechess_ai_mcts.h"
+
+std::unique_ptr<NineChess_AI_Engine> createAiEngine(AiEngineType type)
+{
+    if (type == AI_ENGINE_MCTS) {
+        return std::unique_ptr<NineChess_AI_Engine>(new NineChess_AI_MCTS());
+    }
+    return std::unique_ptr<NineChess_AI_Engine>(new NineChess_AI_AB());
+}
+
+const char* aiEngineName(AiEngineType type)
+{
+    return type == AI_ENGINE_MCTS ? "MCTS" : "Alpha-Beta";
+}
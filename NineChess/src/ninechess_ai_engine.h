@@ -0,0 +1,47 @@
+/****************************************************************************
+** NineChess - AI 引擎公共接口
+** AiThread 等调用方只依赖这个接口，具体算法（Alpha-Beta / MCTS）可按玩家分别选择
+****************************************************************************/
+
+#pragma once
+
+#include "ninechess.h"
+
+#include <cstdint>
+#include <memory>
+
+// 可选的 AI 后端。
+enum AiEngineType : uint32_t {
+    AI_ENGINE_ALPHA_BETA = 0,   // 迭代加深 Alpha-Beta 搜索
+    AI_ENGINE_MCTS = 1,         // 蒙特卡洛树搜索
+    AI_ENGINE_COUNT
+};
+
+class NineChess_AI_Engine
+{
+public:
+    virtual ~NineChess_AI_Engine() = default;
+
+    // 设置待搜索的根局面。
+    virtual void setChess(const NineChess& chess) = 0;
+
+    // 请求搜索尽快中止，可由其它线程调用。
+    virtual void quit() = 0;
+
+    // 按给定强度搜索并返回先手视角估值。
+    // depth 对 Alpha-Beta 是迭代加深的最大层数，对 MCTS 换算为模拟次数上限。
+    virtual int think(int depth) = 0;
+
+    // 返回最近一次搜索得到的最佳命令文本，没有结果时为 "error!"。
+    virtual const char* bestMove() = 0;
+
+    // 对局再走多少条命令就会按限步判和，0 表示不限。
+    // 需在 setChess() 之后调用，只对下一次 think() 生效；不支持的后端忽略。
+    virtual void setRemainingSteps(int steps) { (void)steps; }
+};
+
+// 按类型创建一个 AI 引擎实例。
+std::unique_ptr<NineChess_AI_Engine> createAiEngine(AiEngineType type);
+
+// 引擎类型的显示名称。
+const char* aiEngineName(AiEngineType type);
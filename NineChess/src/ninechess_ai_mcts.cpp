@@ -0,0 +1,614 @@
+/****************************************************************************
+** NineChess - 蒙特卡洛树搜索 AI
+****************************************************************************/
+
+#include "ninechess_ai_mcts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 选择公式未指定探索系数时的默认值。
+constexpr double DEFAULT_UCT_EXPLORATION = 1.0;
+constexpr double DEFAULT_PUCT_EXPLORATION = 1.5;
+
+// PUCT 未访问子节点的初值比父节点均值低这么多，避免一上来就铺开所有子节点。
+constexpr double FIRST_PLAY_REDUCTION = 0.1;
+
+// 选择-展开路径的最大长度。
+constexpr size_t MAX_PATH_LENGTH = 512;
+
+constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+inline uint64_t nextRandom(uint64_t& state)
+{
+    // xorshift64*：每个线程各自一份状态，无需同步。
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+inline double terminalValue(NineChess::Players winner)
+{
+    if (winner == NineChess::PLAYER1) {
+        return 1.0;
+    }
+    if (winner == NineChess::PLAYER2) {
+        return 0.0;
+    }
+    return 0.5;
+}
+
+} // namespace
+
+NineChess_AI_MCTS::NineChess_AI_MCTS()
+    : m_requiredQuit(false),
+      m_playouts(0)
+{
+    const unsigned hardware = std::thread::hardware_concurrency();
+    m_threadCount = hardware > 0u ? hardware : 1u;
+    m_bestMoveText = "error!";
+}
+
+void NineChess_AI_MCTS::setChess(const NineChess& chess)
+{
+    m_requiredQuit.store(false);
+    m_bestMoveText = "error!";
+
+    // 先在旧树里找新局面，再替换根局面；规则变了则整棵树作废。
+    uint32_t reuse = NO_NODE;
+    if (m_pool && m_root.getRuleIndex() == chess.getRuleIndex()) {
+        reuse = findReusableRoot(chess);
+    }
+    m_root = chess;
+    rebuildTree(reuse);
+}
+
+int NineChess_AI_MCTS::think(int depth)
+{
+    m_lastPlayouts = 0;
+    m_bestMoveText = "error!";
+    if (m_root.getPhase() == GAME_OVER) {
+        return 0;
+    }
+
+    Node& root = m_pool->nodes[0];
+    if (root.state.load(std::memory_order_acquire) == NODE_LEAF) {
+        root.state.store(NODE_EXPANDING, std::memory_order_relaxed);
+        expandNode(0, m_root);
+    }
+    if (root.state.load(std::memory_order_acquire) != NODE_EXPANDED || root.childCount == 0) {
+        return 0;
+    }
+
+    // 只有一步可走时无需模拟。
+    if (root.childCount > 1) {
+        const int64_t playoutLimit = static_cast<int64_t>(std::max(1, depth)) * m_playoutsPerDepth;
+        m_playouts.store(0);
+
+        std::vector<std::thread> helpers;
+        for (unsigned t = 1; t < m_threadCount; ++t) {
+            helpers.emplace_back(&NineChess_AI_MCTS::searchWorker, this, t, playoutLimit);
+        }
+        searchWorker(0, playoutLimit);
+        for (std::thread& helper : helpers) {
+            helper.join();
+        }
+        m_lastPlayouts = m_playouts.load();
+    }
+
+    // 以访问次数选最终着法，次数相同时取均值更高者。
+    const Node* best = nullptr;
+    double bestMean = 0.0;
+    for (uint32_t i = 0; i < root.childCount; ++i) {
+        const Node& child = m_pool->nodes[root.firstChild + i];
+        const int32_t visits = child.visits.load();
+        const double mean = visits > 0
+            ? static_cast<double>(child.valueSum.load()) / VALUE_SCALE / visits
+            : static_cast<double>(child.prior);
+        if (best == nullptr || visits > best->visits.load()
+            || (visits == best->visits.load() && mean > bestMean)) {
+            best = &child;
+            bestMean = mean;
+        }
+    }
+
+    m_bestMoveText = formatMove(best->move);
+    const double player1Value = best->mover == PLAYER1 ? bestMean : 1.0 - bestMean;
+    return static_cast<int>(std::lround((player1Value - 0.5) * 2000.0));
+}
+
+const char* NineChess_AI_MCTS::bestMove()
+{
+    return m_bestMoveText.empty() ? "error!" : m_bestMoveText.c_str();
+}
+
+uint32_t NineChess_AI_MCTS::nodeCount() const
+{
+    return m_pool ? std::min(m_pool->used.load(), m_pool->capacity) : 0u;
+}
+
+void NineChess_AI_MCTS::searchWorker(unsigned threadIndex, int64_t playoutLimit)
+{
+    // 每个线程一份工作局面，单线程时随机序列只取决于根局面，结果可复现。
+    Position work(m_root);
+    uint64_t rng = m_root.getHashLite() ^ (0x9e3779b97f4a7c15ULL * (threadIndex + 1u));
+    if (rng == 0u) {
+        rng = 0x2545f4914f6cdd1dULL;
+    }
+
+    while (!m_requiredQuit.load(std::memory_order_relaxed)
+        && m_playouts.load(std::memory_order_relaxed) < playoutLimit) {
+        runPlayout(work, rng);
+        m_playouts.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void NineChess_AI_MCTS::runPlayout(Position& work, uint64_t& rng)
+{
+    resetToRoot(work);
+    Node* nodes = m_pool->nodes.get();
+
+    uint32_t path[MAX_PATH_LENGTH];
+    size_t length = 0;
+    uint32_t index = 0;
+    path[length++] = index;
+    nodes[index].virtualLoss.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+
+    // 选择：沿已展开节点下行；遇到访问过一次以上的叶节点就地展开后继续下行一步。
+    while (work.getPhase() != GAME_OVER && length < MAX_PATH_LENGTH) {
+        Node& node = nodes[index];
+        uint8_t state = node.state.load(std::memory_order_acquire);
+        if (state == NODE_LEAF && node.visits.load(std::memory_order_relaxed) > 0) {
+            uint8_t expected = NODE_LEAF;
+            if (node.state.compare_exchange_strong(expected, NODE_EXPANDING, std::memory_order_acq_rel)) {
+                expandNode(index, work);
+            }
+            state = node.state.load(std::memory_order_acquire);
+        }
+        if (state != NODE_EXPANDED || node.childCount == 0) {
+            break;
+        }
+
+        index = selectChild(node);
+        nodes[index].virtualLoss.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+        applyMove(work, nodes[index].move);
+        path[length++] = index;
+    }
+
+    // 模拟 + 回传：撤掉虚拟损失，按每个节点的 mover 视角累加得分。
+    const double player1Value = work.getPhase() == GAME_OVER
+        ? terminalValue(work.getWinner())
+        : simulate(work, rng);
+    const int64_t player1Score = static_cast<int64_t>(std::llround(player1Value * VALUE_SCALE));
+    for (size_t i = 0; i < length; ++i) {
+        Node& node = nodes[path[i]];
+        if (node.mover != NOBODY) {
+            node.valueSum.fetch_add(node.mover == PLAYER1 ? player1Score : VALUE_SCALE - player1Score,
+                std::memory_order_relaxed);
+        }
+        node.visits.fetch_add(1, std::memory_order_relaxed);
+        node.virtualLoss.fetch_sub(VIRTUAL_LOSS, std::memory_order_relaxed);
+    }
+}
+
+uint32_t NineChess_AI_MCTS::selectChild(const Node& node) const
+{
+    const Node* children = m_pool->nodes.get() + node.firstChild;
+    const double parentVisits = static_cast<double>(
+        node.visits.load(std::memory_order_relaxed) + node.virtualLoss.load(std::memory_order_relaxed));
+    const bool puct = m_selection == SELECTION_PUCT;
+    const double exploration = m_exploration > 0.0
+        ? m_exploration
+        : (puct ? DEFAULT_PUCT_EXPLORATION : DEFAULT_UCT_EXPLORATION);
+
+    // 未访问子节点的初值：取父节点均值（换到子节点 mover 视角）再打个折扣。
+    double firstPlay = 0.5;
+    const int32_t ownVisits = node.visits.load(std::memory_order_relaxed);
+    if (node.mover != NOBODY && ownVisits > 0) {
+        const double mean = static_cast<double>(node.valueSum.load(std::memory_order_relaxed))
+            / VALUE_SCALE / ownVisits;
+        firstPlay = (node.mover == children[0].mover ? mean : 1.0 - mean) - FIRST_PLAY_REDUCTION;
+    }
+
+    const double logParent = std::log(std::max(1.0, parentVisits));
+    const double sqrtParent = std::sqrt(std::max(1.0, parentVisits));
+    uint32_t bestIndex = 0;
+    double bestScore = -std::numeric_limits<double>::infinity();
+    for (uint32_t i = 0; i < node.childCount; ++i) {
+        const Node& child = children[i];
+        // 虚拟损失按“访问过但得 0 分”计入，让并发线程分散到不同分支。
+        const int32_t visits = child.visits.load(std::memory_order_relaxed)
+            + child.virtualLoss.load(std::memory_order_relaxed);
+
+        double score = 0.0;
+        if (puct) {
+            const double q = visits > 0
+                ? static_cast<double>(child.valueSum.load(std::memory_order_relaxed)) / VALUE_SCALE / visits
+                : firstPlay;
+            score = q + exploration * child.prior * sqrtParent / (1.0 + visits);
+        }
+        else if (visits == 0) {
+            // UCT 先把每个子节点都走一遍，先验高的先走。
+            score = 1e9 + child.prior;
+        }
+        else {
+            const double q = static_cast<double>(child.valueSum.load(std::memory_order_relaxed)) / VALUE_SCALE / visits;
+            score = q + exploration * std::sqrt(logParent / visits);
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestIndex = i;
+        }
+    }
+    return node.firstChild + bestIndex;
+}
+
+void NineChess_AI_MCTS::expandNode(uint32_t index, const Position& work)
+{
+    Node& node = m_pool->nodes[index];
+    MoveList list;
+    generateMoves(work, list);
+
+    const uint32_t count = static_cast<uint32_t>(list.count);
+    if (count == 0u) {
+        node.firstChild = 0;
+        node.childCount = 0;
+        node.state.store(NODE_EXPANDED, std::memory_order_release);
+        return;
+    }
+
+    // 节点池满了就保持为叶节点，之后只在这里做模拟。
+    NodePool& pool = *m_pool;
+    if (pool.used.load(std::memory_order_relaxed) + count > pool.capacity) {
+        node.state.store(NODE_LEAF, std::memory_order_release);
+        return;
+    }
+    const uint32_t first = pool.used.fetch_add(count, std::memory_order_relaxed);
+    if (first + count > pool.capacity) {
+        node.state.store(NODE_LEAF, std::memory_order_release);
+        return;
+    }
+
+    uint32_t totalWeight = 0;
+    for (size_t i = 0; i < list.count; ++i) {
+        totalWeight += list.moves[i].weight;
+    }
+    const NineChess::Players mover = work.getTurn();
+    for (uint32_t i = 0; i < count; ++i) {
+        const Move& move = list.moves[i];
+        initNode(pool.nodes[first + i], move, mover,
+            static_cast<float>(move.weight) / static_cast<float>(totalWeight));
+    }
+
+    node.firstChild = first;
+    node.childCount = static_cast<uint16_t>(count);
+    node.state.store(NODE_EXPANDED, std::memory_order_release);
+}
+
+double NineChess_AI_MCTS::simulate(Position& work, uint64_t& rng) const
+{
+    MoveList list;
+    for (int ply = 0; ply < MAX_PLAYOUT_PLIES; ++ply) {
+        if (work.getPhase() == GAME_OVER) {
+            return terminalValue(work.getWinner());
+        }
+
+        generateMoves(work, list);
+        if (list.count == 0) {
+            break;
+        }
+
+        // 按启发式权重抽样：成三、堵三的走法更常被选中，其余保持随机。
+        uint32_t totalWeight = 0;
+        for (size_t i = 0; i < list.count; ++i) {
+            totalWeight += list.moves[i].weight;
+        }
+        uint32_t pick = static_cast<uint32_t>(nextRandom(rng) % totalWeight);
+        size_t chosen = 0;
+        while (pick >= list.moves[chosen].weight) {
+            pick -= list.moves[chosen].weight;
+            ++chosen;
+        }
+        applyMove(work, list.moves[chosen]);
+    }
+
+    if (work.getPhase() == GAME_OVER) {
+        return terminalValue(work.getWinner());
+    }
+
+    // 步数用尽仍未分胜负：按双方剩余总子数（盘上 + 手中）之差估一个偏向。
+    const int diff =
+        static_cast<int>(work.getPlayer1OnBoardCount() + work.getPlayer1InHand())
+        - static_cast<int>(work.getPlayer2OnBoardCount() + work.getPlayer2InHand());
+    return std::min(0.9, std::max(0.1, 0.5 + 0.1 * diff));
+}
+
+void NineChess_AI_MCTS::generateMoves(const Position& chess, MoveList& list) const
+{
+    list.count = 0;
+    if (chess.getPhase() == GAME_OVER) {
+        return;
+    }
+
+    const NineChess::Players turn = chess.getTurn();
+    const uint32_t valid = chess.m_tables->validBoardMask;
+    const uint32_t occupied =
+        (chess.m_data.player1Board | chess.m_data.player2Board | chess.m_data.forbiddenBoard) & valid;
+
+    if (chess.getAction() == ACTION_CAPTURE) {
+        const uint32_t pieces = chess.boardOf(NineChess::opponentOf(turn)) & valid;
+        uint32_t targets = chess.legalCaptures();
+
+        while (targets != 0u && list.count < MoveList::MAX_COUNT) {
+            const int32_t pos = CTZ32(targets);
+            // 提掉对方二子线上的棋子更有价值。
+            uint8_t weight = 1;
+            for (uint32_t k = 0; k < chess.m_tables->posLineCount[pos]; ++k) {
+                const uint32_t mask = chess.m_tables->lineMasks[chess.m_tables->posLineIds[pos][k]];
+                if (POPCOUNT32(pieces & mask) == 2u && POPCOUNT32(occupied & mask) == 2u) {
+                    weight = static_cast<uint8_t>(weight + 3);
+                }
+            }
+            Move& move = list.moves[list.count++];
+            move.type = MOVE_CAPTURE;
+            move.from = -1;
+            move.to = static_cast<int8_t>(pos);
+            move.weight = weight;
+            targets &= targets - 1u;
+        }
+        return;
+    }
+
+    if (chess.getPhase() == GAME_NOTSTARTED || chess.getPhase() == GAME_OPENING) {
+        uint32_t targets = chess.legalTargets();
+        while (targets != 0u && list.count < MoveList::MAX_COUNT) {
+            const int32_t pos = CTZ32(targets);
+            Move& move = list.moves[list.count++];
+            move.type = MOVE_PLACE;
+            move.from = -1;
+            move.to = static_cast<int8_t>(pos);
+            move.weight = placeWeight(chess, -1, pos);
+            targets &= targets - 1u;
+        }
+        return;
+    }
+
+    if (chess.getPhase() != GAME_MID) {
+        return;
+    }
+
+    uint32_t pieces = chess.legalSources();
+    if (chess.getAction() == ACTION_PLACE && chess.isValidPos(chess.m_selectedPos)) {
+        pieces &= NineChess::bitOf(chess.m_selectedPos);
+    }
+
+    while (pieces != 0u && list.count < MoveList::MAX_COUNT) {
+        const int32_t fromPos = CTZ32(pieces);
+        uint32_t targets = chess.legalTargets(fromPos);
+        while (targets != 0u && list.count < MoveList::MAX_COUNT) {
+            const int32_t toPos = CTZ32(targets);
+            Move& move = list.moves[list.count++];
+            move.type = MOVE_SHIFT;
+            move.from = static_cast<int8_t>(fromPos);
+            move.to = static_cast<int8_t>(toPos);
+            move.weight = placeWeight(chess, fromPos, toPos);
+            targets &= targets - 1u;
+        }
+        pieces &= pieces - 1u;
+    }
+}
+
+uint8_t NineChess_AI_MCTS::placeWeight(const Position& chess, int32_t fromPos, int32_t toPos) const
+{
+    const NineChess::Players turn = chess.getTurn();
+    uint32_t own = chess.boardOf(turn) & chess.m_tables->validBoardMask;
+    if (fromPos >= 0) {
+        own &= ~NineChess::bitOf(fromPos);
+    }
+    own |= NineChess::bitOf(toPos);
+    const uint32_t opponent = chess.boardOf(NineChess::opponentOf(turn)) & chess.m_tables->validBoardMask;
+
+    uint32_t weight = 1;
+    for (uint32_t k = 0; k < chess.m_tables->posLineCount[toPos]; ++k) {
+        const uint32_t mask = chess.m_tables->lineMasks[chess.m_tables->posLineIds[toPos][k]];
+        if ((own & mask) == mask) {
+            weight += 8;
+        }
+        else if (POPCOUNT32(opponent & mask) == 2u) {
+            weight += 4;
+        }
+    }
+    return static_cast<uint8_t>(std::min<uint32_t>(weight, 255u));
+}
+
+void NineChess_AI_MCTS::applyMove(Position& chess, const Move& move) const
+{
+    switch (move.type)
+    {
+    case MOVE_PLACE:
+        chess.placeFast(move.to);
+        break;
+    case MOVE_SHIFT:
+        if (chess.getAction() == ACTION_CHOOSE) {
+            chess.chooseFast(move.from);
+        }
+        chess.placeFast(move.to);
+        break;
+    case MOVE_CAPTURE:
+        chess.captureFast(move.to);
+        break;
+    default:
+        break;
+    }
+}
+
+void NineChess_AI_MCTS::resetToRoot(Position& work) const
+{
+    work = m_root;
+}
+
+bool NineChess_AI_MCTS::isSamePosition(const Position& lhs, const Position& rhs) const
+{
+    const ChessData& a = lhs.m_data;
+    const ChessData& b = rhs.m_data;
+    if (((a.status ^ b.status) & ChessData::HASH_STATUS_MASK) != 0u
+        || a.player1Board != b.player1Board
+        || a.player2Board != b.player2Board
+        || a.forbiddenBoard != b.forbiddenBoard
+        || lhs.m_winner != rhs.m_winner
+        || a.millHistory != b.millHistory) {
+        return false;
+    }
+    for (int i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+        if (a.numberBoards[i] != b.numberBoards[i]) {
+            return false;
+        }
+    }
+
+    // 中局已选子等待落子时，选中的是哪颗子也是局面的一部分。
+    if (a.getPhase() == GAME_MID && a.getAction() == ACTION_PLACE) {
+        return lhs.m_selectedPos == rhs.m_selectedPos;
+    }
+    return true;
+}
+
+uint32_t NineChess_AI_MCTS::findReusableRoot(const Position& target) const
+{
+    if (isSamePosition(m_root, target)) {
+        return 0;
+    }
+
+    Position work(m_root);
+    uint32_t budget = REUSE_MAX_NODES;
+    uint32_t found = NO_NODE;
+    findReusableRootFrom(0, work, target, REUSE_MAX_DEPTH, budget, found);
+    return found;
+}
+
+bool NineChess_AI_MCTS::findReusableRootFrom(uint32_t index, Position& work, const Position& target,
+    int depth, uint32_t& budget, uint32_t& found) const
+{
+    const Node& node = m_pool->nodes[index];
+    if (depth <= 0 || node.state.load(std::memory_order_acquire) != NODE_EXPANDED) {
+        return false;
+    }
+
+    // 子数只减不增：任一方总子数已少于目标局面的分支不可能到达目标。
+    const uint32_t targetPlayer1 = target.getPlayer1OnBoardCount() + target.getPlayer1InHand();
+    const uint32_t targetPlayer2 = target.getPlayer2OnBoardCount() + target.getPlayer2InHand();
+
+    for (uint32_t i = 0; i < node.childCount && budget > 0u; ++i, --budget) {
+        const uint32_t childIndex = node.firstChild + i;
+        const ChessData saved = work.m_data;
+        const NineChess::Players savedWinner = work.m_winner;
+        const int32_t savedSelected = work.m_selectedPos;
+
+        applyMove(work, m_pool->nodes[childIndex].move);
+        bool hit = false;
+        if (work.getPlayer1OnBoardCount() + work.getPlayer1InHand() >= targetPlayer1
+            && work.getPlayer2OnBoardCount() + work.getPlayer2InHand() >= targetPlayer2) {
+            if (isSamePosition(work, target)) {
+                found = childIndex;
+                hit = true;
+            }
+            else {
+                hit = findReusableRootFrom(childIndex, work, target, depth - 1, budget, found);
+            }
+        }
+
+        work.m_data = saved;
+        work.m_winner = savedWinner;
+        work.m_selectedPos = savedSelected;
+        if (hit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NineChess_AI_MCTS::rebuildTree(uint32_t index)
+{
+    if (index == 0u && m_pool) {
+        return;
+    }
+
+    std::unique_ptr<NodePool> pool(new NodePool());
+    pool->capacity = m_nodeCapacity;
+    pool->nodes.reset(new Node[pool->capacity]);
+    Node* target = pool->nodes.get();
+
+    if (index == NO_NODE || !m_pool) {
+        initNode(target[0], Move(), NOBODY, 1.0f);
+        pool->used.store(1);
+        m_pool = std::move(pool);
+        return;
+    }
+
+    // 按层复制子树，保持“同一父节点的子节点连续存放”的布局。
+    const Node* source = m_pool->nodes.get();
+    std::vector<std::pair<uint32_t, uint32_t>> queue;
+    queue.emplace_back(index, 0u);
+    uint32_t used = 1;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const Node& from = source[queue[head].first];
+        Node& to = target[queue[head].second];
+        if (head == 0) {
+            initNode(to, from.move, from.mover, 1.0f);
+        }
+        to.visits.store(from.visits.load());
+        to.valueSum.store(from.valueSum.load());
+
+        const bool expanded = from.state.load() == NODE_EXPANDED;
+        if (!expanded || used + from.childCount > pool->capacity) {
+            to.state.store(NODE_LEAF);
+            continue;
+        }
+
+        to.firstChild = used;
+        to.childCount = from.childCount;
+        to.state.store(NODE_EXPANDED);
+        for (uint32_t i = 0; i < from.childCount; ++i) {
+            const Node& child = source[from.firstChild + i];
+            initNode(target[used + i], child.move, child.mover, child.prior);
+            queue.emplace_back(from.firstChild + i, used + i);
+        }
+        used += from.childCount;
+    }
+
+    pool->used.store(used);
+    m_pool = std::move(pool);
+}
+
+void NineChess_AI_MCTS::initNode(Node& node, const Move& move, NineChess::Players mover, float prior)
+{
+    node.visits.store(0, std::memory_order_relaxed);
+    node.virtualLoss.store(0, std::memory_order_relaxed);
+    node.valueSum.store(0, std::memory_order_relaxed);
+    node.state.store(NODE_LEAF, std::memory_order_relaxed);
+    node.firstChild = 0;
+    node.childCount = 0;
+    node.move = move;
+    node.mover = mover;
+    node.prior = prior;
+}
+
+std::string NineChess_AI_MCTS::formatMove(const Move& move) const
+{
+    if (move.type == MOVE_CAPTURE) {
+        return NineChess::formatCaptureCommand(move.to);
+    }
+    if (move.type == MOVE_SHIFT) {
+        return NineChess::formatMoveCommand(move.from, move.to);
+    }
+    if (move.type == MOVE_PLACE) {
+        return NineChess::formatPointCommand(move.to);
+    }
+    return "error!";
+}
@@ -0,0 +1,205 @@
+/****************************************************************************
+** NineChess - 蒙特卡洛树搜索 AI
+** 基于 UCT / PUCT 选择、预分配节点池、树复用和虚拟损失多线程的 MCTS 搜索器
+**
+** 与 Alpha-Beta 的对比：
+**   打三棋开局 24 个空点、每方 12 子，摆子阶段分支多且静态估值难以区分好坏，
+**   MCTS 靠模拟对局统计胜率，不依赖估值函数，适合在这一阶段做对照。
+****************************************************************************/
+
+#pragma once
+
+#include "ninechess.h"
+#include "ninechess_ai_engine.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class NineChess_AI_MCTS : public NineChess_AI_Engine
+{
+public:
+    // 子节点选择公式。
+    enum Selection : uint32_t {
+        SELECTION_UCT = 0,    // Q + c * sqrt(ln N / n)
+        SELECTION_PUCT = 1    // Q + c * P * sqrt(N) / (1 + n)，P 为启发式先验
+    };
+
+    NineChess_AI_MCTS();
+    ~NineChess_AI_MCTS() override = default;
+
+    // 设置根局面。若新局面是上一棵树中几步之内的后代，则保留该子树继续使用。
+    void setChess(const NineChess& chess) override;
+
+    // 请求搜索尽快中止。
+    void quit() override { m_requiredQuit.store(true); }
+
+    // 模拟次数上限为 depth * playoutsPerDepth，返回先手视角胜率换算的分值（-1000~1000）。
+    int think(int depth) override;
+
+    // 返回访问次数最多的根子节点对应的命令文本。
+    const char* bestMove() override;
+
+    // 选择公式，默认 PUCT。
+    void setSelection(Selection selection) { m_selection = selection; }
+
+    // 探索系数 c；小于等于 0 时恢复所选公式的默认值。
+    void setExploration(double exploration) { m_exploration = exploration; }
+
+    // 搜索线程数，默认取硬件并发数。
+    void setThreadCount(unsigned threads) { m_threadCount = threads > 0u ? threads : 1u; }
+
+    // 每单位 depth 对应的模拟次数。
+    void setPlayoutsPerDepth(int playouts) { m_playoutsPerDepth = playouts > 0 ? playouts : 1; }
+
+    // 节点池容量；下次新建树时生效。
+    void setNodeCapacity(uint32_t capacity) { m_nodeCapacity = capacity > 1u ? capacity : 2u; }
+
+    // 最近一次 think() 完成的模拟次数。
+    int64_t lastPlayouts() const { return m_lastPlayouts; }
+
+    // 当前树中的节点数。
+    uint32_t nodeCount() const;
+
+private:
+    enum MoveType : uint8_t {
+        MOVE_NONE = 0,
+        MOVE_PLACE = 1,
+        MOVE_SHIFT = 2,
+        MOVE_CAPTURE = 3
+    };
+
+    struct Move {
+        MoveType type = MOVE_NONE;
+        int8_t from = -1;
+        int8_t to = -1;
+        // 启发式权重：既是 PUCT 的先验，也是模拟对局的抽样权重。
+        uint8_t weight = 1;
+    };
+
+    struct MoveList {
+        static constexpr size_t MAX_COUNT = 128;
+        std::array<Move, MAX_COUNT> moves = {};
+        size_t count = 0;
+    };
+
+    // 节点展开状态。
+    enum NodeState : uint8_t {
+        NODE_LEAF = 0,        // 未展开
+        NODE_EXPANDING = 1,   // 某个线程正在展开
+        NODE_EXPANDED = 2     // 子节点已就绪
+    };
+
+    struct Node {
+        // 以下统计量由多个线程并发更新。
+        std::atomic<int32_t> visits;
+        std::atomic<int32_t> virtualLoss;
+        // 走到本节点的一方（mover）视角的累计得分，按 VALUE_SCALE 定点存储。
+        std::atomic<int64_t> valueSum;
+        std::atomic<uint8_t> state;
+
+        // 以下字段只在展开时写一次，之后只读。
+        uint32_t firstChild;
+        uint16_t childCount;
+        Move move;
+        // 走出这一步的玩家。提子不换手，因此不能按层交替推断。
+        NineChess::Players mover;
+        float prior;
+    };
+
+    // 预分配的节点池：子节点连续分配，只增不减，换树时整体重建。
+    struct NodePool {
+        std::unique_ptr<Node[]> nodes;
+        uint32_t capacity = 0;
+        std::atomic<uint32_t> used;
+
+        NodePool() : used(0) {}
+    };
+
+    // 单次模拟的得分定点倍率。
+    static constexpr int64_t VALUE_SCALE = 1024;
+
+    // 每个正在遍历的线程给路径上的节点记一次虚拟损失。
+    static constexpr int32_t VIRTUAL_LOSS = 1;
+
+    // 模拟对局的最大步数，超过后按子力估算结果。
+    static constexpr int MAX_PLAYOUT_PLIES = 200;
+
+    // 树复用时向下查找新根的最大步数与最多检查的节点数。
+    static constexpr int REUSE_MAX_DEPTH = 4;
+    static constexpr uint32_t REUSE_MAX_NODES = 200000;
+
+private:
+    // 单个线程的搜索循环。
+    void searchWorker(unsigned threadIndex, int64_t playoutLimit);
+
+    // 从根出发执行一次 选择-展开-模拟-回传。
+    void runPlayout(Position& work, uint64_t& rng);
+
+    // 按选择公式挑出最优子节点。
+    uint32_t selectChild(const Node& node) const;
+
+    // 在 work 局面下展开叶节点；节点池不够时保持为叶节点。
+    void expandNode(uint32_t index, const Position& work);
+
+    // 从 work 局面随机模拟到终局，返回先手视角得分（0~1）。
+    double simulate(Position& work, uint64_t& rng) const;
+
+    // 生成当前局面全部合法走法，并为每步填好启发式权重。
+    void generateMoves(const Position& chess, MoveList& list) const;
+
+    // 落子 / 走子的启发式权重：成三优先，其次堵对方的二子线。
+    uint8_t placeWeight(const Position& chess, int32_t fromPos, int32_t toPos) const;
+
+    // 在 chess 上执行一步走法。
+    void applyMove(Position& chess, const Move& move) const;
+
+    // 把 work 恢复为根局面。
+    void resetToRoot(Position& work) const;
+
+    // 两个局面是否完全相同（用于树复用时定位新根）。
+    bool isSamePosition(const Position& lhs, const Position& rhs) const;
+
+    // 在旧树中查找与 target 相同的后代，返回其下标；找不到返回 UINT32_MAX。
+    uint32_t findReusableRoot(const Position& target) const;
+
+    // findReusableRoot() 的递归部分：work 为 index 节点对应的局面，返回时已恢复。
+    bool findReusableRootFrom(uint32_t index, Position& work, const Position& target,
+        int depth, uint32_t& budget, uint32_t& found) const;
+
+    // 把以 index 为根的子树复制到新节点池并设为当前树；index 为 UINT32_MAX 时新建空树。
+    void rebuildTree(uint32_t index);
+
+    // 初始化一个节点的全部字段。
+    static void initNode(Node& node, const Move& move, NineChess::Players mover, float prior);
+
+    // 把内部走法格式化成命令文本。
+    std::string formatMove(const Move& move) const;
+
+private:
+    // 当前树根对应的局面。
+    Position m_root;
+
+    // 当前节点池；下标 0 固定为根节点。
+    std::unique_ptr<NodePool> m_pool;
+
+    // 外部请求停止搜索。
+    std::atomic<bool> m_requiredQuit;
+
+    // 本轮所有线程累计完成的模拟次数。
+    std::atomic<int64_t> m_playouts;
+
+    // 最近一次 think() 的模拟次数。
+    int64_t m_lastPlayouts = 0;
+
+    Selection m_selection = SELECTION_PUCT;
+    double m_exploration = 0.0;
+    unsigned m_threadCount = 1;
+    int m_playoutsPerDepth = 4000;
+    uint32_t m_nodeCapacity = 1u << 19;
+
+    // 最佳走法文本。
+    std::string m_bestMoveText;
+};
@@ -0,0 +1,477 @@
+/****************************************************************************
+** NineChess - AI 神经网络估值（NNUE 风格）
+****************************************************************************/
+
+#include "ninechess_ai_nnue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define NNUE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// SSE2 是 x86-64 的基线指令集；32 位 x86 只在编译器确认可用时启用。
+#if defined(NNUE_X86) && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NNUE_SSE2 1
+#endif
+
+// GCC / Clang 需要按函数开启 AVX2，MSVC 可以直接使用内建函数。
+#if defined(NNUE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NNUE_TARGET_AVX2 __attribute__((target("avx2")))
+#define NNUE_AVX2 1
+#elif defined(NNUE_X86) && defined(_MSC_VER)
+#define NNUE_TARGET_AVX2
+#define NNUE_AVX2 1
+#endif
+
+namespace {
+
+// ==================== CPU 检测 ====================
+
+NnueSimd detectSimd()
+{
+#if defined(NNUE_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return NNUE_SIMD_AVX2;
+    }
+#elif defined(NNUE_AVX2) && defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    // 需要 CPU 支持 AVX，且操作系统已开启 YMM 寄存器保存（OSXSAVE + XCR0）。
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6u) == 0x6u) {
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 5)) != 0) {
+            return NNUE_SIMD_AVX2;
+        }
+    }
+#endif
+
+#if defined(NNUE_SSE2)
+    return NNUE_SIMD_SSE2;
+#else
+    return NNUE_SIMD_SCALAR;
+#endif
+}
+
+const NnueSimd g_detectedSimd = detectSimd();
+std::atomic<uint32_t> g_activeSimd(static_cast<uint32_t>(g_detectedSimd));
+
+inline NnueSimd currentSimd()
+{
+    return static_cast<NnueSimd>(g_activeSimd.load(std::memory_order_relaxed));
+}
+
+// ==================== 第一层：累加器加减 ====================
+
+void addColumnScalar(int16_t* acc, const int16_t* column)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; ++i) {
+        acc[i] = static_cast<int16_t>(acc[i] + column[i]);
+    }
+}
+
+void subColumnScalar(int16_t* acc, const int16_t* column)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; ++i) {
+        acc[i] = static_cast<int16_t>(acc[i] - column[i]);
+    }
+}
+
+#if defined(NNUE_SSE2)
+void addColumnSse2(int16_t* acc, const int16_t* column)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; i += 8) {
+        __m128i* out = reinterpret_cast<__m128i*>(acc + i);
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i));
+        _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), value));
+    }
+}
+
+void subColumnSse2(int16_t* acc, const int16_t* column)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; i += 8) {
+        __m128i* out = reinterpret_cast<__m128i*>(acc + i);
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i));
+        _mm_storeu_si128(out, _mm_sub_epi16(_mm_loadu_si128(out), value));
+    }
+}
+#endif
+
+#if defined(NNUE_AVX2)
+NNUE_TARGET_AVX2 void addColumnAvx2(int16_t* acc, const int16_t* column)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; i += 16) {
+        __m256i* out = reinterpret_cast<__m256i*>(acc + i);
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + i));
+        _mm256_storeu_si256(out, _mm256_add_epi16(_mm256_loadu_si256(out), value));
+    }
+}
+
+NNUE_TARGET_AVX2 void subColumnAvx2(int16_t* acc, const int16_t* column)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; i += 16) {
+        __m256i* out = reinterpret_cast<__m256i*>(acc + i);
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + i));
+        _mm256_storeu_si256(out, _mm256_sub_epi16(_mm256_loadu_si256(out), value));
+    }
+}
+#endif
+
+// ==================== 第二层：截断 ReLU + int8 点积 ====================
+
+void clippedReluScalar(const int16_t* acc, uint8_t* out)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; ++i) {
+        out[i] = static_cast<uint8_t>(std::min<int32_t>(std::max<int32_t>(acc[i], 0), 127));
+    }
+}
+
+void hiddenLayerScalar(const uint8_t* input, const int8_t (*weights)[NNUE_L1_SIZE], const int32_t* bias,
+    int32_t* out)
+{
+    for (uint32_t row = 0; row < NNUE_L2_SIZE; ++row) {
+        int32_t sum = bias[row];
+        for (uint32_t i = 0; i < NNUE_L1_SIZE; ++i) {
+            sum += static_cast<int32_t>(input[i]) * weights[row][i];
+        }
+        out[row] = sum;
+    }
+}
+
+#if defined(NNUE_SSE2)
+void clippedReluSse2(const int16_t* acc, uint8_t* out)
+{
+    // packus 把负数截成 0，再与 127 取最小值完成上截断。
+    const __m128i limit = _mm_set1_epi8(127);
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; i += 16) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i + 8));
+        const __m128i packed = _mm_min_epu8(_mm_packus_epi16(low, high), limit);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+}
+
+void hiddenLayerSse2(const uint8_t* input, const int8_t (*weights)[NNUE_L1_SIZE], const int32_t* bias,
+    int32_t* out)
+{
+    // SSE2 没有 u8 x i8 乘加，先把两侧都扩成 int16 再用 madd。
+    const __m128i zero = _mm_setzero_si128();
+    for (uint32_t row = 0; row < NNUE_L2_SIZE; ++row) {
+        __m128i sum = _mm_setzero_si128();
+        for (uint32_t i = 0; i < NNUE_L1_SIZE; i += 16) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+            const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights[row] + i));
+            const __m128i wSign = _mm_cmpgt_epi8(zero, w);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(w, wSign)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(w, wSign)));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        out[row] = bias[row] + _mm_cvtsi128_si32(sum);
+    }
+}
+#endif
+
+#if defined(NNUE_AVX2)
+NNUE_TARGET_AVX2 void hiddenLayerAvx2(const uint8_t* input, const int8_t (*weights)[NNUE_L1_SIZE],
+    const int32_t* bias, int32_t* out)
+{
+    // 输入已截断到 [0,127]，maddubs 的 int16 中间和不会饱和。
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+    const __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + 32));
+    for (uint32_t row = 0; row < NNUE_L2_SIZE; ++row) {
+        const __m256i w0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights[row]));
+        const __m256i w1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights[row] + 32));
+        __m256i sum = _mm256_madd_epi16(_mm256_maddubs_epi16(x0, w0), ones);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x1, w1), ones));
+
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        out[row] = bias[row] + _mm_cvtsi128_si32(half);
+    }
+}
+#endif
+
+// ==================== 小端读取 ====================
+
+bool readBytes(std::istream& in, void* target, size_t size)
+{
+    in.read(static_cast<char*>(target), static_cast<std::streamsize>(size));
+    return static_cast<size_t>(in.gcount()) == size;
+}
+
+bool readU32(std::istream& in, uint32_t& value)
+{
+    unsigned char bytes[4];
+    if (!readBytes(in, bytes, sizeof(bytes))) {
+        return false;
+    }
+    value = static_cast<uint32_t>(bytes[0])
+        | (static_cast<uint32_t>(bytes[1]) << 8)
+        | (static_cast<uint32_t>(bytes[2]) << 16)
+        | (static_cast<uint32_t>(bytes[3]) << 24);
+    return true;
+}
+
+bool readI16Array(std::istream& in, int16_t* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char bytes[2];
+        if (!readBytes(in, bytes, sizeof(bytes))) {
+            return false;
+        }
+        values[i] = static_cast<int16_t>(static_cast<uint16_t>(bytes[0] | (bytes[1] << 8)));
+    }
+    return true;
+}
+
+bool readI32Array(std::istream& in, int32_t* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t value = 0;
+        if (!readU32(in, value)) {
+            return false;
+        }
+        values[i] = static_cast<int32_t>(value);
+    }
+    return true;
+}
+
+} // namespace
+
+bool NnueNetwork::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    uint32_t header[5] = {};
+    for (uint32_t& value : header) {
+        if (!readU32(in, value)) {
+            return false;
+        }
+    }
+    if (header[0] != NNUE_FILE_MAGIC || header[1] != NNUE_FILE_VERSION
+        || header[2] != NNUE_INPUT_COUNT || header[3] != NNUE_L1_SIZE || header[4] != NNUE_L2_SIZE) {
+        return false;
+    }
+
+    // 先读进副本，整个文件都完整时才提交，避免半套权重生效。
+    NnueNetwork loaded;
+    loaded.m_l1Weights.resize(static_cast<size_t>(NNUE_INPUT_COUNT) * NNUE_L1_SIZE);
+    if (!readI16Array(in, loaded.m_l1Weights.data(), loaded.m_l1Weights.size())
+        || !readI16Array(in, loaded.m_l1Bias, NNUE_L1_SIZE)
+        || !readBytes(in, loaded.m_l2Weights, sizeof(loaded.m_l2Weights))
+        || !readI32Array(in, loaded.m_l2Bias, NNUE_L2_SIZE)
+        || !readBytes(in, loaded.m_outWeights, sizeof(loaded.m_outWeights))
+        || !readI32Array(in, &loaded.m_outBias, 1)) {
+        return false;
+    }
+
+    *this = loaded;
+    return true;
+}
+
+uint32_t NnueNetwork::statusFeatures(const ChessData& data, uint16_t* features)
+{
+    uint32_t count = 0;
+    features[count++] = static_cast<uint16_t>(NNUE_PLAYER1_IN_HAND_BASE
+        + std::min<uint32_t>(data.getPlayer1InHand(), MAX_PIECES_PER_SIDE));
+    features[count++] = static_cast<uint16_t>(NNUE_PLAYER2_IN_HAND_BASE
+        + std::min<uint32_t>(data.getPlayer2InHand(), MAX_PIECES_PER_SIDE));
+    features[count++] = static_cast<uint16_t>(NNUE_PENDING_BASE + data.getPendingCaptures());
+
+    if (data.getPhase() == GAME_OPENING) {
+        features[count++] = static_cast<uint16_t>(NNUE_PHASE_OPENING);
+    }
+    else if (data.getPhase() == GAME_MID) {
+        features[count++] = static_cast<uint16_t>(NNUE_PHASE_MID);
+    }
+    if (data.getTurn() == PLAYER2) {
+        features[count++] = static_cast<uint16_t>(NNUE_TURN_PLAYER2);
+    }
+    if (data.getAction() == ACTION_CAPTURE) {
+        features[count++] = static_cast<uint16_t>(NNUE_ACTION_CAPTURE);
+    }
+    return count;
+}
+
+uint32_t NnueNetwork::activeFeatures(const ChessData& data, uint16_t* features)
+{
+    const uint32_t planes[NNUE_PLANE_COUNT] = {
+        data.player1Board & ChessData::VALID_BOARD_MASK,
+        data.player2Board & ChessData::VALID_BOARD_MASK,
+        data.forbiddenBoard & ChessData::VALID_BOARD_MASK
+    };
+
+    uint32_t count = 0;
+    for (uint32_t plane = 0; plane < NNUE_PLANE_COUNT; ++plane) {
+        for (uint32_t bits = planes[plane]; bits != 0u; bits &= bits - 1u) {
+            features[count++] = static_cast<uint16_t>(plane * BOARD_SIZE + CTZ32(bits));
+        }
+    }
+    return count + statusFeatures(data, features + count);
+}
+
+void NnueNetwork::addFeature(NnueAccumulator& acc, uint32_t feature) const
+{
+    const int16_t* column = m_l1Weights.data() + static_cast<size_t>(feature) * NNUE_L1_SIZE;
+    switch (currentSimd()) {
+#if defined(NNUE_AVX2)
+    case NNUE_SIMD_AVX2:
+        addColumnAvx2(acc.values, column);
+        return;
+#endif
+#if defined(NNUE_SSE2)
+    case NNUE_SIMD_SSE2:
+        addColumnSse2(acc.values, column);
+        return;
+#endif
+    default:
+        addColumnScalar(acc.values, column);
+        return;
+    }
+}
+
+void NnueNetwork::subFeature(NnueAccumulator& acc, uint32_t feature) const
+{
+    const int16_t* column = m_l1Weights.data() + static_cast<size_t>(feature) * NNUE_L1_SIZE;
+    switch (currentSimd()) {
+#if defined(NNUE_AVX2)
+    case NNUE_SIMD_AVX2:
+        subColumnAvx2(acc.values, column);
+        return;
+#endif
+#if defined(NNUE_SSE2)
+    case NNUE_SIMD_SSE2:
+        subColumnSse2(acc.values, column);
+        return;
+#endif
+    default:
+        subColumnScalar(acc.values, column);
+        return;
+    }
+}
+
+void NnueNetwork::refresh(const ChessData& data, NnueAccumulator& acc) const
+{
+    std::memcpy(acc.values, m_l1Bias, sizeof(acc.values));
+
+    uint16_t features[BOARD_SIZE + NNUE_MAX_STATUS_FEATURES];
+    const uint32_t count = activeFeatures(data, features);
+    for (uint32_t i = 0; i < count; ++i) {
+        addFeature(acc, features[i]);
+    }
+}
+
+void NnueNetwork::update(const NnueAccumulator& parent, const ChessData& before, const ChessData& after,
+    NnueAccumulator& child) const
+{
+    if (&child != &parent) {
+        child = parent;
+    }
+
+    // 点位平面：只处理 before / after 之间翻转的位。
+    const uint32_t beforePlanes[NNUE_PLANE_COUNT] = {
+        before.player1Board & ChessData::VALID_BOARD_MASK,
+        before.player2Board & ChessData::VALID_BOARD_MASK,
+        before.forbiddenBoard & ChessData::VALID_BOARD_MASK
+    };
+    const uint32_t afterPlanes[NNUE_PLANE_COUNT] = {
+        after.player1Board & ChessData::VALID_BOARD_MASK,
+        after.player2Board & ChessData::VALID_BOARD_MASK,
+        after.forbiddenBoard & ChessData::VALID_BOARD_MASK
+    };
+    for (uint32_t plane = 0; plane < NNUE_PLANE_COUNT; ++plane) {
+        const uint32_t base = plane * BOARD_SIZE;
+        for (uint32_t bits = beforePlanes[plane] & ~afterPlanes[plane]; bits != 0u; bits &= bits - 1u) {
+            subFeature(child, base + CTZ32(bits));
+        }
+        for (uint32_t bits = afterPlanes[plane] & ~beforePlanes[plane]; bits != 0u; bits &= bits - 1u) {
+            addFeature(child, base + CTZ32(bits));
+        }
+    }
+
+    // 状态特征：status 未变时直接跳过。
+    if (((before.status ^ after.status) & ChessData::HASH_STATUS_MASK) == 0u) {
+        return;
+    }
+
+    uint16_t oldFeatures[NNUE_MAX_STATUS_FEATURES];
+    uint16_t newFeatures[NNUE_MAX_STATUS_FEATURES];
+    const uint32_t oldCount = statusFeatures(before, oldFeatures);
+    const uint32_t newCount = statusFeatures(after, newFeatures);
+    for (uint32_t i = 0; i < oldCount; ++i) {
+        if (std::find(newFeatures, newFeatures + newCount, oldFeatures[i]) == newFeatures + newCount) {
+            subFeature(child, oldFeatures[i]);
+        }
+    }
+    for (uint32_t i = 0; i < newCount; ++i) {
+        if (std::find(oldFeatures, oldFeatures + oldCount, newFeatures[i]) == oldFeatures + oldCount) {
+            addFeature(child, newFeatures[i]);
+        }
+    }
+}
+
+int NnueNetwork::evaluate(const NnueAccumulator& acc) const
+{
+    uint8_t hidden1[NNUE_L1_SIZE];
+    int32_t hidden2[NNUE_L2_SIZE];
+    switch (currentSimd()) {
+#if defined(NNUE_AVX2)
+    case NNUE_SIMD_AVX2:
+        clippedReluSse2(acc.values, hidden1);
+        hiddenLayerAvx2(hidden1, m_l2Weights, m_l2Bias, hidden2);
+        break;
+#endif
+#if defined(NNUE_SSE2)
+    case NNUE_SIMD_SSE2:
+        clippedReluSse2(acc.values, hidden1);
+        hiddenLayerSse2(hidden1, m_l2Weights, m_l2Bias, hidden2);
+        break;
+#endif
+    default:
+        clippedReluScalar(acc.values, hidden1);
+        hiddenLayerScalar(hidden1, m_l2Weights, m_l2Bias, hidden2);
+        break;
+    }
+
+    // 输出层只有 16 个乘加，标量即可。
+    int32_t output = m_outBias;
+    for (uint32_t i = 0; i < NNUE_L2_SIZE; ++i) {
+        const int32_t activated = std::min<int32_t>(std::max<int32_t>(hidden2[i] >> 6, 0), 127);
+        output += activated * m_outWeights[i];
+    }
+    return output / NNUE_OUTPUT_DIVISOR;
+}
+
+NnueSimd NnueNetwork::detectedSimd()
+{
+    return g_detectedSimd;
+}
+
+void NnueNetwork::setSimd(NnueSimd simd)
+{
+    g_activeSimd.store(static_cast<uint32_t>(std::min(simd, g_detectedSimd)), std::memory_order_relaxed);
+}
+
+NnueSimd NnueNetwork::activeSimd()
+{
+    return currentSimd();
+}
@@ -0,0 +1,119 @@
+/****************************************************************************
+** NineChess - AI 神经网络估值（NNUE 风格）
+**
+** 可选的小型量化网络估值器，结构为：
+**   输入 106 维稀疏特征 -> L1 64（int16，增量维护的累加器）
+**   -> 截断 ReLU [0,127] -> L2 16（int8 权重）-> 截断 ReLU -> 输出 1
+**
+** 输入特征：
+**   0~71    : 24 点位 × 3 个平面（先手 / 后手 / 禁点）
+**   72~84   : 先手手牌数 0~12 的 one-hot
+**   85~97   : 后手手牌数 0~12 的 one-hot
+**   98~101  : 待提子数 0~3 的 one-hot
+**   102~103 : 阶段为开局 / 中局
+**   104     : 轮到后手
+**   105     : 当前动作为提子
+**
+** 量化约定（训练端导出权重时必须遵守）：
+**   acc = b1 + Σ W1[i]            （int16，激活 1.0 对应 127）
+**   a1  = clamp(acc, 0, 127)
+**   z2  = b2 + Σ W2 · a1          （W2 为 int8，1.0 对应 64）
+**   a2  = clamp(z2 >> 6, 0, 127)
+**   out = b3 + Σ W3 · a2          （W3 为 int8）
+**   估值 = out / NNUE_OUTPUT_DIVISOR，先手视角，与线性估值同一量纲。
+**
+** 所有内核都有标量实现；x86 上运行时检测 CPU，自动选用 AVX2 或 SSE2。
+** 普通 x86-64 CPU 至少支持 SSE2，不需要 GPU。
+****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ninechess_common.h"
+
+constexpr uint32_t NNUE_PLANE_COUNT = 3;
+constexpr uint32_t NNUE_IN_HAND_SLOTS = MAX_PIECES_PER_SIDE + 1;
+constexpr uint32_t NNUE_PENDING_SLOTS = 4;
+constexpr uint32_t NNUE_PLAYER1_IN_HAND_BASE = NNUE_PLANE_COUNT * BOARD_SIZE;
+constexpr uint32_t NNUE_PLAYER2_IN_HAND_BASE = NNUE_PLAYER1_IN_HAND_BASE + NNUE_IN_HAND_SLOTS;
+constexpr uint32_t NNUE_PENDING_BASE = NNUE_PLAYER2_IN_HAND_BASE + NNUE_IN_HAND_SLOTS;
+constexpr uint32_t NNUE_PHASE_OPENING = NNUE_PENDING_BASE + NNUE_PENDING_SLOTS;
+constexpr uint32_t NNUE_PHASE_MID = NNUE_PHASE_OPENING + 1;
+constexpr uint32_t NNUE_TURN_PLAYER2 = NNUE_PHASE_MID + 1;
+constexpr uint32_t NNUE_ACTION_CAPTURE = NNUE_TURN_PLAYER2 + 1;
+constexpr uint32_t NNUE_INPUT_COUNT = NNUE_ACTION_CAPTURE + 1;
+
+// 任一局面最多激活的状态类特征数：两方手牌、待提子、阶段、轮次、提子动作。
+constexpr uint32_t NNUE_MAX_STATUS_FEATURES = 6;
+
+constexpr uint32_t NNUE_L1_SIZE = 64;
+constexpr uint32_t NNUE_L2_SIZE = 16;
+constexpr int32_t NNUE_OUTPUT_DIVISOR = 16;
+
+// 权重文件头中的魔数 "NCNN" 与格式版本。
+constexpr uint32_t NNUE_FILE_MAGIC = 0x4e4e434eu;
+constexpr uint32_t NNUE_FILE_VERSION = 1u;
+
+// 当前使用的 SIMD 内核。
+enum NnueSimd : uint32_t {
+    NNUE_SIMD_SCALAR = 0,
+    NNUE_SIMD_SSE2 = 1,
+    NNUE_SIMD_AVX2 = 2
+};
+
+// 第一层累加器：只随走法增量更新，估值时直接作为第二层输入。
+struct NnueAccumulator {
+    int16_t values[NNUE_L1_SIZE];
+};
+
+class NnueNetwork
+{
+public:
+    // 读取二进制权重文件。布局（小端）：
+    //   uint32 魔数、版本、输入数、L1 宽度、L2 宽度
+    //   int16  W1[输入数][L1]、b1[L1]
+    //   int8   W2[L2][L1]；int32 b2[L2]
+    //   int8   W3[L2]；int32 b3
+    // 尺寸与本程序不一致时返回 false。
+    bool load(const std::string& path);
+
+    // 按局面从头计算累加器。
+    void refresh(const ChessData& data, NnueAccumulator& acc) const;
+
+    // 从父局面的累加器出发，只对 before -> after 之间变化的特征做加减。
+    // 落子只改变 1 个点位，走子 2 个，提子 1~2 个，另加少量状态特征。
+    void update(const NnueAccumulator& parent, const ChessData& before, const ChessData& after,
+        NnueAccumulator& child) const;
+
+    // 由累加器算出先手视角估值。
+    int evaluate(const NnueAccumulator& acc) const;
+
+    // 把局面的全部激活输入写入 features，返回个数（不超过 BOARD_SIZE + 6）。
+    static uint32_t activeFeatures(const ChessData& data, uint16_t* features);
+
+    // 当前 CPU 支持的最高 SIMD 级别。
+    static NnueSimd detectedSimd();
+
+    // 指定使用的 SIMD 级别，超过 CPU 支持时自动降级；主要用于测试与基准对比。
+    static void setSimd(NnueSimd simd);
+
+    // 当前实际使用的 SIMD 级别。
+    static NnueSimd activeSimd();
+
+private:
+    // 状态类特征（手牌、待提子、阶段、轮次、动作），返回个数。
+    static uint32_t statusFeatures(const ChessData& data, uint16_t* features);
+
+    void addFeature(NnueAccumulator& acc, uint32_t feature) const;
+    void subFeature(NnueAccumulator& acc, uint32_t feature) const;
+
+    std::vector<int16_t> m_l1Weights;
+    int16_t m_l1Bias[NNUE_L1_SIZE] = {};
+    int8_t m_l2Weights[NNUE_L2_SIZE][NNUE_L1_SIZE] = {};
+    int32_t m_l2Bias[NNUE_L2_SIZE] = {};
+    int8_t m_outWeights[NNUE_L2_SIZE] = {};
+    int32_t m_outBias = 0;
+};
@@ -0,0 +1,134 @@
+/****************************************************************************
+** NineChess - AI 估值权重
+****************************************************************************/
+
+#include "ninechess_ai_weights.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+
+const char* const EVAL_PARAM_NAMES[EVAL_PARAM_COUNT] = {
+    "opening.onBoard",
+    "opening.inHand",
+    "opening.mill",
+    "opening.openMill",
+    "opening.capture",
+    "mid.onBoard",
+    "mid.mill",
+    "mid.openMill",
+    "mid.mobility",
+    "mid.capture",
+    "fly.threat",
+    "fly.doubleThreat",
+    "fly.block",
+    "order.mill",
+    "order.openMill",
+    "order.blockThreat",
+    "order.lines",
+    "order.leaveMill",
+    "order.flyThreat",
+    "order.flyBlock"
+};
+
+std::string trimCopy(const std::string& text)
+{
+    std::string::size_type begin = 0;
+    while (begin < text.size() && std::isspace(static_cast<unsigned char>(text[begin]))) {
+        ++begin;
+    }
+
+    std::string::size_type end = text.size();
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+        --end;
+    }
+
+    return text.substr(begin, end - begin);
+}
+
+bool parseInt(const std::string& text, long& value)
+{
+    if (text.empty()) {
+        return false;
+    }
+
+    char* end = nullptr;
+    value = std::strtol(text.c_str(), &end, 10);
+    return end != nullptr && *end == '\0';
+}
+
+} // namespace
+
+const char* evalParamName(EvalParam param)
+{
+    return param < EVAL_PARAM_COUNT ? EVAL_PARAM_NAMES[param] : "";
+}
+
+bool loadEvalWeightTable(const std::string& path, EvalWeightTable& table)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+
+    // 先读进副本，整个文件都合法时才提交，避免半套权重生效。
+    EvalWeightTable loaded = table;
+    long ruleIndex = -1;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = trimCopy(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        if (line.front() == '[' && line.back() == ']') {
+            const std::string section = trimCopy(line.substr(1, line.size() - 2));
+            if (section.compare(0, 4, "rule") != 0
+                || !parseInt(trimCopy(section.substr(4)), ruleIndex)
+                || ruleIndex < 0 || ruleIndex >= RULE_COUNT) {
+                return false;
+            }
+            continue;
+        }
+
+        const std::string::size_type equal = line.find('=');
+        long value = 0;
+        if (ruleIndex < 0 || equal == std::string::npos
+            || !parseInt(trimCopy(line.substr(equal + 1)), value)) {
+            return false;
+        }
+
+        const std::string key = trimCopy(line.substr(0, equal));
+        uint32_t param = 0;
+        while (param < EVAL_PARAM_COUNT && key != EVAL_PARAM_NAMES[param]) {
+            ++param;
+        }
+        if (param == EVAL_PARAM_COUNT) {
+            return false;
+        }
+
+        loaded[static_cast<size_t>(ruleIndex)].values[param] = static_cast<int32_t>(value);
+    }
+
+    table = loaded;
+    return true;
+}
+
+bool saveEvalWeightTable(const std::string& path, const EvalWeightTable& table)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    out << "# NineChess evaluation weights\n";
+    for (uint32_t rule = 0; rule < RULE_COUNT; ++rule) {
+        out << "\n[rule " << rule << "]\n";
+        for (uint32_t param = 0; param < EVAL_PARAM_COUNT; ++param) {
+            out << EVAL_PARAM_NAMES[param] << " = " << table[rule].values[param] << "\n";
+        }
+    }
+    return static_cast<bool>(out);
+}
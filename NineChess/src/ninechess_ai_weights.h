@@ -0,0 +1,93 @@
+/****************************************************************************
+** NineChess - AI 估值权重
+** 静态估值与走法排序使用的全部可调参数，以及权重文件的读写
+**
+** 权重文件为 UTF-8 文本，按规则分段：
+**   # 注释
+**   [rule 2]
+**   opening.onBoard = 120
+**   mid.mobility = 10
+** 未出现的规则或参数保持默认值，因此文件可以只写需要覆盖的部分。
+****************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "ninechess_common.h"
+
+// 参数编号。
+// EVAL_TERM_COUNT 之前的是静态估值的线性项：
+// 估值 = Σ 权重 × 特征，特征一律按“先手减后手”给出，
+// 因此调参工具可以直接对这一段做 logistic 回归。
+// 之后的是走法排序用的启发式分值，不参与估值，只能手工调整。
+enum EvalParam : uint32_t {
+    EVAL_OPENING_ON_BOARD = 0,
+    EVAL_OPENING_IN_HAND,
+    EVAL_OPENING_MILL,
+    EVAL_OPENING_OPEN_MILL,
+    EVAL_OPENING_CAPTURE,
+    EVAL_MID_ON_BOARD,
+    EVAL_MID_MILL,
+    EVAL_MID_OPEN_MILL,
+    EVAL_MID_MOBILITY,
+    EVAL_MID_CAPTURE,
+    EVAL_FLY_THREAT,
+    EVAL_FLY_DOUBLE_THREAT,
+    EVAL_FLY_BLOCK,
+    EVAL_TERM_COUNT,
+
+    ORDER_MILL = EVAL_TERM_COUNT,
+    ORDER_OPEN_MILL,
+    ORDER_BLOCK_THREAT,
+    ORDER_LINES,
+    ORDER_LEAVE_MILL,
+    ORDER_FLY_THREAT,
+    ORDER_FLY_BLOCK,
+    EVAL_PARAM_COUNT
+};
+
+// 一套规则的全部权重。默认值即重构前写死在估值和排序代码里的常数。
+// fly.* / order.fly* 只在飞子残局（中局有一方只剩可飞的子数）中起作用。
+struct EvalWeights {
+    std::array<int32_t, EVAL_PARAM_COUNT> values = { {
+        120, 48, 96, 24, 160,
+        180, 112, 32, 10, 220,
+        64, 240, 24,
+        2400, 240, 180, 48, 160,
+        400, 600
+    } };
+
+    int32_t operator[](EvalParam param) const { return values[param]; }
+    int32_t& operator[](EvalParam param) { return values[param]; }
+};
+
+// 某个局面在全部估值线性项上的特征值。
+// 不属于当前阶段的项保持 0，因此可以和 EvalWeights 直接做点积。
+struct EvalFeatures {
+    std::array<int16_t, EVAL_TERM_COUNT> values = {};
+
+    int dot(const EvalWeights& weights) const
+    {
+        int score = 0;
+        for (uint32_t i = 0; i < EVAL_TERM_COUNT; ++i) {
+            score += static_cast<int>(values[i]) * weights.values[i];
+        }
+        return score;
+    }
+};
+
+// 按规则分开的权重表。
+using EvalWeightTable = std::array<EvalWeights, RULE_COUNT>;
+
+// 参数在权重文件中的键名，例如 "opening.onBoard"。
+const char* evalParamName(EvalParam param);
+
+// 读取权重文件，把其中出现的条目覆盖到 table 上。
+// 文件无法打开或存在无法识别的行时返回 false，此时 table 保持不变。
+bool loadEvalWeightTable(const std::string& path, EvalWeightTable& table);
+
+// 把完整权重表写成文本文件。
+bool saveEvalWeightTable(const std::string& path, const EvalWeightTable& table);
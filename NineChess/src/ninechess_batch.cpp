@@ -0,0 +1,959 @@
+/****************************************************************************
+** NineChess - 批量局面容器（结构数组）
+****************************************************************************/
+
+#include "ninechess_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#include "ninechess_position.h"
+#include "ninechess_rule_traits.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define BATCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC / Clang 需要按函数开启 AVX2 / AVX-512，MSVC 可以直接使用内建函数。
+#if defined(BATCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BATCH_TARGET_AVX2 __attribute__((target("avx2")))
+#define BATCH_TARGET_AVX512 __attribute__((target("avx512f")))
+#define BATCH_AVX2 1
+#define BATCH_AVX512 1
+#elif defined(BATCH_X86) && defined(_MSC_VER)
+#define BATCH_TARGET_AVX2
+#define BATCH_TARGET_AVX512
+#define BATCH_AVX2 1
+#define BATCH_AVX512 1
+#endif
+
+// GCC 13 之前的 avx512fintrin.h 用自初始化的未定义值作占位，开启优化后会误报 -Wmaybe-uninitialized。
+#if defined(BATCH_AVX512) && defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 13
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace {
+
+constexpr uint32_t VALID_BOARD_MASK = ChessData::VALID_BOARD_MASK;
+
+// 每圈 8 个点位正好占一个字节，圈内的旋转、镜像都是字节内的位操作，三圈同时完成。
+constexpr uint32_t RING_LOW_BIT = 0x010101u;
+constexpr uint32_t RING_HIGH_BIT = 0x808080u;
+
+// 跨圈连线所在的点位：无斜线时只有每圈 0/2/4/6 四个中点，有斜线时 8 个点都有。
+constexpr uint32_t crossMaskOf(bool hasDiagonalLines)
+{
+    return hasDiagonalLines ? VALID_BOARD_MASK : 0x555555u;
+}
+
+// 哈希拆成两个 24 位半段计算，每个半段放进一个 32 位通道：
+//   lo = 低 12 个点位的两平面交织，对应 getHashLite() 的第 0~23 位；
+//   hi = 高 12 个点位的两平面交织，对应第 24~47 位。
+// 这样比较、变换都停留在 32 位通道里，一条指令覆盖 8 / 16 个局面。
+constexpr uint32_t HALF_POS_MASK = 0x000fffu;
+constexpr uint32_t HALF_SHIFT = 12;
+
+// ==================== CPU 检测 ====================
+
+BatchSimd detectSimd()
+{
+#if defined(BATCH_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return BATCH_SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return BATCH_SIMD_AVX2;
+    }
+#elif defined(BATCH_AVX2) && defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    // 需要 CPU 支持 AVX，且操作系统已开启对应寄存器的保存（OSXSAVE + XCR0）。
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (maxLeaf >= 7 && osxsave && avx) {
+        const unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        // XCR0 第 5~7 位对应 AVX-512 的掩码寄存器与 ZMM 高位。
+        if ((info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6u) == 0xe6u) {
+            return BATCH_SIMD_AVX512;
+        }
+        if ((info[1] & (1 << 5)) != 0 && (xcr0 & 0x6u) == 0x6u) {
+            return BATCH_SIMD_AVX2;
+        }
+    }
+#endif
+    return BATCH_SIMD_SCALAR;
+}
+
+const BatchSimd g_detectedSimd = detectSimd();
+std::atomic<uint32_t> g_activeSimd(static_cast<uint32_t>(g_detectedSimd));
+
+inline BatchSimd currentSimd()
+{
+    return static_cast<BatchSimd>(g_activeSimd.load(std::memory_order_relaxed));
+}
+
+// 内核读取的四个字段数组。
+struct BatchArrays {
+    const uint32_t* player1;
+    const uint32_t* player2;
+    const uint32_t* forbidden;
+    const uint32_t* status;
+    size_t size;
+};
+
+// ==================== 标量实现 ====================
+// 标量版本既是 CPU 不支持 SIMD 时的回退，也负责 SIMD 主循环之后不足一组的尾部。
+
+// 低 12 位铺到 24 位中的偶数位上。
+inline uint32_t spreadHalf(uint32_t x)
+{
+    x = (x | (x << 8)) & 0x00ff00ffu;
+    x = (x | (x << 4)) & 0x0f0f0f0fu;
+    x = (x | (x << 2)) & 0x33333333u;
+    x = (x | (x << 1)) & 0x55555555u;
+    return x;
+}
+
+// low / high 平面的 48 位交织编码，等于 getHashLite() 去掉 status 的部分。
+inline uint64_t boardKey(uint32_t low, uint32_t high)
+{
+    const uint32_t lo = spreadHalf(low & HALF_POS_MASK) | (spreadHalf(high & HALF_POS_MASK) << 1);
+    const uint32_t hi = spreadHalf(low >> HALF_SHIFT) | (spreadHalf(high >> HALF_SHIFT) << 1);
+    return static_cast<uint64_t>(lo) | (static_cast<uint64_t>(hi) << 24);
+}
+
+inline uint64_t statusKey(uint32_t status)
+{
+    return static_cast<uint64_t>(status & ChessData::HASH_STATUS_MASK) << 48;
+}
+
+// TRANSFORM_MIRROR：seat -> (8 - seat) mod 8，即字节内逆序后再顺时针转 1 格。
+inline uint32_t mirrorBoard(uint32_t board)
+{
+    board = ((board >> 4) & 0x0f0f0fu) | ((board << 4) & 0xf0f0f0u);
+    board = ((board >> 2) & 0x333333u) | ((board << 2) & 0xccccccu);
+    board = ((board >> 1) & 0x555555u) | ((board << 1) & 0xaaaaaau);
+    return ((board << 1) & ~RING_LOW_BIT & VALID_BOARD_MASK) | ((board >> 7) & RING_LOW_BIT);
+}
+
+// TRANSFORM_TURN：内外圈互换。
+inline uint32_t turnBoard(uint32_t board)
+{
+    return (board & 0x00ff00u) | ((board >> 16) & 0xffu) | ((board & 0xffu) << 16);
+}
+
+// TRANSFORM_ROTATE_LEFT：seat -> seat - 2。
+inline uint32_t rotateBoardLeft(uint32_t board)
+{
+    return ((board >> 2) & 0x3f3f3fu) | ((board << 6) & 0xc0c0c0u);
+}
+
+// 相邻空位数之和：四个方向各求一次“哪些棋子朝该方向有空位”，再分别计数。
+inline uint32_t stepMoves(uint32_t pieces, uint32_t empty, uint32_t crossMask)
+{
+    const uint32_t clockwise = ((empty >> 1) & ~RING_HIGH_BIT) | ((empty << 7) & RING_HIGH_BIT);
+    const uint32_t counterClockwise = ((empty << 1) & ~RING_LOW_BIT & VALID_BOARD_MASK) | ((empty >> 7) & RING_LOW_BIT);
+    const uint32_t outward = (empty >> SEAT) & crossMask;
+    const uint32_t inward = (empty << SEAT) & crossMask;
+    return POPCOUNT32(pieces & clockwise) + POPCOUNT32(pieces & counterClockwise)
+        + POPCOUNT32(pieces & outward) + POPCOUNT32(pieces & inward);
+}
+
+template<uint32_t N>
+inline uint32_t mobilityOf(uint32_t pieces, uint32_t empty, uint32_t status)
+{
+    if ((status & STATUS_PHASE_MASK) != GAME_MID) {
+        return 0u;
+    }
+    const uint32_t count = POPCOUNT32(pieces);
+    if (RuleTraits<N>::allowFlying && count <= RuleTraits<N>::minPiecesToSurvive) {
+        return count * POPCOUNT32(empty);
+    }
+    return stepMoves(pieces, empty, crossMaskOf(RuleTraits<N>::hasDiagonalLines));
+}
+
+template<uint32_t N>
+inline uint32_t millsOf(uint32_t board)
+{
+    uint32_t count = 0u;
+    for (uint32_t lineId = 0; lineId < RuleTraits<N>::lineCount; ++lineId) {
+        const uint32_t mask = RuleTraits<N>::lineMask(lineId);
+        if ((board & mask) == mask) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void hashLiteScalar(const BatchArrays& in, size_t begin, uint64_t* out)
+{
+    for (size_t i = begin; i < in.size; ++i) {
+        const uint32_t forbidden = in.forbidden[i] & VALID_BOARD_MASK;
+        out[i] = boardKey((in.player1[i] | forbidden) & VALID_BOARD_MASK, (in.player2[i] | forbidden) & VALID_BOARD_MASK)
+            | statusKey(in.status[i]);
+    }
+}
+
+void canonicalHashLiteScalar(const BatchArrays& in, size_t begin, uint64_t* out, uint8_t* symmetry)
+{
+    for (size_t i = begin; i < in.size; ++i) {
+        const uint32_t forbidden = in.forbidden[i] & VALID_BOARD_MASK;
+        const uint32_t low = (in.player1[i] | forbidden) & VALID_BOARD_MASK;
+        const uint32_t high = (in.player2[i] | forbidden) & VALID_BOARD_MASK;
+
+        // 变换编号 = 镜像 × 8 + 翻转 × 4 + 左旋次数，与 Position::symmetryPos() 一致。
+        uint64_t bestKey = boardKey(low, high);
+        uint32_t bestSymmetry = 0u;
+        for (uint32_t mirror = 0; mirror < 2u; ++mirror) {
+            const uint32_t mirrorLow = mirror != 0u ? mirrorBoard(low) : low;
+            const uint32_t mirrorHigh = mirror != 0u ? mirrorBoard(high) : high;
+            for (uint32_t turn = 0; turn < 2u; ++turn) {
+                uint32_t turnLow = turn != 0u ? turnBoard(mirrorLow) : mirrorLow;
+                uint32_t turnHigh = turn != 0u ? turnBoard(mirrorHigh) : mirrorHigh;
+                for (uint32_t rotate = 0; rotate < 4u; ++rotate) {
+                    const uint32_t s = mirror * 8u + turn * 4u + rotate;
+                    if (s != 0u) {
+                        const uint64_t key = boardKey(turnLow, turnHigh);
+                        if (key < bestKey) {
+                            bestKey = key;
+                            bestSymmetry = s;
+                        }
+                    }
+                    turnLow = rotateBoardLeft(turnLow);
+                    turnHigh = rotateBoardLeft(turnHigh);
+                }
+            }
+        }
+
+        out[i] = bestKey | statusKey(in.status[i]);
+        if (symmetry != nullptr) {
+            symmetry[i] = static_cast<uint8_t>(bestSymmetry);
+        }
+    }
+}
+
+void countPiecesScalar(const BatchArrays& in, size_t begin, uint32_t* player1Out, uint32_t* player2Out)
+{
+    for (size_t i = begin; i < in.size; ++i) {
+        player1Out[i] = POPCOUNT32(in.player1[i] & VALID_BOARD_MASK);
+        player2Out[i] = POPCOUNT32(in.player2[i] & VALID_BOARD_MASK);
+    }
+}
+
+template<uint32_t N>
+void countMillsScalar(const BatchArrays& in, size_t begin, uint32_t* player1Out, uint32_t* player2Out)
+{
+    for (size_t i = begin; i < in.size; ++i) {
+        player1Out[i] = millsOf<N>(in.player1[i] & VALID_BOARD_MASK);
+        player2Out[i] = millsOf<N>(in.player2[i] & VALID_BOARD_MASK);
+    }
+}
+
+template<uint32_t N>
+void countMobilityScalar(const BatchArrays& in, size_t begin, uint32_t* player1Out, uint32_t* player2Out)
+{
+    for (size_t i = begin; i < in.size; ++i) {
+        const uint32_t player1 = in.player1[i] & VALID_BOARD_MASK;
+        const uint32_t player2 = in.player2[i] & VALID_BOARD_MASK;
+        const uint32_t empty = ~(player1 | player2 | in.forbidden[i]) & VALID_BOARD_MASK;
+        player1Out[i] = mobilityOf<N>(player1, empty, in.status[i]);
+        player2Out[i] = mobilityOf<N>(player2, empty, in.status[i]);
+    }
+}
+
+// ==================== AVX2：每组 8 个局面 ====================
+
+#if defined(BATCH_AVX2)
+constexpr size_t AVX2_LANES = 8;
+
+BATCH_TARGET_AVX2 inline __m256i loadAvx2(const uint32_t* values, size_t i)
+{
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i));
+}
+
+BATCH_TARGET_AVX2 inline __m256i maskAvx2(__m256i value, uint32_t mask)
+{
+    return _mm256_and_si256(value, _mm256_set1_epi32(static_cast<int>(mask)));
+}
+
+// 通道内 popcount 的前半段：得到每个字节的置位数。多个结果可以先相加再一次乘法汇总。
+BATCH_TARGET_AVX2 inline __m256i byteCountsAvx2(__m256i x)
+{
+    x = _mm256_sub_epi32(x, maskAvx2(_mm256_srli_epi32(x, 1), 0x55555555u));
+    x = _mm256_add_epi32(maskAvx2(x, 0x33333333u), maskAvx2(_mm256_srli_epi32(x, 2), 0x33333333u));
+    return maskAvx2(_mm256_add_epi32(x, _mm256_srli_epi32(x, 4)), 0x0f0f0f0fu);
+}
+
+BATCH_TARGET_AVX2 inline __m256i sumBytesAvx2(__m256i byteCounts)
+{
+    return _mm256_srli_epi32(_mm256_mullo_epi32(byteCounts, _mm256_set1_epi32(0x01010101)), 24);
+}
+
+BATCH_TARGET_AVX2 inline __m256i popcountAvx2(__m256i x)
+{
+    return sumBytesAvx2(byteCountsAvx2(x));
+}
+
+BATCH_TARGET_AVX2 inline __m256i spreadHalfAvx2(__m256i x)
+{
+    x = maskAvx2(_mm256_or_si256(x, _mm256_slli_epi32(x, 8)), 0x00ff00ffu);
+    x = maskAvx2(_mm256_or_si256(x, _mm256_slli_epi32(x, 4)), 0x0f0f0f0fu);
+    x = maskAvx2(_mm256_or_si256(x, _mm256_slli_epi32(x, 2)), 0x33333333u);
+    return maskAvx2(_mm256_or_si256(x, _mm256_slli_epi32(x, 1)), 0x55555555u);
+}
+
+BATCH_TARGET_AVX2 inline void boardKeyAvx2(__m256i low, __m256i high, __m256i& lo, __m256i& hi)
+{
+    lo = _mm256_or_si256(spreadHalfAvx2(maskAvx2(low, HALF_POS_MASK)),
+        _mm256_slli_epi32(spreadHalfAvx2(maskAvx2(high, HALF_POS_MASK)), 1));
+    hi = _mm256_or_si256(spreadHalfAvx2(_mm256_srli_epi32(low, HALF_SHIFT)),
+        _mm256_slli_epi32(spreadHalfAvx2(_mm256_srli_epi32(high, HALF_SHIFT)), 1));
+}
+
+// 把两个 24 位半段与 status 拼成 8 个 64 位哈希写出。
+BATCH_TARGET_AVX2 inline void storeHashAvx2(uint64_t* out, __m256i lo, __m256i hi, __m256i status)
+{
+    const __m256i low32 = _mm256_or_si256(lo, _mm256_slli_epi32(hi, 24));
+    const __m256i high32 = _mm256_or_si256(_mm256_srli_epi32(hi, 8),
+        _mm256_slli_epi32(maskAvx2(status, ChessData::HASH_STATUS_MASK), 16));
+    // unpack 按 128 位分段交错，得到局面 0 1 4 5 / 2 3 6 7，再用 permute 排回顺序。
+    const __m256i even = _mm256_unpacklo_epi32(low32, high32);
+    const __m256i odd = _mm256_unpackhi_epi32(low32, high32);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(even, odd, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4), _mm256_permute2x128_si256(even, odd, 0x31));
+}
+
+BATCH_TARGET_AVX2 inline __m256i mirrorBoardAvx2(__m256i board)
+{
+    board = _mm256_or_si256(maskAvx2(_mm256_srli_epi32(board, 4), 0x0f0f0fu), maskAvx2(_mm256_slli_epi32(board, 4), 0xf0f0f0u));
+    board = _mm256_or_si256(maskAvx2(_mm256_srli_epi32(board, 2), 0x333333u), maskAvx2(_mm256_slli_epi32(board, 2), 0xccccccu));
+    board = _mm256_or_si256(maskAvx2(_mm256_srli_epi32(board, 1), 0x555555u), maskAvx2(_mm256_slli_epi32(board, 1), 0xaaaaaau));
+    return _mm256_or_si256(maskAvx2(_mm256_slli_epi32(board, 1), ~RING_LOW_BIT & VALID_BOARD_MASK),
+        maskAvx2(_mm256_srli_epi32(board, 7), RING_LOW_BIT));
+}
+
+BATCH_TARGET_AVX2 inline __m256i turnBoardAvx2(__m256i board)
+{
+    return _mm256_or_si256(maskAvx2(board, 0x00ff00u),
+        _mm256_or_si256(maskAvx2(_mm256_srli_epi32(board, 16), 0xffu), _mm256_slli_epi32(maskAvx2(board, 0xffu), 16)));
+}
+
+BATCH_TARGET_AVX2 inline __m256i rotateBoardLeftAvx2(__m256i board)
+{
+    return _mm256_or_si256(maskAvx2(_mm256_srli_epi32(board, 2), 0x3f3f3fu), maskAvx2(_mm256_slli_epi32(board, 6), 0xc0c0c0u));
+}
+
+BATCH_TARGET_AVX2 size_t hashLiteAvx2(const BatchArrays& in, uint64_t* out)
+{
+    const size_t end = in.size - in.size % AVX2_LANES;
+    for (size_t i = 0; i < end; i += AVX2_LANES) {
+        const __m256i forbidden = loadAvx2(in.forbidden, i);
+        const __m256i low = maskAvx2(_mm256_or_si256(loadAvx2(in.player1, i), forbidden), VALID_BOARD_MASK);
+        const __m256i high = maskAvx2(_mm256_or_si256(loadAvx2(in.player2, i), forbidden), VALID_BOARD_MASK);
+        __m256i lo;
+        __m256i hi;
+        boardKeyAvx2(low, high, lo, hi);
+        storeHashAvx2(out + i, lo, hi, loadAvx2(in.status, i));
+    }
+    return end;
+}
+
+BATCH_TARGET_AVX2 size_t canonicalHashLiteAvx2(const BatchArrays& in, uint64_t* out, uint8_t* symmetry)
+{
+    const size_t end = in.size - in.size % AVX2_LANES;
+    alignas(32) uint32_t symmetryLanes[AVX2_LANES];
+    for (size_t i = 0; i < end; i += AVX2_LANES) {
+        const __m256i forbidden = loadAvx2(in.forbidden, i);
+        const __m256i low = maskAvx2(_mm256_or_si256(loadAvx2(in.player1, i), forbidden), VALID_BOARD_MASK);
+        const __m256i high = maskAvx2(_mm256_or_si256(loadAvx2(in.player2, i), forbidden), VALID_BOARD_MASK);
+
+        __m256i bestLo;
+        __m256i bestHi;
+        boardKeyAvx2(low, high, bestLo, bestHi);
+        __m256i bestSymmetry = _mm256_setzero_si256();
+        for (uint32_t mirror = 0; mirror < 2u; ++mirror) {
+            const __m256i mirrorLow = mirror != 0u ? mirrorBoardAvx2(low) : low;
+            const __m256i mirrorHigh = mirror != 0u ? mirrorBoardAvx2(high) : high;
+            for (uint32_t turn = 0; turn < 2u; ++turn) {
+                __m256i turnLow = turn != 0u ? turnBoardAvx2(mirrorLow) : mirrorLow;
+                __m256i turnHigh = turn != 0u ? turnBoardAvx2(mirrorHigh) : mirrorHigh;
+                for (uint32_t rotate = 0; rotate < 4u; ++rotate) {
+                    const uint32_t s = mirror * 8u + turn * 4u + rotate;
+                    if (s != 0u) {
+                        __m256i lo;
+                        __m256i hi;
+                        boardKeyAvx2(turnLow, turnHigh, lo, hi);
+                        // 两个半段都小于 2^24，有符号比较即可；先比高半段，相等再比低半段。
+                        const __m256i less = _mm256_or_si256(_mm256_cmpgt_epi32(bestHi, hi),
+                            _mm256_and_si256(_mm256_cmpeq_epi32(bestHi, hi), _mm256_cmpgt_epi32(bestLo, lo)));
+                        bestLo = _mm256_blendv_epi8(bestLo, lo, less);
+                        bestHi = _mm256_blendv_epi8(bestHi, hi, less);
+                        bestSymmetry = _mm256_blendv_epi8(bestSymmetry, _mm256_set1_epi32(static_cast<int>(s)), less);
+                    }
+                    turnLow = rotateBoardLeftAvx2(turnLow);
+                    turnHigh = rotateBoardLeftAvx2(turnHigh);
+                }
+            }
+        }
+
+        storeHashAvx2(out + i, bestLo, bestHi, loadAvx2(in.status, i));
+        if (symmetry != nullptr) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(symmetryLanes), bestSymmetry);
+            for (size_t lane = 0; lane < AVX2_LANES; ++lane) {
+                symmetry[i + lane] = static_cast<uint8_t>(symmetryLanes[lane]);
+            }
+        }
+    }
+    return end;
+}
+
+BATCH_TARGET_AVX2 size_t countPiecesAvx2(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    const size_t end = in.size - in.size % AVX2_LANES;
+    for (size_t i = 0; i < end; i += AVX2_LANES) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(player1Out + i),
+            popcountAvx2(maskAvx2(loadAvx2(in.player1, i), VALID_BOARD_MASK)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(player2Out + i),
+            popcountAvx2(maskAvx2(loadAvx2(in.player2, i), VALID_BOARD_MASK)));
+    }
+    return end;
+}
+
+template<uint32_t N>
+BATCH_TARGET_AVX2 size_t countMillsAvx2(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    const size_t end = in.size - in.size % AVX2_LANES;
+    for (size_t i = 0; i < end; i += AVX2_LANES) {
+        const __m256i player1 = loadAvx2(in.player1, i);
+        const __m256i player2 = loadAvx2(in.player2, i);
+        __m256i player1Mills = _mm256_setzero_si256();
+        __m256i player2Mills = _mm256_setzero_si256();
+        for (uint32_t lineId = 0; lineId < RuleTraits<N>::lineCount; ++lineId) {
+            // 满线时比较结果为 -1，减去即计数加一。
+            const uint32_t lineMask = RuleTraits<N>::lineMask(lineId);
+            const __m256i mask = _mm256_set1_epi32(static_cast<int>(lineMask));
+            player1Mills = _mm256_sub_epi32(player1Mills, _mm256_cmpeq_epi32(_mm256_and_si256(player1, mask), mask));
+            player2Mills = _mm256_sub_epi32(player2Mills, _mm256_cmpeq_epi32(_mm256_and_si256(player2, mask), mask));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(player1Out + i), player1Mills);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(player2Out + i), player2Mills);
+    }
+    return end;
+}
+
+template<uint32_t N>
+BATCH_TARGET_AVX2 inline __m256i mobilityAvx2(__m256i pieces, __m256i emptyCount, __m256i midgame,
+    __m256i clockwise, __m256i counterClockwise, __m256i outward, __m256i inward)
+{
+    // 四个方向的字节计数各不超过 8，相加后仍在一个字节内，只需一次乘法汇总。
+    __m256i mobility = sumBytesAvx2(_mm256_add_epi32(
+        _mm256_add_epi32(byteCountsAvx2(_mm256_and_si256(pieces, clockwise)), byteCountsAvx2(_mm256_and_si256(pieces, counterClockwise))),
+        _mm256_add_epi32(byteCountsAvx2(_mm256_and_si256(pieces, outward)), byteCountsAvx2(_mm256_and_si256(pieces, inward)))));
+    if (RuleTraits<N>::allowFlying) {
+        const __m256i count = popcountAvx2(pieces);
+        const __m256i flying = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(RuleTraits<N>::minPiecesToSurvive + 1u)), count);
+        mobility = _mm256_blendv_epi8(mobility, _mm256_mullo_epi32(count, emptyCount), flying);
+    }
+    return _mm256_and_si256(mobility, midgame);
+}
+
+template<uint32_t N>
+BATCH_TARGET_AVX2 size_t countMobilityAvx2(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    const size_t end = in.size - in.size % AVX2_LANES;
+    for (size_t i = 0; i < end; i += AVX2_LANES) {
+        const __m256i player1 = maskAvx2(loadAvx2(in.player1, i), VALID_BOARD_MASK);
+        const __m256i player2 = maskAvx2(loadAvx2(in.player2, i), VALID_BOARD_MASK);
+        const __m256i empty = _mm256_andnot_si256(_mm256_or_si256(_mm256_or_si256(player1, player2), loadAvx2(in.forbidden, i)),
+            _mm256_set1_epi32(static_cast<int>(VALID_BOARD_MASK)));
+        const __m256i midgame = _mm256_cmpeq_epi32(maskAvx2(loadAvx2(in.status, i), STATUS_PHASE_MASK),
+            _mm256_set1_epi32(static_cast<int>(GAME_MID)));
+
+        // 四个方向上“相邻点为空”的位棋盘，双方共用。
+        const uint32_t crossMask = crossMaskOf(RuleTraits<N>::hasDiagonalLines);
+        const __m256i clockwise = _mm256_or_si256(maskAvx2(_mm256_srli_epi32(empty, 1), ~RING_HIGH_BIT),
+            maskAvx2(_mm256_slli_epi32(empty, 7), RING_HIGH_BIT));
+        const __m256i counterClockwise = _mm256_or_si256(maskAvx2(_mm256_slli_epi32(empty, 1), ~RING_LOW_BIT & VALID_BOARD_MASK),
+            maskAvx2(_mm256_srli_epi32(empty, 7), RING_LOW_BIT));
+        const __m256i outward = maskAvx2(_mm256_srli_epi32(empty, SEAT), crossMask);
+        const __m256i inward = maskAvx2(_mm256_slli_epi32(empty, SEAT), crossMask);
+        const __m256i emptyCount = RuleTraits<N>::allowFlying ? popcountAvx2(empty) : _mm256_setzero_si256();
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(player1Out + i),
+            mobilityAvx2<N>(player1, emptyCount, midgame, clockwise, counterClockwise, outward, inward));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(player2Out + i),
+            mobilityAvx2<N>(player2, emptyCount, midgame, clockwise, counterClockwise, outward, inward));
+    }
+    return end;
+}
+#endif
+
+// ==================== AVX-512：每组 16 个局面 ====================
+
+#if defined(BATCH_AVX512)
+constexpr size_t AVX512_LANES = 16;
+
+BATCH_TARGET_AVX512 inline __m512i loadAvx512(const uint32_t* values, size_t i)
+{
+    return _mm512_load_si512(values + i);
+}
+
+BATCH_TARGET_AVX512 inline __m512i maskAvx512(__m512i value, uint32_t mask)
+{
+    return _mm512_and_si512(value, _mm512_set1_epi32(static_cast<int>(mask)));
+}
+
+BATCH_TARGET_AVX512 inline __m512i byteCountsAvx512(__m512i x)
+{
+    x = _mm512_sub_epi32(x, maskAvx512(_mm512_srli_epi32(x, 1), 0x55555555u));
+    x = _mm512_add_epi32(maskAvx512(x, 0x33333333u), maskAvx512(_mm512_srli_epi32(x, 2), 0x33333333u));
+    return maskAvx512(_mm512_add_epi32(x, _mm512_srli_epi32(x, 4)), 0x0f0f0f0fu);
+}
+
+BATCH_TARGET_AVX512 inline __m512i sumBytesAvx512(__m512i byteCounts)
+{
+    return _mm512_srli_epi32(_mm512_mullo_epi32(byteCounts, _mm512_set1_epi32(0x01010101)), 24);
+}
+
+BATCH_TARGET_AVX512 inline __m512i popcountAvx512(__m512i x)
+{
+    return sumBytesAvx512(byteCountsAvx512(x));
+}
+
+BATCH_TARGET_AVX512 inline __m512i spreadHalfAvx512(__m512i x)
+{
+    x = maskAvx512(_mm512_or_si512(x, _mm512_slli_epi32(x, 8)), 0x00ff00ffu);
+    x = maskAvx512(_mm512_or_si512(x, _mm512_slli_epi32(x, 4)), 0x0f0f0f0fu);
+    x = maskAvx512(_mm512_or_si512(x, _mm512_slli_epi32(x, 2)), 0x33333333u);
+    return maskAvx512(_mm512_or_si512(x, _mm512_slli_epi32(x, 1)), 0x55555555u);
+}
+
+BATCH_TARGET_AVX512 inline void boardKeyAvx512(__m512i low, __m512i high, __m512i& lo, __m512i& hi)
+{
+    lo = _mm512_or_si512(spreadHalfAvx512(maskAvx512(low, HALF_POS_MASK)),
+        _mm512_slli_epi32(spreadHalfAvx512(maskAvx512(high, HALF_POS_MASK)), 1));
+    hi = _mm512_or_si512(spreadHalfAvx512(_mm512_srli_epi32(low, HALF_SHIFT)),
+        _mm512_slli_epi32(spreadHalfAvx512(_mm512_srli_epi32(high, HALF_SHIFT)), 1));
+}
+
+BATCH_TARGET_AVX512 inline void storeHashAvx512(uint64_t* out, __m512i lo, __m512i hi, __m512i status)
+{
+    const __m512i low32 = _mm512_or_si512(lo, _mm512_slli_epi32(hi, 24));
+    const __m512i high32 = _mm512_or_si512(_mm512_srli_epi32(hi, 8),
+        _mm512_slli_epi32(maskAvx512(status, ChessData::HASH_STATUS_MASK), 16));
+    // unpack 按 128 位分段交错：even 为局面 0 1 4 5 8 9 12 13，odd 为 2 3 6 7 10 11 14 15。
+    const __m512i even = _mm512_unpacklo_epi32(low32, high32);
+    const __m512i odd = _mm512_unpackhi_epi32(low32, high32);
+    _mm512_storeu_si512(out, _mm512_permutex2var_epi64(even, _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0), odd));
+    _mm512_storeu_si512(out + 8, _mm512_permutex2var_epi64(even, _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), odd));
+}
+
+BATCH_TARGET_AVX512 inline __m512i mirrorBoardAvx512(__m512i board)
+{
+    board = _mm512_or_si512(maskAvx512(_mm512_srli_epi32(board, 4), 0x0f0f0fu), maskAvx512(_mm512_slli_epi32(board, 4), 0xf0f0f0u));
+    board = _mm512_or_si512(maskAvx512(_mm512_srli_epi32(board, 2), 0x333333u), maskAvx512(_mm512_slli_epi32(board, 2), 0xccccccu));
+    board = _mm512_or_si512(maskAvx512(_mm512_srli_epi32(board, 1), 0x555555u), maskAvx512(_mm512_slli_epi32(board, 1), 0xaaaaaau));
+    return _mm512_or_si512(maskAvx512(_mm512_slli_epi32(board, 1), ~RING_LOW_BIT & VALID_BOARD_MASK),
+        maskAvx512(_mm512_srli_epi32(board, 7), RING_LOW_BIT));
+}
+
+BATCH_TARGET_AVX512 inline __m512i turnBoardAvx512(__m512i board)
+{
+    return _mm512_or_si512(maskAvx512(board, 0x00ff00u),
+        _mm512_or_si512(maskAvx512(_mm512_srli_epi32(board, 16), 0xffu), _mm512_slli_epi32(maskAvx512(board, 0xffu), 16)));
+}
+
+BATCH_TARGET_AVX512 inline __m512i rotateBoardLeftAvx512(__m512i board)
+{
+    return _mm512_or_si512(maskAvx512(_mm512_srli_epi32(board, 2), 0x3f3f3fu), maskAvx512(_mm512_slli_epi32(board, 6), 0xc0c0c0u));
+}
+
+BATCH_TARGET_AVX512 size_t hashLiteAvx512(const BatchArrays& in, uint64_t* out)
+{
+    const size_t end = in.size - in.size % AVX512_LANES;
+    for (size_t i = 0; i < end; i += AVX512_LANES) {
+        const __m512i forbidden = loadAvx512(in.forbidden, i);
+        const __m512i low = maskAvx512(_mm512_or_si512(loadAvx512(in.player1, i), forbidden), VALID_BOARD_MASK);
+        const __m512i high = maskAvx512(_mm512_or_si512(loadAvx512(in.player2, i), forbidden), VALID_BOARD_MASK);
+        __m512i lo;
+        __m512i hi;
+        boardKeyAvx512(low, high, lo, hi);
+        storeHashAvx512(out + i, lo, hi, loadAvx512(in.status, i));
+    }
+    return end;
+}
+
+BATCH_TARGET_AVX512 size_t canonicalHashLiteAvx512(const BatchArrays& in, uint64_t* out, uint8_t* symmetry)
+{
+    const size_t end = in.size - in.size % AVX512_LANES;
+    for (size_t i = 0; i < end; i += AVX512_LANES) {
+        const __m512i forbidden = loadAvx512(in.forbidden, i);
+        const __m512i low = maskAvx512(_mm512_or_si512(loadAvx512(in.player1, i), forbidden), VALID_BOARD_MASK);
+        const __m512i high = maskAvx512(_mm512_or_si512(loadAvx512(in.player2, i), forbidden), VALID_BOARD_MASK);
+
+        __m512i bestLo;
+        __m512i bestHi;
+        boardKeyAvx512(low, high, bestLo, bestHi);
+        __m512i bestSymmetry = _mm512_setzero_si512();
+        for (uint32_t mirror = 0; mirror < 2u; ++mirror) {
+            const __m512i mirrorLow = mirror != 0u ? mirrorBoardAvx512(low) : low;
+            const __m512i mirrorHigh = mirror != 0u ? mirrorBoardAvx512(high) : high;
+            for (uint32_t turn = 0; turn < 2u; ++turn) {
+                __m512i turnLow = turn != 0u ? turnBoardAvx512(mirrorLow) : mirrorLow;
+                __m512i turnHigh = turn != 0u ? turnBoardAvx512(mirrorHigh) : mirrorHigh;
+                for (uint32_t rotate = 0; rotate < 4u; ++rotate) {
+                    const uint32_t s = mirror * 8u + turn * 4u + rotate;
+                    if (s != 0u) {
+                        __m512i lo;
+                        __m512i hi;
+                        boardKeyAvx512(turnLow, turnHigh, lo, hi);
+                        const __mmask16 less = _mm512_cmplt_epu32_mask(hi, bestHi)
+                            | (_mm512_cmpeq_epu32_mask(hi, bestHi) & _mm512_cmplt_epu32_mask(lo, bestLo));
+                        bestLo = _mm512_mask_blend_epi32(less, bestLo, lo);
+                        bestHi = _mm512_mask_blend_epi32(less, bestHi, hi);
+                        bestSymmetry = _mm512_mask_blend_epi32(less, bestSymmetry, _mm512_set1_epi32(static_cast<int>(s)));
+                    }
+                    turnLow = rotateBoardLeftAvx512(turnLow);
+                    turnHigh = rotateBoardLeftAvx512(turnHigh);
+                }
+            }
+        }
+
+        storeHashAvx512(out + i, bestLo, bestHi, loadAvx512(in.status, i));
+        if (symmetry != nullptr) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(symmetry + i), _mm512_cvtepi32_epi8(bestSymmetry));
+        }
+    }
+    return end;
+}
+
+BATCH_TARGET_AVX512 size_t countPiecesAvx512(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    const size_t end = in.size - in.size % AVX512_LANES;
+    for (size_t i = 0; i < end; i += AVX512_LANES) {
+        _mm512_storeu_si512(player1Out + i, popcountAvx512(maskAvx512(loadAvx512(in.player1, i), VALID_BOARD_MASK)));
+        _mm512_storeu_si512(player2Out + i, popcountAvx512(maskAvx512(loadAvx512(in.player2, i), VALID_BOARD_MASK)));
+    }
+    return end;
+}
+
+template<uint32_t N>
+BATCH_TARGET_AVX512 size_t countMillsAvx512(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    const size_t end = in.size - in.size % AVX512_LANES;
+    const __m512i one = _mm512_set1_epi32(1);
+    for (size_t i = 0; i < end; i += AVX512_LANES) {
+        const __m512i player1 = loadAvx512(in.player1, i);
+        const __m512i player2 = loadAvx512(in.player2, i);
+        __m512i player1Mills = _mm512_setzero_si512();
+        __m512i player2Mills = _mm512_setzero_si512();
+        for (uint32_t lineId = 0; lineId < RuleTraits<N>::lineCount; ++lineId) {
+            const uint32_t lineMask = RuleTraits<N>::lineMask(lineId);
+            const __m512i mask = _mm512_set1_epi32(static_cast<int>(lineMask));
+            player1Mills = _mm512_mask_add_epi32(player1Mills,
+                _mm512_cmpeq_epi32_mask(_mm512_and_si512(player1, mask), mask), player1Mills, one);
+            player2Mills = _mm512_mask_add_epi32(player2Mills,
+                _mm512_cmpeq_epi32_mask(_mm512_and_si512(player2, mask), mask), player2Mills, one);
+        }
+        _mm512_storeu_si512(player1Out + i, player1Mills);
+        _mm512_storeu_si512(player2Out + i, player2Mills);
+    }
+    return end;
+}
+
+template<uint32_t N>
+BATCH_TARGET_AVX512 inline __m512i mobilityAvx512(__m512i pieces, __m512i emptyCount, __mmask16 midgame,
+    __m512i clockwise, __m512i counterClockwise, __m512i outward, __m512i inward)
+{
+    __m512i mobility = sumBytesAvx512(_mm512_add_epi32(
+        _mm512_add_epi32(byteCountsAvx512(_mm512_and_si512(pieces, clockwise)), byteCountsAvx512(_mm512_and_si512(pieces, counterClockwise))),
+        _mm512_add_epi32(byteCountsAvx512(_mm512_and_si512(pieces, outward)), byteCountsAvx512(_mm512_and_si512(pieces, inward)))));
+    if (RuleTraits<N>::allowFlying) {
+        const __m512i count = popcountAvx512(pieces);
+        const __mmask16 flying = _mm512_cmple_epu32_mask(count, _mm512_set1_epi32(static_cast<int>(RuleTraits<N>::minPiecesToSurvive)));
+        mobility = _mm512_mask_blend_epi32(flying, mobility, _mm512_mullo_epi32(count, emptyCount));
+    }
+    return _mm512_maskz_mov_epi32(midgame, mobility);
+}
+
+template<uint32_t N>
+BATCH_TARGET_AVX512 size_t countMobilityAvx512(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    const size_t end = in.size - in.size % AVX512_LANES;
+    for (size_t i = 0; i < end; i += AVX512_LANES) {
+        const __m512i player1 = maskAvx512(loadAvx512(in.player1, i), VALID_BOARD_MASK);
+        const __m512i player2 = maskAvx512(loadAvx512(in.player2, i), VALID_BOARD_MASK);
+        const __m512i empty = _mm512_andnot_si512(_mm512_or_si512(_mm512_or_si512(player1, player2), loadAvx512(in.forbidden, i)),
+            _mm512_set1_epi32(static_cast<int>(VALID_BOARD_MASK)));
+        const __mmask16 midgame = _mm512_cmpeq_epi32_mask(maskAvx512(loadAvx512(in.status, i), STATUS_PHASE_MASK),
+            _mm512_set1_epi32(static_cast<int>(GAME_MID)));
+
+        const uint32_t crossMask = crossMaskOf(RuleTraits<N>::hasDiagonalLines);
+        const __m512i clockwise = _mm512_or_si512(maskAvx512(_mm512_srli_epi32(empty, 1), ~RING_HIGH_BIT),
+            maskAvx512(_mm512_slli_epi32(empty, 7), RING_HIGH_BIT));
+        const __m512i counterClockwise = _mm512_or_si512(maskAvx512(_mm512_slli_epi32(empty, 1), ~RING_LOW_BIT & VALID_BOARD_MASK),
+            maskAvx512(_mm512_srli_epi32(empty, 7), RING_LOW_BIT));
+        const __m512i outward = maskAvx512(_mm512_srli_epi32(empty, SEAT), crossMask);
+        const __m512i inward = maskAvx512(_mm512_slli_epi32(empty, SEAT), crossMask);
+        const __m512i emptyCount = RuleTraits<N>::allowFlying ? popcountAvx512(empty) : _mm512_setzero_si512();
+
+        _mm512_storeu_si512(player1Out + i,
+            mobilityAvx512<N>(player1, emptyCount, midgame, clockwise, counterClockwise, outward, inward));
+        _mm512_storeu_si512(player2Out + i,
+            mobilityAvx512<N>(player2, emptyCount, midgame, clockwise, counterClockwise, outward, inward));
+    }
+    return end;
+}
+#endif
+
+// ==================== 按 SIMD 级别分派 ====================
+// SIMD 版本处理完整的组并返回处理到的下标，剩余尾部交给标量版本。
+
+template<uint32_t N>
+void countMillsDispatch(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    size_t done = 0;
+    switch (currentSimd())
+    {
+#if defined(BATCH_AVX512)
+    case BATCH_SIMD_AVX512:
+        done = countMillsAvx512<N>(in, player1Out, player2Out);
+        break;
+#endif
+#if defined(BATCH_AVX2)
+    case BATCH_SIMD_AVX2:
+        done = countMillsAvx2<N>(in, player1Out, player2Out);
+        break;
+#endif
+    default:
+        break;
+    }
+    countMillsScalar<N>(in, done, player1Out, player2Out);
+}
+
+template<uint32_t N>
+void countMobilityDispatch(const BatchArrays& in, uint32_t* player1Out, uint32_t* player2Out)
+{
+    size_t done = 0;
+    switch (currentSimd())
+    {
+#if defined(BATCH_AVX512)
+    case BATCH_SIMD_AVX512:
+        done = countMobilityAvx512<N>(in, player1Out, player2Out);
+        break;
+#endif
+#if defined(BATCH_AVX2)
+    case BATCH_SIMD_AVX2:
+        done = countMobilityAvx2<N>(in, player1Out, player2Out);
+        break;
+#endif
+    default:
+        break;
+    }
+    countMobilityScalar<N>(in, done, player1Out, player2Out);
+}
+
+} // namespace
+
+PositionBatch::PositionBatch(uint32_t ruleIndex)
+    : m_ruleIndex(ruleIndex < RULE_COUNT ? ruleIndex : 0u)
+{
+}
+
+PositionBatch::PositionBatch(PositionBatch&& other) noexcept
+    : m_ruleIndex(other.m_ruleIndex)
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+    , m_storage(std::move(other.m_storage))
+    , m_fields(other.m_fields)
+{
+    other.m_size = 0;
+    other.m_capacity = 0;
+    other.m_storage.clear();
+    other.m_fields = nullptr;
+}
+
+PositionBatch& PositionBatch::operator=(PositionBatch&& other) noexcept
+{
+    if (this != &other) {
+        m_ruleIndex = other.m_ruleIndex;
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        m_storage = std::move(other.m_storage);
+        m_fields = other.m_fields;
+        other.m_size = 0;
+        other.m_capacity = 0;
+        other.m_storage.clear();
+        other.m_fields = nullptr;
+    }
+    return *this;
+}
+
+void PositionBatch::reserve(size_t count)
+{
+    if (count <= m_capacity) {
+        return;
+    }
+
+    // 按倍数增长，避免逐个 push 时反复搬移。
+    size_t capacity = std::max(count, m_capacity * 2);
+    capacity = (capacity + CAPACITY_STEP - 1) / CAPACITY_STEP * CAPACITY_STEP;
+
+    // 多申请一个对齐步长，从中取第一个 64 字节对齐的地址作为字段数组起点。
+    std::vector<uint32_t> storage(capacity * FIELD_COUNT + CAPACITY_STEP, 0u);
+    const size_t misalign = reinterpret_cast<uintptr_t>(storage.data()) % FIELD_ALIGNMENT;
+    uint32_t* fields = storage.data() + (misalign == 0 ? 0 : (FIELD_ALIGNMENT - misalign) / sizeof(uint32_t));
+
+    for (uint32_t f = 0; f < FIELD_COUNT; ++f) {
+        if (m_size != 0) {
+            std::memcpy(fields + f * capacity, field(static_cast<Field>(f)), m_size * sizeof(uint32_t));
+        }
+    }
+
+    m_storage.swap(storage);
+    m_fields = fields;
+    m_capacity = capacity;
+}
+
+void PositionBatch::resize(size_t count)
+{
+    reserve(count);
+    for (uint32_t f = 0; f < FIELD_COUNT; ++f) {
+        if (count > m_size) {
+            std::memset(field(static_cast<Field>(f)) + m_size, 0, (count - m_size) * sizeof(uint32_t));
+        }
+    }
+    m_size = count;
+}
+
+void PositionBatch::push(const ChessData& data)
+{
+    if (m_size == m_capacity) {
+        reserve(m_size + 1);
+    }
+    player1Boards()[m_size] = data.player1Board;
+    player2Boards()[m_size] = data.player2Board;
+    forbiddenBoards()[m_size] = data.forbiddenBoard;
+    statuses()[m_size] = data.status;
+    ++m_size;
+}
+
+void PositionBatch::push(const Position& position)
+{
+    push(position.getData());
+}
+
+void PositionBatch::load(size_t index, ChessData& data) const
+{
+    data.player1Board = player1Boards()[index];
+    data.player2Board = player2Boards()[index];
+    data.forbiddenBoard = forbiddenBoards()[index];
+    data.status = statuses()[index];
+}
+
+void PositionBatch::hashLite(uint64_t* out) const
+{
+    const BatchArrays in = { player1Boards(), player2Boards(), forbiddenBoards(), statuses(), m_size };
+    size_t done = 0;
+    switch (currentSimd())
+    {
+#if defined(BATCH_AVX512)
+    case BATCH_SIMD_AVX512:
+        done = hashLiteAvx512(in, out);
+        break;
+#endif
+#if defined(BATCH_AVX2)
+    case BATCH_SIMD_AVX2:
+        done = hashLiteAvx2(in, out);
+        break;
+#endif
+    default:
+        break;
+    }
+    hashLiteScalar(in, done, out);
+}
+
+void PositionBatch::canonicalHashLite(uint64_t* out, uint8_t* symmetry) const
+{
+    const BatchArrays in = { player1Boards(), player2Boards(), forbiddenBoards(), statuses(), m_size };
+    size_t done = 0;
+    switch (currentSimd())
+    {
+#if defined(BATCH_AVX512)
+    case BATCH_SIMD_AVX512:
+        done = canonicalHashLiteAvx512(in, out, symmetry);
+        break;
+#endif
+#if defined(BATCH_AVX2)
+    case BATCH_SIMD_AVX2:
+        done = canonicalHashLiteAvx2(in, out, symmetry);
+        break;
+#endif
+    default:
+        break;
+    }
+    canonicalHashLiteScalar(in, done, out, symmetry);
+}
+
+void PositionBatch::countPieces(uint32_t* player1Out, uint32_t* player2Out) const
+{
+    const BatchArrays in = { player1Boards(), player2Boards(), forbiddenBoards(), statuses(), m_size };
+    size_t done = 0;
+    switch (currentSimd())
+    {
+#if defined(BATCH_AVX512)
+    case BATCH_SIMD_AVX512:
+        done = countPiecesAvx512(in, player1Out, player2Out);
+        break;
+#endif
+#if defined(BATCH_AVX2)
+    case BATCH_SIMD_AVX2:
+        done = countPiecesAvx2(in, player1Out, player2Out);
+        break;
+#endif
+    default:
+        break;
+    }
+    countPiecesScalar(in, done, player1Out, player2Out);
+}
+
+void PositionBatch::countMills(uint32_t* player1Out, uint32_t* player2Out) const
+{
+    const BatchArrays in = { player1Boards(), player2Boards(), forbiddenBoards(), statuses(), m_size };
+    dispatchRule(m_ruleIndex, [&](auto rule) {
+        countMillsDispatch<decltype(rule)::value>(in, player1Out, player2Out);
+    });
+}
+
+void PositionBatch::countMobility(uint32_t* player1Out, uint32_t* player2Out) const
+{
+    const BatchArrays in = { player1Boards(), player2Boards(), forbiddenBoards(), statuses(), m_size };
+    dispatchRule(m_ruleIndex, [&](auto rule) {
+        countMobilityDispatch<decltype(rule)::value>(in, player1Out, player2Out);
+    });
+}
+
+BatchSimd PositionBatch::detectedSimd()
+{
+    return g_detectedSimd;
+}
+
+void PositionBatch::setSimd(BatchSimd simd)
+{
+    g_activeSimd.store(static_cast<uint32_t>(std::min(simd, g_detectedSimd)), std::memory_order_relaxed);
+}
+
+BatchSimd PositionBatch::activeSimd()
+{
+    return currentSimd();
+}
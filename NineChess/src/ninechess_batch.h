@@ -0,0 +1,130 @@
+/****************************************************************************
+** NineChess - 批量局面容器（结构数组）
+**
+** 批量分析、生成训练数据时要处理上百万个局面。逐个构造 Position / NineChess
+** 会把大部分内存带宽花在序号层、历史三连和界面层字符串上。
+** PositionBatch 只保存主位棋盘与 status 四个字段，每个字段一条 64 字节对齐的连续数组，
+** 批量内核顺序扫描这些数组：AVX2 一条指令处理 8 个局面，AVX-512 处理 16 个，
+** CPU 不支持时退回标量实现，三种实现结果逐位一致。
+**
+** 一个批次内的局面共用一套规则。九连棋的序号层与历史三连不进入批次，
+** 因此这里的哈希都是 getHashLite() 口径。
+****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ninechess_common.h"
+
+class Position;
+
+// 批量内核使用的 SIMD 级别。
+enum BatchSimd : uint32_t {
+    BATCH_SIMD_SCALAR = 0,
+    BATCH_SIMD_AVX2 = 1,
+    BATCH_SIMD_AVX512 = 2
+};
+
+class PositionBatch
+{
+public:
+    explicit PositionBatch(uint32_t ruleIndex);
+
+    // 字段数组按对齐偏移放在同一块缓冲区里，不能逐成员复制；移动时缓冲区整体转移。
+    PositionBatch(const PositionBatch&) = delete;
+    PositionBatch& operator=(const PositionBatch&) = delete;
+    PositionBatch(PositionBatch&& other) noexcept;
+    PositionBatch& operator=(PositionBatch&& other) noexcept;
+
+    // ==================== 容量与读写 ====================
+    // 批内局面使用的规则下标；越界下标按 0 号规则处理。
+    uint32_t getRuleIndex() const { return m_ruleIndex; }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+
+    // 预留至少 count 个局面的空间，已有数据保持不变。
+    void reserve(size_t count);
+
+    // 改变局面个数，新增的局面四个字段全部为 0，适合随后经字段数组直接填写。
+    void resize(size_t count);
+
+    void clear() { m_size = 0; }
+
+    // 追加一个局面，只取主位棋盘与 status。
+    void push(const ChessData& data);
+    void push(const Position& position);
+
+    // 把第 index 个局面写回 data 的四个字段，其余字段保持不变。
+    void load(size_t index, ChessData& data) const;
+
+    // 字段数组，长度为 size()，起始地址 64 字节对齐。
+    const uint32_t* player1Boards() const { return field(FIELD_PLAYER1); }
+    const uint32_t* player2Boards() const { return field(FIELD_PLAYER2); }
+    const uint32_t* forbiddenBoards() const { return field(FIELD_FORBIDDEN); }
+    const uint32_t* statuses() const { return field(FIELD_STATUS); }
+    uint32_t* player1Boards() { return field(FIELD_PLAYER1); }
+    uint32_t* player2Boards() { return field(FIELD_PLAYER2); }
+    uint32_t* forbiddenBoards() { return field(FIELD_FORBIDDEN); }
+    uint32_t* statuses() { return field(FIELD_STATUS); }
+
+    // ==================== 批量内核 ====================
+    // 以下输出数组至少要有 size() 项，第 i 项对应第 i 个局面。
+
+    // 逐个局面的 ChessData::getHashLite()。
+    void hashLite(uint64_t* out) const;
+
+    // 16 种对称变换下 getHashLite() 的最小值，取法与 Position::getCanonicalHash() 相同：
+    // 按变换编号从小到大比较，相等时保留编号小的。symmetry 非空时写出取得最小值的变换编号。
+    // 非九连棋规则下与 Position::getCanonicalHash() 结果一致。
+    void canonicalHashLite(uint64_t* out, uint8_t* symmetry = nullptr) const;
+
+    // 双方在盘子数。
+    void countPieces(uint32_t* player1Out, uint32_t* player2Out) const;
+
+    // 双方已经占满的三连线条数。
+    void countMills(uint32_t* player1Out, uint32_t* player2Out) const;
+
+    // 双方的走子灵活度，口径与 AI 估值的中局灵活度特征相同：
+    // 非中局为 0；可以飞子的一方为 子数 × 空位数；否则为每个棋子相邻空位数之和。
+    // 只看整盘棋子，不区分当前是否已选中棋子或正在提子。
+    void countMobility(uint32_t* player1Out, uint32_t* player2Out) const;
+
+    // 当前 CPU 支持的最高 SIMD 级别。
+    static BatchSimd detectedSimd();
+
+    // 指定使用的 SIMD 级别，超过 CPU 支持时自动降级；主要用于测试与基准对比。
+    static void setSimd(BatchSimd simd);
+
+    // 当前实际使用的 SIMD 级别。
+    static BatchSimd activeSimd();
+
+private:
+    enum Field : uint32_t {
+        FIELD_PLAYER1 = 0,
+        FIELD_PLAYER2 = 1,
+        FIELD_FORBIDDEN = 2,
+        FIELD_STATUS = 3,
+        FIELD_COUNT = 4
+    };
+
+    // 每个字段数组的起始地址按 64 字节（一条缓存行，一个 AVX-512 寄存器）对齐，
+    // 容量也按 16 个局面取整，保证下一个字段数组同样对齐。
+    static constexpr size_t FIELD_ALIGNMENT = 64;
+    static constexpr size_t CAPACITY_STEP = FIELD_ALIGNMENT / sizeof(uint32_t);
+
+    const uint32_t* field(Field index) const { return m_fields + static_cast<size_t>(index) * m_capacity; }
+    uint32_t* field(Field index) { return m_fields + static_cast<size_t>(index) * m_capacity; }
+
+    uint32_t m_ruleIndex = 0;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+
+    // 四个字段数组依次排在 m_storage 中，m_fields 指向第一个对齐地址。
+    std::vector<uint32_t> m_storage;
+    uint32_t* m_fields = nullptr;
+};
@@ -0,0 +1,129 @@
+/****************************************************************************
+** NineChess - 开局库
+****************************************************************************/
+
+#include "ninechess_book.h"
+#include "ninechess_mappedfile.h"
+
+#include <algorithm>
+#include <fstream>
+
+bool NineChess_Book::coversPosition(const Position& chess)
+{
+    return chess.getPhase() == GAME_OPENING
+        && (chess.getAction() == ACTION_PLACE || chess.getAction() == ACTION_CAPTURE);
+}
+
+uint64_t NineChess_Book::positionKey(const Position& chess, uint32_t& symmetry)
+{
+    return chess.getCanonicalHash(&symmetry);
+}
+
+bool NineChess_Book::load(const std::string& path, uint32_t ruleIndex)
+{
+    m_count = 0;
+    m_ruleIndex = ruleIndex;
+    if (!m_file.open(path) || m_file.size() < BOOK_HEADER_SIZE) {
+        m_file.close();
+        return false;
+    }
+
+    // 文件头：魔数、版本、规则、保留、条目数（64 位），其余补零。
+    const uint8_t* header = m_file.data();
+    const uint64_t count = readU64(header + 16);
+    if (readU32(header) != BOOK_FILE_MAGIC
+        || readU32(header + 4) != BOOK_FILE_VERSION
+        || readU32(header + 8) != ruleIndex
+        // 先限制条目数，避免损坏的计数让乘法回绕后通过长度检查。
+        || count > (m_file.size() - BOOK_HEADER_SIZE) / BOOK_ENTRY_SIZE
+        || m_file.size() != BOOK_HEADER_SIZE + count * BOOK_ENTRY_SIZE) {
+        m_file.close();
+        return false;
+    }
+
+    m_count = count;
+    return true;
+}
+
+BookEntry NineChess_Book::entryAt(uint64_t index) const
+{
+    const uint8_t* bytes = m_file.data() + BOOK_HEADER_SIZE + index * BOOK_ENTRY_SIZE;
+    BookEntry entry;
+    entry.key = readU64(bytes);
+    entry.value = static_cast<int16_t>(readU16(bytes + 8));
+    entry.weight = readU16(bytes + 10);
+    entry.pos = bytes[12];
+    return entry;
+}
+
+bool NineChess_Book::probe(const Position& chess, std::vector<BookEntry>& entries) const
+{
+    entries.clear();
+    if (!isLoaded() || chess.getRuleIndex() != m_ruleIndex || !coversPosition(chess)) {
+        return false;
+    }
+
+    uint32_t symmetry = 0u;
+    const uint64_t key = positionKey(chess, symmetry);
+
+    // 条目按键值排序，二分找到第一条，再顺序读出同键的全部着法（文件中已按权重降序）。
+    uint64_t low = 0u;
+    uint64_t high = m_count;
+    while (low < high) {
+        const uint64_t mid = low + (high - low) / 2u;
+        if (readU64(m_file.data() + BOOK_HEADER_SIZE + mid * BOOK_ENTRY_SIZE) < key) {
+            low = mid + 1u;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    for (uint64_t index = low; index < m_count; ++index) {
+        BookEntry entry = entryAt(index);
+        if (entry.key != key) {
+            break;
+        }
+        const int32_t pos = NineChess::inverseSymmetryPos(entry.pos, symmetry);
+        if (pos < 0) {
+            continue;
+        }
+        entry.pos = static_cast<uint8_t>(pos);
+        entries.push_back(entry);
+    }
+    return !entries.empty();
+}
+
+bool NineChess_Book::save(const std::string& path, uint32_t ruleIndex, std::vector<BookEntry> entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& lhs, const BookEntry& rhs) {
+        if (lhs.key != rhs.key) {
+            return lhs.key < rhs.key;
+        }
+        if (lhs.weight != rhs.weight) {
+            return lhs.weight > rhs.weight;
+        }
+        return lhs.pos < rhs.pos;
+    });
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    writeU32(out, BOOK_FILE_MAGIC);
+    writeU32(out, BOOK_FILE_VERSION);
+    writeU32(out, ruleIndex);
+    writeU32(out, 0u);
+    writeU64(out, static_cast<uint64_t>(entries.size()));
+    writeU64(out, 0u);
+
+    for (const BookEntry& entry : entries) {
+        writeU64(out, entry.key);
+        writeU16(out, static_cast<uint16_t>(entry.value));
+        writeU16(out, entry.weight);
+        const char tail[4] = { static_cast<char>(entry.pos), 0, 0, 0 };
+        out.write(tail, sizeof(tail));
+    }
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+** NineChess - 开局库
+**
+** 开局摆子阶段的前几步几乎对称，搜索花的时间最多、收益最少。
+** 开局库由 NineChessTools book 子命令按规则离线生成：并行深搜前 N 步内的全部局面，
+** 为每个局面记下较优的若干着法及其权重，搜索前先查库，命中即直接出着。
+**
+** 键值：
+**   局面取 NineChess::getCanonicalHash()，即 16 种等价变换下哈希的最小值；
+**   着法点位同时换到取得最小值的那个视角下保存，查询时再按当前局面的变换换回。
+**   局面自身对称时几个变换都能取到最小值，换回后得到的是彼此等价的着法。
+**
+** 文件：
+**   32 字节文件头 + 按 (键值, 权重降序) 排序的 16 字节条目，以只读映射方式打开。
+**   条目：键值 u64、先手视角分值 i16、权重 u16、规范视角点位 u8、保留 3 字节，均为小端。
+****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ninechess.h"
+#include "ninechess_mappedfile.h"
+
+// 开局库文件头中的魔数 "NCBK" 与格式版本。
+constexpr uint32_t BOOK_FILE_MAGIC = 0x4b42434eu;
+constexpr uint32_t BOOK_FILE_VERSION = 1u;
+
+// 文件头与单个条目的字节数。
+constexpr size_t BOOK_HEADER_SIZE = 32;
+constexpr size_t BOOK_ENTRY_SIZE = 16;
+
+// 开局库中的一条着法。
+struct BookEntry {
+    // 局面的规范哈希。
+    uint64_t key = 0;
+
+    // 走完这步后的先手视角分值。
+    int16_t value = 0;
+
+    // 着法权重，越大越优先。
+    uint16_t weight = 0;
+
+    // 落子或提子的点位；写入文件时为规范视角，probe() 返回时已换回当前视角。
+    uint8_t pos = 0;
+};
+
+class NineChess_Book
+{
+public:
+    NineChess_Book() = default;
+
+    NineChess_Book(const NineChess_Book&) = delete;
+    NineChess_Book& operator=(const NineChess_Book&) = delete;
+
+    // 开局库只收录开局摆子阶段（含摆子成三后的提子）的局面。
+    static bool coversPosition(const Position& chess);
+
+    // 局面的规范键值；symmetry 写出当前局面到规范视角所用的变换编号。
+    static uint64_t positionKey(const Position& chess, uint32_t& symmetry);
+
+    // 映射开局库文件并校验文件头，规则不符时返回 false。
+    bool load(const std::string& path, uint32_t ruleIndex);
+
+    bool isLoaded() const { return m_file.data() != nullptr; }
+
+    uint32_t ruleIndex() const { return m_ruleIndex; }
+
+    // 文件中的条目总数。
+    uint64_t entryCount() const { return m_count; }
+
+    // 查询当前局面的全部书内着法，按权重从大到小排列，点位已换回当前视角。
+    // 局面不在库中或规则不符时返回 false。
+    bool probe(const Position& chess, std::vector<BookEntry>& entries) const;
+
+    // 排序后写出开局库；entries 中的点位须是规范视角。
+    static bool save(const std::string& path, uint32_t ruleIndex, std::vector<BookEntry> entries);
+
+private:
+    // 读出第 index 个条目。
+    BookEntry entryAt(uint64_t index) const;
+
+private:
+    MappedFile m_file;
+    uint32_t m_ruleIndex = 0;
+    uint64_t m_count = 0;
+};
@@ -13,8 +13,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <type_traits>
 
 // 位操作的兼容性处理
 #if __cplusplus >= 202002L
@@ -234,6 +235,153 @@ inline bool isMillKeyPlayer2(MillKey key)
     return (key & MILL_KEY_PLAYER_MASK) != 0;
 }
 
+// ==================== 历史三连表 ====================
+// 九连棋的历史三连表：定长数组 + 条数，接口与 vector 的常用部分一致。
+//
+// 容量估算：每条新的历史三连都会换来一次提子，
+// 九连棋一方最多提掉对手 9 - 2 = 7 颗子，最后一手同时成两个三连时多记 1 条，
+// 双方合计不超过 16 条。这里留到 24 条，超出容量的追加直接忽略。
+struct MillHistory {
+    static constexpr uint32_t CAPACITY = 24;
+
+    MillKey keys[CAPACITY] = {};
+    uint16_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0u; }
+    void clear() { count = 0u; }
+
+    void push_back(MillKey key)
+    {
+        if (count < CAPACITY) {
+            keys[count++] = key;
+        }
+    }
+
+    // 只用于按已有表的条数整体改写，新增的条目先清零。
+    void resize(size_t newSize)
+    {
+        const uint16_t target = static_cast<uint16_t>(newSize < CAPACITY ? newSize : CAPACITY);
+        for (uint16_t i = count; i < target; ++i) {
+            keys[i] = MILL_KEY_NONE;
+        }
+        count = target;
+    }
+
+    MillKey& operator[](size_t index) { return keys[index]; }
+    const MillKey& operator[](size_t index) const { return keys[index]; }
+
+    MillKey* begin() { return keys; }
+    MillKey* end() { return keys + count; }
+    const MillKey* begin() const { return keys; }
+    const MillKey* end() const { return keys + count; }
+
+    bool operator==(const MillHistory& other) const
+    {
+        if (count != other.count) {
+            return false;
+        }
+        for (uint16_t i = 0; i < count; ++i) {
+            if (keys[i] != other.keys[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const MillHistory& other) const { return !(*this == other); }
+};
+
+// ==================== 棋谱记录位布局 ====================
+// 命令历史不存命令文本，每一步打包成 16 位：
+// bit  0-4  : 点位 to（0~23），单点、走子终点和提子点都放这里
+// bit  5-9  : 走子起点 from（0~23），只有走子使用
+// bit 10-12 : 记录类型
+// bit 13-15 : 预留
+//
+// 文本只在需要显示时由 NineChess::formatMoveRecord() 生成，
+// 一局 1000 步的历史只占 2KB。
+using MoveRecord = uint16_t;
+constexpr MoveRecord MOVE_RECORD_NONE = 0x0000u;
+constexpr uint32_t MOVE_RECORD_TO_SHIFT = 0;
+constexpr uint32_t MOVE_RECORD_FROM_SHIFT = 5;
+constexpr uint32_t MOVE_RECORD_TYPE_SHIFT = 10;
+constexpr MoveRecord MOVE_RECORD_POS_MASK = 0x001fu;
+constexpr MoveRecord MOVE_RECORD_TYPE_MASK = 0x0007u;
+
+// 记录类型，0 留给 MOVE_RECORD_NONE。
+enum MoveRecordType : uint32_t {
+    MOVE_RECORD_POINT = 1,          // "(c,p)"：开局落子，或中局选子
+    MOVE_RECORD_MOVE = 2,           // "(c1,p1)->(c2,p2)"：中局走子
+    MOVE_RECORD_CAPTURE = 3,        // "-(c,p)"：提子
+    MOVE_RECORD_GIVEUP_PLAYER1 = 4, // "-0"：先手认输
+    MOVE_RECORD_GIVEUP_PLAYER2 = 5, // "-1"：后手认输
+    MOVE_RECORD_DRAW = 6            // "=="：裁定平局
+};
+
+// 生成一条棋谱记录；不使用的点位传 0。
+inline MoveRecord makeMoveRecord(MoveRecordType type, int32_t fromPos = 0, int32_t toPos = 0)
+{
+    return static_cast<MoveRecord>(
+          ((static_cast<uint32_t>(toPos) & MOVE_RECORD_POS_MASK) << MOVE_RECORD_TO_SHIFT)
+        | ((static_cast<uint32_t>(fromPos) & MOVE_RECORD_POS_MASK) << MOVE_RECORD_FROM_SHIFT)
+        | ((static_cast<uint32_t>(type) & MOVE_RECORD_TYPE_MASK) << MOVE_RECORD_TYPE_SHIFT));
+}
+
+// 读取记录类型；MOVE_RECORD_NONE 读出 0。
+inline uint32_t getMoveRecordType(MoveRecord record)
+{
+    return (record >> MOVE_RECORD_TYPE_SHIFT) & MOVE_RECORD_TYPE_MASK;
+}
+
+// 读取走子起点。
+inline int32_t getMoveRecordFrom(MoveRecord record)
+{
+    return static_cast<int32_t>((record >> MOVE_RECORD_FROM_SHIFT) & MOVE_RECORD_POS_MASK);
+}
+
+// 读取单点、走子终点或提子点。
+inline int32_t getMoveRecordTo(MoveRecord record)
+{
+    return static_cast<int32_t>((record >> MOVE_RECORD_TO_SHIFT) & MOVE_RECORD_POS_MASK);
+}
+
+// ==================== 合法着法缓冲区 ====================
+// Position::generateLegal() 的输出，定长数组，生成着法不分配内存。
+// 上界：开局至多 24 个空点；中局不飞子时至多 12 颗子 × 4 个邻点，
+// 飞子时至多 3 颗子 × 21 个空点；提子至多 12 颗。因此 64 项足够，push() 不再检查越界。
+struct MoveBuffer {
+    static constexpr size_t MAX_COUNT = 64;
+
+    MoveRecord moves[MAX_COUNT];
+    size_t count = 0;
+
+    void clear() { count = 0; }
+    void push(MoveRecord record) { moves[count++] = record; }
+
+    const MoveRecord* begin() const { return moves; }
+    const MoveRecord* end() const { return moves + count; }
+};
+
+// ==================== 定长打包格式 ====================
+// 九连棋局面的定长二进制形式，由 ChessData::pack() / unpack() 互转。
+// 非九连棋规则只需要 board 一个字，见 ChessData::packLite()。
+struct PackedChessData {
+    // 主位棋盘与 status，与 ChessData::packLite() 相同。
+    uint64_t board = 0;
+
+    // 9 个序号层，每层 10 bit：低 5 位为先手该号棋的位置，高 5 位为后手的，
+    // 0 表示不在盘上，1~24 为点位 + 1（与 getHashHard() 的 layerCode 相同）。
+    // 第 0~5 层依次放在 numbers[0]，第 6~8 层放在 numbers[1] 的低 30 位；
+    // numbers[1] 的 bit 59-63 是历史三连条数，其余位为 0。
+    uint64_t numbers[2] = {};
+
+    // 历史三连按追加顺序保存，未用的槽位为 0，两份相同的局面打包结果逐字节相同。
+    MillKey millKeys[MillHistory::CAPACITY] = {};
+};
+
+static_assert(sizeof(PackedChessData) == 72, "PackedChessData 的布局必须固定为 72 字节");
+
 // ==================== 棋局数据结构 ====================
 // ChessData 是 NineChess 核心逻辑和 AI 共用的局面描述。
 //
@@ -272,49 +420,6 @@ struct ChessData {
     static constexpr uint32_t PLAYER1_PLACED_ONE_MORE_STATE_2 =
         GAME_OPENING | ACTION_CAPTURE | PLAYER1;
 
-    // 默认构造时把所有核心状态清零。
-    // 这样 AI 在批量创建节点时，不会拿到未初始化的脏位棋盘。
-    ChessData()
-        : status(0),
-          player1Board(0),
-          player2Board(0),
-          forbiddenBoard(0),
-          numberBoards{},
-          millHistory()
-    {
-    }
-
-    // 显式拷贝构造：保证 numberBoards 和 millHistory 被完整复制。
-    ChessData(const ChessData& other)
-        : status(other.status),
-          player1Board(other.player1Board),
-          player2Board(other.player2Board),
-          forbiddenBoard(other.forbiddenBoard),
-          numberBoards{},
-          millHistory(other.millHistory)
-    {
-        for (int i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
-            numberBoards[i] = other.numberBoards[i];
-        }
-    }
-
-    // 显式赋值：和拷贝构造保持一致，避免以后追加成员时漏拷贝。
-    ChessData& operator=(const ChessData& other)
-    {
-        if (this == &other)
-            return *this;
-
-        status = other.status;
-        player1Board = other.player1Board;
-        player2Board = other.player2Board;
-        forbiddenBoard = other.forbiddenBoard;
-        for (int i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
-            numberBoards[i] = other.numberBoards[i];
-        }
-        millHistory = other.millHistory;
-        return *this;
-    }
-
     // 打包状态字段。详见上方 status 位布局说明。
     uint32_t status = 0;
 
@@ -448,14 +553,12 @@ struct ChessData {
     uint32_t numberBoards[NUMBERED_PIECE_COUNT] = {};
 
     // 九连棋历史三连表。
-    // 使用 vector 而不是 list，原因是：
-    // 1. AI 搜索会频繁复制局面，vector 拷贝更紧凑；
-    // 2. hard hash 会遍历整张表，vector 的缓存局部性更好；
-    // 3. 这张表在语义上更接近“历史集合”，主要操作是追加和遍历，而不是中间频繁插删。
+    // 使用定长的 MillHistory 而不是 vector，ChessData 因而可以按字节复制，
+    // AI 搜索复制局面时不再分配堆内存。
     //
     // 这里要求调用方只追加“去重后的历史三连”。
     // 也就是说，同一个 MillKey 最多出现一次。
-    std::vector<MillKey> millHistory;
+    MillHistory millHistory;
 
     // 动态状态说明：
     // 1. player2InHand 已经打包进 status 的最低 4 位；
@@ -604,5 +707,111 @@ struct ChessData {
 
         return mix64(hash ^ rotl64(historyHash, 29u));
     }
+
+    // ==================== 定长打包 ====================
+    // 非九连棋规则的 8 字节形式，与 getHashLite() 逐位相同：
+    //   bit  0-47 : 两平面交织的主位棋盘
+    //   bit 48-61 : status
+    //   bit 62-63 : 0
+    // 三个主位棋盘互斥时（非九连棋规则总是如此）可由 unpackLite() 原样还原。
+    inline uint64_t packLite() const
+    {
+        return getHashLite();
+    }
+
+    // packLite() 的逆运算：写回三个主位棋盘与 status，并清空序号层与历史三连。
+    // 预留位不为 0 时返回 false，数据保持不变。
+    inline bool unpackLite(uint64_t packed)
+    {
+        if ((packed >> 62) != 0u) {
+            return false;
+        }
+
+        // getHashLite() 中 bit expand 的逆过程：把偶数位上的 24 个 bit 收拢回低 24 位。
+        const auto compact = [](uint64_t x) -> uint32_t {
+            x &= 0x0000555555555555ULL;
+            x = (x | (x >> 1)) & 0x3333333333333333ULL;
+            x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+            x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+            x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+            x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+            return static_cast<uint32_t>(x);
+        };
+        const uint32_t low = compact(packed);
+        const uint32_t high = compact(packed >> 1);
+
+        player1Board = low & ~high;
+        player2Board = high & ~low;
+        forbiddenBoard = low & high;
+        status = static_cast<uint32_t>(packed >> 48) & HASH_STATUS_MASK;
+        for (uint32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+            numberBoards[i] = 0u;
+        }
+        millHistory.clear();
+        return true;
+    }
+
+    // 九连棋的定长形式。每个序号层在每一方最多 1 颗棋，且必须落在该方的主位棋盘上，
+    // 满足这一点的局面（九连棋走子过程中总是如此）可由 unpack() 原样还原，
+    // 包括历史三连的顺序。
+    inline void pack(PackedChessData& packed) const
+    {
+        packed = PackedChessData();
+        packed.board = packLite();
+
+        const uint32_t player1 = player1Board & VALID_BOARD_MASK;
+        const uint32_t player2 = player2Board & VALID_BOARD_MASK;
+        for (uint32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+            const uint32_t layer = numberBoards[i] & VALID_BOARD_MASK;
+            const uint32_t player1Piece = player1 & layer;
+            const uint32_t player2Piece = player2 & layer;
+            const uint64_t layerCode =
+                static_cast<uint64_t>(player1Piece == 0u ? 0u : (CTZ32(player1Piece) + 1u))
+                | (static_cast<uint64_t>(player2Piece == 0u ? 0u : (CTZ32(player2Piece) + 1u)) << 5);
+            packed.numbers[i / 6u] |= layerCode << (10u * (i % 6u));
+        }
+
+        packed.numbers[1] |= static_cast<uint64_t>(millHistory.size()) << 59;
+        for (size_t i = 0; i < millHistory.size(); ++i) {
+            packed.millKeys[i] = millHistory[i];
+        }
+    }
+
+    // pack() 的逆运算。点位编码越界、条数超出容量或预留位不为 0 时返回 false，数据保持不变。
+    inline bool unpack(const PackedChessData& packed)
+    {
+        ChessData data;
+        if (!data.unpackLite(packed.board)) {
+            return false;
+        }
+        if ((packed.numbers[0] >> 60) != 0u || ((packed.numbers[1] >> 30) & 0x1FFFFFFFULL) != 0u) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+            const uint32_t layerCode = static_cast<uint32_t>(packed.numbers[i / 6u] >> (10u * (i % 6u))) & 0x3ffu;
+            const uint32_t player1Pos = layerCode & 0x1fu;
+            const uint32_t player2Pos = layerCode >> 5;
+            if (player1Pos > static_cast<uint32_t>(BOARD_SIZE) || player2Pos > static_cast<uint32_t>(BOARD_SIZE)) {
+                return false;
+            }
+            data.numberBoards[i] = (player1Pos == 0u ? 0u : (1u << (player1Pos - 1u)))
+                | (player2Pos == 0u ? 0u : (1u << (player2Pos - 1u)));
+        }
+
+        const uint32_t historySize = static_cast<uint32_t>(packed.numbers[1] >> 59);
+        if (historySize > MillHistory::CAPACITY) {
+            return false;
+        }
+        for (uint32_t i = 0; i < historySize; ++i) {
+            data.millHistory.push_back(packed.millKeys[i]);
+        }
+
+        *this = data;
+        return true;
+    }
 };
 
+// Position 按值复制依赖这一点：ChessData 里不能再出现需要深拷贝的成员。
+static_assert(std::is_trivially_copyable<ChessData>::value, "ChessData 必须可以按字节复制");
+
@@ -0,0 +1,272 @@
+/****************************************************************************
+** NineChess - 中局残局库
+****************************************************************************/
+
+#include "ninechess_endgame.h"
+#include "ninechess_mappedfile.h"
+
+#include <fstream>
+#include <vector>
+
+namespace {
+
+// 文件头：魔数、版本、规则、own 子数、other 子数、种类（0 结果 / 1 距离）、下标总数（64 位）。
+void writeHeader(std::ostream& out, uint32_t ruleIndex, uint32_t ownCount, uint32_t otherCount,
+    uint32_t kind, uint64_t count)
+{
+    writeU32(out, ENDGAME_FILE_MAGIC);
+    writeU32(out, ENDGAME_FILE_VERSION);
+    writeU32(out, ruleIndex);
+    writeU32(out, ownCount);
+    writeU32(out, otherCount);
+    writeU32(out, kind);
+    writeU32(out, static_cast<uint32_t>(count & 0xffffffffu));
+    writeU32(out, static_cast<uint32_t>(count >> 32));
+}
+
+bool checkHeader(const MappedFile& file, uint32_t ruleIndex, uint32_t ownCount, uint32_t otherCount,
+    uint32_t kind, uint64_t count, uint64_t payloadSize)
+{
+    if (file.size() != ENDGAME_HEADER_SIZE + payloadSize) {
+        return false;
+    }
+
+    const uint8_t* header = file.data();
+    const uint64_t storedCount = static_cast<uint64_t>(readU32(header + 24))
+        | (static_cast<uint64_t>(readU32(header + 28)) << 32);
+    return readU32(header) == ENDGAME_FILE_MAGIC
+        && readU32(header + 4) == ENDGAME_FILE_VERSION
+        && readU32(header + 8) == ruleIndex
+        && readU32(header + 12) == ownCount
+        && readU32(header + 16) == otherCount
+        && readU32(header + 20) == kind
+        && storedCount == count;
+}
+
+} // namespace
+
+NineChess_Endgame::NineChess_Endgame(uint32_t ruleIndex)
+{
+    const RuleTables& tables = Position::ruleTables(ruleIndex);
+    m_ruleIndex = tables.ruleIndex;
+    m_minPieces = tables.rule.minPiecesToSurvive;
+    m_allowFlying = tables.rule.allowFlying;
+}
+
+bool NineChess_Endgame::supportsRule(uint32_t ruleIndex)
+{
+    if (ruleIndex >= static_cast<uint32_t>(RULE_COUNT)) {
+        return false;
+    }
+
+    const Rule& rule = NineChess::rules[ruleIndex];
+    return rule.allowRepeatedMills
+        && !rule.hasDiagonalLines
+        && !rule.allowMultiCapture
+        && rule.blockedIsLoss
+        && rule.piecesPerSide <= ENDGAME_MAX_PIECES
+        && rule.minPiecesToSurvive == ENDGAME_MIN_PIECES;
+}
+
+uint64_t NineChess_Endgame::classSize(uint32_t ownCount, uint32_t otherCount)
+{
+    if (tableSlot(ownCount, otherCount) < 0) {
+        return 0u;
+    }
+    return NineChess::boardClassSize(ownCount, otherCount);
+}
+
+bool NineChess_Endgame::prepareOwn(uint32_t own, OwnKey& key)
+{
+    const uint32_t count = static_cast<uint32_t>(POPCOUNT32(own));
+    if (count < ENDGAME_MIN_PIECES || count > ENDGAME_MAX_PIECES) {
+        return false;
+    }
+
+    NineChess::prepareBoardRank(own, key);
+    return true;
+}
+
+uint64_t NineChess_Endgame::indexWith(const OwnKey& key, uint32_t other)
+{
+    return NineChess::rankBoards(key, other);
+}
+
+uint64_t NineChess_Endgame::indexOf(uint32_t own, uint32_t other)
+{
+    return NineChess::rankBoards(own, other);
+}
+
+bool NineChess_Endgame::positionAt(uint32_t ownCount, uint32_t otherCount, uint64_t index,
+    uint32_t& own, uint32_t& other)
+{
+    if (tableSlot(ownCount, otherCount) < 0) {
+        return false;
+    }
+
+    uint32_t unused = 0u;
+    return NineChess::unrankBoards(ownCount, otherCount, 0u, index, own, other, unused);
+}
+
+std::string NineChess_Endgame::fileName(uint32_t ruleIndex, uint32_t ownCount, uint32_t otherCount, bool distance)
+{
+    return "ninechess_rule" + std::to_string(ruleIndex) + "_" + std::to_string(ownCount) + "v"
+        + std::to_string(otherCount) + (distance ? ".dtw" : ".wdl");
+}
+
+int NineChess_Endgame::tableSlot(uint32_t ownCount, uint32_t otherCount)
+{
+    if (ownCount < ENDGAME_MIN_PIECES || ownCount > ENDGAME_MAX_PIECES
+        || otherCount < ENDGAME_MIN_PIECES || otherCount > ENDGAME_MAX_PIECES) {
+        return -1;
+    }
+    return static_cast<int>((ownCount - ENDGAME_MIN_PIECES) * CLASS_SPAN + (otherCount - ENDGAME_MIN_PIECES));
+}
+
+bool NineChess_Endgame::loadTable(const std::string& directory, uint32_t ownCount, uint32_t otherCount)
+{
+    const int slot = tableSlot(ownCount, otherCount);
+    if (slot < 0 || !supportsRule(m_ruleIndex)) {
+        return false;
+    }
+
+    const std::string prefix = directory.empty() ? std::string() : directory + "/";
+    std::unique_ptr<Table> table(new Table());
+    table->count = classSize(ownCount, otherCount);
+    if (!table->values.open(prefix + fileName(m_ruleIndex, ownCount, otherCount, false))
+        || !checkHeader(table->values, m_ruleIndex, ownCount, otherCount, 0u, table->count,
+            (table->count + 3u) / 4u)) {
+        return false;
+    }
+
+    // 距离文件是可选的；格式不符时只丢弃距离，结果照常使用。
+    if (table->distances.open(prefix + fileName(m_ruleIndex, ownCount, otherCount, true))
+        && !checkHeader(table->distances, m_ruleIndex, ownCount, otherCount, 1u, table->count, table->count)) {
+        table->distances.close();
+    }
+
+    m_tables[static_cast<size_t>(slot)] = std::move(table);
+    return true;
+}
+
+size_t NineChess_Endgame::loadDirectory(const std::string& directory)
+{
+    size_t loaded = 0;
+    for (uint32_t ownCount = ENDGAME_MIN_PIECES; ownCount <= ENDGAME_MAX_PIECES; ++ownCount) {
+        for (uint32_t otherCount = ENDGAME_MIN_PIECES; otherCount <= ENDGAME_MAX_PIECES; ++otherCount) {
+            if (loadTable(directory, ownCount, otherCount)) {
+                ++loaded;
+            }
+        }
+    }
+    return loaded;
+}
+
+bool NineChess_Endgame::hasTable(uint32_t ownCount, uint32_t otherCount) const
+{
+    const int slot = tableSlot(ownCount, otherCount);
+    return slot >= 0 && m_tables[static_cast<size_t>(slot)] != nullptr;
+}
+
+bool NineChess_Endgame::probe(uint32_t own, uint32_t other, EndgameValue& value, int& distance) const
+{
+    const int slot = tableSlot(static_cast<uint32_t>(POPCOUNT32(own)), static_cast<uint32_t>(POPCOUNT32(other)));
+    if (slot < 0 || m_tables[static_cast<size_t>(slot)] == nullptr) {
+        return false;
+    }
+
+    const Table& table = *m_tables[static_cast<size_t>(slot)];
+    const uint64_t index = indexOf(own, other);
+    const uint8_t packed = table.values.data()[ENDGAME_HEADER_SIZE + index / 4u];
+    value = static_cast<EndgameValue>((packed >> ((index % 4u) * 2u)) & 0x3u);
+    if (value == ENDGAME_UNUSED) {
+        return false;
+    }
+
+    distance = -1;
+    if (table.distances.data() != nullptr) {
+        const uint8_t stored = table.distances.data()[ENDGAME_HEADER_SIZE + index];
+        distance = stored == ENDGAME_DISTANCE_NONE ? -1 : static_cast<int>(stored);
+    }
+    return true;
+}
+
+bool NineChess_Endgame::probe(const Position& chess, EndgameValue& value, int& distance) const
+{
+    if (chess.getRuleIndex() != m_ruleIndex
+        || chess.getPhase() != GAME_MID
+        || chess.getAction() != ACTION_CHOOSE) {
+        return false;
+    }
+
+    const ChessData& data = chess.getData();
+    if ((data.forbiddenBoard & ChessData::VALID_BOARD_MASK) != 0u) {
+        return false;
+    }
+
+    const bool player1Turn = chess.getTurn() == PLAYER1;
+    const uint32_t own = (player1Turn ? data.player1Board : data.player2Board) & ChessData::VALID_BOARD_MASK;
+    const uint32_t other = (player1Turn ? data.player2Board : data.player1Board) & ChessData::VALID_BOARD_MASK;
+    return probe(own, other, value, distance);
+}
+
+bool NineChess_Endgame::saveTable(const std::string& directory, uint32_t ruleIndex,
+    uint32_t ownCount, uint32_t otherCount, bool withDistance,
+    const std::function<void(uint64_t, EndgameValue&, uint8_t&)>& entryAt)
+{
+    const uint64_t count = classSize(ownCount, otherCount);
+    if (count == 0u) {
+        return false;
+    }
+
+    const std::string prefix = directory.empty() ? std::string() : directory + "/";
+    std::ofstream values(prefix + fileName(ruleIndex, ownCount, otherCount, false), std::ios::binary | std::ios::trunc);
+    std::ofstream distances;
+    if (!values) {
+        return false;
+    }
+    if (withDistance) {
+        distances.open(prefix + fileName(ruleIndex, ownCount, otherCount, true), std::ios::binary | std::ios::trunc);
+        if (!distances) {
+            return false;
+        }
+        writeHeader(distances, ruleIndex, ownCount, otherCount, 1u, count);
+    }
+    writeHeader(values, ruleIndex, ownCount, otherCount, 0u, count);
+
+    // 按块缓冲写出，4 个局面拼成一个字节，低位在前。
+    std::vector<char> packed;
+    std::vector<char> bytes;
+    packed.reserve(1u << 16);
+    bytes.reserve(1u << 18);
+    uint8_t current = 0u;
+    for (uint64_t index = 0; index < count; ++index) {
+        EndgameValue value = ENDGAME_UNUSED;
+        uint8_t distance = ENDGAME_DISTANCE_NONE;
+        entryAt(index, value, distance);
+
+        current = static_cast<uint8_t>(current | ((value & 0x3u) << ((index % 4u) * 2u)));
+        if (index % 4u == 3u || index + 1u == count) {
+            packed.push_back(static_cast<char>(current));
+            current = 0u;
+        }
+        if (withDistance) {
+            bytes.push_back(static_cast<char>(distance));
+        }
+
+        if (packed.size() >= (1u << 16)) {
+            values.write(packed.data(), static_cast<std::streamsize>(packed.size()));
+            packed.clear();
+        }
+        if (bytes.size() >= (1u << 18)) {
+            distances.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            bytes.clear();
+        }
+    }
+
+    values.write(packed.data(), static_cast<std::streamsize>(packed.size()));
+    if (withDistance) {
+        distances.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    return static_cast<bool>(values) && (!withDistance || static_cast<bool>(distances));
+}
@@ -0,0 +1,211 @@
+/****************************************************************************
+** NineChess - 中局残局库
+**
+** 针对“成三棋”“莫里斯九子棋”两套不带编号、不带斜线的规则，
+** 按子力类别（轮到走棋一方子数 own × 对方子数 other，各 3~9）
+** 保存中局全部局面的胜 / 负 / 和结果，由 NineChessTools endgame 子命令离线逆推生成。
+**
+** 局面视角：
+**   残局库只记录“轮到走棋一方正待选子”的局面，棋盘拆成 own / other 两张位棋盘，
+**   结果也站在 own 一方的视角。走子并提子记作一步，两者之间的中间状态不入库。
+**
+** 下标：
+**   own 棋盘取 16 种等价变换下的最小值作为代表元，代表元按从小到大编号；
+**   other 棋盘在同一变换下映射后，压缩到 own 之外的 24 - own 个空点上，
+**   用组合数系统编号。下标 = 代表元序号 × C(24 - own, other) + other 编号。
+**   own 本身对称时，同一局面可能落在几个下标上，只有 other 也取最小的那个是规范下标。
+**   下标直接取自 NineChess::rankBoards（第三张棋盘为空），与完整局面编号共用一套表。
+**
+** 文件：
+**   ninechess_rule<R>_<own>v<other>.wdl : 32 字节文件头 + 每局面 2 bit 结果
+**   ninechess_rule<R>_<own>v<other>.dtw : 32 字节文件头 + 每局面 1 字节距胜负步数（可选）
+**   文件以只读映射方式打开，多个 AI 实例共享。
+****************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "ninechess.h"
+#include "ninechess_mappedfile.h"
+
+// 残局库文件头中的魔数 "NCEG" 与格式版本。
+constexpr uint32_t ENDGAME_FILE_MAGIC = 0x4745434eu;
+constexpr uint32_t ENDGAME_FILE_VERSION = 1u;
+
+// 文件头字节数。
+constexpr size_t ENDGAME_HEADER_SIZE = 32;
+
+// 残局库覆盖的单方子数范围。
+constexpr uint32_t ENDGAME_MIN_PIECES = 3;
+constexpr uint32_t ENDGAME_MAX_PIECES = 9;
+
+// 距离文件中表示“和棋或非规范下标”的取值。
+constexpr uint8_t ENDGAME_DISTANCE_NONE = 0xff;
+
+// 残局库中每个局面的 2 bit 结果，站在轮到走棋一方的视角。
+enum EndgameValue : uint8_t {
+    ENDGAME_DRAW = 0,
+    ENDGAME_WIN = 1,
+    ENDGAME_LOSS = 2,
+    ENDGAME_UNUSED = 3    // 非规范下标，不对应需要查询的局面
+};
+
+class NineChess_Endgame
+{
+public:
+    // own 棋盘归一化后的结果，同一 own 下查询多个 other 时可以复用。
+    using OwnKey = NineChess::BoardRankKey;
+
+    // 支持的规则都没有斜线，邻接表和三连线表直接取编译期拓扑表。
+    using Topology = RuleTopology<false>;
+
+    // 记下规则的飞子条件；规则不受支持时仍可构造，但 supportsRule() 为 false 的规则不会有表。
+    explicit NineChess_Endgame(uint32_t ruleIndex);
+
+    NineChess_Endgame(const NineChess_Endgame&) = delete;
+    NineChess_Endgame& operator=(const NineChess_Endgame&) = delete;
+
+    // 残局库只支持可重复成三、无斜线、一次只提一子、被闷判负的规则（0 与 3）。
+    static bool supportsRule(uint32_t ruleIndex);
+
+    uint32_t ruleIndex() const { return m_ruleIndex; }
+
+    // ==================== 局面下标 ====================
+    // 某个子力类别的下标总数（含非规范下标）。
+    static uint64_t classSize(uint32_t ownCount, uint32_t otherCount);
+
+    // 归一化 own 棋盘；子数不在 3~9 时返回 false。
+    static bool prepareOwn(uint32_t own, OwnKey& key);
+
+    // 在已归一化的 own 下，计算与 own 不重叠的 other 棋盘对应的规范下标。
+    static uint64_t indexWith(const OwnKey& key, uint32_t other);
+
+    // 计算局面的规范下标；调用方须保证两方子数都在 3~9。
+    static uint64_t indexOf(uint32_t own, uint32_t other);
+
+    // 由下标还原局面；下标越界或不是规范下标时返回 false。
+    static bool positionAt(uint32_t ownCount, uint32_t otherCount, uint64_t index,
+        uint32_t& own, uint32_t& other);
+
+    // ==================== 走法 ====================
+    // 子数为 count 的一方在中局能否飞子。
+    bool canFly(uint32_t count) const { return m_allowFlying && count <= m_minPieces; }
+
+    // 某一方棋盘上处于三连中的全部点位。
+    static uint32_t millBoard(uint32_t board) { return Topology::millBoard(board); }
+
+    // 枚举 own 方一步（走子，成三则连同提子）后的全部后继，返回是否至少有一步可走。
+    // 对每个后继调用 fn(nextOwn, nextOther, wins)：后继已换成对方视角；
+    // wins 为 true 表示提子后对方子数不足、本步直接获胜，此时两张棋盘无意义。
+    // fn 返回 false 时停止枚举。
+    template <typename Fn>
+    bool forEachSuccessor(uint32_t own, uint32_t other, Fn fn) const;
+
+    // ==================== 残局库文件 ====================
+    // 某个子力类别的文件名（不含目录）。
+    static std::string fileName(uint32_t ruleIndex, uint32_t ownCount, uint32_t otherCount, bool distance);
+
+    // 映射单个子力类别的结果文件，距离文件存在时一并映射。
+    bool loadTable(const std::string& directory, uint32_t ownCount, uint32_t otherCount);
+
+    // 映射目录下本规则的全部子力类别，返回成功载入的类别数。
+    size_t loadDirectory(const std::string& directory);
+
+    // 某个子力类别是否已载入。
+    bool hasTable(uint32_t ownCount, uint32_t otherCount) const;
+
+    // 按 own / other 查询。distance 为距终局的步数（走子并提子算一步），
+    // 和棋或没有距离文件时为 -1。类别未载入时返回 false。
+    bool probe(uint32_t own, uint32_t other, EndgameValue& value, int& distance) const;
+
+    // 按完整局面查询：只接受本规则、中局、待选子且两方子数都在 3~9 的局面。
+    bool probe(const Position& chess, EndgameValue& value, int& distance) const;
+
+    // 写出一个子力类别的结果文件；withDistance 为 true 时同时写出距离文件。
+    // entryAt(index, value, distance) 依次给出每个下标的结果与距离。
+    static bool saveTable(const std::string& directory, uint32_t ruleIndex,
+        uint32_t ownCount, uint32_t otherCount, bool withDistance,
+        const std::function<void(uint64_t, EndgameValue&, uint8_t&)>& entryAt);
+
+private:
+    struct Table {
+        // 2 bit 结果文件。
+        MappedFile values;
+
+        // 1 字节距离文件，可能未打开。
+        MappedFile distances;
+
+        // 下标总数。
+        uint64_t count = 0;
+    };
+
+    static constexpr uint32_t CLASS_SPAN = ENDGAME_MAX_PIECES - ENDGAME_MIN_PIECES + 1;
+
+    // 子力类别在 m_tables 中的槽位；越界时返回 -1。
+    static int tableSlot(uint32_t ownCount, uint32_t otherCount);
+
+private:
+    uint32_t m_ruleIndex = 0;
+    uint32_t m_minPieces = MILL;
+    bool m_allowFlying = false;
+
+    std::array<std::unique_ptr<Table>, CLASS_SPAN * CLASS_SPAN> m_tables;
+};
+
+template <typename Fn>
+bool NineChess_Endgame::forEachSuccessor(uint32_t own, uint32_t other, Fn fn) const
+{
+    const uint32_t empty = ~(own | other) & ChessData::VALID_BOARD_MASK;
+    const bool fly = canFly(static_cast<uint32_t>(POPCOUNT32(own)));
+    const bool captureWins = static_cast<uint32_t>(POPCOUNT32(other)) - 1u < m_minPieces;
+
+    // 对方不在三连中的棋子优先可提；全部在三连中时任意一颗都可以提。
+    uint32_t capturable = other & ~millBoard(other);
+    if (capturable == 0u) {
+        capturable = other;
+    }
+
+    bool anyMove = false;
+    uint32_t pieces = own;
+    while (pieces != 0u) {
+        const int32_t fromPos = CTZ32(pieces);
+        pieces &= pieces - 1u;
+
+        uint32_t targets = fly ? empty : (Topology::moveMask(fromPos) & empty);
+        while (targets != 0u) {
+            const int32_t toPos = CTZ32(targets);
+            targets &= targets - 1u;
+            anyMove = true;
+
+            const uint32_t next = (own & ~(1u << fromPos)) | (1u << toPos);
+            if (!Topology::formsMill(next, toPos)) {
+                if (!fn(other, next, false)) {
+                    return true;
+                }
+                continue;
+            }
+
+            if (captureWins) {
+                if (!fn(0u, next, true)) {
+                    return true;
+                }
+                continue;
+            }
+
+            uint32_t victims = capturable;
+            while (victims != 0u) {
+                const int32_t victim = CTZ32(victims);
+                victims &= victims - 1u;
+                if (!fn(other & ~(1u << victim), next, false)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return anyMove;
+}
@@ -0,0 +1,129 @@
+/****************************************************************************
+** NineChess - 只读文件映射
+****************************************************************************/
+
+#include "ninechess_mappedfile.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return readWhole(path);
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    m_mapped = true;
+    return true;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info = {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    // 映射建立后即可关闭描述符，页面由映射本身保持。
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return readWhole(path);
+    }
+
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+    m_mapped = true;
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+    if (m_mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle(static_cast<HANDLE>(m_mapping));
+        CloseHandle(static_cast<HANDLE>(m_file));
+        m_mapping = nullptr;
+        m_file = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+}
+
+bool MappedFile::readWhole(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+
+    const std::streamoff size = in.tellg();
+    if (size <= 0) {
+        return false;
+    }
+
+    m_buffer.resize(static_cast<size_t>(size));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(m_buffer.data()), size)) {
+        m_buffer.clear();
+        return false;
+    }
+
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    m_mapped = false;
+    return true;
+}
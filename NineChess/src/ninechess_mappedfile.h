@@ -0,0 +1,88 @@
+/****************************************************************************
+** NineChess - 只读文件映射
+** 残局库等大文件按需映射进内存，多个 AI 实例共享同一份页面；
+** 平台不支持映射或映射失败时退回整文件读入。
+** 映射文件统一按小端存储，读写辅助函数也放在这里。
+****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 打开并映射整个文件；已打开的文件会先关闭。文件不存在或为空时返回 false。
+    bool open(const std::string& path);
+
+    // 解除映射并释放读入缓冲。
+    void close();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    // 是否通过内存映射访问；false 表示使用的是读入缓冲。
+    bool isMapped() const { return m_mapped; }
+
+private:
+    // 映射失败时的整文件读入。
+    bool readWhole(const std::string& path);
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::vector<uint8_t> m_buffer;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+// 按小端写入定长整数。
+inline void writeU16(std::ostream& out, uint16_t value)
+{
+    const char bytes[2] = {
+        static_cast<char>(value & 0xffu),
+        static_cast<char>((value >> 8) & 0xffu)
+    };
+    out.write(bytes, sizeof(bytes));
+}
+
+inline void writeU32(std::ostream& out, uint32_t value)
+{
+    writeU16(out, static_cast<uint16_t>(value & 0xffffu));
+    writeU16(out, static_cast<uint16_t>(value >> 16));
+}
+
+inline void writeU64(std::ostream& out, uint64_t value)
+{
+    writeU32(out, static_cast<uint32_t>(value & 0xffffffffu));
+    writeU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+// 从映射内存按小端读取定长整数，调用方保证长度足够。
+inline uint16_t readU16(const uint8_t* bytes)
+{
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+inline uint32_t readU32(const uint8_t* bytes)
+{
+    return static_cast<uint32_t>(readU16(bytes)) | (static_cast<uint32_t>(readU16(bytes + 2)) << 16);
+}
+
+inline uint64_t readU64(const uint8_t* bytes)
+{
+    return static_cast<uint64_t>(readU32(bytes)) | (static_cast<uint64_t>(readU32(bytes + 4)) << 32);
+}
@@ -0,0 +1,980 @@
+/****************************************************************************
+** NineChess - 局面与规则走子
+****************************************************************************/
+
+#include "ninechess_position.h"
+
+static_assert(std::is_trivially_copyable<Position>::value, "Position 必须可以按字节复制");
+static_assert(sizeof(Position) <= 128, "Position 应保持在两条缓存行以内");
+
+const Rule Position::rules[RULE_COUNT] = {
+{
+    "成三棋",
+    "1. 双方各9颗子，开局依次摆子；\n"
+    "2. 凡出现三子相连，就提掉对手一子；\n"
+    "3. 不能提对手的“三连”子，除非无子可提；\n"
+    "4. 同时出现两个“三连”只能提一子；\n"
+    "5. 摆完后依次走子，每次只能往相邻位置走一步；\n"
+    "6. 把对手棋子提到少于3颗时胜利；\n"
+    "7. 走棋阶段不能行动（被“闷”）算负。",
+    9, 3, false, false, false, true, false, true, true, false
+},
+{
+    "打三棋(12连棋)",
+    "1. 双方各12颗子，棋盘有斜线；\n"
+    "2. 摆棋阶段被提子的位置不能再摆子，直到走棋阶段；\n"
+    "3. 摆棋阶段，摆满棋盘算先手负；\n"
+    "4. 走棋阶段，后摆棋的一方先走；\n"
+    "5. 一步出现几个“三连”就可以提几个子；\n"
+    "6. 其它规则与成三棋基本相同。",
+    12, 3, true, true, true, true, true, true, true, false
+},
+{
+    "九连棋",
+    "1. 规则与成三棋基本相同，只是它的棋子有序号，\n"
+    "2. 相同序号、位置的“三连”不能重复提子；\n"
+    "3. 走棋阶段不能行动（被“闷”），则由对手继续走棋；\n"
+    "4. 一步出现几个“三连”就可以提几个子。",
+    9, 3, false, false, false, false, true, true, false, false
+},
+{
+    "莫里斯九子棋",
+    "规则与成三棋基本相同，只是在走子阶段，当一方仅剩3子时，他可以飞子到任意空位。",
+    9, 3, false, false, false, true, false, true, true, true
+}
+};
+
+namespace {
+
+// 规则 N 的辅助表：规则对象取自 Position::rules[N]，棋盘表取自同拓扑的 constexpr 数组。
+template<uint32_t N>
+constexpr RuleTables makeRuleTables()
+{
+    return RuleTables{
+        N,
+        Position::rules[N],
+        ChessData::VALID_BOARD_MASK,
+        BoardTopologyTable<RuleTraits<N>::hasDiagonalLines>::value.moveMask,
+        BoardTopologyTable<RuleTraits<N>::hasDiagonalLines>::value.lineCount,
+        BoardTopologyTable<RuleTraits<N>::hasDiagonalLines>::value.lineMasks,
+        BoardTopologyTable<RuleTraits<N>::hasDiagonalLines>::value.linePos,
+        BoardTopologyTable<RuleTraits<N>::hasDiagonalLines>::value.posLineCount,
+        BoardTopologyTable<RuleTraits<N>::hasDiagonalLines>::value.posLineIds
+    };
+}
+
+// 4 套规则的辅助表在编译期完成初始化，程序里只有这一份。
+constexpr RuleTables ruleTableSet[RULE_COUNT] = {
+    makeRuleTables<0>(),
+    makeRuleTables<1>(),
+    makeRuleTables<2>(),
+    makeRuleTables<3>()
+};
+
+} // namespace
+
+Position::Position()
+{
+    setRule(2);
+}
+
+const RuleTables& Position::ruleTables(uint32_t ruleIndex)
+{
+    return ruleTableSet[ruleIndex < RULE_COUNT ? ruleIndex : 0u];
+}
+
+void Position::setRule(uint32_t ruleIndex)
+{
+    m_tables = &ruleTables(ruleIndex);
+    reset();
+}
+
+void Position::reset()
+{
+    m_data = ChessData();
+    m_data.setState(GAME_NOTSTARTED, ACTION_NONE, NOBODY);
+    m_data.setPlayer2InHand(m_tables->rule.piecesPerSide);
+    m_winner = NOBODY;
+    m_selectedPos = -1;
+    m_overReason = GAME_OVER_NONE;
+}
+
+void Position::start()
+{
+    if (m_data.getPhase() == GAME_OVER) {
+        reset();
+    }
+    if (m_data.getPhase() == GAME_NOTSTARTED) {
+        enterOpening();
+    }
+}
+
+bool Position::isValidCP(int32_t c, int32_t p)
+{
+    return c >= 0 && c < RING && p >= 0 && p < SEAT;
+}
+
+bool Position::isValidPos(int32_t pos)
+{
+    return pos >= 0 && pos < BOARD_SIZE;
+}
+
+int32_t Position::cpToPos(int32_t c, int32_t p)
+{
+    return isValidCP(c, p) ? (c * SEAT + p) : -1;
+}
+
+void Position::posToCP(int32_t pos, int32_t& c, int32_t& p)
+{
+    if (!isValidPos(pos)) {
+        c = -1;
+        p = -1;
+        return;
+    }
+    c = pos / SEAT;
+    p = pos % SEAT;
+}
+
+Players Position::getWhosPiece(int32_t c, int32_t p) const
+{
+    return getWhosPiecePos(cpToPos(c, p));
+}
+
+Players Position::getWhosPiecePos(int32_t pos) const
+{
+    if (!isValidPos(pos)) {
+        return NOBODY;
+    }
+
+    const uint32_t bit = bitOf(pos);
+    if ((m_data.player1Board & bit) != 0u) {
+        return PLAYER1;
+    }
+    if ((m_data.player2Board & bit) != 0u) {
+        return PLAYER2;
+    }
+    if ((m_data.forbiddenBoard & bit) != 0u) {
+        // DRAW表示禁止点
+        return DRAW;
+    }
+    return NOBODY;
+}
+
+bool Position::getPieceCP(Players player, uint32_t number, int32_t& c, int32_t& p) const
+{
+    if (m_tables->rule.allowRepeatedMills || number >= NUMBERED_PIECE_COUNT) {
+        return false;
+    }
+
+    const uint32_t layer = m_data.numberBoards[number] & boardOf(player);
+    if (layer == 0u) {
+        return false;
+    }
+
+    posToCP(CTZ32(layer), c, p);
+    return true;
+}
+
+bool Position::getCurrentPiece(Players& player, uint32_t& number) const
+{
+    if (m_tables->rule.allowRepeatedMills || !isValidPos(m_selectedPos)) {
+        return false;
+    }
+
+    player = getWhosPiecePos(m_selectedPos);
+    if (player == NOBODY) {
+        return false;
+    }
+
+    const int32_t pieceNumber = getPieceNumberAtPos(m_selectedPos);
+    if (pieceNumber < 0) {
+        return false;
+    }
+
+    number = static_cast<uint32_t>(pieceNumber);
+    return true;
+}
+
+bool Position::canChoosePos(int32_t pos) const
+{
+    return isValidPos(pos) && (legalSources() & bitOf(pos)) != 0u;
+}
+
+bool Position::canPlacePos(int32_t pos) const
+{
+    return isValidPos(pos) && (legalTargets() & bitOf(pos)) != 0u;
+}
+
+bool Position::canCapturePos(int32_t pos) const
+{
+    return isValidPos(pos) && (legalCaptures() & bitOf(pos)) != 0u;
+}
+
+uint32_t Position::millBoard(Players player) const
+{
+    return dispatchRule(getRuleIndex(), [&](auto rule) {
+        return millBoard<decltype(rule)::value>(player);
+    });
+}
+
+uint32_t Position::legalSources() const
+{
+    return dispatchRule(getRuleIndex(), [&](auto rule) {
+        return legalSources<decltype(rule)::value>();
+    });
+}
+
+uint32_t Position::legalTargets(int32_t fromPos) const
+{
+    return dispatchRule(getRuleIndex(), [&](auto rule) {
+        return legalTargets<decltype(rule)::value>(fromPos);
+    });
+}
+
+uint32_t Position::legalCaptures() const
+{
+    return dispatchRule(getRuleIndex(), [&](auto rule) {
+        return legalCaptures<decltype(rule)::value>();
+    });
+}
+
+void Position::generateLegal(MoveBuffer& buffer) const
+{
+    dispatchRule(getRuleIndex(), [&](auto rule) {
+        generateLegal<decltype(rule)::value>(buffer);
+    });
+}
+
+template<uint32_t N>
+void Position::generateLegal(MoveBuffer& buffer) const
+{
+    buffer.clear();
+    if (m_data.getAction() == ACTION_CAPTURE) {
+        for (uint32_t targets = legalCaptures<N>(); targets != 0u; targets &= targets - 1u) {
+            buffer.push(makeMoveRecord(MOVE_RECORD_CAPTURE, 0, CTZ32(targets)));
+        }
+        return;
+    }
+    if (m_data.getPhase() != GAME_MID) {
+        for (uint32_t targets = legalTargets<N>(); targets != 0u; targets &= targets - 1u) {
+            buffer.push(makeMoveRecord(MOVE_RECORD_POINT, 0, CTZ32(targets)));
+        }
+        return;
+    }
+
+    uint32_t sources = legalSources<N>();
+    if (m_data.getAction() == ACTION_PLACE && isValidPos(m_selectedPos)) {
+        sources &= bitOf(m_selectedPos);
+    }
+    for (; sources != 0u; sources &= sources - 1u) {
+        const int32_t fromPos = CTZ32(sources);
+        for (uint32_t targets = legalTargets<N>(fromPos); targets != 0u; targets &= targets - 1u) {
+            buffer.push(makeMoveRecord(MOVE_RECORD_MOVE, fromPos, CTZ32(targets)));
+        }
+    }
+}
+
+bool Position::choosePos(int32_t pos)
+{
+    if (!canChoosePos(pos)) {
+        return false;
+    }
+
+    chooseFast(pos);
+    return true;
+}
+
+bool Position::placePos(int32_t pos)
+{
+    if (!canPlacePos(pos)) {
+        return false;
+    }
+
+    placeFast(pos);
+    return true;
+}
+
+bool Position::capturePos(int32_t pos)
+{
+    if (!canCapturePos(pos)) {
+        return false;
+    }
+
+    captureFast(pos);
+    return true;
+}
+
+void Position::chooseFast(int32_t pos)
+{
+    m_selectedPos = pos;
+    m_data.setAction(ACTION_PLACE);
+}
+
+void Position::placeFast(int32_t pos)
+{
+    dispatchRule(getRuleIndex(), [&](auto rule) {
+        placeFast<decltype(rule)::value>(pos);
+    });
+}
+
+void Position::captureFast(int32_t pos)
+{
+    dispatchRule(getRuleIndex(), [&](auto rule) {
+        captureFast<decltype(rule)::value>(pos);
+    });
+}
+
+void Position::saveFast(FastSnapshot& snapshot) const
+{
+    snapshot.data = m_data;
+    snapshot.winner = m_winner;
+    snapshot.selectedPos = m_selectedPos;
+    snapshot.overReason = m_overReason;
+}
+
+void Position::restoreFast(const FastSnapshot& snapshot)
+{
+    m_data = snapshot.data;
+    m_winner = snapshot.winner;
+    m_selectedPos = snapshot.selectedPos;
+    m_overReason = snapshot.overReason;
+}
+
+uint64_t Position::getHash() const
+{
+    return dispatchRule(getRuleIndex(), [&](auto rule) {
+        return getHash<decltype(rule)::value>();
+    });
+}
+
+int32_t Position::symmetryPos(int32_t pos, uint32_t symmetry)
+{
+    if ((symmetry & 8u) != 0u) {
+        pos = transformPos(pos, TRANSFORM_MIRROR);
+    }
+    if ((symmetry & 4u) != 0u) {
+        pos = transformPos(pos, TRANSFORM_TURN);
+    }
+    switch (symmetry & 3u)
+    {
+    case 1u:
+        return transformPos(pos, TRANSFORM_ROTATE_LEFT);
+    case 2u:
+        return transformPos(pos, TRANSFORM_ROTATE_180);
+    case 3u:
+        return transformPos(pos, TRANSFORM_ROTATE_RIGHT);
+    default:
+        return pos;
+    }
+}
+
+int32_t Position::inverseSymmetryPos(int32_t pos, uint32_t symmetry)
+{
+    for (int32_t source = 0; source < BOARD_SIZE; ++source) {
+        if (symmetryPos(source, symmetry) == pos) {
+            return source;
+        }
+    }
+    return -1;
+}
+
+void Position::applySymmetry(uint32_t symmetry)
+{
+    if ((symmetry & 8u) != 0u) {
+        transformState(TRANSFORM_MIRROR);
+    }
+    if ((symmetry & 4u) != 0u) {
+        transformState(TRANSFORM_TURN);
+    }
+    switch (symmetry & 3u)
+    {
+    case 1u:
+        transformState(TRANSFORM_ROTATE_LEFT);
+        break;
+    case 2u:
+        transformState(TRANSFORM_ROTATE_180);
+        break;
+    case 3u:
+        transformState(TRANSFORM_ROTATE_RIGHT);
+        break;
+    default:
+        break;
+    }
+}
+
+uint64_t Position::getCanonicalHash(uint32_t* symmetry) const
+{
+    uint64_t bestHash = getHash();
+    uint32_t bestSymmetry = 0u;
+    for (uint32_t s = 1; s < SYMMETRY_COUNT; ++s) {
+        Position variant(*this);
+        variant.applySymmetry(s);
+        const uint64_t hash = variant.getHash();
+        if (hash < bestHash) {
+            bestHash = hash;
+            bestSymmetry = s;
+        }
+    }
+
+    if (symmetry != nullptr) {
+        *symmetry = bestSymmetry;
+    }
+    return bestHash;
+}
+
+Players Position::opponentOf(Players player)
+{
+    if (player == PLAYER1) {
+        return PLAYER2;
+    }
+    if (player == PLAYER2) {
+        return PLAYER1;
+    }
+    return NOBODY;
+}
+
+uint32_t Position::boardOf(Players player) const
+{
+    if (player == PLAYER1) {
+        return m_data.player1Board;
+    }
+    if (player == PLAYER2) {
+        return m_data.player2Board;
+    }
+    return 0u;
+}
+
+uint32_t& Position::boardRef(Players player)
+{
+    return player == PLAYER1 ? m_data.player1Board : m_data.player2Board;
+}
+
+bool Position::isOccupiedPos(int32_t pos) const
+{
+    return isValidPos(pos) && (((m_data.player1Board | m_data.player2Board) & bitOf(pos)) != 0u);
+}
+
+bool Position::isForbiddenPos(int32_t pos) const
+{
+    return isValidPos(pos) && ((m_data.forbiddenBoard & bitOf(pos)) != 0u);
+}
+
+bool Position::isEmptyPos(int32_t pos) const
+{
+    return isValidPos(pos) && !isOccupiedPos(pos) && !isForbiddenPos(pos);
+}
+
+bool Position::canFly(Players player) const
+{
+    return dispatchRule(getRuleIndex(), [&](auto rule) {
+        return canFly<decltype(rule)::value>(player);
+    });
+}
+
+bool Position::isAdjacent(int32_t fromPos, int32_t toPos) const
+{
+    return isValidPos(fromPos)
+        && isValidPos(toPos)
+        && ((m_tables->moveMask[fromPos] & bitOf(toPos)) != 0u);
+}
+
+bool Position::isOwnPieceAt(Players player, int32_t pos) const
+{
+    return isValidPos(pos) && ((boardOf(player) & bitOf(pos)) != 0u);
+}
+
+bool Position::isOpponentPieceAt(Players player, int32_t pos) const
+{
+    return isOwnPieceAt(opponentOf(player), pos);
+}
+
+template<uint32_t N>
+void Position::placeFast(int32_t pos)
+{
+    if (m_data.getPhase() == GAME_NOTSTARTED) {
+        enterOpening();
+    }
+
+    if (m_data.getPhase() == GAME_OPENING) {
+        applyOpeningPlacement<N>(pos);
+    }
+    else {
+        applyMidMove<N>(pos);
+    }
+
+    (void)tryFinishAfterPlaceOrMove<N>(pos);
+}
+
+template<uint32_t N>
+void Position::captureFast(int32_t pos)
+{
+    applyCapture<N>(pos);
+    (void)tryFinishAfterCapture<N>();
+}
+
+template<uint32_t N>
+void Position::applyOpeningPlacement(int32_t pos)
+{
+    const Players turn = m_data.getTurn();
+    boardRef(turn) |= bitOf(pos);
+    if (!RuleTraits<N>::allowRepeatedMills) {
+        placeNumberedPiece<N>(pos);
+    }
+    if (turn == PLAYER2) {
+        m_data.decPlayer2InHand();
+    }
+    m_selectedPos = pos;
+}
+
+template<uint32_t N>
+void Position::applyMidMove(int32_t toPos)
+{
+    const Players turn = m_data.getTurn();
+    const uint32_t fromBit = bitOf(m_selectedPos);
+    const uint32_t toBit = bitOf(toPos);
+    uint32_t& board = boardRef(turn);
+
+    board &= ~fromBit;
+    board |= toBit;
+    if (!RuleTraits<N>::allowRepeatedMills) {
+        moveNumberedPiece(m_selectedPos, toPos);
+    }
+    m_selectedPos = toPos;
+}
+
+template<uint32_t N>
+void Position::applyCapture(int32_t pos)
+{
+    const Players victim = opponentOf(m_data.getTurn());
+    const uint32_t bit = bitOf(pos);
+
+    boardRef(victim) &= ~bit;
+    if (RuleTraits<N>::hasForbiddenPoints && m_data.getPhase() == GAME_OPENING) {
+        m_data.forbiddenBoard |= bit;
+    }
+    else {
+        m_data.forbiddenBoard &= ~bit;
+    }
+
+    if (!RuleTraits<N>::allowRepeatedMills) {
+        removeNumberedPiece(pos);
+    }
+
+    m_data.setPendingCaptures(m_data.getPendingCaptures() - 1u);
+    m_selectedPos = -1;
+}
+
+template<uint32_t N>
+bool Position::tryFinishAfterPlaceOrMove(int32_t pos)
+{
+    const uint32_t newMills = addNewMills<N>(pos);
+    if (newMills > 0u) {
+        // 开局最后一手如果同时出现“摆满棋盘”和“三连”，按当前约定应先执行提子。
+        // 因此开局阶段的“满盘判负/判和”必须放到新三连判断之后，
+        // 否则会把本应进入 ACTION_CAPTURE 的局面提前终结。
+        m_data.setPendingCaptures(RuleTraits<N>::allowMultiCapture ? newMills : 1u);
+        m_data.setAction(ACTION_CAPTURE);
+        return false;
+    }
+
+    if (m_data.getPhase() == GAME_OPENING) {
+        // 开局普通落子完成后，要先把 turn/action 切到“命令结束后的稳定状态”。
+        // 否则当后手刚落完一子、但尚未 toggleTurn 时，
+        // getPlayer1InHand() 会把这个瞬时 ACTION_PLACE|PLAYER2 误判成
+        // “先手刚好多摆了一手”的常态，从而把先手手牌少算 1。
+        toggleTurn();
+        m_data.setAction(ACTION_PLACE);
+
+        if (trySetWinnerFromMaterialOrBoard<N>()) {
+            return true;
+        }
+
+        if (m_data.getPlayer1InHand() == 0u && m_data.getPlayer2InHand() == 0u) {
+            enterMidgame<N>();
+            if (trySetWinnerFromMaterialOrBoard<N>()) {
+                return true;
+            }
+            return tryHandleBlockedTurn<N>();
+        }
+        return false;
+    }
+
+    m_selectedPos = -1;
+    toggleTurn();
+    m_data.setAction(ACTION_CHOOSE);
+    if (trySetWinnerFromMaterialOrBoard<N>()) {
+        return true;
+    }
+    return tryHandleBlockedTurn<N>();
+}
+
+template<uint32_t N>
+bool Position::tryFinishAfterCapture()
+{
+    if (trySetWinnerFromMaterialOrBoard<N>()) {
+        return true;
+    }
+
+    if (m_data.getPendingCaptures() > 0u) {
+        return false;
+    }
+
+    if (m_data.getPhase() == GAME_OPENING) {
+        if (m_data.getPlayer1InHand() == 0u && m_data.getPlayer2InHand() == 0u) {
+            enterMidgame<N>();
+            if (trySetWinnerFromMaterialOrBoard<N>()) {
+                return true;
+            }
+            return tryHandleBlockedTurn<N>();
+        }
+
+        toggleTurn();
+        m_data.setAction(ACTION_PLACE);
+        return false;
+    }
+
+    toggleTurn();
+    m_data.setAction(ACTION_CHOOSE);
+    if (trySetWinnerFromMaterialOrBoard<N>()) {
+        return true;
+    }
+    return tryHandleBlockedTurn<N>();
+}
+
+template<uint32_t N>
+bool Position::trySetWinnerFromMaterialOrBoard()
+{
+    if (m_data.getPhase() == GAME_OVER) {
+        return true;
+    }
+
+    const uint32_t total1 = m_data.getPlayer1OnBoardCount() + m_data.getPlayer1InHand();
+    const uint32_t total2 = m_data.getPlayer2OnBoardCount() + m_data.getPlayer2InHand();
+    if (total1 < RuleTraits<N>::minPiecesToSurvive) {
+        setGameOver(PLAYER2, GAME_OVER_MATERIAL);
+        return true;
+    }
+    if (total2 < RuleTraits<N>::minPiecesToSurvive) {
+        setGameOver(PLAYER1, GAME_OVER_MATERIAL);
+        return true;
+    }
+
+    if (m_data.getPhase() == GAME_OPENING) {
+        const uint32_t onBoardTotal = m_data.getPlayer1OnBoardCount() + m_data.getPlayer2OnBoardCount();
+        if (onBoardTotal >= BOARD_SIZE) {
+            if (RuleTraits<N>::fullBoardIsLoss) {
+                setGameOver(PLAYER2, GAME_OVER_FULL_BOARD);
+            }
+            else {
+                setGameOver(DRAW, GAME_OVER_FULL_BOARD);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template<uint32_t N>
+bool Position::tryHandleBlockedTurn()
+{
+    if (m_data.getPhase() != GAME_MID || m_data.getAction() != ACTION_CHOOSE) {
+        return false;
+    }
+
+    if (hasAnyLegalMove<N>(m_data.getTurn())) {
+        return false;
+    }
+
+    if (RuleTraits<N>::blockedIsLoss) {
+        const Players loser = m_data.getTurn();
+        setGameOver(opponentOf(loser), GAME_OVER_BLOCKED);
+        return true;
+    }
+
+    toggleTurn();
+    if (!hasAnyLegalMove<N>(m_data.getTurn())) {
+        setGameOver(DRAW, GAME_OVER_ALL_BLOCKED);
+        return true;
+    }
+    return false;
+}
+
+template<uint32_t N>
+uint32_t Position::addNewMills(int32_t pos)
+{
+    const Players player = getWhosPiecePos(pos);
+    if (player != PLAYER1 && player != PLAYER2) {
+        return 0u;
+    }
+
+    const uint32_t board = boardOf(player);
+    uint32_t count = 0u;
+    for (uint32_t i = 0; i < RuleTraits<N>::posLineCount(pos); ++i) {
+        const uint32_t lineId = static_cast<uint32_t>(RuleTraits<N>::posLineId(pos, i));
+        const uint32_t mask = RuleTraits<N>::lineMask(lineId);
+        if ((board & mask) != mask) {
+            continue;
+        }
+
+        if (RuleTraits<N>::allowRepeatedMills) {
+            ++count;
+            continue;
+        }
+
+        const MillKey key = makeMillKeyForLine<N>(player, lineId);
+        if (!hasMillKey(key)) {
+            m_data.millHistory.push_back(key);
+            ++count;
+        }
+    }
+    return count;
+}
+
+template<uint32_t N>
+void Position::placeNumberedPiece(int32_t pos)
+{
+    const Players turn = m_data.getTurn();
+    const uint32_t number = turn == PLAYER1
+        ? (RuleTraits<N>::piecesPerSide - m_data.getPlayer1InHand())
+        : (RuleTraits<N>::piecesPerSide - m_data.getPlayer2InHand());
+    if (number < NUMBERED_PIECE_COUNT) {
+        m_data.numberBoards[number] |= bitOf(pos);
+    }
+}
+
+template<uint32_t N>
+MillKey Position::makeMillKeyForLine(Players player, uint32_t lineId) const
+{
+    const int32_t piece0 = getPieceNumberAtPos(RuleTraits<N>::linePos(lineId, 0));
+    const int32_t piece1 = getPieceNumberAtPos(RuleTraits<N>::linePos(lineId, 1));
+    const int32_t piece2 = getPieceNumberAtPos(RuleTraits<N>::linePos(lineId, 2));
+
+    return makeMillKey(player == PLAYER2, lineId,
+        piece0 >= 0 ? static_cast<uint32_t>(piece0) : 0u,
+        piece1 >= 0 ? static_cast<uint32_t>(piece1) : 0u,
+        piece2 >= 0 ? static_cast<uint32_t>(piece2) : 0u);
+}
+
+template<uint32_t N>
+void Position::enterMidgame()
+{
+    m_selectedPos = -1;
+    m_data.setPhase(GAME_MID);
+    m_data.setAction(ACTION_CHOOSE);
+    m_data.clearPendingCaptures();
+    m_data.forbiddenBoard = 0u;
+    m_data.setTurn(RuleTraits<N>::defenderMovesFirst ? PLAYER2 : PLAYER1);
+}
+
+// AI 搜索等别的编译单元按规则调用这些版本。
+template void Position::placeFast<0>(int32_t pos);
+template void Position::placeFast<1>(int32_t pos);
+template void Position::placeFast<2>(int32_t pos);
+template void Position::placeFast<3>(int32_t pos);
+template void Position::captureFast<0>(int32_t pos);
+template void Position::captureFast<1>(int32_t pos);
+template void Position::captureFast<2>(int32_t pos);
+template void Position::captureFast<3>(int32_t pos);
+template void Position::generateLegal<0>(MoveBuffer& buffer) const;
+template void Position::generateLegal<1>(MoveBuffer& buffer) const;
+template void Position::generateLegal<2>(MoveBuffer& buffer) const;
+template void Position::generateLegal<3>(MoveBuffer& buffer) const;
+
+uint32_t Position::countMillsAt(int32_t pos) const
+{
+    return dispatchRule(getRuleIndex(), [&](auto rule) {
+        return countMillsAt<decltype(rule)::value>(pos);
+    });
+}
+
+bool Position::isPieceInMill(int32_t pos) const
+{
+    return countMillsAt(pos) > 0u;
+}
+
+bool Position::isAllInMills(Players player) const
+{
+    return ((boardOf(player) & m_tables->validBoardMask) & ~millBoard(player)) == 0u;
+}
+
+int32_t Position::getPieceNumberAtPos(int32_t pos) const
+{
+    if (!isValidPos(pos)) {
+        return -1;
+    }
+
+    const uint32_t bit = bitOf(pos);
+    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+        if ((m_data.numberBoards[i] & bit) != 0u) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Position::moveNumberedPiece(int32_t fromPos, int32_t toPos)
+{
+    const uint32_t fromBit = bitOf(fromPos);
+    const uint32_t toBit = bitOf(toPos);
+    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+        if ((m_data.numberBoards[i] & fromBit) != 0u) {
+            m_data.numberBoards[i] &= ~fromBit;
+            m_data.numberBoards[i] |= toBit;
+            return;
+        }
+    }
+}
+
+void Position::removeNumberedPiece(int32_t pos)
+{
+    const uint32_t bit = bitOf(pos);
+    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+        if ((m_data.numberBoards[i] & bit) != 0u) {
+            m_data.numberBoards[i] &= ~bit;
+            return;
+        }
+    }
+}
+
+bool Position::hasMillKey(MillKey key) const
+{
+    for (const MillKey historyKey : m_data.millHistory) {
+        if (historyKey == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Players Position::toggleTurn()
+{
+    if (m_data.getTurn() == PLAYER1) {
+        m_data.setTurn(PLAYER2);
+        return PLAYER2;
+    }
+    if (m_data.getTurn() == PLAYER2) {
+        m_data.setTurn(PLAYER1);
+        return PLAYER1;
+    }
+    return NOBODY;
+}
+
+void Position::enterOpening()
+{
+    m_winner = NOBODY;
+    m_overReason = GAME_OVER_NONE;
+    m_selectedPos = -1;
+    m_data.setState(GAME_OPENING, ACTION_PLACE, PLAYER1);
+    m_data.clearPendingCaptures();
+}
+
+void Position::setGameOver(Players winner, GameOverReason reason)
+{
+    m_winner = winner;
+    m_selectedPos = -1;
+    m_data.setState(GAME_OVER, ACTION_NONE,
+        winner == PLAYER1 ? PLAYER1 : (winner == PLAYER2 ? PLAYER2 : NOBODY));
+    m_data.clearPendingCaptures();
+    m_overReason = reason;
+}
+
+int32_t Position::transformPos(int32_t pos, TransformMode mode)
+{
+    const int32_t ring = pos / SEAT;
+    const int32_t seat = pos % SEAT;
+
+    switch (mode)
+    {
+    case TRANSFORM_MIRROR:
+        return ring * SEAT + ((SEAT - seat) & 7);
+    case TRANSFORM_TURN:
+        return (RING - 1 - ring) * SEAT + seat;
+    case TRANSFORM_FLIP_VERTICAL:
+        // 上下翻转可视为 seat -> (4 - seat) mod 8。
+        // 它与“左右镜像 + 180 度旋转”完全等价，但这里直接给出闭式表达式，
+        // 便于一次完成整局变换。
+        return ring * SEAT + ((4 - seat) & 7);
+    case TRANSFORM_ROTATE_LEFT:
+        return ring * SEAT + ((seat + SEAT - 2) & 7);
+    case TRANSFORM_ROTATE_RIGHT:
+        return ring * SEAT + ((seat + 2) & 7);
+    case TRANSFORM_ROTATE_180:
+        return ring * SEAT + ((seat + 4) & 7);
+    default:
+        return pos;
+    }
+}
+
+uint32_t Position::transformBoard(uint32_t board, TransformMode mode) const
+{
+    uint32_t result = 0u;
+    uint32_t bits = board & m_tables->validBoardMask;
+    while (bits != 0u) {
+        const int32_t pos = CTZ32(bits);
+        result |= bitOf(transformPos(pos, mode));
+        bits &= bits - 1u;
+    }
+    return result;
+}
+
+MillKey Position::transformMillKey(MillKey key, TransformMode mode) const
+{
+    const uint32_t oldLineId = getMillKeyLineId(key);
+    if (oldLineId >= m_tables->lineCount) {
+        return key;
+    }
+
+    const int32_t mappedPos[MILL] = {
+        transformPos(m_tables->linePos[oldLineId][0], mode),
+        transformPos(m_tables->linePos[oldLineId][1], mode),
+        transformPos(m_tables->linePos[oldLineId][2], mode)
+    };
+    const uint32_t mappedMask = bitOf(mappedPos[0]) | bitOf(mappedPos[1]) | bitOf(mappedPos[2]);
+
+    int32_t newLineId = -1;
+    for (uint32_t lineId = 0; lineId < m_tables->lineCount; ++lineId) {
+        if (m_tables->lineMasks[lineId] == mappedMask) {
+            newLineId = static_cast<int32_t>(lineId);
+            break;
+        }
+    }
+    if (newLineId < 0) {
+        return key;
+    }
+
+    const uint32_t oldPieces[MILL] = { getMillKeyPiece0(key), getMillKeyPiece1(key), getMillKeyPiece2(key) };
+    uint32_t newPieces[MILL] = {};
+    for (int32_t targetIndex = 0; targetIndex < MILL; ++targetIndex) {
+        const int32_t targetPos = m_tables->linePos[newLineId][targetIndex];
+        for (int32_t sourceIndex = 0; sourceIndex < MILL; ++sourceIndex) {
+            if (mappedPos[sourceIndex] == targetPos) {
+                newPieces[targetIndex] = oldPieces[sourceIndex];
+                break;
+            }
+        }
+    }
+
+    return makeMillKey(isMillKeyPlayer2(key), static_cast<uint32_t>(newLineId),
+        newPieces[0], newPieces[1], newPieces[2]);
+}
+
+void Position::transformState(TransformMode mode)
+{
+    m_data.player1Board = transformBoard(m_data.player1Board, mode);
+    m_data.player2Board = transformBoard(m_data.player2Board, mode);
+    m_data.forbiddenBoard = transformBoard(m_data.forbiddenBoard, mode);
+    for (int32_t i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+        m_data.numberBoards[i] = transformBoard(m_data.numberBoards[i], mode);
+    }
+
+    if (!m_tables->rule.allowRepeatedMills) {
+        for (MillKey& key : m_data.millHistory) {
+            key = transformMillKey(key, mode);
+        }
+    }
+
+    if (isValidPos(m_selectedPos)) {
+        m_selectedPos = transformPos(m_selectedPos, mode);
+    }
+}
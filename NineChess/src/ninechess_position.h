@@ -0,0 +1,601 @@
+/****************************************************************************
+** NineChess - 局面与规则走子
+**
+** Position 只包含决定棋局走向的状态：
+**   - ChessData（位棋盘、status、九连棋序号层与历史三连）
+**   - 赢家、中局已选中的棋子、结局原因
+**   - 指向当前规则辅助表的指针
+** 全部规则走子（选子 / 落子 / 提子、成三、阶段切换、胜负判定）都在这里完成。
+**
+** 命令文本、命令历史和提示文本属于界面层，由派生类 NineChess 维护。
+** Position 可以按字节复制（约两条缓存行），AI 搜索复制局面的代价与对局长度无关。
+**
+** 棋盘辅助表（邻接表、三连线表）在编译期生成，按棋盘拓扑共用，局面只保存一个指针。
+** 走子热路径另有按 RuleTraits<N> 实例化的模板版本（见 ninechess_rule_traits.h），
+** 规则开关与辅助表都是编译期常量；不带模板参数的接口按规则下标分派到对应实例。
+****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "ninechess_common.h"
+#include "ninechess_rule_traits.h"
+
+// 一套规则的全部棋盘辅助表，全程只读。
+// 4 套规则的 RuleTables 都在编译期常量初始化，表本身指向 ninechess_rule_traits.h 中
+// 按棋盘拓扑生成的 constexpr 数组，同拓扑的规则共用一份；取表与切换规则都不需要构建。
+struct RuleTables {
+    // 棋盘上合法三连线的最大数量。
+    // 无斜线为 16，有斜线时为 20，因此这里取上界 20。
+    static constexpr uint32_t MAX_MILL_LINE_COUNT = BoardTopology::MAX_MILL_LINE_COUNT;
+
+    // 单个点位最多会参与 3 条三连线。
+    static constexpr uint32_t MAX_LINES_PER_POS = BoardTopology::MAX_LINES_PER_POS;
+
+    // 规则在 Position::rules[] 中的下标与规则对象本身。
+    uint32_t ruleIndex;
+    const Rule& rule;
+
+    // 24 位有效棋盘掩码，低 24 位对应真实棋盘点位。
+    uint32_t validBoardMask;
+
+    // 每个点位的邻接点位集合，共 BOARD_SIZE 项。
+    const uint32_t* moveMask;
+
+    // 当前规则下实际三连线总数。
+    uint32_t lineCount;
+
+    // 每条三连线对应的 24 位掩码。
+    const uint32_t* lineMasks;
+
+    // 每条三连线的 3 个固定点位。
+    const int8_t (*linePos)[MILL];
+
+    // 每个点位一共参与多少条三连线。
+    const uint8_t* posLineCount;
+
+    // 每个点位参与的 lineId 列表。
+    const int8_t (*posLineIds)[MAX_LINES_PER_POS];
+};
+
+class Position
+{
+    // AI 搜索直接读取辅助表与局面数据。
+    friend class NineChess_AI_AB;
+    friend class NineChess_AI_MCTS;
+
+public:
+    // 工程内置的 4 套规则表。
+    static const Rule rules[RULE_COUNT];
+
+    // 局面进入 GAME_OVER 的原因，界面层据此生成提示文本。
+    enum GameOverReason : uint8_t {
+        GAME_OVER_NONE = 0,         // 未结束，或由外部直接写入的结局局面
+        GAME_OVER_MATERIAL = 1,     // 一方子数不足
+        GAME_OVER_FULL_BOARD = 2,   // 开局摆满棋盘
+        GAME_OVER_BLOCKED = 3,      // 行棋方无子可走且按规则判负
+        GAME_OVER_ALL_BLOCKED = 4,  // 双方均无子可走
+        GAME_OVER_ADJUDICATED = 5   // 认输或外部裁定
+    };
+
+public:
+    // 默认使用“九连棋”规则（rules[2]），与 NineChess 一致。
+    Position();
+
+    // 返回某套规则的共享辅助表；下标越界时返回 rules[0] 的表。
+    static const RuleTables& ruleTables(uint32_t ruleIndex);
+
+    // ==================== 规则与数据 ====================
+    // 切换规则并 reset 到该规则的初始局面。
+    void setRule(uint32_t ruleIndex);
+
+    // 返回当前规则在 rules[] 中的下标。
+    uint32_t getRuleIndex() const { return m_tables->ruleIndex; }
+
+    // 返回当前规则对象。
+    const Rule* getRule() const { return &m_tables->rule; }
+
+    // 直接返回当前局面数据。
+    // const 版本用于查询，非 const 版本主要给 AI / 调试代码使用。
+    const ChessData& getData() const { return m_data; }
+    ChessData& getData() { return m_data; }
+
+    // ==================== 基础查询 ====================
+    // 坐标均为 0-based：
+    // c: 0~2 表示三圈
+    // p: 0~7 表示该圈上的 8 个位置
+    // 判断给定的圈位坐标是否落在棋盘范围内。
+    static bool isValidCP(int32_t c, int32_t p);
+
+    // 判断给定的一维点位编号是否在 0~23 范围内。
+    static bool isValidPos(int32_t pos);
+
+    // 将 (圈, 位) 转成 0~23 的一维点位编号。
+    // 输入非法时返回 -1。
+    static int32_t cpToPos(int32_t c, int32_t p);
+
+    // 将一维点位编号拆成 (圈, 位)。
+    // 输入非法时 c / p 均返回 -1。
+    static void posToCP(int32_t pos, int32_t& c, int32_t& p);
+
+    // 当前局面阶段：未开局 / 开局摆子 / 中局走子 / 结局。
+    Phases getPhase() const { return m_data.getPhase(); }
+
+    // 当前动作：选子 / 落子 / 提子。
+    Actions getAction() const { return m_data.getAction(); }
+
+    // 当前轮到哪一方行动。
+    Players getTurn() const { return m_data.getTurn(); }
+
+    // 当前赢家。
+    // 未分胜负返回 NOBODY，平局返回 DRAW。
+    Players getWinner() const { return m_winner; }
+
+    // 兼容旧接口名。
+    Players whoWin() const { return getWinner(); }
+
+    // 局面进入 GAME_OVER 的原因。
+    GameOverReason getGameOverReason() const { return m_overReason; }
+
+    // 压缩后的 status 原始值。
+    uint32_t getStatus() const { return m_data.status; }
+
+    // 兼容旧接口名。
+    uint16_t getFlags() const { return static_cast<uint16_t>(getStatus()); }
+
+    // 当前被选中的棋子点位；没有选中时为 -1。
+    int32_t getCurrentPos() const { return m_selectedPos; }
+
+    // 先手当前手中的未落子数。
+    uint32_t getPlayer1InHand() const { return m_data.getPlayer1InHand(); }
+
+    // 兼容旧接口名。
+    uint32_t getPlayer1_InHand() const { return getPlayer1InHand(); }
+
+    // 后手当前手中的未落子数。
+    uint32_t getPlayer2InHand() const { return m_data.getPlayer2InHand(); }
+
+    // 兼容旧接口名。
+    uint32_t getPlayer2_InHand() const { return getPlayer2InHand(); }
+
+    // 先手当前在盘存活棋子数。
+    uint32_t getPlayer1OnBoardCount() const { return m_data.getPlayer1OnBoardCount(); }
+
+    // 后手当前在盘存活棋子数。
+    uint32_t getPlayer2OnBoardCount() const { return m_data.getPlayer2OnBoardCount(); }
+
+    // 当前还需要继续提掉多少颗子。
+    uint32_t getPendingCaptures() const { return m_data.getPendingCaptures(); }
+
+    // 兼容旧接口名。
+    Players whosTurn() const { return getTurn(); }
+
+    // 查询给定圈位坐标上的棋子归属。
+    // 空点或禁点都返回 NOBODY。
+    Players getWhosPiece(int32_t c, int32_t p) const;
+
+    // 查询给定 0~23 点位上的棋子归属。
+    // 空点或禁点都返回 NOBODY。
+    Players getWhosPiecePos(int32_t pos) const;
+
+    // 返回某个点位的邻接点位掩码。
+    // 主要给 AI 快速生成着法时使用。
+    uint32_t getMoveMask(int32_t pos) const { return isValidPos(pos) ? m_tables->moveMask[pos] : 0u; }
+
+    // 九连棋专用查询：按“玩家 + 编号”返回对应棋子的圈位坐标。
+    // 非九连棋规则或该编号棋不在盘上时返回 false。
+    bool getPieceCP(Players player, uint32_t number, int32_t& c, int32_t& p) const;
+
+    // 九连棋专用查询：返回当前选中棋子的玩家和编号。
+    // 非九连棋规则或当前没有选中棋子时返回 false。
+    bool getCurrentPiece(Players& player, uint32_t& number) const;
+
+    // ==================== 合法性判断 ====================
+    // 判断当前局面下，给定点位是否允许“选子”。
+    bool canChoosePos(int32_t pos) const;
+
+    // 判断当前局面下，给定点位是否允许“落子/移子到该点”。
+    bool canPlacePos(int32_t pos) const;
+
+    // 判断当前局面下，给定点位是否允许“提子”。
+    bool canCapturePos(int32_t pos) const;
+
+    // 返回某一方当前处于三连中的全部点位掩码。
+    // 一次遍历全部三连线，把被该方完整占据的线掩码按位或起来；
+    // 提子合法性、AI 提子生成等场景只需再做几次与运算即可。
+    uint32_t millBoard(Players player) const;
+
+    // 按编译期规则 N 计算的 millBoard()，调用方须保证 N == getRuleIndex()。
+    template<uint32_t N>
+    uint32_t millBoard(Players player) const;
+
+    // ==================== 合法着法 ====================
+    // 以下查询用位运算一次算出全部点位，结果与逐点调用 canChoosePos / canPlacePos /
+    // canCapturePos 一致。界面高亮、命令行提示和各个 AI 的着法生成都走这一套。
+
+    // 当前可以选中的己方棋子点位。
+    uint32_t legalSources() const;
+
+    // fromPos 上的棋子可以走到的点位，fromPos 须在 legalSources() 中，不要求已经选中。
+    // fromPos 为 -1 时返回当前可落子的点位：开局为全部空点，中局为已选中棋子的落点。
+    uint32_t legalTargets(int32_t fromPos = -1) const;
+
+    // 当前可以提掉的对方棋子点位。
+    uint32_t legalCaptures() const;
+
+    // 列出当前的全部完整着法，覆盖 buffer 原有内容，不分配内存：
+    // 提子为 MOVE_RECORD_CAPTURE，开局为 MOVE_RECORD_POINT，中局为 MOVE_RECORD_MOVE，
+    // 中局已选子时只列出该棋子的走法。按起点、终点编号从小到大排列，结局时为空。
+    void generateLegal(MoveBuffer& buffer) const;
+
+    // 按编译期规则 N 实例化的版本，调用方须保证 N == getRuleIndex()。
+    template<uint32_t N>
+    uint32_t legalSources() const;
+
+    template<uint32_t N>
+    uint32_t legalTargets(int32_t fromPos = -1) const;
+
+    template<uint32_t N>
+    uint32_t legalCaptures() const;
+
+    template<uint32_t N>
+    void generateLegal(MoveBuffer& buffer) const;
+
+    // ==================== 局面控制 ====================
+    // 重置到当前规则的初始局面，但不改变规则本身。
+    void reset();
+
+    // 从未开局或已结局状态进入新对局。
+    void start();
+
+    // ==================== 走子 ====================
+    // 带合法性校验的点位选子，非法时返回 false 且局面不变。
+    bool choosePos(int32_t pos);
+
+    // 带合法性校验的点位落子 / 移子。
+    bool placePos(int32_t pos);
+
+    // 带合法性校验的点位提子。
+    bool capturePos(int32_t pos);
+
+    // 快速版选子，不做合法性验证，供 AI 搜索热路径使用。
+    // 选子与规则无关，因此没有按规则实例化的版本。
+    void chooseFast(int32_t pos);
+
+    // 快速版落子/移子。
+    void placeFast(int32_t pos);
+
+    // 快速版提子。
+    void captureFast(int32_t pos);
+
+    // 按编译期规则 N 实例化的快速落子/移子与提子，调用方须保证 N == getRuleIndex()。
+    // 已按规则实例化的搜索直接调用这两个版本，省去每步一次的规则分派。
+    template<uint32_t N>
+    void placeFast(int32_t pos);
+
+    template<uint32_t N>
+    void captureFast(int32_t pos);
+
+    // 快速接口的回退快照，只包含快速走子会改写的状态。
+    struct FastSnapshot {
+        ChessData data;
+        Players winner = ::NOBODY;
+        int32_t selectedPos = -1;
+        GameOverReason overReason = GAME_OVER_NONE;
+    };
+
+    // 记录当前局面，供 restoreFast() 回退。
+    void saveFast(FastSnapshot& snapshot) const;
+
+    // 回退到 saveFast() 记录的局面。
+    void restoreFast(const FastSnapshot& snapshot);
+
+    // ==================== 哈希与对称变换 ====================
+    // 按当前规则自动选择 lite / hard 哈希算法。
+    uint64_t getHash() const;
+
+    // 按编译期规则 N 选择哈希算法的 getHash()。
+    template<uint32_t N>
+    uint64_t getHash() const;
+
+    // 只基于主位棋盘和 status 的轻量哈希。
+    uint64_t getHashLite() const { return m_data.getHashLite(); }
+
+    // 把九连棋序号层和历史三连也混入的重哈希。
+    uint64_t getHashHard() const { return m_data.getHashHard(); }
+
+    // 16 种等价变换的统一编号：symmetry = 左右镜像 × 8 + 内外翻转 × 4 + 左旋次数（0~3），
+    // 依次执行镜像、翻转、旋转。局面编号、开局库等需要“规范视角”的模块都用这套编号。
+    static constexpr uint32_t SYMMETRY_COUNT = 16;
+
+    // 点位在第 symmetry 种变换下的像。
+    static int32_t symmetryPos(int32_t pos, uint32_t symmetry);
+
+    // symmetryPos 的逆映射：变换后的点位还原到原视角。
+    static int32_t inverseSymmetryPos(int32_t pos, uint32_t symmetry);
+
+    // 对局面执行第 symmetry 种变换。
+    void applySymmetry(uint32_t symmetry);
+
+    // 16 种变换下 getHash() 的最小值；symmetry 非空时写出取得最小值的变换编号。
+    uint64_t getCanonicalHash(uint32_t* symmetry = nullptr) const;
+
+protected:
+    // 局面变换的内部编码。
+    // mirror / turn / rotate 最终都会映射到这里统一处理。
+    enum TransformMode : uint32_t {
+        TRANSFORM_MIRROR = 0,
+        TRANSFORM_TURN = 1,
+        TRANSFORM_FLIP_VERTICAL = 2,
+        TRANSFORM_ROTATE_LEFT = 3,
+        TRANSFORM_ROTATE_RIGHT = 4,
+        TRANSFORM_ROTATE_180 = 5,
+        TRANSFORM_MODE_COUNT = 6
+    };
+
+    // 当前规则的共享辅助表。
+    const RuleTables* m_tables = nullptr;
+
+    // 当前局面真值数据。
+    ChessData m_data;
+
+    // 当前赢家缓存。
+    Players m_winner = NOBODY;
+
+    // 当前被选中的棋子点位；未选中时为 -1。
+    int32_t m_selectedPos = -1;
+
+    // 局面进入 GAME_OVER 的原因。
+    GameOverReason m_overReason = GAME_OVER_NONE;
+
+protected:
+    // 计算点位 pos 对应的单比特掩码。
+    static uint32_t bitOf(int32_t pos) { return 1u << pos; }
+
+    // 返回某一方的对手。
+    static Players opponentOf(Players player);
+
+    // 返回指定玩家当前主位棋盘的值拷贝。
+    uint32_t boardOf(Players player) const;
+
+    // 返回指定玩家主位棋盘的可写引用。
+    uint32_t& boardRef(Players player);
+
+    // 判断点位上是否已有棋子。
+    bool isOccupiedPos(int32_t pos) const;
+
+    // 判断点位当前是否是禁点。
+    bool isForbiddenPos(int32_t pos) const;
+
+    // 判断点位是否为空且不是禁点。
+    bool isEmptyPos(int32_t pos) const;
+
+    // 既没有棋子也不是禁点的全部点位。
+    uint32_t emptyBoard() const
+    {
+        return ~(m_data.player1Board | m_data.player2Board | m_data.forbiddenBoard) & ChessData::VALID_BOARD_MASK;
+    }
+
+    // 判断指定玩家在当前局面下是否拥有飞子权。
+    bool canFly(Players player) const;
+
+    template<uint32_t N>
+    bool canFly(Players player) const;
+
+    // 判断两个点位是否直接邻接。
+    bool isAdjacent(int32_t fromPos, int32_t toPos) const;
+
+    // 判断点位上是否是某一方自己的棋子。
+    bool isOwnPieceAt(Players player, int32_t pos) const;
+
+    // 判断点位上是否是某一方对手的棋子。
+    bool isOpponentPieceAt(Players player, int32_t pos) const;
+
+    // 以下走子步骤都按编译期规则 N 实例化，规则开关与辅助表取自 RuleTraits<N>。
+    // 执行开局阶段的一次摆子。
+    template<uint32_t N>
+    void applyOpeningPlacement(int32_t pos);
+
+    // 执行中局阶段的一次移子。
+    template<uint32_t N>
+    void applyMidMove(int32_t toPos);
+
+    // 执行一次提子。
+    template<uint32_t N>
+    void applyCapture(int32_t pos);
+
+    // 落子或移子后，处理成三、切换阶段、切换轮次和胜负判断。
+    template<uint32_t N>
+    bool tryFinishAfterPlaceOrMove(int32_t pos);
+
+    // 提子后，处理剩余提子数、切换阶段、切换轮次和胜负判断。
+    template<uint32_t N>
+    bool tryFinishAfterCapture();
+
+    // 仅从棋子数量和棋盘是否摆满角度判断是否已经分胜负。
+    template<uint32_t N>
+    bool trySetWinnerFromMaterialOrBoard();
+
+    // 在中局选子阶段处理“无子可走”的情况。
+    template<uint32_t N>
+    bool tryHandleBlockedTurn();
+
+    // 统计某个点位上的棋子当前参与了多少条三连。
+    uint32_t countMillsAt(int32_t pos) const;
+
+    template<uint32_t N>
+    uint32_t countMillsAt(int32_t pos) const;
+
+    // 判断某个点位上的棋子是否处于至少一条三连中。
+    bool isPieceInMill(int32_t pos) const;
+
+    // 判断某一方当前是否所有棋子都处于三连中。
+    bool isAllInMills(Players player) const;
+
+    // 某一方当前能走动的棋子点位，不看轮次与动作；中局选子和无子可走判定共用。
+    template<uint32_t N>
+    uint32_t movableBoard(Players player) const;
+
+    // 判断某一方当前是否还存在至少一步合法着法。
+    template<uint32_t N>
+    bool hasAnyLegalMove(Players player) const { return movableBoard<N>(player) != 0u; }
+
+    // 检查某点产生的新三连，并返回本次真正新增的可提子三连数。
+    template<uint32_t N>
+    uint32_t addNewMills(int32_t pos);
+
+    // 返回某点位上的棋子编号。
+    // 非九连棋或该点无编号棋时返回 -1。
+    int32_t getPieceNumberAtPos(int32_t pos) const;
+
+    // 开局落子时，为九连棋编号层登记一颗新棋子。
+    template<uint32_t N>
+    void placeNumberedPiece(int32_t pos);
+
+    // 中局移子时，同步移动编号层中的那颗棋子。
+    void moveNumberedPiece(int32_t fromPos, int32_t toPos);
+
+    // 提子时，从编号层中移除对应棋子。
+    void removeNumberedPiece(int32_t pos);
+
+    // 查询某个历史三连 key 是否已经存在。
+    bool hasMillKey(MillKey key) const;
+
+    // 按“玩家 + lineId”生成当前三连对应的 MillKey。
+    template<uint32_t N>
+    MillKey makeMillKeyForLine(Players player, uint32_t lineId) const;
+
+    // 在 PLAYER1 / PLAYER2 之间切换轮次，并返回切换后的结果。
+    Players toggleTurn();
+
+    // 把局面切换到开局摆子阶段。
+    void enterOpening();
+
+    // 把局面切换到中局走子阶段。
+    template<uint32_t N>
+    void enterMidgame();
+
+    // 设置赢家并进入 GAME_OVER 状态。
+    void setGameOver(Players winner, GameOverReason reason);
+
+    // 把单个点位按指定变换模式映射到新点位。
+    static int32_t transformPos(int32_t pos, TransformMode mode);
+
+    // 把整张位棋盘按指定变换模式映射。
+    uint32_t transformBoard(uint32_t board, TransformMode mode) const;
+
+    // 把历史三连 key 按指定变换模式映射。
+    MillKey transformMillKey(MillKey key, TransformMode mode) const;
+
+    // 对位棋盘、序号层、历史三连和选中点位执行几何变换。
+    void transformState(TransformMode mode);
+};
+
+template<uint32_t N>
+inline bool Position::canFly(Players player) const
+{
+    if (!RuleTraits<N>::allowFlying || m_data.getPhase() != GAME_MID) {
+        return false;
+    }
+
+    return (player == PLAYER1 ? m_data.getPlayer1OnBoardCount() : m_data.getPlayer2OnBoardCount())
+        <= RuleTraits<N>::minPiecesToSurvive;
+}
+
+template<uint32_t N>
+inline uint32_t Position::millBoard(Players player) const
+{
+    return RuleTraits<N>::millBoard(boardOf(player) & ChessData::VALID_BOARD_MASK);
+}
+
+template<uint32_t N>
+inline uint32_t Position::movableBoard(Players player) const
+{
+    const uint32_t board = boardOf(player) & ChessData::VALID_BOARD_MASK;
+    const uint32_t empty = emptyBoard();
+    if (canFly<N>(player)) {
+        return empty != 0u ? board : 0u;
+    }
+    return board & RuleTraits<N>::neighbors(empty);
+}
+
+template<uint32_t N>
+inline uint32_t Position::legalSources() const
+{
+    if (m_data.getPhase() != GAME_MID
+        || (m_data.getAction() != ACTION_CHOOSE && m_data.getAction() != ACTION_PLACE)) {
+        return 0u;
+    }
+    return movableBoard<N>(m_data.getTurn());
+}
+
+template<uint32_t N>
+inline uint32_t Position::legalTargets(int32_t fromPos) const
+{
+    switch (m_data.getPhase())
+    {
+    case GAME_NOTSTARTED:
+        return fromPos < 0 ? emptyBoard() : 0u;
+    case GAME_OPENING:
+        return fromPos < 0 && m_data.getAction() == ACTION_PLACE ? emptyBoard() : 0u;
+    case GAME_MID:
+        break;
+    default:
+        return 0u;
+    }
+
+    if (fromPos < 0) {
+        if (m_data.getAction() != ACTION_PLACE || !isValidPos(m_selectedPos)) {
+            return 0u;
+        }
+        fromPos = m_selectedPos;
+    }
+    const Players turn = m_data.getTurn();
+    if (m_data.getAction() == ACTION_CAPTURE || !isValidPos(fromPos) || !isOwnPieceAt(turn, fromPos)) {
+        return 0u;
+    }
+    return canFly<N>(turn) ? emptyBoard() : RuleTraits<N>::moveMask(fromPos) & emptyBoard();
+}
+
+template<uint32_t N>
+inline uint32_t Position::legalCaptures() const
+{
+    const Phases phase = m_data.getPhase();
+    if (phase == GAME_NOTSTARTED || phase == GAME_OVER
+        || m_data.getAction() != ACTION_CAPTURE || m_data.getPendingCaptures() == 0u) {
+        return 0u;
+    }
+
+    // 对手全部棋子都在三连中时可以任意提；否则只能提不在三连中的棋子。
+    const Players defender = opponentOf(m_data.getTurn());
+    const uint32_t pieces = boardOf(defender) & ChessData::VALID_BOARD_MASK;
+    const uint32_t freePieces = pieces & ~millBoard<N>(defender);
+    return freePieces != 0u ? freePieces : pieces;
+}
+
+template<uint32_t N>
+inline uint32_t Position::countMillsAt(int32_t pos) const
+{
+    const Players owner = getWhosPiecePos(pos);
+    if (owner != PLAYER1 && owner != PLAYER2) {
+        return 0u;
+    }
+
+    const uint32_t board = boardOf(owner);
+    uint32_t count = 0u;
+    for (uint32_t i = 0; i < RuleTraits<N>::posLineCount(pos); ++i) {
+        const uint32_t mask = RuleTraits<N>::lineMask(static_cast<uint32_t>(RuleTraits<N>::posLineId(pos, i)));
+        if ((board & mask) == mask) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+template<uint32_t N>
+inline uint64_t Position::getHash() const
+{
+    return RuleTraits<N>::allowRepeatedMills ? m_data.getHashLite() : m_data.getHashHard();
+}
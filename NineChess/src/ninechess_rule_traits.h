@@ -0,0 +1,284 @@
+/****************************************************************************
+** NineChess - 编译期规则特性
+**
+** RuleTraits<N> 与 Position::rules[N] 一一对应，把规则开关和棋盘辅助表
+** （邻接表、三连线表）都变成编译期常量。
+** 走子热路径与 AI 搜索按规则下标实例化一次，内层循环里不再读取 Rule 的开关，
+** 也不再经由 RuleTables 指针取表。
+**
+** 运行期只在入口处按规则下标分派一次，见 dispatchRule()。
+****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "ninechess_common.h"
+
+// 一种棋盘拓扑的全部辅助表。有无斜线决定拓扑，4 套规则只用到两种。
+struct BoardTopology {
+    // 棋盘上合法三连线的最大数量：无斜线为 16，有斜线为 20。
+    static constexpr uint32_t MAX_MILL_LINE_COUNT = 20;
+
+    // 单个点位最多会参与 3 条三连线。
+    static constexpr uint32_t MAX_LINES_PER_POS = 3;
+
+    // 每个点位的邻接点位集合。
+    uint32_t moveMask[BOARD_SIZE];
+
+    // 实际三连线总数。
+    uint32_t lineCount;
+
+    // 每条三连线对应的 24 位掩码。
+    uint32_t lineMasks[MAX_MILL_LINE_COUNT];
+
+    // 每条三连线的 3 个固定点位，未用的线为 -1。
+    int8_t linePos[MAX_MILL_LINE_COUNT][MILL];
+
+    // 每个点位一共参与多少条三连线。
+    uint8_t posLineCount[BOARD_SIZE];
+
+    // 每个点位参与的 lineId 列表，未用的槽位为 -1。
+    int8_t posLineIds[BOARD_SIZE][MAX_LINES_PER_POS];
+};
+
+namespace rule_traits_detail {
+
+constexpr void addMillLine(BoardTopology& topology, int32_t pos0, int32_t pos1, int32_t pos2)
+{
+    const uint32_t lineId = topology.lineCount++;
+    const int32_t positions[MILL] = { pos0, pos1, pos2 };
+    for (int32_t i = 0; i < MILL; ++i) {
+        const int32_t pos = positions[i];
+        topology.linePos[lineId][i] = static_cast<int8_t>(pos);
+        topology.lineMasks[lineId] |= 1u << pos;
+        topology.posLineIds[pos][topology.posLineCount[pos]++] = static_cast<int8_t>(lineId);
+    }
+}
+
+// 线的编号顺序与历史三连 key、开局库和残局库共用，不能改动：
+// 先按圈生成 4 条圈上的线，再生成跨圈线。
+constexpr BoardTopology makeBoardTopology(bool hasDiagonalLines)
+{
+    BoardTopology topology{};
+    for (uint32_t i = 0; i < BoardTopology::MAX_MILL_LINE_COUNT; ++i) {
+        for (int32_t j = 0; j < MILL; ++j) {
+            topology.linePos[i][j] = -1;
+        }
+    }
+    for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+        for (uint32_t i = 0; i < BoardTopology::MAX_LINES_PER_POS; ++i) {
+            topology.posLineIds[pos][i] = -1;
+        }
+    }
+
+    for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+        const int32_t ring = pos / SEAT;
+        const int32_t seat = pos % SEAT;
+        uint32_t mask = 0u;
+
+        mask |= 1u << (ring * SEAT + ((seat + SEAT - 1) % SEAT));
+        mask |= 1u << (ring * SEAT + ((seat + 1) % SEAT));
+
+        // 默认规则下，跨圈直线位于 0/2/4/6 四个中点；
+        // 带斜线规则下，8 个点都允许沿同编号跨圈连接。
+        if ((seat & 1) == 0 || hasDiagonalLines) {
+            if (ring > 0) {
+                mask |= 1u << ((ring - 1) * SEAT + seat);
+            }
+            if (ring + 1 < RING) {
+                mask |= 1u << ((ring + 1) * SEAT + seat);
+            }
+        }
+        topology.moveMask[pos] = mask;
+    }
+
+    for (int32_t ring = 0; ring < RING; ++ring) {
+        const int32_t base = ring * SEAT;
+        addMillLine(topology, base + 7, base + 0, base + 1);
+        addMillLine(topology, base + 1, base + 2, base + 3);
+        addMillLine(topology, base + 3, base + 4, base + 5);
+        addMillLine(topology, base + 5, base + 6, base + 7);
+    }
+    for (int32_t seat = 0; seat < SEAT; ++seat) {
+        if ((seat & 1) == 0 || hasDiagonalLines) {
+            addMillLine(topology, seat, seat + SEAT, seat + SEAT * 2);
+        }
+    }
+    return topology;
+}
+
+} // namespace rule_traits_detail
+
+// 两种拓扑各一份编译期常量表，全程序共用。
+template<bool HasDiagonalLines>
+struct BoardTopologyTable {
+    static constexpr BoardTopology value = rule_traits_detail::makeBoardTopology(HasDiagonalLines);
+};
+
+template<bool HasDiagonalLines>
+constexpr BoardTopology BoardTopologyTable<HasDiagonalLines>::value;
+
+// 各规则共有的表查询，按拓扑实例化。
+template<bool HasDiagonalLines>
+struct RuleTopology {
+    static constexpr bool hasDiagonalLines = HasDiagonalLines;
+
+    // 实际三连线总数。
+    static constexpr uint32_t lineCount = BoardTopologyTable<HasDiagonalLines>::value.lineCount;
+
+    static constexpr uint32_t moveMask(int32_t pos) { return BoardTopologyTable<HasDiagonalLines>::value.moveMask[pos]; }
+    static constexpr uint32_t lineMask(uint32_t lineId) { return BoardTopologyTable<HasDiagonalLines>::value.lineMasks[lineId]; }
+    static constexpr int32_t linePos(uint32_t lineId, int32_t slot) { return BoardTopologyTable<HasDiagonalLines>::value.linePos[lineId][slot]; }
+    static constexpr uint32_t posLineCount(int32_t pos) { return BoardTopologyTable<HasDiagonalLines>::value.posLineCount[pos]; }
+    static constexpr int32_t posLineId(int32_t pos, uint32_t index) { return BoardTopologyTable<HasDiagonalLines>::value.posLineIds[pos][index]; }
+
+    // board 中各点位 moveMask 的并集，用移位一次算完：圈内是每 8 位循环移一位，
+    // 跨圈是整体移 8 位，无斜线时只保留偶数位。邻接关系对称，
+    // 因此 own & neighbors(empty) 就是至少有一个空邻点的己方棋子。
+    static constexpr uint32_t neighbors(uint32_t board)
+    {
+        const uint32_t ringwise = ((board << 1) & 0xfefefeu) | ((board >> 7) & 0x010101u)
+            | ((board >> 1) & 0x7f7f7fu) | ((board << 7) & 0x808080u);
+        const uint32_t crossRing = ((board << SEAT) | (board >> SEAT)) & (HasDiagonalLines ? 0xffffffu : 0x555555u);
+        return ringwise | crossRing;
+    }
+
+    // board 中处于三连里的全部点位。
+    static constexpr uint32_t millBoard(uint32_t board)
+    {
+        uint32_t mills = 0u;
+        for (uint32_t lineId = 0; lineId < lineCount; ++lineId) {
+            const uint32_t mask = lineMask(lineId);
+            if ((board & mask) == mask) {
+                mills |= mask;
+            }
+        }
+        return mills;
+    }
+
+    // board 中 pos 上的棋子是否处于三连中。
+    static constexpr bool formsMill(uint32_t board, int32_t pos)
+    {
+        for (uint32_t i = 0; i < posLineCount(pos); ++i) {
+            const uint32_t mask = lineMask(static_cast<uint32_t>(posLineId(pos, i)));
+            if ((board & mask) == mask) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template<bool HasDiagonalLines>
+constexpr bool RuleTopology<HasDiagonalLines>::hasDiagonalLines;
+
+template<bool HasDiagonalLines>
+constexpr uint32_t RuleTopology<HasDiagonalLines>::lineCount;
+
+namespace rule_traits_detail {
+
+// neighbors() 的移位写法必须与 moveMask 表逐点一致。
+template<bool HasDiagonalLines>
+constexpr bool neighborsMatchMoveMask()
+{
+    for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+        if (RuleTopology<HasDiagonalLines>::neighbors(1u << pos) != RuleTopology<HasDiagonalLines>::moveMask(pos)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace rule_traits_detail
+
+static_assert(rule_traits_detail::neighborsMatchMoveMask<false>() && rule_traits_detail::neighborsMatchMoveMask<true>(),
+    "邻点移位与邻接表不符");
+
+// RuleTraits<N> 的字段与 Rule 同名同义，取值必须与 Position::rules[N] 一致。
+template<uint32_t N>
+struct RuleTraits;
+
+// 成三棋
+template<>
+struct RuleTraits<0> : RuleTopology<false> {
+    static constexpr uint32_t index = 0;
+    static constexpr uint32_t piecesPerSide = 9;
+    static constexpr uint32_t minPiecesToSurvive = 3;
+    static constexpr bool hasForbiddenPoints = false;
+    static constexpr bool defenderMovesFirst = false;
+    static constexpr bool allowRepeatedMills = true;
+    static constexpr bool allowMultiCapture = false;
+    static constexpr bool fullBoardIsLoss = true;
+    static constexpr bool blockedIsLoss = true;
+    static constexpr bool allowFlying = false;
+};
+
+// 打三棋（12 连棋）
+template<>
+struct RuleTraits<1> : RuleTopology<true> {
+    static constexpr uint32_t index = 1;
+    static constexpr uint32_t piecesPerSide = 12;
+    static constexpr uint32_t minPiecesToSurvive = 3;
+    static constexpr bool hasForbiddenPoints = true;
+    static constexpr bool defenderMovesFirst = true;
+    static constexpr bool allowRepeatedMills = true;
+    static constexpr bool allowMultiCapture = true;
+    static constexpr bool fullBoardIsLoss = true;
+    static constexpr bool blockedIsLoss = true;
+    static constexpr bool allowFlying = false;
+};
+
+// 九连棋
+template<>
+struct RuleTraits<2> : RuleTopology<false> {
+    static constexpr uint32_t index = 2;
+    static constexpr uint32_t piecesPerSide = 9;
+    static constexpr uint32_t minPiecesToSurvive = 3;
+    static constexpr bool hasForbiddenPoints = false;
+    static constexpr bool defenderMovesFirst = false;
+    static constexpr bool allowRepeatedMills = false;
+    static constexpr bool allowMultiCapture = true;
+    static constexpr bool fullBoardIsLoss = true;
+    static constexpr bool blockedIsLoss = false;
+    static constexpr bool allowFlying = false;
+};
+
+// 莫里斯九子棋
+template<>
+struct RuleTraits<3> : RuleTopology<false> {
+    static constexpr uint32_t index = 3;
+    static constexpr uint32_t piecesPerSide = 9;
+    static constexpr uint32_t minPiecesToSurvive = 3;
+    static constexpr bool hasForbiddenPoints = false;
+    static constexpr bool defenderMovesFirst = false;
+    static constexpr bool allowRepeatedMills = true;
+    static constexpr bool allowMultiCapture = false;
+    static constexpr bool fullBoardIsLoss = true;
+    static constexpr bool blockedIsLoss = true;
+    static constexpr bool allowFlying = true;
+};
+
+static_assert(RuleTraits<0>::lineCount == 16 && RuleTraits<1>::lineCount == 20, "三连线数量与棋盘拓扑不符");
+static_assert(RuleTraits<1>::posLineCount(1) == 3 && RuleTraits<0>::posLineCount(1) == 2, "点位所在三连线数量不符");
+static_assert(RuleTraits<2>::piecesPerSide <= NUMBERED_PIECE_COUNT, "编号规则的棋子数超过序号层数");
+
+// 按运行期规则下标调用 visitor(std::integral_constant<uint32_t, N>())，
+// visitor 内以 decltype(rule)::value 取得 N。越界下标按 0 号规则处理，与 Position::ruleTables() 一致。
+template<typename Visitor>
+auto dispatchRule(uint32_t ruleIndex, Visitor&& visitor)
+    -> decltype(visitor(std::integral_constant<uint32_t, 0>()))
+{
+    switch (ruleIndex)
+    {
+    case 1:
+        return visitor(std::integral_constant<uint32_t, 1>());
+    case 2:
+        return visitor(std::integral_constant<uint32_t, 2>());
+    case 3:
+        return visitor(std::integral_constant<uint32_t, 3>());
+    default:
+        return visitor(std::integral_constant<uint32_t, 0>());
+    }
+}
@@ -0,0 +1,330 @@
+/****************************************************************************
+** NineChess - 跨进程共享置换表
+****************************************************************************/
+
+#include "ninechess_sharedtt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 段头魔数 "NCST" 与段格式版本。
+constexpr uint32_t SHARED_TT_MAGIC = 0x5453434eu;
+constexpr uint32_t SHARED_TT_VERSION = 1u;
+
+// 段头初始化状态。
+constexpr uint32_t SHARED_TT_READY = 2u;
+
+// 段头字节数，条目数组从这里开始。
+constexpr size_t SHARED_TT_HEADER_SIZE = 64;
+
+// 等待创建者完成初始化的上限。
+constexpr int SHARED_TT_WAIT_MS = 2000;
+
+// data 字的布局：分值 16 位、深度 16 位、标记 2 位、世代号 8 位，最高位恒为 1 以区分空位。
+constexpr unsigned FLAG_SHIFT = 32;
+constexpr unsigned GENERATION_SHIFT = 40;
+constexpr uint64_t USED_BIT = 1ULL << 63;
+
+uint64_t packEntry(const SharedTTEntry& entry)
+{
+    return static_cast<uint64_t>(static_cast<uint16_t>(entry.value))
+        | (static_cast<uint64_t>(static_cast<uint16_t>(entry.depth)) << 16)
+        | (static_cast<uint64_t>(entry.flag & 3u) << FLAG_SHIFT)
+        | (static_cast<uint64_t>(entry.generation) << GENERATION_SHIFT)
+        | USED_BIT;
+}
+
+SharedTTEntry unpackEntry(uint64_t data)
+{
+    SharedTTEntry entry;
+    entry.value = static_cast<int16_t>(data & 0xffffu);
+    entry.depth = static_cast<int16_t>((data >> 16) & 0xffffu);
+    entry.flag = static_cast<uint8_t>((data >> FLAG_SHIFT) & 3u);
+    entry.generation = static_cast<uint8_t>((data >> GENERATION_SHIFT) & 0xffu);
+    return entry;
+}
+
+size_t bucketCountFor(size_t memoryMB)
+{
+    // 向下取 2 的幂，至少一组。
+    const size_t bytes = std::max<size_t>(memoryMB, 1u) * 1024u * 1024u;
+    size_t buckets = 1u;
+    while (buckets * 2u * 4u * 16u <= bytes) {
+        buckets *= 2u;
+    }
+    return buckets;
+}
+
+} // namespace
+
+struct SharedTranspositionTable::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ruleIndex;
+    uint32_t hashScheme;
+    uint64_t entryCount;
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> generation;
+};
+
+SharedTranspositionTable::~SharedTranspositionTable()
+{
+    detach();
+}
+
+std::string SharedTranspositionTable::segmentName(const std::string& name)
+{
+#ifdef _WIN32
+    return "Local\\ninechess_" + name;
+#else
+    return "/ninechess_" + name;
+#endif
+}
+
+bool SharedTranspositionTable::attach(const std::string& name, uint32_t ruleIndex, uint32_t hashScheme, size_t memoryMB)
+{
+    static_assert(sizeof(Header) <= SHARED_TT_HEADER_SIZE, "共享置换表段头超出预留空间");
+    detach();
+
+    // 跨进程共用的原子字必须真正无锁，否则各进程各自的锁保护不了同一块内存。
+    std::atomic<uint64_t> probe(0u);
+    std::atomic<uint32_t> probe32(0u);
+    if (!probe.is_lock_free() || !probe32.is_lock_free()) {
+        return false;
+    }
+
+    const size_t createEntries = bucketCountFor(memoryMB) * BUCKET_SIZE;
+    const size_t createSize = SHARED_TT_HEADER_SIZE + createEntries * sizeof(Slot);
+    const std::string segment = segmentName(name);
+    bool creator = false;
+    void* view = nullptr;
+    size_t viewSize = 0;
+
+#ifdef _WIN32
+    const uint64_t size64 = static_cast<uint64_t>(createSize);
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xffffffffu), segment.c_str());
+    if (mapping == nullptr) {
+        return false;
+    }
+    creator = GetLastError() != ERROR_ALREADY_EXISTS;
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info = {};
+    if (view == nullptr || VirtualQuery(view, &info, sizeof(info)) == 0) {
+        if (view != nullptr) {
+            UnmapViewOfFile(view);
+        }
+        CloseHandle(mapping);
+        return false;
+    }
+    viewSize = creator ? createSize : static_cast<size_t>(info.RegionSize);
+    m_mapping = mapping;
+#else
+    int fd = shm_open(segment.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd >= 0) {
+        creator = true;
+        if (ftruncate(fd, static_cast<off_t>(createSize)) != 0) {
+            ::close(fd);
+            shm_unlink(segment.c_str());
+            return false;
+        }
+        viewSize = createSize;
+    }
+    else {
+        fd = shm_open(segment.c_str(), O_RDWR, 0666);
+        if (fd < 0) {
+            return false;
+        }
+        // 创建者可能还没来得及设定大小。
+        struct stat info = {};
+        for (int waited = 0; waited < SHARED_TT_WAIT_MS; ++waited) {
+            if (fstat(fd, &info) != 0) {
+                break;
+            }
+            if (info.st_size > 0) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (info.st_size < static_cast<off_t>(SHARED_TT_HEADER_SIZE)) {
+            ::close(fd);
+            return false;
+        }
+        viewSize = static_cast<size_t>(info.st_size);
+    }
+
+    view = mmap(nullptr, viewSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        if (creator) {
+            shm_unlink(segment.c_str());
+        }
+        return false;
+    }
+#endif
+
+    m_view = view;
+    m_viewSize = viewSize;
+    m_header = static_cast<Header*>(view);
+
+    // 新段的内存已清零：空条目就是全零，只需写段头，最后发布就绪状态。
+    if (creator) {
+        m_header->magic = SHARED_TT_MAGIC;
+        m_header->version = SHARED_TT_VERSION;
+        m_header->ruleIndex = ruleIndex;
+        m_header->hashScheme = hashScheme;
+        m_header->entryCount = createEntries;
+        m_header->generation.store(0u, std::memory_order_relaxed);
+        m_header->state.store(SHARED_TT_READY, std::memory_order_release);
+    }
+    else {
+        for (int waited = 0; waited < SHARED_TT_WAIT_MS; ++waited) {
+            if (m_header->state.load(std::memory_order_acquire) == SHARED_TT_READY) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    const uint64_t entryCount = m_header->entryCount;
+    if (m_header->state.load(std::memory_order_acquire) != SHARED_TT_READY
+        || m_header->magic != SHARED_TT_MAGIC
+        || m_header->version != SHARED_TT_VERSION
+        || m_header->ruleIndex != ruleIndex
+        || m_header->hashScheme != hashScheme
+        || entryCount == 0u
+        || entryCount % BUCKET_SIZE != 0u
+        || ((entryCount / BUCKET_SIZE) & (entryCount / BUCKET_SIZE - 1u)) != 0u
+        || SHARED_TT_HEADER_SIZE + entryCount * sizeof(Slot) > viewSize) {
+        detach();
+        return false;
+    }
+
+    m_entries = reinterpret_cast<Slot*>(static_cast<uint8_t*>(view) + SHARED_TT_HEADER_SIZE);
+    m_entryCount = static_cast<size_t>(entryCount);
+    m_bucketMask = m_entryCount / BUCKET_SIZE - 1u;
+    return true;
+}
+
+void SharedTranspositionTable::detach()
+{
+    if (m_view != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_view);
+        CloseHandle(static_cast<HANDLE>(m_mapping));
+        m_mapping = nullptr;
+#else
+        munmap(m_view, m_viewSize);
+#endif
+    }
+
+    m_view = nullptr;
+    m_viewSize = 0;
+    m_header = nullptr;
+    m_entries = nullptr;
+    m_entryCount = 0;
+    m_bucketMask = 0;
+}
+
+bool SharedTranspositionTable::remove(const std::string& name)
+{
+#ifdef _WIN32
+    // Windows 的命名映射随最后一个句柄关闭而释放，无需删除。
+    (void)name;
+    return true;
+#else
+    return shm_unlink(segmentName(name).c_str()) == 0;
+#endif
+}
+
+bool SharedTranspositionTable::readSlot(size_t index, uint64_t& key, SharedTTEntry& entry) const
+{
+    const uint64_t data = m_entries[index].data.load(std::memory_order_relaxed);
+    if ((data & USED_BIT) == 0u) {
+        return false;
+    }
+    key = m_entries[index].check.load(std::memory_order_relaxed) ^ data;
+    // 再读一次 data，两次不同说明读的过程中被改写。
+    if (m_entries[index].data.load(std::memory_order_relaxed) != data) {
+        return false;
+    }
+    entry = unpackEntry(data);
+    return true;
+}
+
+bool SharedTranspositionTable::probe(uint64_t key, SharedTTEntry& entry) const
+{
+    const Slot* bucket = &m_entries[(key & m_bucketMask) * BUCKET_SIZE];
+    for (size_t i = 0; i < BUCKET_SIZE; ++i) {
+        const uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        if ((data & USED_BIT) != 0u && (bucket[i].check.load(std::memory_order_relaxed) ^ data) == key) {
+            entry = unpackEntry(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SharedTranspositionTable::store(uint64_t key, const SharedTTEntry& entry)
+{
+    // 同键直接覆盖（更深且同世代时保留）；否则先用空位，再淘汰“深度 - 8 × 世代差”最小的条目。
+    Slot* bucket = &m_entries[(key & m_bucketMask) * BUCKET_SIZE];
+    Slot* target = nullptr;
+    int targetPriority = INT_MAX;
+    for (size_t i = 0; i < BUCKET_SIZE; ++i) {
+        const uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        if ((data & USED_BIT) == 0u) {
+            if (targetPriority > INT_MIN) {
+                target = &bucket[i];
+                targetPriority = INT_MIN;
+            }
+            continue;
+        }
+
+        const SharedTTEntry old = unpackEntry(data);
+        if ((bucket[i].check.load(std::memory_order_relaxed) ^ data) == key) {
+            if (old.depth > entry.depth && old.generation == entry.generation) {
+                return;
+            }
+            target = &bucket[i];
+            break;
+        }
+
+        const int age = static_cast<uint8_t>(entry.generation - old.generation);
+        const int priority = old.depth - 8 * age;
+        if (priority < targetPriority) {
+            target = &bucket[i];
+            targetPriority = priority;
+        }
+    }
+
+    const uint64_t data = packEntry(entry);
+    target->check.store(key ^ data, std::memory_order_relaxed);
+    target->data.store(data, std::memory_order_relaxed);
+}
+
+uint8_t SharedTranspositionTable::nextGeneration()
+{
+    return static_cast<uint8_t>(m_header->generation.fetch_add(1u, std::memory_order_relaxed) + 1u);
+}
+
+uint8_t SharedTranspositionTable::generation() const
+{
+    return static_cast<uint8_t>(m_header->generation.load(std::memory_order_relaxed));
+}
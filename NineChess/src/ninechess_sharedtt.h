@@ -0,0 +1,111 @@
+/****************************************************************************
+** NineChess - 跨进程共享置换表
+**
+** 同一台机器上成批运行的无界面引擎进程（自对弈、批量分析）各自建一份置换表，
+** 内容大同小异。共享模式把某规则的置换表放进命名共享内存段
+** （POSIX shm_open / Windows 命名文件映射），所有挂接同一名称的进程共用一份：
+** 内存不随进程数增长，一个进程算过的局面其它进程直接命中。
+**
+** 段布局：
+**   64 字节段头（魔数、版本、规则、哈希方案、条目数、初始化状态、世代号）+ 条目数组。
+**   条目按 4 个一组组相联，每个条目是两个 64 位原子字：check = 键值 ^ data、data，
+**   读写都不加锁；读到的两个字对不上（另一进程正写到一半）时按未命中处理。
+**   data 打包分值、深度、标记与 8 位世代号，替换时优先淘汰旧世代、浅深度的条目。
+**
+** 段由第一个挂接的进程创建并初始化段头，其余进程等待初始化完成后校验段头；
+** 规则、哈希方案或大小不一致时挂接失败。段在全部进程退出后仍然保留，
+** 需要释放时调用 SharedTranspositionTable::remove()。
+****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 共享置换表中的一条结果。
+struct SharedTTEntry {
+    int16_t value = 0;
+    int16_t depth = 0;
+    uint8_t flag = 0;
+    uint8_t generation = 0;
+};
+
+class SharedTranspositionTable
+{
+public:
+    SharedTranspositionTable() = default;
+    ~SharedTranspositionTable();
+
+    SharedTranspositionTable(const SharedTranspositionTable&) = delete;
+    SharedTranspositionTable& operator=(const SharedTranspositionTable&) = delete;
+
+    // 挂接名为 name 的共享段，不存在时按 memoryMB 创建。
+    // hashScheme 为调用方键值的哈希方案版本，与段头不一致时返回 false。
+    bool attach(const std::string& name, uint32_t ruleIndex, uint32_t hashScheme, size_t memoryMB);
+
+    // 解除挂接，不删除共享段。
+    void detach();
+
+    bool isAttached() const { return m_entries != nullptr; }
+
+    // 条目总数。
+    size_t entryCount() const { return m_entryCount; }
+
+    // 查询 key，命中时写出条目。
+    bool probe(uint64_t key, SharedTTEntry& entry) const;
+
+    // 写入 key 的结果。同键条目更深且世代相同时保留原条目。
+    void store(uint64_t key, const SharedTTEntry& entry);
+
+    // 推进共享世代号并返回新值（8 位回绕），所有进程共用同一个计数。
+    uint8_t nextGeneration();
+
+    // 当前共享世代号。
+    uint8_t generation() const;
+
+    // 依次读出全部有效条目，供写快照使用。
+    template <typename Fn>
+    void forEach(Fn fn) const
+    {
+        for (size_t i = 0; i < m_entryCount; ++i) {
+            uint64_t key = 0;
+            SharedTTEntry entry;
+            if (readSlot(i, key, entry)) {
+                fn(key, entry);
+            }
+        }
+    }
+
+    // 删除命名共享段；已挂接的进程不受影响，全部解除后内存才释放。
+    static bool remove(const std::string& name);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    struct Header;
+
+    // 一组的条目数。
+    static constexpr size_t BUCKET_SIZE = 4;
+
+    // 读取第 index 个条目；空位或读到半新半旧的条目时返回 false。
+    bool readSlot(size_t index, uint64_t& key, SharedTTEntry& entry) const;
+
+    // 平台相关的共享段名称。
+    static std::string segmentName(const std::string& name);
+
+private:
+    Header* m_header = nullptr;
+    Slot* m_entries = nullptr;
+    size_t m_entryCount = 0;
+    size_t m_bucketMask = 0;
+    void* m_view = nullptr;
+    size_t m_viewSize = 0;
+#ifdef _WIN32
+    void* m_mapping = nullptr;
+#endif
+};
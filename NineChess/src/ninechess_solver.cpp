@@ -0,0 +1,496 @@
+/****************************************************************************
+** NineChess - 证明数搜索求解器
+****************************************************************************/
+
+#include "ninechess_solver.h"
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+namespace {
+
+// 置换表数据字的位布局：证明数 0~27 位，否证数 28~55 位，子树规模的对数 56~63 位。
+constexpr uint32_t NUMBER_BITS = 28;
+constexpr uint64_t NUMBER_MASK = (1ULL << NUMBER_BITS) - 1u;
+constexpr uint32_t WORK_SHIFT = 2u * NUMBER_BITS;
+
+inline uint64_t mixKey(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+inline uint32_t workLog(uint64_t work)
+{
+    uint32_t log = 0u;
+    while (work > 1u && log < 255u) {
+        work >>= 1;
+        ++log;
+    }
+    return log;
+}
+
+} // namespace
+
+constexpr uint32_t NineChess_Solver::INF;
+
+struct NineChess_Solver::Move {
+    enum Type : uint8_t {
+        PLACE,      // 开局落子，或中局已选子后的落点
+        SHIFT,      // 中局选子 + 落子
+        CAPTURE,
+        PASS        // 无子可走时轮空
+    };
+
+    Type type = PLACE;
+    int8_t from = -1;
+    int8_t to = -1;
+};
+
+struct NineChess_Solver::Child {
+    Move move;
+    uint64_t key = 0;
+
+    // 终局子结点的证明数 / 否证数在展开时就已确定，不查置换表。
+    bool terminal = false;
+    uint32_t pn = 1;
+    uint32_t dn = 1;
+};
+
+struct NineChess_Solver::ThreadState {
+    unsigned index = 0;
+
+    // 本线程展开的结点数，用来计算子树规模。
+    uint64_t nodes = 0;
+
+    // 根到当前结点路径上的键值，用于识别重复局面。
+    std::vector<uint64_t> path;
+
+    // 按深度复用的子结点与着法缓冲，避免每个结点都分配内存。
+    // 递归时上层仍引用自己那一层，用 deque 保证加深时已有各层不搬家。
+    std::deque<std::vector<Child>> children;
+    std::vector<Move> moves;
+};
+
+NineChess_Solver::NineChess_Solver(size_t memoryMB)
+    : m_nodes(0)
+    , m_quit(false)
+    , m_stop(false)
+{
+    setMemoryLimit(memoryMB);
+}
+
+void NineChess_Solver::setMemoryLimit(size_t memoryMB)
+{
+    // 组数取不超过内存上限的 2 的幂，下标直接按位与。
+    const size_t bytes = std::max<size_t>(memoryMB, 1u) * 1024u * 1024u;
+    size_t buckets = 1u;
+    while (buckets * 2u * BUCKET_SIZE * sizeof(Entry) <= bytes) {
+        buckets *= 2u;
+    }
+
+    m_entryCount = buckets * BUCKET_SIZE;
+    m_bucketMask = buckets - 1u;
+    m_entries.reset(new Entry[m_entryCount]);
+    clear();
+}
+
+void NineChess_Solver::clear()
+{
+    for (size_t i = 0; i < m_entryCount; ++i) {
+        m_entries[i].check.store(0u, std::memory_order_relaxed);
+        m_entries[i].data.store(0u, std::memory_order_relaxed);
+    }
+}
+
+void NineChess_Solver::lookup(uint64_t key, uint32_t& pn, uint32_t& dn) const
+{
+    const Entry* bucket = &m_entries[(key & m_bucketMask) * BUCKET_SIZE];
+    for (size_t i = 0; i < BUCKET_SIZE; ++i) {
+        const uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        if (data != 0u && (bucket[i].check.load(std::memory_order_relaxed) ^ data) == key) {
+            pn = static_cast<uint32_t>(data & NUMBER_MASK);
+            dn = static_cast<uint32_t>((data >> NUMBER_BITS) & NUMBER_MASK);
+            return;
+        }
+    }
+
+    pn = 1u;
+    dn = 1u;
+}
+
+void NineChess_Solver::store(uint64_t key, uint32_t pn, uint32_t dn, uint64_t work)
+{
+    // 已解出的条目再展开也不会变，替换优先级额外加高。
+    Entry* bucket = &m_entries[(key & m_bucketMask) * BUCKET_SIZE];
+    Entry* target = nullptr;
+    uint32_t targetPriority = UINT32_MAX;
+    uint32_t log = workLog(work);
+    for (size_t i = 0; i < BUCKET_SIZE; ++i) {
+        const uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        if (data == 0u) {
+            if (targetPriority > 0u) {
+                target = &bucket[i];
+                targetPriority = 0u;
+            }
+            continue;
+        }
+        if ((bucket[i].check.load(std::memory_order_relaxed) ^ data) == key) {
+            target = &bucket[i];
+            log = std::max(log, static_cast<uint32_t>(data >> WORK_SHIFT));
+            break;
+        }
+
+        const uint32_t oldPn = static_cast<uint32_t>(data & NUMBER_MASK);
+        const uint32_t oldDn = static_cast<uint32_t>((data >> NUMBER_BITS) & NUMBER_MASK);
+        const uint32_t priority = 1u + static_cast<uint32_t>(data >> WORK_SHIFT)
+            + (oldPn == 0u || oldDn == 0u ? 256u : 0u);
+        if (priority < targetPriority) {
+            target = &bucket[i];
+            targetPriority = priority;
+        }
+    }
+
+    const uint64_t data = static_cast<uint64_t>(pn) | (static_cast<uint64_t>(dn) << NUMBER_BITS)
+        | (static_cast<uint64_t>(log) << WORK_SHIFT);
+    target->check.store(key ^ data, std::memory_order_relaxed);
+    target->data.store(data, std::memory_order_relaxed);
+}
+
+uint64_t NineChess_Solver::positionKey(const Position& chess) const
+{
+    uint64_t hash = chess.getHash();
+    if (chess.getPhase() == NineChess::GAME_MID && chess.getAction() == NineChess::ACTION_PLACE) {
+        hash ^= mixKey(static_cast<uint64_t>(chess.getCurrentPos()) + 0x2545f4914f6cdd1dULL);
+    }
+    hash ^= mixKey((static_cast<uint64_t>(m_ruleIndex) << 1)
+        + (m_attacker == NineChess::PLAYER2 ? 1u : 0u) + 0x9e3779b97f4a7c15ULL);
+    const uint64_t key = mixKey(hash);
+    return key != 0u ? key : 1u;
+}
+
+void NineChess_Solver::generateMoves(Position& chess, std::vector<Move>& moves) const
+{
+    moves.clear();
+    if (chess.getPhase() != NineChess::GAME_OPENING && chess.getPhase() != NineChess::GAME_MID) {
+        return;
+    }
+
+    Move move;
+    if (chess.getAction() == NineChess::ACTION_CAPTURE) {
+        move.type = Move::CAPTURE;
+        for (uint32_t targets = chess.legalCaptures(); targets != 0u; targets &= targets - 1u) {
+            move.to = static_cast<int8_t>(CTZ32(targets));
+            moves.push_back(move);
+        }
+        return;
+    }
+
+    if (chess.getPhase() == NineChess::GAME_OPENING || chess.getAction() == NineChess::ACTION_PLACE) {
+        move.type = Move::PLACE;
+        for (uint32_t targets = chess.legalTargets(); targets != 0u; targets &= targets - 1u) {
+            move.to = static_cast<int8_t>(CTZ32(targets));
+            moves.push_back(move);
+        }
+        return;
+    }
+
+    move.type = Move::SHIFT;
+    for (uint32_t sources = chess.legalSources(); sources != 0u; sources &= sources - 1u) {
+        const int32_t fromPos = CTZ32(sources);
+        move.from = static_cast<int8_t>(fromPos);
+        for (uint32_t targets = chess.legalTargets(fromPos); targets != 0u; targets &= targets - 1u) {
+            move.to = static_cast<int8_t>(CTZ32(targets));
+            moves.push_back(move);
+        }
+    }
+
+    // 内核只在走子之后处理轮空；根局面本身无子可走时在这里补上，对方也走不动则留空（和棋）。
+    if (moves.empty() && !m_blockedIsLoss) {
+        Position passed(chess);
+        applyMove(passed, Move{ Move::PASS, -1, -1 });
+        std::vector<Move> replies;
+        generateMoves(passed, replies);
+        if (!replies.empty()) {
+            moves.push_back(Move{ Move::PASS, -1, -1 });
+        }
+    }
+}
+
+void NineChess_Solver::applyMove(Position& chess, const Move& move)
+{
+    switch (move.type) {
+    case Move::SHIFT:
+        chess.chooseFast(move.from);
+        chess.placeFast(move.to);
+        break;
+    case Move::CAPTURE:
+        chess.captureFast(move.to);
+        break;
+    case Move::PASS:
+        chess.getData().setTurn(chess.getTurn() == NineChess::PLAYER1 ? NineChess::PLAYER2 : NineChess::PLAYER1);
+        break;
+    default:
+        chess.placeFast(move.to);
+        break;
+    }
+}
+
+bool NineChess_Solver::terminalNumbers(const Position& chess, uint32_t& pn, uint32_t& dn) const
+{
+    if (chess.getPhase() != NineChess::GAME_OVER) {
+        return false;
+    }
+
+    if (chess.getWinner() == m_attacker) {
+        pn = 0u;
+        dn = INF;
+    }
+    else {
+        pn = INF;
+        dn = 0u;
+    }
+    return true;
+}
+
+void NineChess_Solver::countNode()
+{
+    const uint64_t nodes = ++m_nodes;
+    if (m_limits.maxNodes != 0u && nodes >= m_limits.maxNodes) {
+        m_stop.store(true, std::memory_order_relaxed);
+    }
+    if (nodes % LIMIT_CHECK_INTERVAL == 0u) {
+        if (m_quit.load(std::memory_order_relaxed)
+            || (m_limits.abort != nullptr && m_limits.abort->load(std::memory_order_relaxed))
+            || (m_limits.maxSeconds > 0.0 && std::chrono::steady_clock::now() >= m_deadline)) {
+            m_stop.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+void NineChess_Solver::multipleIterativeDeepening(Position& chess, uint64_t key, uint32_t thpn, uint32_t thdn,
+    ThreadState& state, uint32_t& pn, uint32_t& dn)
+{
+    countNode();
+    const uint64_t nodesBefore = state.nodes++;
+    const bool orNode = chess.getTurn() == m_attacker;
+
+    generateMoves(chess, state.moves);
+    if (state.moves.empty()) {
+        // 未终局却没有着法：判负规则下行棋方负，否则是双方都走不动的和棋。
+        const bool attackerWins = m_blockedIsLoss && chess.getPhase() == NineChess::GAME_MID && !orNode;
+        pn = attackerWins ? 0u : INF;
+        dn = attackerWins ? INF : 0u;
+        store(key, pn, dn, 1u);
+        return;
+    }
+
+    const size_t depth = state.path.size();
+    if (state.children.size() <= depth) {
+        state.children.resize(depth + 1u);
+    }
+    std::vector<Child>& children = state.children[depth];
+    children.clear();
+
+    NineChess::FastSnapshot snapshot;
+    chess.saveFast(snapshot);
+    for (const Move& move : state.moves) {
+        Child child;
+        child.move = move;
+        applyMove(chess, move);
+        child.terminal = terminalNumbers(chess, child.pn, child.dn);
+        child.key = positionKey(chess);
+        chess.restoreFast(snapshot);
+        children.push_back(child);
+    }
+
+    state.path.push_back(key);
+    const uint64_t threadSeed = mixKey(state.index + 1u);
+    for (;;) {
+        // 或结点：证明数取子结点最小值，否证数求和；与结点反之。
+        // value 是决定本结点的那一项，other 是需要求和的那一项。
+        size_t best = 0u;
+        uint32_t bestValue = INF + 1u;
+        uint32_t secondValue = INF;
+        uint32_t bestOther = 0u;
+        uint32_t sumOther = 0u;
+        for (size_t i = 0; i < children.size(); ++i) {
+            Child& child = children[i];
+            uint32_t childPn = child.pn;
+            uint32_t childDn = child.dn;
+            if (!child.terminal) {
+                if (std::find(state.path.begin(), state.path.end(), child.key) != state.path.end()) {
+                    childPn = INF;
+                    childDn = 0u;
+                }
+                else {
+                    lookup(child.key, childPn, childDn);
+                }
+            }
+
+            const uint32_t value = orNode ? childPn : childDn;
+            const uint32_t other = orNode ? childDn : childPn;
+            sumOther = (sumOther >= INF || other >= INF) ? INF : std::min(INF - 1u, sumOther + other);
+
+            // 数值相同的子结点，0 号线程按生成顺序选，其它线程按各自的种子错开。
+            const bool better = value < bestValue
+                || (value == bestValue && state.index != 0u
+                    && mixKey(child.key ^ threadSeed) < mixKey(children[best].key ^ threadSeed));
+            if (better) {
+                secondValue = std::min(secondValue, bestValue);
+                best = i;
+                bestValue = value;
+                bestOther = other;
+            }
+            else if (value < secondValue) {
+                secondValue = value;
+            }
+        }
+
+        pn = orNode ? bestValue : sumOther;
+        dn = orNode ? sumOther : bestValue;
+        if (pn >= thpn || dn >= thdn || shouldStop()) {
+            break;
+        }
+
+        // 子结点阈值：决定项不超过次优值的 1 + 1/4 倍（至少多 1），求和项扣掉兄弟结点的部分。
+        const uint32_t grown = secondValue >= INF ? INF
+            : std::min(INF - 1u, std::max(secondValue + 1u, secondValue + secondValue / 4u));
+        uint32_t childThpn = 0u;
+        uint32_t childThdn = 0u;
+        if (orNode) {
+            childThpn = std::min(thpn, grown);
+            childThdn = thdn >= INF ? INF : thdn - dn + bestOther;
+        }
+        else {
+            childThdn = std::min(thdn, grown);
+            childThpn = thpn >= INF ? INF : thpn - pn + bestOther;
+        }
+
+        const Child& child = children[best];
+        applyMove(chess, child.move);
+        uint32_t childPn = 0u;
+        uint32_t childDn = 0u;
+        multipleIterativeDeepening(chess, child.key, childThpn, childThdn, state, childPn, childDn);
+        chess.restoreFast(snapshot);
+    }
+    state.path.pop_back();
+
+    store(key, pn, dn, state.nodes - nodesBefore);
+}
+
+SolverResult NineChess_Solver::solve(const Position& chess, NineChess::Players attacker, const SolverLimits& limits)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_ruleIndex = chess.getRuleIndex();
+    m_attacker = attacker == NineChess::PLAYER2 ? NineChess::PLAYER2 : NineChess::PLAYER1;
+    m_blockedIsLoss = chess.getRule()->blockedIsLoss;
+    m_limits = limits;
+    m_nodes.store(0u);
+    m_quit.store(false);
+    m_stop.store(false);
+    m_bestMove.clear();
+    m_bestMoveIsPass = false;
+    m_deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(std::max(0.0, limits.maxSeconds)));
+
+    SolverResult result = SOLVER_UNKNOWN;
+    uint32_t rootPn = 0u;
+    uint32_t rootDn = 0u;
+    if (terminalNumbers(chess, rootPn, rootDn)) {
+        result = rootPn == 0u ? SOLVER_PROVEN : SOLVER_DISPROVEN;
+    }
+    else {
+        // 各线程反复从根开始展开，直到根解出或需要停止；第一个解出根的线程记下结果。
+        std::atomic<uint8_t> shared(SOLVER_UNKNOWN);
+        const uint64_t rootKey = positionKey(chess);
+        auto worker = [&](unsigned index) {
+            ThreadState state;
+            state.index = index;
+            Position work(chess);
+            while (!shouldStop()) {
+                uint32_t pn = 0u;
+                uint32_t dn = 0u;
+                multipleIterativeDeepening(work, rootKey, INF, INF, state, pn, dn);
+                if (pn == 0u || dn == 0u) {
+                    uint8_t expected = SOLVER_UNKNOWN;
+                    shared.compare_exchange_strong(expected, pn == 0u ? SOLVER_PROVEN : SOLVER_DISPROVEN);
+                    m_stop.store(true);
+                }
+            }
+        };
+
+        const unsigned threads = std::max(1u, limits.threads);
+        std::vector<std::thread> helpers;
+        for (unsigned i = 1; i < threads; ++i) {
+            helpers.emplace_back(worker, i);
+        }
+        worker(0u);
+        for (std::thread& helper : helpers) {
+            helper.join();
+        }
+        result = static_cast<SolverResult>(shared.load());
+    }
+
+    if (result != SOLVER_UNKNOWN) {
+        m_bestMove = findBestMove(chess, result);
+    }
+    m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::string NineChess_Solver::findBestMove(const Position& root, SolverResult result)
+{
+    // 进攻方行棋且已证明：找证明数为 0 的子结点；防守方行棋且已否证：找否证数为 0 的子结点。
+    const bool orNode = root.getTurn() == m_attacker;
+    if (root.getPhase() == NineChess::GAME_OVER || orNode != (result == SOLVER_PROVEN)) {
+        return std::string();
+    }
+
+    Position chess(root);
+    std::vector<Move> moves;
+    generateMoves(chess, moves);
+    const uint64_t rootKey = positionKey(chess);
+    NineChess::FastSnapshot snapshot;
+    chess.saveFast(snapshot);
+    for (const Move& move : moves) {
+        applyMove(chess, move);
+        uint32_t pn = 1u;
+        uint32_t dn = 1u;
+        const uint64_t key = positionKey(chess);
+        if (!terminalNumbers(chess, pn, dn)) {
+            if (key == rootKey) {
+                pn = INF;
+                dn = 0u;
+            }
+            else {
+                lookup(key, pn, dn);
+            }
+        }
+        chess.restoreFast(snapshot);
+        if ((orNode && pn == 0u) || (!orNode && dn == 0u)) {
+            m_bestMoveIsPass = move.type == Move::PASS;
+            return formatMove(move);
+        }
+    }
+    return std::string();
+}
+
+std::string NineChess_Solver::formatMove(const Move& move)
+{
+    switch (move.type) {
+    case Move::SHIFT:
+        return NineChess::formatMoveCommand(move.from, move.to);
+    case Move::CAPTURE:
+        return NineChess::formatCaptureCommand(move.to);
+    case Move::PASS:
+        return std::string();
+    default:
+        return NineChess::formatPointCommand(move.to);
+    }
+}
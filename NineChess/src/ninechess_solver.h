@@ -0,0 +1,164 @@
+/****************************************************************************
+** NineChess - 证明数搜索求解器
+**
+** 用 df-pn（深度优先证明数搜索）判定某一方能否从当前局面强制取胜，
+** 只给出“已证明 / 已否证 / 未知”，不估分，用于残局研究和题目验证。
+**
+** 与或树：
+**   进攻方行棋的结点为“或”结点，防守方行棋的为“与”结点。
+**   结点类型每次都按局面的 getTurn() 判断，不按层数交替：
+**   成三后继续提子、以及 blockedIsLoss 为 false 的规则下无子可走时由内核自动轮空，
+**   都会让同一方连续行棋。根局面本身无子可走时，这里按同样的规则补一次轮空。
+**   和棋（摆满判和、双方都无子可走、路径上的重复局面）一律算作进攻方未能取胜。
+**
+** 置换表：
+**   固定内存上限，按 4 个条目一组组相联；每个条目是两个 64 位原子字（键值异或数据、数据），
+**   数据里打包了证明数、否证数和子树规模的对数，多个线程无锁共享。
+**   同组满时替换子树规模最小的条目，已证明 / 已否证的条目优先保留。
+**
+** 多线程：
+**   各线程都从根开始做 df-pn，共享同一张置换表，证明数相同的子结点按线程编号错开选择，
+**   使各线程先展开不同的分支；任何一个线程解出根后全部停止。
+**
+** 重复局面按否证处理，结论只在当前路径上成立却会写入置换表（图历史交互问题），
+** 因此“已否证”在有循环的中局里可能偏保守；“已证明”不依赖重复局面，总是可靠的。
+****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ninechess.h"
+
+// 求解结果。
+enum SolverResult : uint8_t {
+    SOLVER_UNKNOWN = 0,     // 达到节点数 / 时间上限或被中止
+    SOLVER_PROVEN = 1,      // 进攻方必胜
+    SOLVER_DISPROVEN = 2    // 进攻方无法强制取胜
+};
+
+// 单次求解的限制。0 表示不限。
+struct SolverLimits {
+    uint64_t maxNodes = 0;
+    double maxSeconds = 0.0;
+    unsigned threads = 1;
+
+    // 外部停止标志，置位后求解尽快返回 SOLVER_UNKNOWN；AI 借用求解器时传入自己的中止标志。
+    const std::atomic<bool>* abort = nullptr;
+};
+
+class NineChess_Solver
+{
+public:
+    // memoryMB 为置换表的内存上限（MB）。
+    explicit NineChess_Solver(size_t memoryMB = 64);
+
+    NineChess_Solver(const NineChess_Solver&) = delete;
+    NineChess_Solver& operator=(const NineChess_Solver&) = delete;
+
+    // 重新分配置换表，原有结果全部丢弃。
+    void setMemoryLimit(size_t memoryMB);
+
+    // 置换表条目数。
+    size_t tableEntryCount() const { return m_entryCount; }
+
+    // 清空置换表。
+    void clear();
+
+    // 判定 attacker 能否从 chess 强制取胜。attacker 只能是 PLAYER1 或 PLAYER2。
+    // 置换表在多次求解之间保留，同一规则、同一进攻方的后续求解可以直接复用。
+    SolverResult solve(const Position& chess, NineChess::Players attacker, const SolverLimits& limits);
+
+    // 请求正在进行的 solve() 尽快返回 SOLVER_UNKNOWN，可以从其它线程调用。
+    void quit() { m_quit.store(true); }
+
+    // 上一次求解中根局面行棋方实现结论的着法：
+    // 已证明且进攻方行棋时为取胜着法，已否证且防守方行棋时为解围着法；其余情况为空串。
+    // 该着法为轮空时没有对应的命令文本，同样为空串，由 bestMoveIsPass() 区分。
+    const std::string& bestMove() const { return m_bestMove; }
+
+    // 上一次求解实现结论的着法是否为轮空（行棋方无子可走，按规则跳过本轮）。
+    bool bestMoveIsPass() const { return m_bestMoveIsPass; }
+
+    // 上一次求解展开的结点数与用时（秒）。
+    uint64_t nodes() const { return m_nodes.load(); }
+    double seconds() const { return m_seconds; }
+
+private:
+    struct Move;
+    struct Child;
+    struct ThreadState;
+
+    // 置换表中的一个条目。check 为键值异或 data，读到的两个字不匹配时视为未命中。
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    // 证明数 / 否证数各占 28 位，INF 表示已解出。
+    static constexpr uint32_t INF = 0x0fffffffu;
+
+    // 置换表一组的条目数。
+    static constexpr size_t BUCKET_SIZE = 4;
+
+    // 每展开多少个结点检查一次时间上限。
+    static constexpr uint64_t LIMIT_CHECK_INTERVAL = 1024;
+
+    // 读取 key 的证明数 / 否证数；未命中时给出初始值 1 / 1。
+    void lookup(uint64_t key, uint32_t& pn, uint32_t& dn) const;
+
+    // 写入 key 的结果，work 为本次展开的子树结点数。
+    void store(uint64_t key, uint32_t pn, uint32_t dn, uint64_t work);
+
+    // 局面在置换表中的键值：哈希再混入规则、进攻方和中局已选中的棋子。
+    uint64_t positionKey(const Position& chess) const;
+
+    // 列出当前局面的全部着法；无子可走且按规则轮空时生成一个轮空着法。
+    void generateMoves(Position& chess, std::vector<Move>& moves) const;
+
+    // 在 chess 上执行一个着法。
+    static void applyMove(Position& chess, const Move& move);
+
+    // 终局的证明数 / 否证数；未终局时返回 false。
+    bool terminalNumbers(const Position& chess, uint32_t& pn, uint32_t& dn) const;
+
+    // df-pn 的核心递归：在阈值 thpn / thdn 之内展开 chess，返回时 pn / dn 为本结点的最新值。
+    void multipleIterativeDeepening(Position& chess, uint64_t key, uint32_t thpn, uint32_t thdn,
+        ThreadState& state, uint32_t& pn, uint32_t& dn);
+
+    // 是否应当停止搜索（根已解出、被中止或超过限制）。
+    bool shouldStop() const { return m_stop.load(std::memory_order_relaxed); }
+
+    // 计入一个结点，必要时检查节点数与时间上限。
+    void countNode();
+
+    // 根局面解出后，找出行棋方实现结论的着法。
+    std::string findBestMove(const Position& root, SolverResult result);
+
+    // 着法的命令文本；轮空没有命令文本，返回空串。
+    static std::string formatMove(const Move& move);
+
+private:
+    std::unique_ptr<Entry[]> m_entries;
+    size_t m_entryCount = 0;
+    size_t m_bucketMask = 0;
+
+    // 当前求解的规则、进攻方与限制。
+    uint32_t m_ruleIndex = 0;
+    NineChess::Players m_attacker = NineChess::PLAYER1;
+    bool m_blockedIsLoss = false;
+    SolverLimits m_limits;
+
+    std::atomic<uint64_t> m_nodes;
+    std::atomic<bool> m_quit;
+    std::atomic<bool> m_stop;
+    double m_seconds = 0.0;
+    std::chrono::steady_clock::time_point m_deadline;
+    std::string m_bestMove;
+    bool m_bestMoveIsPass = false;
+};
@@ -422,24 +422,33 @@ void NineChessWindow::on_actionOpen_O_triggered()
             // 取消AI设定
             ui.actionEngine1_T->setChecked(false);
             ui.actionEngine2_R->setChecked(false);
-            // 读文件
-            QTextStream textStream(&file);
-            QString cmd;
-            cmd = textStream.readLine();
-            // 读取并显示棋谱时，不必刷新棋局场景
-            if(!(game->command(cmd,false))) {
-                // 定义新对话框
-                QMessageBox msgBox(QMessageBox::Warning, tr("文件错误"), tr("不是正确的棋谱文件"), QMessageBox::Ok);
+            // 整份读入后一次解码，任何一行写错都不导入
+            const QByteArray bytes = file.readAll();
+            std::vector<NineChess::MoveRecord> moves;
+            NineChess::ManualError error;
+            if (!NineChess::decodeManual(TextView(bytes.constData(), static_cast<size_t>(bytes.size())), moves, &error))
+            {
+                QMessageBox msgBox(QMessageBox::Warning, tr("文件错误"),
+                    tr("不是正确的棋谱文件（第 %1 行第 %2 列）").arg(error.line).arg(error.column), QMessageBox::Ok);
                 msgBox.exec();
                 return;
             }
-            while (!textStream.atEnd())
+            if (moves.empty())
             {
-                cmd = textStream.readLine();
-                game->command(cmd, false);
+                QMessageBox msgBox(QMessageBox::Warning, tr("文件错误"), tr("不是正确的棋谱文件"), QMessageBox::Ok);
+                msgBox.exec();
+                return;
             }
+            // 读取并显示棋谱时，不必刷新棋局场景
+            const size_t played = game->playManual(moves);
             // 最后刷新棋局场景
             game->updateScence();
+            if (played < moves.size())
+            {
+                QMessageBox msgBox(QMessageBox::Warning, tr("文件错误"),
+                    tr("不是正确的棋谱文件（第 %1 步无法执行）").arg(played + 1), QMessageBox::Ok);
+                msgBox.exec();
+            }
         }
     }
 }
@@ -698,7 +707,7 @@ void NineChessWindow::on_actionEngine_E_triggered()
     dialog->setWindowFlags(Qt::Dialog | Qt::WindowCloseButtonHint);
     dialog->setObjectName(QStringLiteral("Dialog"));
     dialog->setWindowTitle(tr("AI设置"));
-    dialog->resize(256, 188);
+    dialog->resize(320, 188);
     dialog->setModal(true);
 
     // 生成各个控件
@@ -707,12 +716,14 @@ void NineChessWindow::on_actionEngine_E_triggered()
     QGroupBox *groupBox2 = new QGroupBox(dialog);
 
     QHBoxLayout *hLayout1 = new QHBoxLayout;
+    QComboBox *comboBox_engine1 = new QComboBox(dialog);
     QLabel *label_depth1 = new QLabel(dialog);
     QSpinBox *spinBox_depth1 = new QSpinBox(dialog);
     QLabel *label_time1 = new QLabel(dialog);
     QSpinBox *spinBox_time1 = new QSpinBox(dialog);
 
     QHBoxLayout *hLayout2 = new QHBoxLayout;
+    QComboBox *comboBox_engine2 = new QComboBox(dialog);
     QLabel *label_depth2 = new QLabel(dialog);
     QSpinBox *spinBox_depth2 = new QSpinBox(dialog);
     QLabel *label_time2 = new QLabel(dialog);
@@ -722,6 +733,10 @@ void NineChessWindow::on_actionEngine_E_triggered()
 
     // 设置各个控件数据
     groupBox1->setTitle(tr("玩家1 AI设置"));
+    for (uint32_t engine = 0; engine < AI_ENGINE_COUNT; ++engine) {
+        comboBox_engine1->addItem(aiEngineName(static_cast<AiEngineType>(engine)));
+        comboBox_engine2->addItem(aiEngineName(static_cast<AiEngineType>(engine)));
+    }
     label_depth1->setText(tr("深度"));
     spinBox_depth1->setMinimum(1);
     spinBox_depth1->setMaximum(10);
@@ -748,10 +763,12 @@ void NineChessWindow::on_actionEngine_E_triggered()
     vLayout->addWidget(buttonBox);
     groupBox1->setLayout(hLayout1);
     groupBox2->setLayout(hLayout2);
+    hLayout1->addWidget(comboBox_engine1);
     hLayout1->addWidget(label_depth1);
     hLayout1->addWidget(spinBox_depth1);
     hLayout1->addWidget(label_time1);
     hLayout1->addWidget(spinBox_time1);
+    hLayout2->addWidget(comboBox_engine2);
     hLayout2->addWidget(label_depth2);
     hLayout2->addWidget(spinBox_depth2);
     hLayout2->addWidget(label_time2);
@@ -768,6 +785,10 @@ void NineChessWindow::on_actionEngine_E_triggered()
     spinBox_depth2->setValue(depth2);
     spinBox_time1->setValue(time1);
     spinBox_time2->setValue(time2);
+    AiEngineType engine1, engine2;
+    game->getAiEngine(engine1, engine2);
+    comboBox_engine1->setCurrentIndex(static_cast<int>(engine1));
+    comboBox_engine2->setCurrentIndex(static_cast<int>(engine2));
 
     // 新设数据
     if (dialog->exec() == QDialog::Accepted) {
@@ -781,6 +802,12 @@ void NineChessWindow::on_actionEngine_E_triggered()
             // 重置AI
             game->setAiDepthTime(depth1_new, time1_new, depth2_new, time2_new);
         }
+
+        AiEngineType engine1_new = static_cast<AiEngineType>(comboBox_engine1->currentIndex());
+        AiEngineType engine2_new = static_cast<AiEngineType>(comboBox_engine2->currentIndex());
+        if (engine1 != engine1_new || engine2 != engine2_new) {
+            game->setAiEngine(engine1_new, engine2_new);
+        }
     }
 
     // 删除对话框，子控件会一并删除
@@ -1,9 +1,11 @@
 ﻿// NineChessConsole.cpp : 此文件包含 "main" 函数。程序执行将在此处开始并结束。
 //
 
+#include <algorithm>
 #include <cctype>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
@@ -11,6 +13,7 @@
 #endif
 
 #include "ninechess.h"
+#include "ninechess_solver.h"
 
 namespace {
 
@@ -144,10 +147,13 @@ void printHelp()
         << "  -1                 后手认输\n"
         << "  board              重新打印当前棋盘\n"
         << "  history            打印命令历史\n"
+        << "  moves              列出当前局面的全部合法命令\n"
         << "  undo               回退到上一个局面\n"
+        << "  redo               重做刚撤销的一步\n"
         << "  new                按当前规则重新开局\n"
         << "  rules              列出所有规则及说明\n"
         << "  rule N             切换到第 N 条规则、显示说明并重新开局\n"
+        << "  solve [秒数]       用证明数搜索判定当前行棋方能否强制取胜（默认限时 10 秒）\n"
         << "  help               显示帮助\n"
         << "  quit               退出程序\n"
         << "\n"
@@ -184,6 +190,20 @@ void printHistory(const NineChess& chess)
     }
 }
 
+void printLegalMoves(const NineChess& chess)
+{
+    MoveBuffer buffer;
+    chess.generateLegal(buffer);
+    std::cout << "合法命令 (" << buffer.count << "):";
+    if (buffer.count == 0u) {
+        std::cout << " 无";
+    }
+    for (const MoveRecord record : buffer) {
+        std::cout << " " << NineChess::formatMoveRecord(record);
+    }
+    std::cout << "\n";
+}
+
 bool tryHandleRuleCommand(const std::string& cmd, NineChess& chess, bool& changed)
 {
     changed = false;
@@ -218,6 +238,61 @@ bool tryHandleRuleCommand(const std::string& cmd, NineChess& chess, bool& change
     return true;
 }
 
+// solve [秒数]：以当前行棋方为进攻方求解，多线程共享一张 256 MB 的置换表。
+bool tryHandleSolveCommand(const std::string& cmd, const NineChess& chess)
+{
+    if (!startsWith(cmd, "solve")) {
+        return false;
+    }
+
+    double seconds = 10.0;
+    const std::string arg = trimCopy(cmd.substr(5));
+    if (!arg.empty()) {
+        try {
+            seconds = std::stod(arg);
+        }
+        catch (...) {
+            seconds = -1.0;
+        }
+        if (seconds <= 0.0) {
+            std::cout << "solve 命令格式错误，请使用: solve [秒数]\n";
+            return true;
+        }
+    }
+
+    if (chess.getPhase() != NineChess::GAME_OPENING && chess.getPhase() != NineChess::GAME_MID) {
+        std::cout << "对局未在进行中，无法求解。\n";
+        return true;
+    }
+
+    const NineChess::Players attacker = chess.getTurn();
+    const char* attackerText = attacker == NineChess::PLAYER1 ? "玩家1" : "玩家2";
+    static NineChess_Solver solver(256);
+    SolverLimits limits;
+    limits.maxSeconds = seconds;
+    limits.threads = std::max(1u, std::thread::hardware_concurrency());
+    const SolverResult result = solver.solve(chess, attacker, limits);
+
+    if (result == SOLVER_PROVEN) {
+        std::cout << "已证明: " << attackerText << "必胜";
+        if (solver.bestMoveIsPass()) {
+            std::cout << "，本方无子可走，轮空后即可取胜";
+        }
+        else if (!solver.bestMove().empty()) {
+            std::cout << "，取胜着法 " << solver.bestMove();
+        }
+        std::cout << "\n";
+    }
+    else if (result == SOLVER_DISPROVEN) {
+        std::cout << "已否证: " << attackerText << "无法强制取胜。\n";
+    }
+    else {
+        std::cout << "未能在限定时间内解出。\n";
+    }
+    std::cout << "展开结点 " << solver.nodes() << "，用时 " << solver.seconds() << " 秒。\n";
+    return true;
+}
+
 } // namespace
 
 int main(int argc, char* argv[])
@@ -233,6 +308,7 @@ int main(int argc, char* argv[])
         chess.setRule(startupRuleIndex);
     }
     chess.start();
+    // 走子的撤销由 NineChess 自己的撤销差量完成，这里只保存 new / rule 之前的整局。
     std::vector<NineChess> undoStack;
 
     std::cout << "NineChess 命令行测试\n";
@@ -280,16 +356,39 @@ int main(int argc, char* argv[])
             continue;
         }
 
+        if (cmd == "moves") {
+            printLegalMoves(chess);
+            continue;
+        }
+
+        if (tryHandleSolveCommand(cmd, chess)) {
+            continue;
+        }
+
         if (cmd == "undo") {
-            if (undoStack.empty()) {
-                std::cout << "没有可撤销的局面。\n";
+            if (!chess.undo()) {
+                if (undoStack.empty()) {
+                    std::cout << "没有可撤销的局面。\n";
+                    printBoard(chess);
+                    continue;
+                }
+
+                chess = undoStack.back();
+                undoStack.pop_back();
+            }
+            std::cout << "已撤销一步。\n";
+            printBoard(chess);
+            continue;
+        }
+
+        if (cmd == "redo") {
+            if (!chess.redo()) {
+                std::cout << "没有可重做的命令。\n";
                 printBoard(chess);
                 continue;
             }
 
-            chess = undoStack.back();
-            undoStack.pop_back();
-            std::cout << "已撤销一步。\n";
+            std::cout << "已重做一步。\n";
             printBoard(chess);
             continue;
         }
@@ -302,18 +401,18 @@ int main(int argc, char* argv[])
             continue;
         }
 
-        const NineChess snapshot = chess;
-        bool ruleChanged = false;
-        if (tryHandleRuleCommand(cmd, chess, ruleChanged)) {
-            if (ruleChanged) {
-                undoStack.push_back(snapshot);
+        if (startsWith(cmd, "rule")) {
+            const NineChess snapshot = chess;
+            bool ruleChanged = false;
+            if (tryHandleRuleCommand(cmd, chess, ruleChanged)) {
+                if (ruleChanged) {
+                    undoStack.push_back(snapshot);
+                }
+                continue;
             }
-            continue;
         }
 
-        undoStack.push_back(chess);
         if (!chess.command(cmd.c_str())) {
-            undoStack.pop_back();
             std::cout << "命令无效，或该命令在当前局面下不合法。\n";
             printBoard(chess);
             continue;
@@ -0,0 +1,503 @@
+/****************************************************************************
+** NineChessPerft - 走法枚举计数
+**
+** 从初始局面（或回放若干命令后的局面）出发，统计深度 N 的叶子局面数：
+**   - fast    : 通过 chooseFast / placeFast / captureFast + saveFast / restoreFast 走子回退；
+**   - command : 拼出命令文本，复制整个棋局后调用 command()，与控制台的 undo 方式相同。
+** 两条路径的计数必须一致。fast 路径用 generateLegal() 一次列出全部走法，
+** command 路径逐点调用 canChoosePos / canPlacePos / canCapturePos 枚举，两者互为对照。
+**
+** 一层（ply）是一条完整命令：开局落子、中局移子（选子 + 落子）或一次提子。
+** 已经结束的局面不再展开，对更深的计数贡献为 0。
+**
+** --check 按内置参考表逐规则核对，供后续优化内核时回归。
+****************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "ninechess.h"
+
+namespace {
+
+void initConsoleUtf8()
+{
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+}
+
+enum PerftMoveType : uint8_t {
+    PERFT_PLACE,    // 开局落子，或中局已选子后的落点
+    PERFT_SHIFT,    // 中局选子 + 落子
+    PERFT_CAPTURE
+};
+
+struct PerftMove {
+    PerftMoveType type = PERFT_PLACE;
+    int8_t from = -1;
+    int8_t to = -1;
+};
+
+struct PerftMoveList {
+    // 飞子时每颗棋子最多 23 个落点，24 × 24 足够覆盖任何局面。
+    static constexpr size_t MAX_COUNT = BOARD_SIZE * BOARD_SIZE;
+
+    PerftMove moves[MAX_COUNT];
+    size_t count = 0;
+
+    void push(PerftMoveType type, int32_t from, int32_t to)
+    {
+        PerftMove& move = moves[count++];
+        move.type = type;
+        move.from = static_cast<int8_t>(from);
+        move.to = static_cast<int8_t>(to);
+    }
+};
+
+// 参考局面的起始命令。
+// 中局局面来自固定种子的随机对局；飞子局面中后手只剩 3 子，规则 0 与规则 3 的计数从第一层起就不同。
+const char* const PERFT_START = "";
+const char* const PERFT_MID = "(1,5) (0,1) (2,2) (2,4) (0,4) (0,2) (1,7) (2,7) (2,6) (2,1) (0,7) (0,0) "
+    "(1,1) (1,3) (1,0) -(2,4) (0,6) (2,3) (1,2) (1,7)->(1,6) (0,2)->(0,3)";
+const char* const PERFT_MID_RULE1 = "(1,5) (0,1) (2,2) (2,4) (0,4) (0,2) (1,7) (2,7) (2,6) (2,1) (0,7) (0,0) "
+    "(1,1) (1,3) (1,0) -(2,4) (1,2) (0,5) (2,0) -(2,2) (0,3) -(1,2) (1,4) (0,6) -(1,3) (1,6) (2,3) (2,5) "
+    "(2,5)->(2,4) (2,3)->(2,2)";
+const char* const PERFT_FLYING = "(0,2) (1,0) (0,1) (1,2) (2,2) (0,0) (0,4) (1,6) (1,3) (1,4) (2,5) (1,1) "
+    "(2,6) (1,7) -(2,5) (0,3) -(1,6) (2,1) (0,5) -(1,2) (0,6) (0,2)->(1,2) (1,4)->(2,4) (0,3)->(0,2) "
+    "-(2,4) (0,6)->(1,6) (2,6)->(2,7) (1,6)->(2,6) (0,2)->(0,3) -(2,1) (1,0)->(2,0) (1,3)->(1,4) "
+    "(1,7)->(1,0) -(2,7) (0,1)->(0,2) -(2,6) (0,0)->(0,1) (2,2)->(2,1) (2,0)->(2,7) (2,1)->(2,2) -(1,1)";
+
+// 内置参考计数：rule 下回放 moves 后，depth 层的叶子数。
+struct PerftReference {
+    uint32_t rule;
+    const char* moves;
+    int depth;
+    uint64_t nodes;
+};
+
+const PerftReference PERFT_REFERENCES[] = {
+    { 0, PERFT_START, 1, 24u },
+    { 0, PERFT_START, 2, 552u },
+    { 0, PERFT_START, 3, 12144u },
+    { 0, PERFT_START, 4, 255024u },
+    { 0, PERFT_START, 5, 5100480u },
+    { 0, PERFT_START, 6, 96223680u },
+    { 0, PERFT_MID, 1, 8u },
+    { 0, PERFT_MID, 2, 57u },
+    { 0, PERFT_MID, 3, 475u },
+    { 0, PERFT_MID, 4, 3607u },
+    { 0, PERFT_MID, 5, 27626u },
+    { 0, PERFT_MID, 6, 224975u },
+    { 0, PERFT_FLYING, 1, 7u },
+    { 0, PERFT_FLYING, 2, 56u },
+    { 0, PERFT_FLYING, 3, 302u },
+    { 0, PERFT_FLYING, 4, 2535u },
+    { 0, PERFT_FLYING, 5, 15091u },
+    { 0, PERFT_FLYING, 6, 134410u },
+
+    { 1, PERFT_START, 1, 24u },
+    { 1, PERFT_START, 2, 552u },
+    { 1, PERFT_START, 3, 12144u },
+    { 1, PERFT_START, 4, 255024u },
+    { 1, PERFT_START, 5, 5100480u },
+    { 1, PERFT_START, 6, 96052320u },
+    { 1, PERFT_MID_RULE1, 1, 4u },
+    { 1, PERFT_MID_RULE1, 2, 21u },
+    { 1, PERFT_MID_RULE1, 3, 118u },
+    { 1, PERFT_MID_RULE1, 4, 700u },
+    { 1, PERFT_MID_RULE1, 5, 3878u },
+    { 1, PERFT_MID_RULE1, 6, 22974u },
+
+    { 2, PERFT_START, 1, 24u },
+    { 2, PERFT_START, 2, 552u },
+    { 2, PERFT_START, 3, 12144u },
+    { 2, PERFT_START, 4, 255024u },
+    { 2, PERFT_START, 5, 5100480u },
+    { 2, PERFT_START, 6, 96223680u },
+    { 2, PERFT_MID, 1, 8u },
+    { 2, PERFT_MID, 2, 57u },
+    { 2, PERFT_MID, 3, 481u },
+    { 2, PERFT_MID, 4, 3501u },
+    { 2, PERFT_MID, 5, 27575u },
+    { 2, PERFT_MID, 6, 213949u },
+
+    { 3, PERFT_START, 1, 24u },
+    { 3, PERFT_START, 2, 552u },
+    { 3, PERFT_START, 3, 12144u },
+    { 3, PERFT_START, 4, 255024u },
+    { 3, PERFT_START, 5, 5100480u },
+    { 3, PERFT_START, 6, 96223680u },
+    { 3, PERFT_MID, 1, 8u },
+    { 3, PERFT_MID, 2, 57u },
+    { 3, PERFT_MID, 3, 475u },
+    { 3, PERFT_MID, 4, 3607u },
+    { 3, PERFT_MID, 5, 27626u },
+    { 3, PERFT_MID, 6, 224975u },
+    { 3, PERFT_FLYING, 1, 42u },
+    { 3, PERFT_FLYING, 2, 326u },
+    { 3, PERFT_FLYING, 3, 13692u },
+    { 3, PERFT_FLYING, 4, 114280u },
+    { 3, PERFT_FLYING, 5, 4372783u },
+    { 3, PERFT_FLYING, 6, 39244388u },
+};
+
+std::string formatPoint(int32_t pos)
+{
+    return "(" + std::to_string(pos / SEAT) + "," + std::to_string(pos % SEAT) + ")";
+}
+
+std::string formatMove(const PerftMove& move)
+{
+    switch (move.type) {
+    case PERFT_SHIFT:
+        return formatPoint(move.from) + "->" + formatPoint(move.to);
+    case PERFT_CAPTURE:
+        return "-" + formatPoint(move.to);
+    default:
+        return formatPoint(move.to);
+    }
+}
+
+// 列出当前局面的全部走法。fast 为 true 时直接取 generateLegal()；
+// 否则逐点判断，中局选子后的落点要复制棋局、调用安全接口 choosePos 真正选中才能判断。
+void generateMoves(NineChess& chess, PerftMoveList& list, bool fast)
+{
+    list.count = 0;
+    if (chess.getPhase() != NineChess::GAME_OPENING && chess.getPhase() != NineChess::GAME_MID) {
+        return;
+    }
+
+    if (fast) {
+        MoveBuffer buffer;
+        chess.generateLegal(buffer);
+        for (const MoveRecord record : buffer) {
+            switch (getMoveRecordType(record)) {
+            case MOVE_RECORD_MOVE:
+                list.push(PERFT_SHIFT, getMoveRecordFrom(record), getMoveRecordTo(record));
+                break;
+            case MOVE_RECORD_CAPTURE:
+                list.push(PERFT_CAPTURE, -1, getMoveRecordTo(record));
+                break;
+            default:
+                list.push(PERFT_PLACE, -1, getMoveRecordTo(record));
+                break;
+            }
+        }
+        return;
+    }
+
+    if (chess.getAction() == NineChess::ACTION_CAPTURE) {
+        for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+            if (chess.canCapturePos(pos)) {
+                list.push(PERFT_CAPTURE, -1, pos);
+            }
+        }
+        return;
+    }
+
+    if (chess.getPhase() == NineChess::GAME_OPENING || chess.getAction() == NineChess::ACTION_PLACE) {
+        for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+            if (chess.canPlacePos(pos)) {
+                list.push(PERFT_PLACE, -1, pos);
+            }
+        }
+        return;
+    }
+
+    for (int32_t fromPos = 0; fromPos < BOARD_SIZE; ++fromPos) {
+        if (!chess.canChoosePos(fromPos)) {
+            continue;
+        }
+
+        NineChess chosen(chess);
+        chosen.choosePos(fromPos);
+        for (int32_t toPos = 0; toPos < BOARD_SIZE; ++toPos) {
+            if (chosen.canPlacePos(toPos)) {
+                list.push(PERFT_SHIFT, fromPos, toPos);
+            }
+        }
+    }
+}
+
+void applyFast(NineChess& chess, const PerftMove& move)
+{
+    switch (move.type) {
+    case PERFT_SHIFT:
+        chess.chooseFast(move.from);
+        chess.placeFast(move.to);
+        break;
+    case PERFT_CAPTURE:
+        chess.captureFast(move.to);
+        break;
+    default:
+        chess.placeFast(move.to);
+        break;
+    }
+}
+
+uint64_t perftFast(NineChess& chess, int depth)
+{
+    if (depth <= 0) {
+        return 1u;
+    }
+
+    PerftMoveList list;
+    generateMoves(chess, list, true);
+
+    uint64_t nodes = 0u;
+    NineChess::FastSnapshot snapshot;
+    chess.saveFast(snapshot);
+    for (size_t i = 0; i < list.count; ++i) {
+        applyFast(chess, list.moves[i]);
+        nodes += perftFast(chess, depth - 1);
+        chess.restoreFast(snapshot);
+    }
+    return nodes;
+}
+
+// command 路径：任何一条由 can*Pos 判为合法的命令被 command() 拒绝，都说明两套接口不一致。
+uint64_t perftCommand(const NineChess& chess, int depth, std::string& error)
+{
+    if (depth <= 0 || !error.empty()) {
+        return depth <= 0 ? 1u : 0u;
+    }
+
+    NineChess work(chess);
+    PerftMoveList list;
+    generateMoves(work, list, false);
+
+    uint64_t nodes = 0u;
+    for (size_t i = 0; i < list.count && error.empty(); ++i) {
+        NineChess child(chess);
+        const std::string text = formatMove(list.moves[i]);
+        if (!child.command(text.c_str())) {
+            error = "command() 拒绝了合法走法 " + text;
+            return nodes;
+        }
+        nodes += perftCommand(child, depth - 1, error);
+    }
+    return nodes;
+}
+
+struct PerftResult {
+    uint64_t nodes = 0u;
+    double seconds = 0.0;
+    std::string error;
+};
+
+PerftResult runPerft(const NineChess& root, int depth, bool fast, bool divide)
+{
+    PerftResult result;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    NineChess chess(root);
+    if (!divide || depth <= 0) {
+        result.nodes = fast ? perftFast(chess, depth) : perftCommand(chess, depth, result.error);
+    }
+    else {
+        PerftMoveList list;
+        generateMoves(chess, list, fast);
+        NineChess::FastSnapshot snapshot;
+        chess.saveFast(snapshot);
+        for (size_t i = 0; i < list.count && result.error.empty(); ++i) {
+            uint64_t nodes = 0u;
+            if (fast) {
+                applyFast(chess, list.moves[i]);
+                nodes = perftFast(chess, depth - 1);
+                chess.restoreFast(snapshot);
+            }
+            else {
+                NineChess child(root);
+                const std::string text = formatMove(list.moves[i]);
+                if (!child.command(text.c_str())) {
+                    result.error = "command() 拒绝了合法走法 " + text;
+                    break;
+                }
+                nodes = perftCommand(child, depth - 1, result.error);
+            }
+            std::cout << "  " << formatMove(list.moves[i]) << ": " << nodes << "\n";
+            result.nodes += nodes;
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void printResult(const char* mode, int depth, const PerftResult& result)
+{
+    std::cout << mode << " depth " << depth << ": " << result.nodes << " nodes, "
+        << result.seconds << " s";
+    if (result.seconds > 0.0) {
+        std::cout << ", " << static_cast<uint64_t>(static_cast<double>(result.nodes) / result.seconds) << " nodes/s";
+    }
+    std::cout << "\n";
+    if (!result.error.empty()) {
+        std::cout << "  错误: " << result.error << "\n";
+    }
+}
+
+bool setupPosition(NineChess& chess, uint32_t rule, const std::string& moves)
+{
+    chess.setRule(rule);
+    chess.start();
+
+    std::istringstream in(moves);
+    std::string command;
+    while (in >> command) {
+        if (!chess.command(command.c_str())) {
+            std::cerr << "无法执行起始命令: " << command << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// 按参考表逐项核对；commandToo 为 true 时 command 路径也跑一遍。
+int runCheck(int maxDepth, bool commandToo)
+{
+    int failures = 0;
+    for (const PerftReference& reference : PERFT_REFERENCES) {
+        if (reference.depth > maxDepth) {
+            continue;
+        }
+
+        NineChess chess;
+        if (!setupPosition(chess, reference.rule, reference.moves)) {
+            ++failures;
+            continue;
+        }
+        const PerftResult fast = runPerft(chess, reference.depth, true, false);
+        bool ok = fast.nodes == reference.nodes;
+        const char* label = reference.moves == PERFT_START ? " 初始" : (reference.moves == PERFT_FLYING ? " 飞子" : " 中局");
+        std::cout << "rule " << reference.rule << label
+            << " depth " << reference.depth
+            << ": fast " << fast.nodes;
+        if (commandToo) {
+            const PerftResult command = runPerft(chess, reference.depth, false, false);
+            ok = ok && command.error.empty() && command.nodes == reference.nodes;
+            std::cout << ", command " << command.nodes;
+        }
+        std::cout << ", 参考 " << reference.nodes << (ok ? "  OK" : "  FAIL") << "\n";
+        if (!ok) {
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+void printUsage()
+{
+    std::cout
+        << "用法: NineChessPerft [--rule N] [--depth N] [--mode fast|command|both]\n"
+        << "                     [--moves \"命令 命令 ...\"] [--divide]\n"
+        << "      NineChessPerft --check [最大深度，默认 4] [--mode fast|both]\n"
+        << "\n"
+        << "  --rule N     规则编号 0~" << (RULE_COUNT - 1) << "，默认 0\n"
+        << "  --depth N    枚举深度（一层为一条完整命令），默认 4\n"
+        << "  --mode       fast 走快速接口，command 走 command()，both 两者都跑并比较（默认）\n"
+        << "  --moves      起始局面：从初始局面依次执行的命令\n"
+        << "  --divide     按根节点走法分别列出计数\n"
+        << "  --check      按内置参考表核对全部规则\n";
+}
+
+bool parseInt(const char* text, int& value)
+{
+    char* end = nullptr;
+    const long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0') {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    initConsoleUtf8();
+
+    int rule = 0;
+    int depth = 4;
+    std::string mode = "both";
+    std::string moves;
+    bool divide = false;
+    bool check = false;
+    int checkDepth = 4;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--rule" && hasValue && parseInt(argv[i + 1], rule)) {
+            ++i;
+        }
+        else if (arg == "--depth" && hasValue && parseInt(argv[i + 1], depth)) {
+            ++i;
+        }
+        else if (arg == "--mode" && hasValue) {
+            mode = argv[++i];
+        }
+        else if (arg == "--moves" && hasValue) {
+            moves = argv[++i];
+        }
+        else if (arg == "--divide") {
+            divide = true;
+        }
+        else if (arg == "--check") {
+            check = true;
+            if (hasValue && parseInt(argv[i + 1], checkDepth)) {
+                ++i;
+            }
+        }
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (rule < 0 || rule >= RULE_COUNT || depth < 0
+        || (mode != "fast" && mode != "command" && mode != "both")) {
+        printUsage();
+        return 2;
+    }
+
+    if (check) {
+        return runCheck(checkDepth, mode != "fast");
+    }
+
+    NineChess chess;
+    if (!setupPosition(chess, static_cast<uint32_t>(rule), moves)) {
+        return 1;
+    }
+
+    std::cout << "规则 " << rule << " : " << chess.getRule()->name << "\n";
+    PerftResult fast;
+    PerftResult command;
+    if (mode != "command") {
+        fast = runPerft(chess, depth, true, divide);
+        printResult("fast", depth, fast);
+    }
+    if (mode != "fast") {
+        command = runPerft(chess, depth, false, divide);
+        printResult("command", depth, command);
+    }
+
+    if (!command.error.empty()) {
+        return 1;
+    }
+    if (mode == "both" && fast.nodes != command.nodes) {
+        std::cout << "两条路径计数不一致！\n";
+        return 1;
+    }
+    return 0;
+}
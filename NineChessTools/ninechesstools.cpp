@@ -0,0 +1,243 @@
+/****************************************************************************
+** NineChessTools - 离线工具集
+** 直接复用 NineChess 核心与 Alpha-Beta AI 的命令行工具，按子命令分派
+****************************************************************************/
+
+#include "tools_common.h"
+
+#include "ninechess_ai_ab.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+ToolArgs::ToolArgs(int argc, char* argv[], int first)
+{
+    for (int i = first; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            const std::string name = arg.substr(2);
+            if (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) {
+                m_options[name] = argv[++i];
+            }
+            else {
+                m_options[name] = std::string();
+            }
+            continue;
+        }
+        m_positional.push_back(arg);
+    }
+}
+
+std::string ToolArgs::positionalAt(size_t index, const std::string& fallback) const
+{
+    return index < m_positional.size() ? m_positional[index] : fallback;
+}
+
+bool ToolArgs::has(const char* name) const
+{
+    return m_options.find(name) != m_options.end();
+}
+
+std::string ToolArgs::get(const char* name, const std::string& fallback) const
+{
+    const std::map<std::string, std::string>::const_iterator it = m_options.find(name);
+    return it == m_options.end() ? fallback : it->second;
+}
+
+int ToolArgs::getInt(const char* name, int fallback) const
+{
+    const std::map<std::string, std::string>::const_iterator it = m_options.find(name);
+    if (it == m_options.end() || it->second.empty()) {
+        return fallback;
+    }
+
+    char* end = nullptr;
+    const long value = std::strtol(it->second.c_str(), &end, 10);
+    return (end != nullptr && *end == '\0') ? static_cast<int>(value) : fallback;
+}
+
+unsigned ToolArgs::threadCount() const
+{
+    const unsigned hardware = std::thread::hardware_concurrency();
+    const int requested = getInt("threads", hardware == 0u ? 1 : static_cast<int>(hardware));
+    return requested > 0 ? static_cast<unsigned>(requested) : 1u;
+}
+
+std::string formatToolPoint(int32_t pos)
+{
+    return "(" + std::to_string(pos / SEAT) + "," + std::to_string(pos % SEAT) + ")";
+}
+
+void collectLegalCommands(const NineChess& chess, std::vector<std::string>& commands)
+{
+    commands.clear();
+    MoveBuffer buffer;
+    chess.generateLegal(buffer);
+    for (const MoveRecord record : buffer) {
+        commands.push_back(NineChess::formatMoveRecord(record));
+    }
+}
+
+const char* formatGameResult(NineChess::Players winner)
+{
+    if (winner == NineChess::PLAYER1) {
+        return "1-0";
+    }
+    if (winner == NineChess::PLAYER2) {
+        return "0-1";
+    }
+    return "1/2";
+}
+
+bool parseGameResult(const std::string& text, double& score)
+{
+    if (text == "1-0") {
+        score = 1.0;
+        return true;
+    }
+    if (text == "0-1") {
+        score = 0.0;
+        return true;
+    }
+    if (text == "1/2") {
+        score = 0.5;
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+bool parseGameLine(const std::string& line, GameRecord& record)
+{
+    std::istringstream in(line);
+    int rule = -1;
+    std::string result;
+    if (!(in >> rule >> result) || rule < 0 || rule >= RULE_COUNT
+        || !parseGameResult(result, record.result)) {
+        return false;
+    }
+
+    record.rule = static_cast<uint32_t>(rule);
+    record.commands.clear();
+    std::string command;
+    while (in >> command) {
+        record.commands.push_back(command);
+    }
+    return true;
+}
+
+void printUsage()
+{
+    std::cout
+        << "用法: NineChessTools <子命令> [参数]\n"
+        << "\n"
+        << "  selfplay <语料文件> [--rule N] [--games N] [--depth N] [--random N]\n"
+        << "           [--max-plies N] [--shared-tt 名称] [--shared-tt-mb N] [--threads N]\n"
+        << "      并行自对弈，每局一行写出 \"规则 结果 命令...\"。\n"
+        << "  tune <语料文件> [--out 权重文件] [--init 权重文件] [--rule N]\n"
+        << "       [--iterations N] [--skip N] [--threads N]\n"
+        << "      按规则拟合静态估值权重（logistic 损失），写出权重文件。\n"
+        << "  nnue-dump <语料文件> <样本文件> [--rule N] [--depth N] [--skip N] [--threads N]\n"
+        << "      回放语料，导出神经网络训练样本（局面、搜索估值、终局结果）。\n"
+        << "  match [--rule N] [--engine1 ab|mcts] [--engine2 ab|mcts] [--depth1 N] [--depth2 N]\n"
+        << "        [--games N] [--random N] [--mcts-threads N] [--endgame 目录] [--book 文件]\n"
+        << "        [--proof-nodes N] [--contempt N] [--max-plies N] [--tt 文件]\n"
+        << "        [--shared-tt 名称] [--shared-tt-mb N] [--threads N]\n"
+        << "      两个 AI 后端轮流执先对弈，按引擎 1 视角统计胜负与平均每步用时。\n"
+        << "  endgame <输出目录> [--rule 0|3] [--max-pieces N] [--no-distance] [--threads N]\n"
+        << "      逆推生成单方 3~N 子的中局残局库（胜负和 + 距离），已有的类别会跳过。\n"
+        << "  book <输出文件> [--rule N] [--plies N] [--depth N] [--margin N] [--tt 文件]\n"
+        << "       [--shared-tt 名称] [--shared-tt-mb N] [--threads N]\n"
+        << "      深搜开局前 N 步内的全部不等价局面，写出带权重的开局库。\n"
+        << "\n"
+        << "  --shared-tt 名称：同机多个进程挂接同一名称时共用一份置换表（命名共享内存，\n"
+        << "  不存在时按 --shared-tt-mb 创建，默认 64 MB）；--tt 快照随之针对共享表读写。\n";
+}
+
+} // namespace
+
+bool loadGameCorpus(const std::string& path, std::vector<GameRecord>& games)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        GameRecord record;
+        if (!parseGameLine(line, record)) {
+            std::cerr << path << ":" << lineNumber << ": 无法解析的语料行，已跳过\n";
+            continue;
+        }
+        games.push_back(record);
+    }
+    return true;
+}
+
+bool attachToolSharedTable(const ToolArgs& args, uint32_t rule)
+{
+    if (!args.has("shared-tt")) {
+        return true;
+    }
+
+    const std::string name = args.get("shared-tt", "");
+    const size_t memoryMB = static_cast<size_t>(std::max(1, args.getInt("shared-tt-mb", 64)));
+    if (!NineChess_AI_AB::attachSharedTranspositionTable(rule, name, memoryMB)) {
+        std::cerr << "未能挂接共享置换表 " << name << "，按进程内置换表继续。\n";
+        return false;
+    }
+    std::cout << "已挂接共享置换表 " << NineChess_AI_AB::sharedTranspositionTableName(rule, name) << "\n";
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+
+    const std::string tool(argv[1]);
+    const ToolArgs args(argc, argv, 2);
+    if (tool == "selfplay") {
+        return runSelfplayTool(args);
+    }
+    if (tool == "tune") {
+        return runTuneTool(args);
+    }
+    if (tool == "nnue-dump") {
+        return runNnueDumpTool(args);
+    }
+    if (tool == "match") {
+        return runMatchTool(args);
+    }
+    if (tool == "endgame") {
+        return runEndgameTool(args);
+    }
+    if (tool == "book") {
+        return runBookTool(args);
+    }
+
+    printUsage();
+    return 2;
+}
@@ -0,0 +1,177 @@
+/****************************************************************************
+** NineChessTools - 开局库生成
+**
+** book 先按层展开开局前 N 步内的全部局面，用规范哈希去掉等价局面；
+** 再并行用 Alpha-Beta 把第 1~N 层的每个局面深搜到指定深度，
+** 最后为第 0~N-1 层的每个局面按子局面分值挑出与最优着法相差不超过 margin 的着法，
+** 按差距折算成权重写入开局库（见 ninechess_book.h）。
+****************************************************************************/
+
+#include "tools_common.h"
+
+#include "ninechess_ai_ab.h"
+#include "ninechess_book.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+struct BookNode {
+    NineChess chess;
+    uint64_t key = 0;
+    uint32_t symmetry = 0;
+    int ply = 0;
+    int value = 0;
+};
+
+// 开局阶段当前局面的全部落子 / 提子点位。
+void collectBookMoves(const NineChess& chess, std::vector<int32_t>& moves)
+{
+    moves.clear();
+    uint32_t targets = chess.getAction() == NineChess::ACTION_CAPTURE ? chess.legalCaptures() : chess.legalTargets();
+    for (; targets != 0u; targets &= targets - 1u) {
+        moves.push_back(CTZ32(targets));
+    }
+}
+
+NineChess playBookMove(const NineChess& chess, int32_t pos)
+{
+    NineChess child(chess);
+    if (child.getAction() == NineChess::ACTION_CAPTURE) {
+        child.captureFast(pos);
+    }
+    else {
+        child.placeFast(pos);
+    }
+    return child;
+}
+
+} // namespace
+
+int runBookTool(const ToolArgs& args)
+{
+    const std::string outPath = args.positionalAt(0);
+    if (outPath.empty()) {
+        std::cerr << "book 需要输出文件路径。\n";
+        return 2;
+    }
+
+    const int rule = args.getInt("rule", 2);
+    const int plies = std::max(1, args.getInt("plies", 4));
+    const int depth = std::max(1, args.getInt("depth", 6));
+    const int margin = std::max(0, args.getInt("margin", 50));
+    if (rule < 0 || rule >= RULE_COUNT) {
+        std::cerr << "规则编号无效。\n";
+        return 2;
+    }
+
+    attachToolSharedTable(args, static_cast<uint32_t>(rule));
+    const std::string ttPath = args.get("tt", "");
+    if (!ttPath.empty() && NineChess_AI_AB::loadTranspositionTable(static_cast<uint32_t>(rule), ttPath)) {
+        std::cout << "已载入置换表快照 " << ttPath << "\n";
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // 按层展开，等价局面只保留第一次出现的那个。
+    std::vector<BookNode> nodes;
+    std::unordered_map<uint64_t, size_t> indexByKey;
+    {
+        BookNode root;
+        root.chess.setRule(static_cast<uint32_t>(rule));
+        root.chess.start();
+        root.key = NineChess_Book::positionKey(root.chess, root.symmetry);
+        indexByKey[root.key] = 0u;
+        nodes.push_back(root);
+    }
+
+    std::vector<int32_t> moves;
+    size_t levelBegin = 0;
+    for (int ply = 1; ply <= plies; ++ply) {
+        const size_t levelEnd = nodes.size();
+        for (size_t i = levelBegin; i < levelEnd; ++i) {
+            if (!NineChess_Book::coversPosition(nodes[i].chess)) {
+                continue;
+            }
+            collectBookMoves(nodes[i].chess, moves);
+            for (const int32_t pos : moves) {
+                BookNode child;
+                child.chess = playBookMove(nodes[i].chess, pos);
+                child.key = NineChess_Book::positionKey(child.chess, child.symmetry);
+                child.ply = ply;
+                if (indexByKey.emplace(child.key, nodes.size()).second) {
+                    nodes.push_back(child);
+                }
+            }
+        }
+        std::cout << "第 " << ply << " 层：" << (nodes.size() - levelEnd) << " 个不等价局面\n";
+        levelBegin = levelEnd;
+    }
+
+    // 并行深搜第 1~N 层的局面，分值取先手视角。
+    std::atomic<size_t> searched(0);
+    parallelFor(nodes.size() - 1u, args.threadCount(), [&](size_t begin, size_t end, unsigned) {
+        NineChess_AI_AB ai;
+        for (size_t i = begin; i < end; ++i) {
+            BookNode& node = nodes[i + 1u];
+            ai.setChess(node.chess);
+            node.value = ai.alphaBetaPruning(depth);
+            const size_t done = ++searched;
+            if (done % 1000u == 0u) {
+                std::cout << "  已搜索 " << done << " / " << (nodes.size() - 1u) << "\n";
+            }
+        }
+    });
+
+    // 为第 0~N-1 层的局面挑选着法，点位换到规范视角保存。
+    std::vector<BookEntry> entries;
+    size_t bookPositions = 0;
+    for (const BookNode& node : nodes) {
+        if (node.ply >= plies || !NineChess_Book::coversPosition(node.chess)) {
+            continue;
+        }
+
+        collectBookMoves(node.chess, moves);
+        const int sign = node.chess.getTurn() == NineChess::PLAYER1 ? 1 : -1;
+        std::vector<int> childValues;
+        int best = -32768;
+        for (const int32_t pos : moves) {
+            const NineChess child = playBookMove(node.chess, pos);
+            uint32_t symmetry = 0u;
+            const size_t childIndex = indexByKey.at(NineChess_Book::positionKey(child, symmetry));
+            childValues.push_back(nodes[childIndex].value);
+            best = std::max(best, sign * nodes[childIndex].value);
+        }
+
+        for (size_t i = 0; i < moves.size(); ++i) {
+            const int gap = best - sign * childValues[i];
+            if (gap > margin) {
+                continue;
+            }
+
+            BookEntry entry;
+            entry.key = node.key;
+            entry.value = static_cast<int16_t>(std::max(-32767, std::min(32767, childValues[i])));
+            entry.weight = static_cast<uint16_t>(65535 - gap * 65534 / (margin + 1));
+            entry.pos = static_cast<uint8_t>(NineChess::symmetryPos(moves[i], node.symmetry));
+            entries.push_back(entry);
+        }
+        ++bookPositions;
+    }
+
+    if (!NineChess_Book::save(outPath, static_cast<uint32_t>(rule), entries)) {
+        std::cerr << "无法写入开局库: " << outPath << "\n";
+        return 1;
+    }
+    if (!ttPath.empty() && !NineChess_AI_AB::saveTranspositionTable(static_cast<uint32_t>(rule), ttPath)) {
+        std::cerr << "无法写入置换表快照: " << ttPath << "\n";
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "已写出开局库 " << outPath << "：" << bookPositions << " 个局面，"
+        << entries.size() << " 条着法，用时 " << seconds << " s\n";
+    return 0;
+}
@@ -0,0 +1,110 @@
+/****************************************************************************
+** NineChessTools - 离线工具集
+** 各子命令共用的参数解析、合法命令枚举和入口声明
+****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ninechess.h"
+
+// 子命令参数。
+// 形如 "--name value" 的写入选项表，其余按顺序作为位置参数。
+class ToolArgs
+{
+public:
+    ToolArgs(int argc, char* argv[], int first);
+
+    // 按顺序排列的位置参数。
+    const std::vector<std::string>& positional() const { return m_positional; }
+
+    // 返回第 index 个位置参数，不存在时返回 fallback。
+    std::string positionalAt(size_t index, const std::string& fallback = std::string()) const;
+
+    // 是否给出了某个选项。
+    bool has(const char* name) const;
+
+    // 读取字符串选项。
+    std::string get(const char* name, const std::string& fallback) const;
+
+    // 读取整数选项；缺失或格式错误时返回 fallback。
+    int getInt(const char* name, int fallback) const;
+
+    // 读取线程数选项 "--threads"，默认取硬件并发数。
+    unsigned threadCount() const;
+
+private:
+    std::vector<std::string> m_positional;
+    std::map<std::string, std::string> m_options;
+};
+
+// 列出当前局面下全部合法的完整命令文本：
+// 开局为 "(c,p)"，中局为 "(c1,p1)->(c2,p2)"，提子为 "-(c,p)"。
+// 中局已选中棋子时只列出该子的走法。顺序与 NineChess::generateLegal() 相同。
+void collectLegalCommands(const NineChess& chess, std::vector<std::string>& commands);
+
+// 把 0~23 点位格式化为 "(c,p)"。
+std::string formatToolPoint(int32_t pos);
+
+// 对局结果在语料中的写法："1-0"、"0-1"、"1/2"。
+const char* formatGameResult(NineChess::Players winner);
+
+// 解析对局结果，返回先手视角得分 1 / 0.5 / 0；无法识别时返回 false。
+bool parseGameResult(const std::string& text, double& score);
+
+// 语料中的一局：规则、先手视角结果（1 / 0.5 / 0）和完整命令序列。
+struct GameRecord {
+    uint32_t rule = 0;
+    double result = 0.5;
+    std::vector<std::string> commands;
+};
+
+// 读取语料文件，每行一局 "<规则> <结果> <命令...>"，# 开头为注释。
+// 无法解析的行在 stderr 提示后跳过；文件打不开时返回 false。
+bool loadGameCorpus(const std::string& path, std::vector<GameRecord>& games);
+
+// 按 --shared-tt 名称 / --shared-tt-mb N 为 rule 挂接共享置换表，未指定时什么也不做。
+// 挂接失败时在 stderr 提示并返回 false，调用方按进程内置换表继续。
+bool attachToolSharedTable(const ToolArgs& args, uint32_t rule);
+
+// 在 [0, count) 上按线程切块并行执行 fn(begin, end, threadIndex)。
+template <typename Fn>
+void parallelFor(size_t count, unsigned threads, Fn fn)
+{
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(std::max<size_t>(count, 1u))));
+    std::vector<std::thread> workers;
+    const size_t chunk = (count + threads - 1u) / threads;
+    for (unsigned t = 0; t < threads; ++t) {
+        const size_t begin = std::min(count, chunk * t);
+        const size_t end = std::min(count, begin + chunk);
+        workers.emplace_back([=]() { fn(begin, end, t); });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// ==================== 子命令入口 ====================
+// selfplay：并行自对弈，生成调参语料。
+int runSelfplayTool(const ToolArgs& args);
+
+// tune：按规则拟合静态估值权重，输出权重文件。
+int runTuneTool(const ToolArgs& args);
+
+// nnue-dump：回放语料，导出神经网络训练样本。
+int runNnueDumpTool(const ToolArgs& args);
+
+// match：两个 AI 后端对弈，统计胜负与用时。
+int runMatchTool(const ToolArgs& args);
+
+// endgame：逆推生成中局残局库。
+int runEndgameTool(const ToolArgs& args);
+
+// book：深搜开局前几步，生成开局库。
+int runBookTool(const ToolArgs& args);
@@ -0,0 +1,310 @@
+/****************************************************************************
+** NineChessTools - 残局库生成
+**
+** endgame 用逆推分析生成中局残局库（见 ninechess_endgame.h）。
+** 子力总数从少到多处理：a v b 与 b v a 互为后继，两个类别一起求解；
+** 提子后进入的少一子类别在此之前已经生成并映射进来。
+**
+** 每一轮 d 只确定“距终局恰为 d 步”的局面：
+**   - 存在距离 d - 1 的必败后继，则本局面必胜，距离 d；
+**   - 全部后继都是距离不超过 d - 1 的必胜，则本局面必败，距离 d。
+** 本轮新确定的局面距离都是 d，其它线程读到后按“未知”处理，
+** 因此各线程可以无锁地并行扫描同一张表，结果与扫描顺序无关。
+** 没有新局面、也没有更远的低类别结果待用时停止，其余局面都是和棋。
+****************************************************************************/
+
+#include "tools_common.h"
+
+#include "ninechess_endgame.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+// 工作表每个局面 2 字节：0 未知，1 非规范下标，其余为 2 + (距离 << 1 | 必胜)。
+// 轮内判断“本轮新确定”依赖真实距离，工作表里不能截断，只在写 .dtw 时饱和。
+constexpr uint16_t STATE_UNKNOWN = 0;
+constexpr uint16_t STATE_UNUSED = 1;
+constexpr int MAX_PASS = 0x7ffe;
+constexpr int MAX_FILE_DISTANCE = ENDGAME_DISTANCE_NONE - 1;
+
+inline uint16_t encodeState(bool win, int distance)
+{
+    return static_cast<uint16_t>(2 + ((distance << 1) | (win ? 1 : 0)));
+}
+
+inline int stateDistance(uint16_t state)
+{
+    return (state - 2) >> 1;
+}
+
+struct WorkClass {
+    uint32_t ownCount = 0;
+    uint32_t otherCount = 0;
+    uint64_t count = 0;
+    std::unique_ptr<std::atomic<uint16_t>[]> states;
+};
+
+// 某个后继在第 pass 轮时的已知结果（后继一方视角）。
+struct SuccessorResult {
+    bool known = false;
+    bool win = false;
+    // 结果已知但距离不小于 pass，要等以后的轮次才能使用。
+    bool later = false;
+};
+
+class EndgameBuilder
+{
+public:
+    EndgameBuilder(NineChess_Endgame& endgame, uint32_t a, uint32_t b)
+        : m_endgame(endgame)
+    {
+        m_classes[0].ownCount = a;
+        m_classes[0].otherCount = b;
+        m_classes[1].ownCount = b;
+        m_classes[1].otherCount = a;
+        m_classCount = a == b ? 1u : 2u;
+        for (uint32_t i = 0; i < m_classCount; ++i) {
+            WorkClass& work = m_classes[i];
+            work.count = NineChess_Endgame::classSize(work.ownCount, work.otherCount);
+            work.states.reset(new std::atomic<uint16_t>[static_cast<size_t>(work.count)]);
+            for (uint64_t index = 0; index < work.count; ++index) {
+                work.states[index].store(STATE_UNKNOWN, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    uint64_t positionCount() const
+    {
+        return m_classes[0].count + (m_classCount > 1u ? m_classes[1].count : 0u);
+    }
+
+    // 逐轮逆推直到收敛，返回轮数。
+    int solve(unsigned threads)
+    {
+        int pass = 0;
+        for (;;) {
+            std::atomic<uint64_t> resolved(0);
+            std::atomic<bool> later(false);
+            parallelFor(static_cast<size_t>(positionCount()), threads, [&](size_t begin, size_t end, unsigned) {
+                uint64_t localResolved = 0;
+                bool localLater = false;
+                for (size_t i = begin; i < end; ++i) {
+                    const uint32_t classIndex = i < m_classes[0].count ? 0u : 1u;
+                    const uint64_t index = classIndex == 0u ? i : i - m_classes[0].count;
+                    if (resolvePosition(classIndex, index, pass, localLater)) {
+                        ++localResolved;
+                    }
+                }
+                resolved.fetch_add(localResolved);
+                if (localLater) {
+                    later.store(true);
+                }
+            });
+
+            std::cout << "    第 " << pass << " 轮：新确定 " << resolved.load() << " 个局面\n";
+            if (pass > 0 && resolved.load() == 0u && !later.load()) {
+                return pass;
+            }
+            if (pass == MAX_PASS) {
+                std::cerr << "    轮数超出工作表距离上限，其余局面按和棋保存\n";
+                return pass;
+            }
+            ++pass;
+        }
+    }
+
+    bool save(const std::string& directory, bool withDistance, uint64_t stats[3]) const
+    {
+        for (uint32_t i = 0; i < m_classCount; ++i) {
+            const WorkClass& work = m_classes[i];
+            const bool saved = NineChess_Endgame::saveTable(directory, m_endgame.ruleIndex(),
+                work.ownCount, work.otherCount, withDistance,
+                [&](uint64_t index, EndgameValue& value, uint8_t& distance) {
+                    const uint16_t state = work.states[index].load(std::memory_order_relaxed);
+                    distance = ENDGAME_DISTANCE_NONE;
+                    if (state == STATE_UNUSED) {
+                        value = ENDGAME_UNUSED;
+                        return;
+                    }
+                    if (state == STATE_UNKNOWN) {
+                        value = ENDGAME_DRAW;
+                        ++stats[ENDGAME_DRAW];
+                        return;
+                    }
+                    value = ((state - 2) & 1) != 0 ? ENDGAME_WIN : ENDGAME_LOSS;
+                    distance = static_cast<uint8_t>(std::min(stateDistance(state), MAX_FILE_DISTANCE));
+                    ++stats[value];
+                });
+            if (!saved) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    // 尝试在第 pass 轮确定一个局面，返回是否新确定。
+    bool resolvePosition(uint32_t classIndex, uint64_t index, int pass, bool& later)
+    {
+        WorkClass& work = m_classes[classIndex];
+        std::atomic<uint16_t>& state = work.states[index];
+        if (state.load(std::memory_order_relaxed) != STATE_UNKNOWN) {
+            return false;
+        }
+
+        uint32_t own = 0u;
+        uint32_t other = 0u;
+        if (!NineChess_Endgame::positionAt(work.ownCount, work.otherCount, index, own, other)) {
+            state.store(STATE_UNUSED, std::memory_order_relaxed);
+            return false;
+        }
+
+        // 第 0 轮只处理被闷的局面：无路可走直接判负。
+        if (pass == 0) {
+            const bool canMove = m_endgame.forEachSuccessor(own, other, [](uint32_t, uint32_t, bool) {
+                return false;
+            });
+            if (!canMove) {
+                state.store(encodeState(false, 0), std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+
+        bool win = false;
+        bool allWins = true;
+        NineChess_Endgame::OwnKey key;
+        uint32_t keyBoard = 0u;
+        m_endgame.forEachSuccessor(own, other, [&](uint32_t nextOwn, uint32_t nextOther, bool wins) {
+            if (wins) {
+                win = true;
+                return false;
+            }
+
+            const SuccessorResult result = lookup(nextOwn, nextOther, pass, key, keyBoard);
+            if (result.known && !result.win) {
+                win = true;
+                return false;
+            }
+            if (!result.known) {
+                allWins = false;
+                later = later || result.later;
+            }
+            return true;
+        });
+
+        if (win || allWins) {
+            state.store(encodeState(win, pass), std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    SuccessorResult lookup(uint32_t own, uint32_t other, int pass,
+        NineChess_Endgame::OwnKey& key, uint32_t& keyBoard) const
+    {
+        SuccessorResult result;
+        const uint32_t ownCount = static_cast<uint32_t>(POPCOUNT32(own));
+        const uint32_t otherCount = static_cast<uint32_t>(POPCOUNT32(other));
+        for (uint32_t i = 0; i < m_classCount; ++i) {
+            const WorkClass& work = m_classes[i];
+            if (work.ownCount != ownCount || work.otherCount != otherCount) {
+                continue;
+            }
+
+            // 不提子的后继共用同一张 own 棋盘，归一化结果可以复用。
+            if (keyBoard != own) {
+                NineChess_Endgame::prepareOwn(own, key);
+                keyBoard = own;
+            }
+            const uint16_t state = work.states[NineChess_Endgame::indexWith(key, other)].load(std::memory_order_relaxed);
+            if (state >= 2u && stateDistance(state) < pass) {
+                result.known = true;
+                result.win = ((state - 2) & 1) != 0;
+            }
+            return result;
+        }
+
+        // 提子后进入的低类别：和棋永远不会变成已知胜负。
+        EndgameValue value = ENDGAME_DRAW;
+        int distance = -1;
+        if (m_endgame.probe(own, other, value, distance) && value != ENDGAME_DRAW) {
+            if (std::max(distance, 0) < pass) {
+                result.known = true;
+                result.win = value == ENDGAME_WIN;
+            }
+            else {
+                result.later = true;
+            }
+        }
+        return result;
+    }
+
+private:
+    NineChess_Endgame& m_endgame;
+    WorkClass m_classes[2];
+    uint32_t m_classCount = 1;
+};
+
+} // namespace
+
+int runEndgameTool(const ToolArgs& args)
+{
+    const std::string directory = args.positionalAt(0);
+    if (directory.empty()) {
+        std::cerr << "缺少输出目录。\n";
+        return 2;
+    }
+
+    const int rule = args.getInt("rule", 0);
+    if (rule < 0 || !NineChess_Endgame::supportsRule(static_cast<uint32_t>(rule))) {
+        std::cerr << "残局库只支持规则 0（成三棋）和规则 3（莫里斯九子棋）。\n";
+        return 2;
+    }
+
+    const uint32_t maxPieces = static_cast<uint32_t>(std::max<int>(ENDGAME_MIN_PIECES,
+        std::min<int>(ENDGAME_MAX_PIECES, args.getInt("max-pieces", ENDGAME_MAX_PIECES))));
+    const bool withDistance = !args.has("no-distance");
+    const unsigned threads = args.threadCount();
+
+    NineChess_Endgame endgame(static_cast<uint32_t>(rule));
+    const size_t existing = endgame.loadDirectory(directory);
+    if (existing > 0u) {
+        std::cout << "目录中已有 " << existing << " 个类别，跳过已完成的部分。\n";
+    }
+
+    // 按子力总数从少到多，每次求解 a v b 与 b v a 一对类别。
+    for (uint32_t total = 2u * ENDGAME_MIN_PIECES; total <= 2u * maxPieces; ++total) {
+        for (uint32_t a = ENDGAME_MIN_PIECES; 2u * a <= total; ++a) {
+            const uint32_t b = total - a;
+            if (b > maxPieces) {
+                continue;
+            }
+            if (endgame.hasTable(a, b) && endgame.hasTable(b, a)) {
+                continue;
+            }
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            EndgameBuilder builder(endgame, a, b);
+            std::cout << "规则 " << rule << " " << a << "v" << b << (a == b ? "" : " / " + std::to_string(b) + "v" + std::to_string(a))
+                << "：" << builder.positionCount() << " 个下标\n";
+            const int passes = builder.solve(threads);
+
+            uint64_t stats[3] = { 0u, 0u, 0u };
+            if (!builder.save(directory, withDistance, stats)
+                || !endgame.loadTable(directory, a, b) || !endgame.loadTable(directory, b, a)) {
+                std::cerr << "写入残局库失败：" << directory << "\n";
+                return 1;
+            }
+
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "  " << passes << " 轮收敛，胜 " << stats[ENDGAME_WIN] << " 负 " << stats[ENDGAME_LOSS]
+                << " 和 " << stats[ENDGAME_DRAW] << "，用时 " << seconds << " s\n";
+        }
+    }
+    return 0;
+}
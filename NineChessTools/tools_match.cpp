@@ -0,0 +1,188 @@
+/****************************************************************************
+** NineChessTools - 引擎对局
+**
+** match 让两个 AI 后端在同一规则下对弈若干局，双方轮流执先，
+** 开局前若干步随机以增加多样性，最后按引擎 1 的视角统计胜负和每步用时。
+****************************************************************************/
+
+#include "tools_common.h"
+
+#include "ninechess_ai_ab.h"
+#include "ninechess_ai_engine.h"
+#include "ninechess_ai_mcts.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace {
+
+struct MatchSide {
+    AiEngineType engine = AI_ENGINE_ALPHA_BETA;
+    int depth = 4;
+};
+
+struct MatchResult {
+    int engine1Score = 0;   // 1 胜，0 和，-1 负
+    double engine1Millis = 0.0;
+    double engine2Millis = 0.0;
+    int engine1Moves = 0;
+    int engine2Moves = 0;
+};
+
+bool parseEngine(const std::string& text, AiEngineType& engine)
+{
+    if (text == "ab" || text == "alphabeta") {
+        engine = AI_ENGINE_ALPHA_BETA;
+        return true;
+    }
+    if (text == "mcts") {
+        engine = AI_ENGINE_MCTS;
+        return true;
+    }
+    return false;
+}
+
+std::unique_ptr<NineChess_AI_Engine> makeEngine(AiEngineType type, unsigned mctsThreads)
+{
+    std::unique_ptr<NineChess_AI_Engine> engine = createAiEngine(type);
+    if (type == AI_ENGINE_MCTS) {
+        static_cast<NineChess_AI_MCTS*>(engine.get())->setThreadCount(mctsThreads);
+    }
+    return engine;
+}
+
+MatchResult playMatchGame(uint32_t rule, const MatchSide& side1, const MatchSide& side2, bool engine1First,
+    uint32_t seed, int randomPlies, int maxPlies, unsigned mctsThreads)
+{
+    std::mt19937 rng(seed);
+    std::unique_ptr<NineChess_AI_Engine> engine1 = makeEngine(side1.engine, mctsThreads);
+    std::unique_ptr<NineChess_AI_Engine> engine2 = makeEngine(side2.engine, mctsThreads);
+
+    NineChess chess;
+    chess.setRule(rule);
+    chess.start();
+
+    MatchResult result;
+    std::vector<std::string> legal;
+    for (int ply = 0; ply < maxPlies && chess.getPhase() != NineChess::GAME_OVER; ++ply) {
+        std::string command;
+        if (ply < randomPlies) {
+            collectLegalCommands(chess, legal);
+            if (legal.empty()) {
+                break;
+            }
+            command = legal[std::uniform_int_distribution<size_t>(0, legal.size() - 1u)(rng)];
+        }
+        else {
+            const bool engine1Turn = (chess.getTurn() == NineChess::PLAYER1) == engine1First;
+            NineChess_AI_Engine& engine = engine1Turn ? *engine1 : *engine2;
+            const int depth = engine1Turn ? side1.depth : side2.depth;
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            engine.setChess(chess);
+            engine.setRemainingSteps(maxPlies - ply);
+            engine.think(depth);
+            command = engine.bestMove();
+            const double millis = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            if (engine1Turn) {
+                result.engine1Millis += millis;
+                ++result.engine1Moves;
+            }
+            else {
+                result.engine2Millis += millis;
+                ++result.engine2Moves;
+            }
+        }
+
+        if (!chess.command(command.c_str())) {
+            break;
+        }
+    }
+
+    const NineChess::Players engine1Player = engine1First ? NineChess::PLAYER1 : NineChess::PLAYER2;
+    const NineChess::Players engine2Player = engine1First ? NineChess::PLAYER2 : NineChess::PLAYER1;
+    if (chess.getWinner() == engine1Player) {
+        result.engine1Score = 1;
+    }
+    else if (chess.getWinner() == engine2Player) {
+        result.engine1Score = -1;
+    }
+    return result;
+}
+
+} // namespace
+
+int runMatchTool(const ToolArgs& args)
+{
+    MatchSide side1;
+    MatchSide side2;
+    if (!parseEngine(args.get("engine1", "ab"), side1.engine)
+        || !parseEngine(args.get("engine2", "mcts"), side2.engine)) {
+        std::cerr << "引擎只能是 ab 或 mcts。\n";
+        return 2;
+    }
+
+    const int rule = args.getInt("rule", 2);
+    if (rule < 0 || rule >= RULE_COUNT) {
+        std::cerr << "规则编号无效。\n";
+        return 2;
+    }
+
+    side1.depth = std::max(1, args.getInt("depth1", 4));
+    side2.depth = std::max(1, args.getInt("depth2", 4));
+    const int games = std::max(1, args.getInt("games", 20));
+    const int randomPlies = std::max(0, args.getInt("random", 2));
+    const int maxPlies = std::max(1, args.getInt("max-plies", 200));
+    const unsigned mctsThreads = static_cast<unsigned>(std::max(1, args.getInt("mcts-threads", 1)));
+    if (args.has("endgame") && !NineChess_AI_AB::loadEndgameDatabase(static_cast<uint32_t>(rule), args.get("endgame", ""))) {
+        std::cerr << "未能载入残局库，按无残局库对局。\n";
+    }
+    if (args.has("book") && !NineChess_AI_AB::loadOpeningBook(static_cast<uint32_t>(rule), args.get("book", ""))) {
+        std::cerr << "未能载入开局库，按无开局库对局。\n";
+    }
+    NineChess_AI_AB::setProofSearch(static_cast<uint64_t>(std::max(0, args.getInt("proof-nodes", 0))));
+    NineChess_AI_AB::setContempt(args.getInt("contempt", 0));
+    attachToolSharedTable(args, static_cast<uint32_t>(rule));
+    const std::string ttPath = args.get("tt", "");
+    if (!ttPath.empty() && NineChess_AI_AB::loadTranspositionTable(static_cast<uint32_t>(rule), ttPath)) {
+        std::cout << "已载入置换表快照 " << ttPath << "\n";
+    }
+
+    // 对局之间并行；MCTS 内部线程数单独由 --mcts-threads 控制。
+    // 相邻两局使用同一随机开局并交换先后手，抵消开局偏差。
+    std::vector<MatchResult> results(static_cast<size_t>(games));
+    parallelFor(results.size(), args.threadCount(), [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; ++i) {
+            results[i] = playMatchGame(static_cast<uint32_t>(rule), side1, side2, (i % 2u) == 0u,
+                static_cast<uint32_t>(i / 2u * 7919u + 17u), randomPlies, maxPlies, mctsThreads);
+        }
+    });
+
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+    MatchResult total;
+    for (const MatchResult& result : results) {
+        wins += result.engine1Score > 0 ? 1 : 0;
+        draws += result.engine1Score == 0 ? 1 : 0;
+        losses += result.engine1Score < 0 ? 1 : 0;
+        total.engine1Millis += result.engine1Millis;
+        total.engine2Millis += result.engine2Millis;
+        total.engine1Moves += result.engine1Moves;
+        total.engine2Moves += result.engine2Moves;
+    }
+
+    std::cout << "规则 " << rule << "，共 " << games << " 局\n"
+        << "引擎 1 (" << aiEngineName(side1.engine) << ", depth " << side1.depth << "): "
+        << wins << " 胜 " << draws << " 和 " << losses << " 负，平均每步 "
+        << (total.engine1Moves > 0 ? total.engine1Millis / total.engine1Moves : 0.0) << " ms\n"
+        << "引擎 2 (" << aiEngineName(side2.engine) << ", depth " << side2.depth << "): 平均每步 "
+        << (total.engine2Moves > 0 ? total.engine2Millis / total.engine2Moves : 0.0) << " ms\n";
+
+    if (!ttPath.empty() && !NineChess_AI_AB::saveTranspositionTable(static_cast<uint32_t>(rule), ttPath)) {
+        std::cerr << "无法写入置换表快照: " << ttPath << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+/****************************************************************************
+** NineChessTools - 神经网络训练样本导出
+**
+** nnue-dump 回放语料（格式同 tune），把每条命令之后的非终局局面写成定长记录，
+** 供外部训练脚本读取。网络训练本身不在本工具内完成，训练端按
+** ninechess_ai_nnue.h 中的量化约定导出 .nnue 权重文件即可被程序载入。
+**
+** 样本文件布局（小端）：
+**   文件头 8 字节：uint32 魔数 "NCTD"、uint32 版本 1
+**   每条记录 20 字节：
+**     uint32 先手位棋盘、后手位棋盘、禁点位棋盘、status
+**     int16  搜索估值（先手视角，--depth 为 0 时即静态估值）
+**     int8   终局结果（先手视角：1 胜、0 和、-1 负）
+**     uint8  规则编号
+****************************************************************************/
+
+#include "tools_common.h"
+
+#include "ninechess_ai_ab.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr uint32_t SAMPLE_FILE_MAGIC = 0x4454434eu;
+constexpr uint32_t SAMPLE_FILE_VERSION = 1u;
+constexpr size_t SAMPLE_RECORD_SIZE = 20u;
+
+void putU32(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<unsigned char>((value >> shift) & 0xffu));
+    }
+}
+
+void appendSample(std::vector<unsigned char>& out, const NineChess::ChessData& data, int score,
+    int result, uint32_t rule)
+{
+    putU32(out, data.player1Board & ChessData::VALID_BOARD_MASK);
+    putU32(out, data.player2Board & ChessData::VALID_BOARD_MASK);
+    putU32(out, data.forbiddenBoard & ChessData::VALID_BOARD_MASK);
+    putU32(out, data.status & ChessData::HASH_STATUS_MASK);
+    const uint16_t packedScore = static_cast<uint16_t>(static_cast<int16_t>(score));
+    out.push_back(static_cast<unsigned char>(packedScore & 0xffu));
+    out.push_back(static_cast<unsigned char>(packedScore >> 8));
+    out.push_back(static_cast<unsigned char>(static_cast<int8_t>(result)));
+    out.push_back(static_cast<unsigned char>(rule));
+}
+
+} // namespace
+
+int runNnueDumpTool(const ToolArgs& args)
+{
+    const std::string corpusPath = args.positionalAt(0);
+    const std::string outPath = args.positionalAt(1);
+    if (corpusPath.empty() || outPath.empty()) {
+        std::cerr << "nnue-dump 需要语料文件和样本文件路径。\n";
+        return 2;
+    }
+
+    std::vector<GameRecord> games;
+    if (!loadGameCorpus(corpusPath, games)) {
+        std::cerr << "无法读取语料文件: " << corpusPath << "\n";
+        return 1;
+    }
+
+    const unsigned threads = args.threadCount();
+    const int onlyRule = args.getInt("rule", -1);
+    const int depth = std::max(0, args.getInt("depth", 2));
+    const int skip = std::max(0, args.getInt("skip", 0));
+
+    // 每个线程写自己的缓冲，最后按线程顺序拼接，输出与线程数无关。
+    std::vector<std::vector<unsigned char>> buffers(threads);
+    parallelFor(games.size(), threads, [&](size_t begin, size_t end, unsigned t) {
+        NineChess_AI_AB ai;
+        for (size_t i = begin; i < end; ++i) {
+            const GameRecord& game = games[i];
+            if (onlyRule >= 0 && game.rule != static_cast<uint32_t>(onlyRule)) {
+                continue;
+            }
+
+            const int result = game.result > 0.75 ? 1 : (game.result < 0.25 ? -1 : 0);
+            NineChess chess;
+            chess.setRule(game.rule);
+            chess.start();
+            for (size_t ply = 0; ply < game.commands.size(); ++ply) {
+                if (!chess.command(game.commands[ply].c_str()) || chess.getPhase() == NineChess::GAME_OVER) {
+                    break;
+                }
+                if (ply < static_cast<size_t>(skip)) {
+                    continue;
+                }
+
+                ai.setChess(chess);
+                const int score = ai.alphaBetaPruning(depth);
+                appendSample(buffers[t], chess.getData(), score, result, game.rule);
+            }
+        }
+    });
+
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "无法写入样本文件: " << outPath << "\n";
+        return 1;
+    }
+
+    std::vector<unsigned char> header;
+    putU32(header, SAMPLE_FILE_MAGIC);
+    putU32(header, SAMPLE_FILE_VERSION);
+    out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+    size_t records = 0;
+    for (const std::vector<unsigned char>& buffer : buffers) {
+        out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        records += buffer.size() / SAMPLE_RECORD_SIZE;
+    }
+    if (!out) {
+        std::cerr << "写入样本文件失败: " << outPath << "\n";
+        return 1;
+    }
+
+    std::cout << "已导出 " << records << " 条样本: " << outPath << "\n";
+    return 0;
+}
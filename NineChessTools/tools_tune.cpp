@@ -0,0 +1,304 @@
+/****************************************************************************
+** NineChessTools - 估值权重调参
+**
+** 语料每行一局：
+**   <规则编号> <结果> <命令1> <命令2> ...
+** 结果为先手视角的 "1-0" / "0-1" / "1/2"，命令与 NineChess::command() 完全一致。
+** 以 # 开头的行视为注释。
+**
+** tune 会回放每一局，把每条命令之后的局面连同终局结果作为一个样本，
+** 再按规则做 Texel 式拟合：先拟合 sigmoid 的缩放系数，
+** 然后固定缩放、对估值线性项做 logistic 损失的梯度下降。
+****************************************************************************/
+
+#include "tools_common.h"
+
+#include "ninechess_ai_ab.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+struct TuneSample {
+    EvalFeatures features;
+    float result = 0.5f;
+};
+
+double sigmoid(double x)
+{
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+// 在 scale 缩放下，用当前权重计算平均 logistic 损失；gradient 非空时同时累加梯度。
+double evaluateLoss(const std::vector<TuneSample>& samples, const std::array<double, EVAL_TERM_COUNT>& weights,
+    double scale, unsigned threads, std::array<double, EVAL_TERM_COUNT>* gradient)
+{
+    std::vector<double> losses(threads, 0.0);
+    std::vector<std::array<double, EVAL_TERM_COUNT>> gradients(threads);
+    for (std::array<double, EVAL_TERM_COUNT>& g : gradients) {
+        g.fill(0.0);
+    }
+
+    parallelFor(samples.size(), threads, [&](size_t begin, size_t end, unsigned t) {
+        double loss = 0.0;
+        std::array<double, EVAL_TERM_COUNT>& g = gradients[t];
+        for (size_t i = begin; i < end; ++i) {
+            const TuneSample& sample = samples[i];
+            double score = 0.0;
+            for (uint32_t k = 0; k < EVAL_TERM_COUNT; ++k) {
+                score += weights[k] * sample.features.values[k];
+            }
+
+            const double p = std::min(1.0 - 1e-9, std::max(1e-9, sigmoid(scale * score)));
+            const double y = sample.result;
+            loss -= y * std::log(p) + (1.0 - y) * std::log(1.0 - p);
+            if (gradient != nullptr) {
+                const double delta = (p - y) * scale;
+                for (uint32_t k = 0; k < EVAL_TERM_COUNT; ++k) {
+                    g[k] += delta * sample.features.values[k];
+                }
+            }
+        }
+        losses[t] = loss;
+    });
+
+    double total = 0.0;
+    for (unsigned t = 0; t < threads; ++t) {
+        total += losses[t];
+    }
+    if (gradient != nullptr) {
+        gradient->fill(0.0);
+        for (unsigned t = 0; t < threads; ++t) {
+            for (uint32_t k = 0; k < EVAL_TERM_COUNT; ++k) {
+                (*gradient)[k] += gradients[t][k] / static_cast<double>(samples.size());
+            }
+        }
+    }
+    return total / static_cast<double>(samples.size());
+}
+
+// 固定权重，在对数尺度上做黄金分割搜索，找到让损失最小的 sigmoid 缩放。
+double fitScale(const std::vector<TuneSample>& samples, const std::array<double, EVAL_TERM_COUNT>& weights,
+    unsigned threads)
+{
+    const double ratio = 0.6180339887498949;
+    double lo = std::log(1e-5);
+    double hi = std::log(1e-1);
+    for (int i = 0; i < 40; ++i) {
+        const double a = hi - ratio * (hi - lo);
+        const double b = lo + ratio * (hi - lo);
+        if (evaluateLoss(samples, weights, std::exp(a), threads, nullptr)
+            < evaluateLoss(samples, weights, std::exp(b), threads, nullptr)) {
+            hi = b;
+        }
+        else {
+            lo = a;
+        }
+    }
+    return std::exp(0.5 * (lo + hi));
+}
+
+void tuneRule(uint32_t rule, const std::vector<TuneSample>& samples, EvalWeights& weights,
+    int iterations, unsigned threads)
+{
+    std::array<double, EVAL_TERM_COUNT> w = {};
+    for (uint32_t k = 0; k < EVAL_TERM_COUNT; ++k) {
+        w[k] = weights.values[k];
+    }
+
+    const double scale = fitScale(samples, w, threads);
+    const double before = evaluateLoss(samples, w, scale, threads, nullptr);
+
+    // Adam：各项特征的量级差别很大（子数差 vs. 机动性差），自适应步长更稳。
+    const double learningRate = 2.0;
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    std::array<double, EVAL_TERM_COUNT> m = {};
+    std::array<double, EVAL_TERM_COUNT> v = {};
+    std::array<double, EVAL_TERM_COUNT> gradient = {};
+    double loss = before;
+    for (int step = 1; step <= iterations; ++step) {
+        loss = evaluateLoss(samples, w, scale, threads, &gradient);
+        for (uint32_t k = 0; k < EVAL_TERM_COUNT; ++k) {
+            m[k] = beta1 * m[k] + (1.0 - beta1) * gradient[k];
+            v[k] = beta2 * v[k] + (1.0 - beta2) * gradient[k] * gradient[k];
+            const double mHat = m[k] / (1.0 - std::pow(beta1, step));
+            const double vHat = v[k] / (1.0 - std::pow(beta2, step));
+            w[k] -= learningRate * mHat / (std::sqrt(vHat) + 1e-12);
+        }
+    }
+
+    for (uint32_t k = 0; k < EVAL_TERM_COUNT; ++k) {
+        weights.values[k] = static_cast<int32_t>(std::lround(w[k]));
+    }
+
+    std::cout << "规则 " << rule << ": 样本 " << samples.size()
+        << "  缩放 " << scale
+        << "  损失 " << before << " -> " << loss << "\n";
+    for (uint32_t k = 0; k < EVAL_TERM_COUNT; ++k) {
+        std::cout << "  " << evalParamName(static_cast<EvalParam>(k)) << " = " << weights.values[k] << "\n";
+    }
+}
+
+std::string playSelfplayGame(uint32_t rule, uint32_t seed, int depth, int randomPlies, int maxPlies)
+{
+    std::mt19937 rng(seed);
+    NineChess chess;
+    chess.setRule(rule);
+    chess.start();
+
+    NineChess_AI_AB ai;
+    std::vector<std::string> legal;
+    int ply = 0;
+    for (; ply < maxPlies && chess.getPhase() != NineChess::GAME_OVER; ++ply) {
+        std::string command;
+        if (ply < randomPlies) {
+            collectLegalCommands(chess, legal);
+            if (legal.empty()) {
+                break;
+            }
+            command = legal[std::uniform_int_distribution<size_t>(0, legal.size() - 1u)(rng)];
+        }
+        else {
+            ai.setChess(chess);
+            ai.alphaBetaPruning(depth);
+            command = ai.bestMove();
+        }
+
+        if (!chess.command(command.c_str())) {
+            break;
+        }
+    }
+
+    std::ostringstream out;
+    out << rule << " " << formatGameResult(chess.getWinner());
+    for (const std::string& command : chess.getCmdHistory()) {
+        out << " " << command;
+    }
+    return out.str();
+}
+
+} // namespace
+
+int runSelfplayTool(const ToolArgs& args)
+{
+    const std::string outPath = args.positionalAt(0);
+    if (outPath.empty()) {
+        std::cerr << "selfplay 需要输出语料文件路径。\n";
+        return 2;
+    }
+
+    const int rule = args.getInt("rule", 2);
+    const int games = std::max(1, args.getInt("games", 100));
+    const int depth = std::max(1, args.getInt("depth", 3));
+    const int randomPlies = std::max(0, args.getInt("random", 4));
+    const int maxPlies = std::max(1, args.getInt("max-plies", 200));
+    if (rule < 0 || rule >= RULE_COUNT) {
+        std::cerr << "规则编号无效。\n";
+        return 2;
+    }
+    attachToolSharedTable(args, static_cast<uint32_t>(rule));
+
+    std::vector<std::string> lines(static_cast<size_t>(games));
+    std::atomic<size_t> finished(0);
+    parallelFor(lines.size(), args.threadCount(), [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; ++i) {
+            lines[i] = playSelfplayGame(static_cast<uint32_t>(rule), static_cast<uint32_t>(i * 7919u + 17u),
+                depth, randomPlies, maxPlies);
+            ++finished;
+        }
+    });
+
+    std::ofstream out(outPath, std::ios::trunc);
+    if (!out) {
+        std::cerr << "无法写入语料文件: " << outPath << "\n";
+        return 1;
+    }
+    for (const std::string& line : lines) {
+        out << line << "\n";
+    }
+    std::cout << "已生成 " << finished.load() << " 局自对弈语料: " << outPath << "\n";
+    return 0;
+}
+
+int runTuneTool(const ToolArgs& args)
+{
+    const std::string corpusPath = args.positionalAt(0);
+    if (corpusPath.empty()) {
+        std::cerr << "tune 需要语料文件路径。\n";
+        return 2;
+    }
+
+    EvalWeightTable table = {};
+    const std::string initPath = args.get("init", std::string());
+    if (!initPath.empty() && !loadEvalWeightTable(initPath, table)) {
+        std::cerr << "无法读取初始权重文件: " << initPath << "\n";
+        return 1;
+    }
+
+    std::vector<GameRecord> games;
+    if (!loadGameCorpus(corpusPath, games)) {
+        std::cerr << "无法读取语料文件: " << corpusPath << "\n";
+        return 1;
+    }
+
+    const unsigned threads = args.threadCount();
+    const int onlyRule = args.getInt("rule", -1);
+    const int skip = std::max(0, args.getInt("skip", 0));
+
+    // 并行回放语料，每个线程各用一个 AI 实例抽取特征。
+    std::vector<std::array<std::vector<TuneSample>, RULE_COUNT>> perThread(threads);
+    parallelFor(games.size(), threads, [&](size_t begin, size_t end, unsigned t) {
+        NineChess_AI_AB ai;
+        for (size_t i = begin; i < end; ++i) {
+            const GameRecord& game = games[i];
+            if (onlyRule >= 0 && game.rule != static_cast<uint32_t>(onlyRule)) {
+                continue;
+            }
+
+            NineChess chess;
+            chess.setRule(game.rule);
+            chess.start();
+            for (size_t ply = 0; ply < game.commands.size(); ++ply) {
+                if (!chess.command(game.commands[ply].c_str()) || chess.getPhase() == NineChess::GAME_OVER) {
+                    break;
+                }
+                if (ply < static_cast<size_t>(skip)) {
+                    continue;
+                }
+
+                TuneSample sample;
+                ai.setChess(chess);
+                ai.evaluationFeatures(sample.features);
+                sample.result = static_cast<float>(game.result);
+                perThread[t][game.rule].push_back(sample);
+            }
+        }
+    });
+
+    const int iterations = std::max(1, args.getInt("iterations", 500));
+    for (uint32_t rule = 0; rule < RULE_COUNT; ++rule) {
+        std::vector<TuneSample> samples;
+        for (unsigned t = 0; t < threads; ++t) {
+            samples.insert(samples.end(), perThread[t][rule].begin(), perThread[t][rule].end());
+        }
+        if (samples.empty()) {
+            continue;
+        }
+        tuneRule(rule, samples, table[rule], iterations, threads);
+    }
+
+    const std::string outPath = args.get("out", "ninechess_weights.txt");
+    if (!saveEvalWeightTable(outPath, table)) {
+        std::cerr << "无法写入权重文件: " << outPath << "\n";
+        return 1;
+    }
+    std::cout << "权重已写入: " << outPath << "\n";
+    return 0;
+}
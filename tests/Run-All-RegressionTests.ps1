@@ -4,7 +4,8 @@ Set-StrictMode -Version Latest
 $scriptRoot = Split-Path -Parent $MyInvocation.MyCommand.Path
 $scripts = @(
     "Run-All-RuleTests.ps1",
-    "Run-ConsoleBlackBoxTests.ps1"
+    "Run-ConsoleBlackBoxTests.ps1",
+    "Run-PerftTests.ps1"
 )
 
 $passed = 0
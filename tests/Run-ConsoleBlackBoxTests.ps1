@@ -236,6 +236,24 @@ $cases += New-Case `
         (U "6Zi25q61OiDlvIDlsYAgIOWKqOS9nDog6JC95a2QICDlvZPliY3ova7mrKE6IOWFiOaJiw==")
     )
 
+$cases += New-Case `
+    -Name "solve_proves_forced_win" `
+    -Arguments @("0") `
+    -Commands @(
+        "(0,2)", "(1,0)", "(0,1)", "(1,2)", "(2,2)", "(0,0)", "(0,4)", "(1,6)",
+        "(1,3)", "(1,4)", "(2,5)", "(1,1)", "(2,6)", "(1,7)", "-(2,5)", "(0,3)",
+        "-(1,6)", "(2,1)", "(0,5)", "-(1,2)", "(0,6)", "(0,2)->(1,2)", "(1,4)->(2,4)", "(0,3)->(0,2)",
+        "-(2,4)", "(0,6)->(1,6)", "(2,6)->(2,7)", "(1,6)->(2,6)", "(0,2)->(0,3)", "-(2,1)", "(1,0)->(2,0)", "(1,3)->(1,4)",
+        "(1,7)->(1,0)", "-(2,7)", "(0,1)->(0,2)", "-(2,6)", "(0,0)->(0,1)", "(2,2)->(2,1)", "(2,0)->(2,7)", "solve 5",
+        "quit"
+    ) `
+    -Contains @(
+        (U "5bey6K+B5piOOiDnjqnlrrYx5b+F6IOc77yM5Y+W6IOc552A5rOVIA==")
+    ) `
+    -NotContains @(
+        (U "5pyq6IO95Zyo6ZmQ5a6a5pe26Ze05YaF6Kej5Ye644CC")
+    )
+
 $casePassed = 0
 $caseFailed = 0
 $checks = 0
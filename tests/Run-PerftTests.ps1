@@ -0,0 +1,39 @@
+$ErrorActionPreference = "Stop"
+Set-StrictMode -Version Latest
+
+function Get-MSBuildPath {
+    $candidates = @(
+        "C:\Program Files\Microsoft Visual Studio\2022\Community\MSBuild\Current\Bin\amd64\MSBuild.exe",
+        "C:\Program Files\Microsoft Visual Studio\2022\BuildTools\MSBuild\Current\Bin\amd64\MSBuild.exe",
+        "C:\Program Files (x86)\Microsoft Visual Studio\2019\Community\MSBuild\Current\Bin\amd64\MSBuild.exe",
+        "C:\Program Files (x86)\Microsoft Visual Studio\2019\BuildTools\MSBuild\Current\Bin\amd64\MSBuild.exe"
+    )
+
+    foreach ($candidate in $candidates) {
+        if (Test-Path $candidate) {
+            return $candidate
+        }
+    }
+
+    throw "MSBuild.exe was not found."
+}
+
+$scriptRoot = Split-Path -Parent $MyInvocation.MyCommand.Path
+$projectDir = Join-Path (Split-Path -Parent $scriptRoot) "NineChessPerft"
+$projectPath = Join-Path $projectDir "NineChessPerft.vcxproj"
+$exePath = Join-Path $projectDir "bin\x64\Release\NineChessPerft.exe"
+$msbuildPath = Get-MSBuildPath
+
+Write-Host "== Build NineChessPerft =="
+& $msbuildPath $projectPath /t:Build /p:Configuration=Release /p:Platform=x64 /nologo
+if ($LASTEXITCODE -ne 0) {
+    exit $LASTEXITCODE
+}
+
+if (-not (Test-Path $exePath)) {
+    throw ("NineChessPerft executable was not found: {0}" -f $exePath)
+}
+
+Write-Host "== Run perft reference check =="
+& $exePath --check
+exit $LASTEXITCODE
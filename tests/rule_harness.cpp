@@ -1,10 +1,17 @@
 #include "ninechess.h"
+#include "ninechess_ai_ab.h"
+#include "ninechess_ai_nnue.h"
+#include "ninechess_batch.h"
+#include "ninechess_solver.h"
 
 #include <cstdint>
+#include <cstdio>
 #include <exception>
+#include <fstream>
 #include <functional>
 #include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -142,6 +149,26 @@ struct CaseContext {
     }
 };
 
+// 规则 1 的标准开局：先手在顶边连成三，第二个后手子落在 secondPoint。
+void playRule1Mill(CaseContext& t, NineChess& chess, const std::string& secondPoint)
+{
+    chess.setRule(1);
+    chess.start();
+
+    t.expectCommand(chess, "(0,7)", true, "player1 places first point");
+    t.expectCommand(chess, "(0,2)", true, "player2 places first point");
+    t.expectCommand(chess, "(0,0)", true, "player1 extends top line");
+    t.expectCommand(chess, secondPoint, true, "player2 places second point");
+    t.expectCommand(chess, "(0,1)", true, "player1 completes a mill");
+}
+
+// 在 playRule1Mill 之后提掉 (0,2)，留下一个禁点。
+void playRule1MillAndCapture(CaseContext& t, NineChess& chess, const std::string& secondPoint)
+{
+    playRule1Mill(t, chess, secondPoint);
+    t.expectCommand(chess, "-(0,2)", true, "capture leaves a forbidden point");
+}
+
 struct Harness {
     int cases = 0;
     int failedCases = 0;
@@ -173,6 +200,180 @@ struct Harness {
     }
 };
 
+// 随机局面逐项对照：批量内核在每个 SIMD 级别下都要与逐局面的计算结果一致。
+void checkPositionBatch(CaseContext& t, const uint32_t rule)
+{
+    const Rule& ruleInfo = NineChess::rules[rule];
+    const RuleTables& tables = NineChess::ruleTables(rule);
+
+    // 数量故意不是 16 的倍数，覆盖 SIMD 主循环之后的标量尾部。
+    PositionBatch batch(rule);
+    std::vector<NineChess::ChessData> positions;
+    uint32_t seed = 0x9e3779b9u + rule;
+    const auto nextRandom = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+    for (int i = 0; i < 203; ++i) {
+        NineChess::ChessData data;
+        uint32_t free = ChessData::VALID_BOARD_MASK;
+        const auto takePieces = [&](const uint32_t count) {
+            uint32_t board = 0u;
+            for (uint32_t n = 0; n < count && free != 0u; ++n) {
+                uint32_t bits = free;
+                for (uint32_t skip = nextRandom() % POPCOUNT32(free); skip > 0u; --skip) {
+                    bits &= bits - 1u;
+                }
+                board |= bits & (0u - bits);
+                free &= ~(bits & (0u - bits));
+            }
+            return board;
+        };
+        data.player1Board = takePieces(nextRandom() % (ruleInfo.piecesPerSide + 1u));
+        data.player2Board = takePieces(nextRandom() % (ruleInfo.piecesPerSide + 1u));
+        data.forbiddenBoard = ruleInfo.hasForbiddenPoints ? takePieces(nextRandom() % 4u) : 0u;
+        data.setPlayer2InHand(nextRandom() % (ruleInfo.piecesPerSide + 1u));
+        data.setState((nextRandom() & 1u) != 0u ? NineChess::GAME_MID : NineChess::GAME_OPENING,
+            (nextRandom() & 1u) != 0u ? NineChess::ACTION_CHOOSE : NineChess::ACTION_CAPTURE,
+            (nextRandom() & 1u) != 0u ? NineChess::PLAYER1 : NineChess::PLAYER2);
+        batch.push(data);
+        positions.push_back(data);
+    }
+    t.expect(batch.size() == positions.size() && reinterpret_cast<uintptr_t>(batch.player1Boards()) % 64u == 0u
+        && reinterpret_cast<uintptr_t>(batch.statuses()) % 64u == 0u, "batch keeps every position in aligned arrays");
+
+    const BatchSimd savedSimd = PositionBatch::activeSimd();
+    for (const BatchSimd simd : { BATCH_SIMD_SCALAR, BATCH_SIMD_AVX2, BATCH_SIMD_AVX512 }) {
+        PositionBatch::setSimd(simd);
+        std::vector<uint64_t> hashes(batch.size());
+        std::vector<uint64_t> canonical(batch.size());
+        std::vector<uint8_t> symmetries(batch.size());
+        std::vector<uint32_t> player1Values(batch.size());
+        std::vector<uint32_t> player2Values(batch.size());
+
+        bool hashSame = true;
+        bool canonicalSame = true;
+        batch.hashLite(hashes.data());
+        batch.canonicalHashLite(canonical.data(), symmetries.data());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            NineChess chess;
+            chess.setRule(rule);
+            batch.load(i, chess.getData());
+            uint32_t symmetry = 0u;
+            hashSame = hashSame && hashes[i] == positions[i].getHashLite();
+            canonicalSame = canonicalSame && canonical[i] == chess.getCanonicalHash(&symmetry) && symmetries[i] == symmetry;
+        }
+        t.expect(hashSame, "batch lite hashes match ChessData");
+        t.expect(canonicalSame, "batch canonical hashes and symmetries match Position");
+
+        bool piecesSame = true;
+        batch.countPieces(player1Values.data(), player2Values.data());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            piecesSame = piecesSame && player1Values[i] == positions[i].getPlayer1OnBoardCount()
+                && player2Values[i] == positions[i].getPlayer2OnBoardCount();
+        }
+        t.expect(piecesSame, "batch piece counts match ChessData");
+
+        bool millsSame = true;
+        batch.countMills(player1Values.data(), player2Values.data());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            uint32_t player1Mills = 0u;
+            uint32_t player2Mills = 0u;
+            for (uint32_t lineId = 0; lineId < tables.lineCount; ++lineId) {
+                const uint32_t mask = tables.lineMasks[lineId];
+                player1Mills += (positions[i].player1Board & mask) == mask ? 1u : 0u;
+                player2Mills += (positions[i].player2Board & mask) == mask ? 1u : 0u;
+            }
+            millsSame = millsSame && player1Values[i] == player1Mills && player2Values[i] == player2Mills;
+        }
+        t.expect(millsSame, "batch mill counts match the line table");
+
+        bool mobilitySame = true;
+        batch.countMobility(player1Values.data(), player2Values.data());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            const NineChess::ChessData& data = positions[i];
+            const uint32_t empty = ~(data.player1Board | data.player2Board | data.forbiddenBoard) & ChessData::VALID_BOARD_MASK;
+            uint32_t expected[2] = { 0u, 0u };
+            const uint32_t boards[2] = { data.player1Board, data.player2Board };
+            for (int side = 0; side < 2 && data.getPhase() == NineChess::GAME_MID; ++side) {
+                if (ruleInfo.allowFlying && POPCOUNT32(boards[side]) <= ruleInfo.minPiecesToSurvive) {
+                    expected[side] = POPCOUNT32(boards[side]) * POPCOUNT32(empty);
+                    continue;
+                }
+                for (int pos = 0; pos < BOARD_SIZE; ++pos) {
+                    if ((boards[side] & bitOf(pos)) != 0u) {
+                        expected[side] += POPCOUNT32(tables.moveMask[pos] & empty);
+                    }
+                }
+            }
+            mobilitySame = mobilitySame && player1Values[i] == expected[0] && player2Values[i] == expected[1];
+        }
+        t.expect(mobilitySame, "batch mobility matches the adjacency table");
+    }
+    PositionBatch::setSimd(savedSimd);
+}
+
+// 写出一份按固定种子生成的小权重网络，布局与 NnueNetwork::load() 一致。
+bool writeTestNetwork(const std::string& path)
+{
+    std::ofstream out(path, std::ios::binary);
+    uint32_t seed = 0x2545f491u;
+    const auto nextSmall = [&seed](const int range) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return static_cast<int>(seed % static_cast<uint32_t>(range * 2 + 1)) - range;
+    };
+    const auto writeLE = [&out](const uint32_t value, const int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out.put(static_cast<char>((value >> (8 * i)) & 0xffu));
+        }
+    };
+
+    for (const uint32_t value : { NNUE_FILE_MAGIC, NNUE_FILE_VERSION, NNUE_INPUT_COUNT, NNUE_L1_SIZE, NNUE_L2_SIZE }) {
+        writeLE(value, 4);
+    }
+    for (uint32_t i = 0; i < (NNUE_INPUT_COUNT + 1u) * NNUE_L1_SIZE; ++i) {
+        writeLE(static_cast<uint32_t>(nextSmall(40)), 2);
+    }
+    for (uint32_t i = 0; i < NNUE_L2_SIZE * NNUE_L1_SIZE; ++i) {
+        writeLE(static_cast<uint32_t>(nextSmall(60)), 1);
+    }
+    for (uint32_t i = 0; i < NNUE_L2_SIZE; ++i) {
+        writeLE(static_cast<uint32_t>(nextSmall(500)), 4);
+    }
+    for (uint32_t i = 0; i < NNUE_L2_SIZE; ++i) {
+        writeLE(static_cast<uint32_t>(nextSmall(60)), 1);
+    }
+    writeLE(static_cast<uint32_t>(nextSmall(500)), 4);
+    return static_cast<bool>(out);
+}
+
+std::string readFileBytes(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+bool writeFileBytes(const std::string& path, const std::string& bytes)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(out);
+}
+
+bool sameAccumulator(const NnueAccumulator& lhs, const NnueAccumulator& rhs)
+{
+    for (uint32_t i = 0; i < NNUE_L1_SIZE; ++i) {
+        if (lhs.values[i] != rhs.values[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void runRule0(Harness& harness)
 {
     harness.runCase("rule0_opening_capture_and_reuse_allowed", [](CaseContext& t) {
@@ -201,6 +402,71 @@ void runRule0(Harness& harness)
         t.expect(chess.getWhosPiece(0, 2) == NineChess::PLAYER2, "player2 piece is back on the captured point");
     });
 
+    harness.runCase("rule0_move_text_parses_in_one_pass", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(0);
+        const int from = posOf(chess, 0, 7);
+        const int to = posOf(chess, 1, 7);
+
+        NineChess::MoveRecord record = MOVE_RECORD_NONE;
+        t.expect(NineChess::parseMoveText(" ( 0 , 7 ) ->( 1,7 ) ", record)
+            && record == makeMoveRecord(MOVE_RECORD_MOVE, from, to), "move text allows spaces around tokens");
+        t.expect(NineChess::parseMoveText("-(1,7)", record) && record == makeMoveRecord(MOVE_RECORD_CAPTURE, 0, to),
+            "capture text parses");
+        t.expect(NineChess::parseMoveText("-1", record) && record == makeMoveRecord(MOVE_RECORD_GIVEUP_PLAYER2),
+            "giveup text parses");
+        t.expect(NineChess::parseMoveText("Resign", record, NineChess::PLAYER1)
+            && record == makeMoveRecord(MOVE_RECORD_GIVEUP_PLAYER1), "resign keyword uses the given turn");
+        t.expect(!NineChess::parseMoveText("resign", record), "resign keyword needs a turn");
+
+        const char buffer[] = "(0,7)(0,0)";
+        t.expect(NineChess::parseMoveText(TextView(buffer, 5), record)
+            && record == makeMoveRecord(MOVE_RECORD_POINT, 0, from), "text view need not end with a terminator");
+
+        size_t column = 0;
+        t.expect(!NineChess::parseMoveText("(0,7)->(1,7", record, NineChess::NOBODY, &column) && column == 11u
+            && record == MOVE_RECORD_NONE, "truncated move reports the end column");
+        t.expect(!NineChess::parseMoveText("  (0,7) -> (5,1)", record, NineChess::NOBODY, &column) && column == 11u,
+            "invalid point reports its opening bracket");
+        t.expect(!NineChess::parseMoveText("(0,99999999999)", record, NineChess::NOBODY, &column) && column == 0u,
+            "oversized coordinate is rejected without overflow");
+    });
+
+    harness.runCase("rule0_undo_redo_and_seek", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(0);
+        chess.start();
+        const uint64_t startHash = chess.getHash();
+
+        t.expectCommand(chess, "(0,7)", true, "player1 places first point");
+        t.expectCommand(chess, "(0,2)", true, "player2 places first point");
+        const uint64_t twoPlyHash = chess.getHash();
+        t.expectCommand(chess, "(0,0)", true, "player1 extends top line");
+        t.expectCommand(chess, "(0,3)", true, "player2 places second point");
+        t.expectCommand(chess, "(0,1)", true, "player1 completes a mill");
+        t.expectCommand(chess, "-(0,2)", true, "capture succeeds");
+        const uint64_t endHash = chess.getHash();
+        const std::string endTip = chess.getTip();
+
+        t.expect(chess.undo(), "undo takes back the capture");
+        t.expect(chess.getAction() == NineChess::ACTION_CAPTURE && chess.getWhosPiece(0, 2) == NineChess::PLAYER2,
+            "undo restores the captured piece and the capture action");
+        t.expect(chess.getHistorySize() == 5u && chess.getRedoSize() == 1u, "undo moves one record to redo");
+
+        t.expect(chess.seek(2u), "seek back to ply 2");
+        t.expect(chess.getHash() == twoPlyHash, "seek back reaches the ply 2 position");
+        t.expect(chess.seek(0u) && chess.getHash() == startHash, "seek to ply 0 reaches the start position");
+        t.expect(!chess.undo(), "nothing left to undo at ply 0");
+
+        t.expect(chess.seek(6u), "seek forward to the last ply");
+        t.expect(chess.getHash() == endHash && chess.getTip() == endTip, "seek forward restores the final position");
+        t.expect(!chess.redo(), "nothing left to redo at the last ply");
+
+        t.expect(chess.undo() && chess.undo(), "undo back to the mill placement");
+        t.expectCommand(chess, "(0,4)", true, "player1 plays a different point");
+        t.expect(chess.getRedoSize() == 0u, "a different command drops the redo records");
+    });
+
     harness.runCase("rule0_double_mill_only_one_capture", [](CaseContext& t) {
         NineChess chess;
         chess.setRule(0);
@@ -225,6 +491,26 @@ void runRule0(Harness& harness)
         t.expectCommand(chess, "-(2,2)", false, "second capture must be rejected in rule0");
     });
 
+    harness.runCase("rule0_mill_board_limits_capture_targets", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(0);
+        const std::vector<int> player2Mill = { posOf(chess, 0, 7), posOf(chess, 0, 0), posOf(chess, 0, 1) };
+        setupOpeningCapture(chess, NineChess::PLAYER1, 4u,
+            toVector({ posOf(chess, 1, 7), posOf(chess, 1, 0), posOf(chess, 1, 1), posOf(chess, 2, 4) }),
+            toVector({ posOf(chess, 0, 7), posOf(chess, 0, 0), posOf(chess, 0, 1), posOf(chess, 0, 4) }));
+
+        t.expect(chess.millBoard(NineChess::PLAYER2) == maskOf(player2Mill), "mill board covers exactly the player2 mill");
+        t.expect(chess.millBoard(NineChess::PLAYER1) == maskOf(toVector({ posOf(chess, 1, 7), posOf(chess, 1, 0), posOf(chess, 1, 1) })),
+            "mill board covers exactly the player1 mill");
+        t.expect(!chess.canCapturePos(posOf(chess, 0, 0)), "piece inside a mill cannot be captured while a free piece exists");
+        t.expect(chess.canCapturePos(posOf(chess, 0, 4)), "piece outside any mill can be captured");
+
+        t.expectCommand(chess, "-(0,4)", true, "capture the only free piece");
+        chess.getData().setPendingCaptures(1u);
+        chess.getData().setState(NineChess::GAME_OPENING, NineChess::ACTION_CAPTURE, NineChess::PLAYER1);
+        t.expect(chess.canCapturePos(posOf(chess, 0, 0)), "mill piece becomes capturable once every piece is in a mill");
+    });
+
     harness.runCase("rule0_three_pieces_cannot_fly", [](CaseContext& t) {
         NineChess chess;
         chess.setRule(0);
@@ -252,21 +538,38 @@ void runRule0(Harness& harness)
         t.expect(chess.getPhase() == NineChess::GAME_OVER, "game ends when next player is blocked");
         t.expect(chess.getWinner() == NineChess::PLAYER1, "player1 wins because player2 is blocked");
     });
+
+    harness.runCase("rule0_transposition_snapshot_rejects_bad_counts", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(0);
+        chess.start();
+        NineChess_AI_AB ai;
+        ai.setChess(chess);
+        ai.alphaBetaPruning(3);
+
+        const std::string path = "rule_harness_test.tt";
+        t.expect(NineChess_AI_AB::saveTranspositionTable(0u, path), "searched table saves a snapshot");
+        const std::string bytes = readFileBytes(path);
+        t.expect(bytes.size() > 32u && NineChess_AI_AB::loadTranspositionTable(0u, path), "saved snapshot loads back");
+        t.expect(!NineChess_AI_AB::loadTranspositionTable(1u, path), "snapshot of another rule is rejected");
+
+        // 条目数第 60 位置 1 后乘以 16 字节正好回绕，长度检查必须先限制条目数。
+        std::string oversized = bytes;
+        oversized[24 + 7] = static_cast<char>(oversized[24 + 7] | 0x10);
+        t.expect(writeFileBytes(path, oversized) && !NineChess_AI_AB::loadTranspositionTable(0u, path),
+            "count that wraps the size check is rejected");
+
+        t.expect(writeFileBytes(path, bytes.substr(0, bytes.size() - 1u)) && !NineChess_AI_AB::loadTranspositionTable(0u, path),
+            "truncated snapshot is rejected");
+        std::remove(path.c_str());
+    });
 }
 
 void runRule1(Harness& harness)
 {
     harness.runCase("rule1_forbidden_point_blocks_reuse", [](CaseContext& t) {
         NineChess chess;
-        chess.setRule(1);
-        chess.start();
-
-        t.expectCommand(chess, "(0,7)", true, "player1 places first point");
-        t.expectCommand(chess, "(0,2)", true, "player2 places first point");
-        t.expectCommand(chess, "(0,0)", true, "player1 extends top line");
-        t.expectCommand(chess, "(0,3)", true, "player2 places second point");
-        t.expectCommand(chess, "(0,1)", true, "player1 completes a mill");
-        t.expectCommand(chess, "-(0,2)", true, "capture succeeds");
+        playRule1MillAndCapture(t, chess, "(0,3)");
 
         const int forbiddenPos = posOf(chess, 0, 2);
         t.expect((chess.getData().forbiddenBoard & bitOf(forbiddenPos)) != 0u,
@@ -275,6 +578,252 @@ void runRule1(Harness& harness)
         t.expect(chess.getWhosPiece(0, 2) == NineChess::NOBODY, "forbidden point stays empty");
     });
 
+    harness.runCase("rule1_legal_moves_skip_forbidden_points", [](CaseContext& t) {
+        NineChess chess;
+        playRule1Mill(t, chess, "(0,3)");
+
+        MoveBuffer buffer;
+        chess.generateLegal(buffer);
+        t.expect(chess.legalCaptures() == maskOf(toVector({ posOf(chess, 0, 2), posOf(chess, 0, 3) }))
+            && buffer.count == 2u && getMoveRecordType(buffer.moves[0]) == MOVE_RECORD_CAPTURE,
+            "both player2 pieces can be captured");
+        t.expect(chess.legalTargets() == 0u && chess.legalSources() == 0u, "capture action has no placements");
+
+        t.expectCommand(chess, "-(0,2)", true, "capture leaves a forbidden point");
+        chess.generateLegal(buffer);
+        t.expect((chess.legalTargets() & bitOf(posOf(chess, 0, 2))) == 0u, "forbidden point is not a target");
+        t.expect(buffer.count == 19u && getMoveRecordType(buffer.moves[0]) == MOVE_RECORD_POINT,
+            "placements cover every other empty point");
+    });
+
+    harness.runCase("rule1_nnue_incremental_update_matches_refresh", [](CaseContext& t) {
+        const std::string path = "rule_harness_test.nnue";
+        NnueNetwork network;
+        t.expect(writeTestNetwork(path) && network.load(path), "test network loads");
+        std::remove(path.c_str());
+
+        NineChess chess;
+        chess.setRule(1);
+        chess.start();
+        NnueAccumulator incremental;
+        network.refresh(chess.getData(), incremental);
+
+        bool updateSame = true;
+        bool simdSame = true;
+        const NnueSimd savedSimd = NnueNetwork::activeSimd();
+        for (const char* command : { "(0,7)", "(0,2)", "(0,0)", "(1,3)", "(0,1)", "-(0,2)", "(2,5)", "(1,4)" }) {
+            const NineChess::ChessData before = chess.getData();
+            t.expectCommand(chess, command, true, "scripted command is legal");
+            NnueAccumulator child;
+            network.update(incremental, before, chess.getData(), child);
+            incremental = child;
+
+            NnueAccumulator refreshed;
+            network.refresh(chess.getData(), refreshed);
+            updateSame = updateSame && sameAccumulator(incremental, refreshed);
+
+            NnueNetwork::setSimd(NNUE_SIMD_SCALAR);
+            const int scalar = network.evaluate(refreshed);
+            for (const NnueSimd simd : { NNUE_SIMD_SSE2, NNUE_SIMD_AVX2 }) {
+                NnueNetwork::setSimd(simd);
+                NnueAccumulator simdRefreshed;
+                network.refresh(chess.getData(), simdRefreshed);
+                simdSame = simdSame && sameAccumulator(simdRefreshed, refreshed) && network.evaluate(refreshed) == scalar;
+            }
+            NnueNetwork::setSimd(savedSimd);
+        }
+        t.expect(updateSame, "incremental accumulator equals a fresh refresh after every move");
+        t.expect(simdSame, "AVX2, SSE2 and scalar kernels give the same accumulator and score");
+    });
+
+    harness.runCase("rule1_position_rank_round_trip", [](CaseContext& t) {
+        NineChess chess;
+        playRule1MillAndCapture(t, chess, "(1,3)");
+
+        const NineChess::PositionClass positionClass = chess.getPositionClass();
+        const uint64_t rank = chess.rankPosition();
+        t.expect(positionClass.forbiddenCount == 1u, "position class counts the forbidden point");
+        t.expect(rank < NineChess::positionClassSize(positionClass), "rank lies inside its class");
+
+        NineChess restored;
+        restored.setRule(1);
+        t.expect(restored.unrankPosition(positionClass, rank), "canonical rank can be unranked");
+        t.expect(restored.rankPosition() == rank, "unranked position has the same rank");
+        t.expect(restored.getTurn() == chess.getTurn() && restored.getPhase() == chess.getPhase(),
+            "unranked position keeps phase and turn");
+        t.expect(restored.getData().getPlayer1InHand() == chess.getData().getPlayer1InHand()
+            && restored.getData().getPlayer2InHand() == chess.getData().getPlayer2InHand(),
+            "unranked position keeps pieces in hand");
+
+        chess.mirror();
+        t.expect(chess.rankPosition() == rank, "mirrored position shares the rank");
+        chess.rotate(90);
+        t.expect(chess.rankPosition() == rank, "rotated position shares the rank");
+        chess.turn();
+        t.expect(chess.rankPosition() == rank, "inside-out position shares the rank");
+
+        bool allCanonical = true;
+        uint64_t canonicalCount = 0;
+        const uint64_t size = NineChess::boardClassSize(3u, 2u, 1u);
+        for (uint64_t i = 0; i < size; ++i) {
+            uint32_t first = 0u;
+            uint32_t second = 0u;
+            uint32_t third = 0u;
+            if (!NineChess::unrankBoards(3u, 2u, 1u, i, first, second, third)) {
+                continue;
+            }
+            ++canonicalCount;
+            allCanonical = allCanonical && (first & second) == 0u && (first & third) == 0u && (second & third) == 0u
+                && NineChess::rankBoards(first, second, third) == i;
+        }
+        t.expect(allCanonical && canonicalCount > size / 16u, "every canonical board rank round-trips");
+    });
+
+    harness.runCase("rule1_packed_lite_round_trips", [](CaseContext& t) {
+        NineChess chess;
+        playRule1MillAndCapture(t, chess, "(1,3)");
+
+        const NineChess::ChessData& data = chess.getData();
+        const uint64_t packed = data.packLite();
+        t.expect(packed == data.getHashLite(), "packed word equals the lite hash");
+
+        NineChess::ChessData restored;
+        restored.numberBoards[0] = 1u;
+        t.expect(restored.unpackLite(packed), "packed word unpacks");
+        t.expect(restored.player1Board == data.player1Board && restored.player2Board == data.player2Board
+            && restored.forbiddenBoard == data.forbiddenBoard && restored.status == data.status
+            && restored.numberBoards[0] == 0u, "unpacked data matches the original");
+        t.expect(!restored.unpackLite(packed | (1ULL << 63)) && restored.packLite() == packed,
+            "reserved bits are rejected without touching the data");
+    });
+
+    harness.runCase("rule1_canonical_hash_is_symmetry_invariant", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(1);
+        chess.start();
+
+        t.expectCommand(chess, "(0,7)", true, "player1 places first point");
+        t.expectCommand(chess, "(1,2)", true, "player2 places first point");
+        t.expectCommand(chess, "(2,3)", true, "player1 places second point");
+
+        bool posRoundTrip = true;
+        for (uint32_t symmetry = 0; symmetry < NineChess::SYMMETRY_COUNT; ++symmetry) {
+            for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+                posRoundTrip = posRoundTrip
+                    && NineChess::inverseSymmetryPos(NineChess::symmetryPos(pos, symmetry), symmetry) == pos;
+            }
+        }
+        t.expect(posRoundTrip, "symmetry point maps invert each other");
+
+        uint32_t canonicalSymmetry = 0u;
+        const uint64_t canonical = chess.getCanonicalHash(&canonicalSymmetry);
+        bool invariant = true;
+        for (uint32_t symmetry = 0; symmetry < NineChess::SYMMETRY_COUNT; ++symmetry) {
+            NineChess variant(chess);
+            variant.applySymmetry(symmetry);
+            invariant = invariant && variant.getCanonicalHash() == canonical;
+        }
+        t.expect(invariant, "every symmetric variant shares the canonical hash");
+
+        chess.applySymmetry(canonicalSymmetry);
+        t.expect(chess.getHash() == canonical, "reported symmetry reaches the canonical hash");
+    });
+
+    harness.runCase("rule1_position_copy_follows_game", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(1);
+        chess.start();
+
+        t.expectCommand(chess, "(0,7)", true, "player1 places first point");
+        Position position(chess);
+        t.expectCommand(chess, "(1,2)", true, "player2 places first point");
+        t.expect(position.getHash() != chess.getHash(), "copied position does not follow the game");
+
+        t.expect(position.placePos(posOf(chess, 1, 2)), "copied position accepts the same placement");
+        t.expect(position.getHash() == chess.getHash(), "copied position reaches the same hash");
+        t.expect(position.getTurn() == chess.getTurn(), "copied position reaches the same turn");
+    });
+
+    harness.runCase("rule1_rule_traits_match_runtime_tables", [](CaseContext& t) {
+        using Traits = RuleTraits<1>;
+        const Rule& rule = Position::rules[1];
+        const RuleTables& tables = Position::ruleTables(1);
+
+        t.expect(Traits::piecesPerSide == rule.piecesPerSide && Traits::minPiecesToSurvive == rule.minPiecesToSurvive,
+            "traits piece counts match the rule");
+        t.expect(Traits::hasDiagonalLines == rule.hasDiagonalLines && Traits::hasForbiddenPoints == rule.hasForbiddenPoints
+            && Traits::defenderMovesFirst == rule.defenderMovesFirst && Traits::allowRepeatedMills == rule.allowRepeatedMills
+            && Traits::allowMultiCapture == rule.allowMultiCapture && Traits::fullBoardIsLoss == rule.fullBoardIsLoss
+            && Traits::blockedIsLoss == rule.blockedIsLoss && Traits::allowFlying == rule.allowFlying,
+            "traits flags match the rule");
+
+        bool same = Traits::lineCount == tables.lineCount;
+        for (int32_t pos = 0; pos < BOARD_SIZE; ++pos) {
+            same = same && Traits::moveMask(pos) == tables.moveMask[pos] && Traits::posLineCount(pos) == tables.posLineCount[pos];
+            for (uint32_t i = 0; i < tables.posLineCount[pos]; ++i) {
+                same = same && Traits::posLineId(pos, i) == tables.posLineIds[pos][i];
+            }
+        }
+        for (uint32_t lineId = 0; lineId < tables.lineCount; ++lineId) {
+            same = same && Traits::lineMask(lineId) == tables.lineMasks[lineId]
+                && Traits::linePos(lineId, 0) == tables.linePos[lineId][0]
+                && Traits::linePos(lineId, 2) == tables.linePos[lineId][2];
+        }
+        t.expect(same, "compile-time tables match the runtime tables");
+    });
+
+    harness.runCase("rule1_position_batch_matches_single_positions", [](CaseContext& t) {
+        checkPositionBatch(t, 1u);
+    });
+
+    harness.runCase("rule1_move_history_transforms_and_replays", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(1);
+        chess.start();
+
+        t.expectCommand(chess, "(0,7)", true, "player1 places first point");
+        t.expectCommand(chess, "(1,2)", true, "player2 places first point");
+        t.expectCommand(chess, "(2,3)", true, "player1 places second point");
+        t.expect(chess.getHistorySize() == 3u, "history keeps one record per command");
+
+        chess.mirror();
+        const std::vector<std::string> history = chess.getCmdHistory();
+        t.expect(history.size() == 3u && history[0] == "(0,1)" && history[1] == "(1,6)" && history[2] == "(2,5)",
+            "mirror rewrites every history record");
+        t.expect(chess.getCmdLine() == "(2,5)", "mirror rewrites the last command");
+
+        NineChess replay;
+        replay.setRule(1);
+        replay.start();
+        bool replayed = true;
+        for (const NineChess::MoveRecord record : chess.getMoveHistory()) {
+            replayed = replayed && replay.playMoveRecord(record);
+        }
+        t.expect(replayed, "every history record replays");
+        t.expect(replay.getHash() == chess.getHash(), "replayed records reach the same position");
+    });
+
+    harness.runCase("rule1_manual_decodes_command_history", [](CaseContext& t) {
+        NineChess chess;
+        playRule1MillAndCapture(t, chess, "(1,3)");
+
+        std::string manual;
+        for (const std::string& line : chess.getCmdHistory()) {
+            manual += line + "\r\n";
+        }
+        manual += "\n  \n";
+
+        std::vector<NineChess::MoveRecord> moves;
+        t.expect(NineChess::decodeManual(manual, moves) && moves == chess.getMoveHistory(),
+            "decoded manual equals the move history");
+
+        moves.clear();
+        NineChess::ManualError error;
+        t.expect(!NineChess::decodeManual("(0,7)\n\n  (0,2)->x\n(0,0)", moves, &error)
+            && error.line == 3u && error.column == 10u, "bad line reports line and column");
+        t.expect(moves.size() == 1u, "records before the bad line are kept");
+    });
+
     harness.runCase("rule1_diagonal_cross_ring_mill_is_valid", [](CaseContext& t) {
         NineChess chess;
         chess.setRule(1);
@@ -362,6 +911,43 @@ void runRule2(Harness& harness)
         t.expect(chess.getData().millHistory.size() == 1u, "mill history stays unchanged");
     });
 
+    harness.runCase("rule2_packed_data_round_trips", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(2);
+        setupMidgame(chess, NineChess::PLAYER1,
+            toVector({ posOf(chess, 0, 7), posOf(chess, 0, 0), posOf(chess, 0, 1), posOf(chess, 2, 4) }),
+            toVector({ posOf(chess, 0, 3), posOf(chess, 0, 5), posOf(chess, 0, 6) }),
+            true);
+        chess.getData().millHistory.push_back(makeMillKey(true, 5u, 2u, 0u, 1u));
+        chess.getData().millHistory.push_back(makeMillKey(false, 0u, 0u, 1u, 2u));
+
+        t.expectCommand(chess, "(2,4)->(2,3)", true, "player1 makes a quiet move");
+        t.expectCommand(chess, "(0,6)->(1,6)", true, "player2 makes a quiet reply");
+
+        const NineChess::ChessData& data = chess.getData();
+        PackedChessData packed;
+        data.pack(packed);
+        t.expect(packed.board == data.packLite(), "packed board equals the lite word");
+
+        NineChess::ChessData restored;
+        restored.millHistory.push_back(MILL_KEY_NONE);
+        t.expect(restored.unpack(packed), "packed data unpacks");
+        bool layersSame = true;
+        for (int i = 0; i < NUMBERED_PIECE_COUNT; ++i) {
+            layersSame = layersSame && restored.numberBoards[i] == data.numberBoards[i];
+        }
+        t.expect(restored.player1Board == data.player1Board && restored.player2Board == data.player2Board
+            && restored.status == data.status, "unpacked main boards and status match");
+        t.expect(layersSame, "unpacked number layers match");
+        t.expect(restored.millHistory == data.millHistory, "unpacked mill history keeps its order");
+        t.expect(restored.getHashHard() == data.getHashHard(), "unpacked data has the same hard hash");
+
+        PackedChessData corrupt = packed;
+        corrupt.numbers[0] |= 0x1fu;
+        t.expect(!restored.unpack(corrupt) && restored.millHistory == data.millHistory,
+            "out-of-range layer code is rejected without touching the data");
+    });
+
     harness.runCase("rule2_blocked_turn_is_skipped", [](CaseContext& t) {
         NineChess chess;
         chess.setRule(2);
@@ -380,6 +966,39 @@ void runRule2(Harness& harness)
         t.expect(chess.getAction() == NineChess::ACTION_CHOOSE, "game continues in choose action");
     });
 
+    harness.runCase("rule2_solver_passes_blocked_turn", [](CaseContext& t) {
+        NineChess blockedIsLoss;
+        blockedIsLoss.setRule(0);
+        const std::vector<int> player1 = toVector({
+            posOf(blockedIsLoss, 0, 0), posOf(blockedIsLoss, 0, 2),
+            posOf(blockedIsLoss, 0, 4), posOf(blockedIsLoss, 0, 6)
+        });
+        const std::vector<int> player2 = toVector({
+            posOf(blockedIsLoss, 0, 1), posOf(blockedIsLoss, 0, 3), posOf(blockedIsLoss, 0, 5)
+        });
+        NineChess_Solver solver(4);
+        SolverLimits limits;
+        limits.maxNodes = 1000000u;
+
+        setupMidgame(blockedIsLoss, NineChess::PLAYER2, player1, player2);
+        t.expect(solver.solve(blockedIsLoss, NineChess::PLAYER1, limits) == SOLVER_PROVEN && solver.nodes() == 1u,
+            "blocked side to move loses at once in rule0");
+
+        NineChess chess;
+        chess.setRule(2);
+        setupMidgame(chess, NineChess::PLAYER2, player1, player2, true);
+        t.expect(solver.solve(chess, NineChess::PLAYER2, limits) == SOLVER_DISPROVEN,
+            "blocked side cannot force a win in rule2");
+        t.expect(solver.solve(chess, NineChess::PLAYER1, limits) == SOLVER_PROVEN && solver.nodes() > 1u,
+            "blocked side passes instead of losing in rule2");
+
+        NineChess passed(chess);
+        passed.getData().setTurn(NineChess::PLAYER1);
+        t.expect(solver.solve(passed, NineChess::PLAYER1, limits) == SOLVER_PROVEN,
+            "position after the pass is a proven win");
+        t.expectCommand(passed, solver.bestMove().c_str(), true, "proof move is legal");
+    });
+
     harness.runCase("rule2_double_mill_requires_two_captures", [](CaseContext& t) {
         NineChess chess;
         chess.setRule(2);
@@ -484,6 +1103,37 @@ void runRule3(Harness& harness)
         t.expect(chess.getTurn() == NineChess::PLAYER2, "turn passes to player2 after flying");
     });
 
+    harness.runCase("rule3_legal_moves_cover_flying_pieces", [](CaseContext& t) {
+        NineChess chess;
+        chess.setRule(3);
+        const std::vector<int> player1 = toVector({ posOf(chess, 0, 0), posOf(chess, 0, 2), posOf(chess, 0, 4) });
+        const std::vector<int> player2 = toVector({ posOf(chess, 0, 7), posOf(chess, 0, 1), posOf(chess, 0, 3) });
+        setupMidgame(chess, NineChess::PLAYER1, player1, player2);
+        const uint32_t empty = ~(maskOf(player1) | maskOf(player2)) & 0xffffffu;
+
+        MoveBuffer buffer;
+        chess.generateLegal(buffer);
+        t.expect(chess.legalSources() == maskOf(player1), "every flying piece is a legal source");
+        t.expect(chess.legalTargets(posOf(chess, 0, 0)) == empty, "a flying piece reaches every empty point");
+        t.expect(buffer.count == 3u * 18u, "flying moves cover every piece and empty point");
+
+        bool allReplay = true;
+        for (const MoveRecord record : buffer) {
+            NineChess child(chess);
+            allReplay = allReplay && getMoveRecordType(record) == MOVE_RECORD_MOVE && child.playMoveRecord(record);
+        }
+        t.expect(allReplay, "every generated move is accepted");
+
+        t.expectCommand(chess, "(0,0)", true, "player1 selects a piece");
+        chess.generateLegal(buffer);
+        bool fromSelected = buffer.count == 18u;
+        for (const MoveRecord record : buffer) {
+            fromSelected = fromSelected && getMoveRecordFrom(record) == posOf(chess, 0, 0);
+        }
+        t.expect(fromSelected, "selected piece limits the moves to its own");
+        t.expect(chess.legalTargets() == empty, "default targets follow the selected piece");
+    });
+
     harness.runCase("rule3_repeated_mill_can_capture_again", [](CaseContext& t) {
         NineChess chess;
         chess.setRule(3);
@@ -525,6 +1175,10 @@ void runRule3(Harness& harness)
         t.expectCommand(chess, "-(2,2)", false, "second capture must be rejected in rule3");
     });
 
+    harness.runCase("rule3_position_batch_matches_single_positions", [](CaseContext& t) {
+        checkPositionBatch(t, 3u);
+    });
+
     harness.runCase("rule3_blocked_player_loses", [](CaseContext& t) {
         NineChess chess;
         chess.setRule(3);